@@ -70,13 +70,23 @@ pub fn build(b: *std.Build) void {
             "src/core/undo.c",
             "src/core/export.c",
             "src/core/preferences.c",
+            "src/core/spsc_queue.c",
+            "src/core/string_arena.c",
+            "src/core/task_table.c",
+            "src/core/id_bitmap.c",
+            "src/core/profiler.c",
+            "src/core/trace.c",
+            "src/core/model.c",
+            "src/core/row_view.c",
             "src/db/database.c",
+            "src/db/writer.c",
             "src/ui/inbox_view.c",
             "src/ui/sidebar.c",
             "src/ui/help_overlay.c",
             "src/ui/command_palette.c",
             "src/ui/markdown.c",
             "src/ui/launcher.c",
+            "src/ui/profiler_overlay.c",
         },
         .flags = &.{ "-std=c11", "-Wall", "-Wextra" },
     });
@@ -120,6 +130,11 @@ pub fn build(b: *std.Build) void {
             "src/core/task.c",
             "src/core/project.c",
             "src/core/context.c",
+            "src/core/string_arena.c",
+            "src/core/task_table.c",
+            "src/core/id_bitmap.c",
+            "src/core/profiler.c",
+            "src/core/trace.c",
             "src/core/platform.c",
         },
         .flags = &.{ "-std=gnu11", "-Wall", "-Wextra", "-D_POSIX_C_SOURCE=200809L" },
@@ -157,9 +172,19 @@ pub fn build(b: *std.Build) void {
         .files = &.{
             "tests/unit/test_database.c",
             "src/db/database.c",
+            "src/db/writer.c",
+            "src/core/model.c",
+            "src/core/row_view.c",
             "src/core/task.c",
             "src/core/project.c",
             "src/core/context.c",
+            "src/core/platform.c",
+            "src/core/spsc_queue.c",
+            "src/core/string_arena.c",
+            "src/core/task_table.c",
+            "src/core/id_bitmap.c",
+            "src/core/profiler.c",
+            "src/core/trace.c",
         },
         .flags = &.{"-std=c11"},
     });
@@ -171,9 +196,11 @@ pub fn build(b: *std.Build) void {
 
     if (target.result.os.tag == .linux) {
         test_database.root_module.addCMacro("PLATFORM_LINUX", "1");
+        test_database.linkSystemLibrary("pthread");
     } else if (target.result.os.tag == .windows) {
         test_database.root_module.addCMacro("PLATFORM_WINDOWS", "1");
         test_database.root_module.addCMacro("_CRT_SECURE_NO_WARNINGS", "1");
+        test_database.linkSystemLibrary("shell32");
     }
 
     // Integration tests
@@ -187,9 +214,19 @@ pub fn build(b: *std.Build) void {
         .files = &.{
             "tests/integration/test_workflows.c",
             "src/db/database.c",
+            "src/db/writer.c",
+            "src/core/model.c",
+            "src/core/row_view.c",
             "src/core/task.c",
             "src/core/project.c",
             "src/core/context.c",
+            "src/core/platform.c",
+            "src/core/spsc_queue.c",
+            "src/core/string_arena.c",
+            "src/core/task_table.c",
+            "src/core/id_bitmap.c",
+            "src/core/profiler.c",
+            "src/core/trace.c",
         },
         .flags = &.{"-std=c11"},
     });
@@ -201,9 +238,11 @@ pub fn build(b: *std.Build) void {
 
     if (target.result.os.tag == .linux) {
         test_workflows.root_module.addCMacro("PLATFORM_LINUX", "1");
+        test_workflows.linkSystemLibrary("pthread");
     } else if (target.result.os.tag == .windows) {
         test_workflows.root_module.addCMacro("PLATFORM_WINDOWS", "1");
         test_workflows.root_module.addCMacro("_CRT_SECURE_NO_WARNINGS", "1");
+        test_workflows.linkSystemLibrary("shell32");
     }
 
     // Register test steps
@@ -10,6 +10,7 @@
 #include "../db/database.h"
 #include "../core/task.h"
 #include "../core/project.h"
+#include "../core/trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -40,7 +41,13 @@ static int init_database(cli_ctx *ctx) {
         return -1;
     }
     
-    if (db_init(db_path) != 0) {
+    // Short-lived and single-threaded; wait for the GUI if it is mid-commit
+    DbConfig config;
+    db_config_default(&config);
+    config.single_threaded = 1;
+    config.cache_size_kb = 2 * 1024;
+    
+    if (db_init_ex(db_path, &config) != 0) {
         cli_error(ctx, "Error: Could not initialize database: %s\n", db_get_error());
         return -1;
     }
@@ -54,6 +61,21 @@ static int init_database(cli_ctx *ctx) {
     return 0;
 }
 
+// Strings of every task and project a command loads; released on close
+static StringArena strings;
+
+static void close_database(void) {
+    string_arena_free(&strings);
+    db_close();
+}
+
+// Write the session trace, if one was asked for, however the command ends
+static void write_trace(void) {
+    if (trace_stop() != 0) {
+        fprintf(stderr, "Error: Could not write trace: %s\n", trace_get_error());
+    }
+}
+
 // ============================================================
 // Helper Functions
 // ============================================================
@@ -105,9 +127,9 @@ static int cmd_list(cli_ctx *c) {
     Task* tasks = NULL;
     int count = 0;
     
-    if (db_load_tasks(&tasks, &count, filter) != 0) {
+    if (db_load_tasks(&tasks, &count, filter, &strings) != 0) {
         cli_error(c, "Error loading tasks: %s\n", db_get_error());
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -130,7 +152,7 @@ static int cmd_list(cli_ctx *c) {
     cli_print(c, "\nTotal: %d task(s)\n", count);
     
     free(tasks);
-    db_close();
+    close_database();
     return 0;
 }
 
@@ -140,16 +162,13 @@ static int cmd_add(cli_ctx *c) {
     const char* title = cli_arg(c, 0);
     if (!title) {
         cli_error(c, "Error: Task title is required\n");
-        db_close();
+        close_database();
         return 1;
     }
     
-    int task_id = db_insert_task(title, TASK_STATUS_INBOX);
-    if (task_id < 0) {
-        cli_error(c, "Error adding task: %s\n", db_get_error());
-        db_close();
-        return 1;
-    }
+    TaskDraft draft = {0};
+    draft.title = title;
+    draft.status = TASK_STATUS_INBOX;
     
     // Handle optional dates
     const char* defer_str = cli_opt_str(c, "--defer");
@@ -158,8 +177,7 @@ static int cmd_add(cli_ctx *c) {
         if (sscanf(defer_str, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) == 3) {
             tm.tm_year -= 1900;
             tm.tm_mon -= 1;
-            time_t defer_at = mktime(&tm);
-            db_update_task_defer_at(task_id, defer_at);
+            draft.defer_at = mktime(&tm);
         }
     }
     
@@ -169,17 +187,22 @@ static int cmd_add(cli_ctx *c) {
         if (sscanf(due_str, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) == 3) {
             tm.tm_year -= 1900;
             tm.tm_mon -= 1;
-            time_t due_at = mktime(&tm);
-            db_update_task_due_at(task_id, due_at);
+            draft.due_at = mktime(&tm);
         }
     }
     
-    if (cli_opt_bool(c, "--flag")) {
-        db_update_task_flagged(task_id, 1);
+    draft.flagged = cli_opt_bool(c, "--flag") ? 1 : 0;
+    
+    // Task and its attributes are written in one transaction
+    int task_id = db_insert_task_full(&draft);
+    if (task_id < 0) {
+        cli_error(c, "Error adding task: %s\n", db_get_error());
+        close_database();
+        return 1;
     }
     
     cli_print(c, "Task added successfully (ID: %d)\n", task_id);
-    db_close();
+    close_database();
     return 0;
 }
 
@@ -189,23 +212,23 @@ static int cmd_complete(cli_ctx *c) {
     const char* id_str = cli_arg(c, 0);
     if (!id_str) {
         cli_error(c, "Error: Task ID is required\n");
-        db_close();
+        close_database();
         return 1;
     }
     
     int task_id = atoi(id_str);
     if (task_id <= 0) {
         cli_error(c, "Error: Invalid task ID\n");
-        db_close();
+        close_database();
         return 1;
     }
     
     // Load task to check recurrence
     Task* tasks = NULL;
     int count = 0;
-    if (db_load_tasks(&tasks, &count, -1) != 0) {
+    if (db_load_tasks(&tasks, &count, -1, &strings) != 0) {
         cli_error(c, "Error loading tasks: %s\n", db_get_error());
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -220,14 +243,14 @@ static int cmd_complete(cli_ctx *c) {
     if (!task) {
         cli_error(c, "Error: Task not found\n");
         free(tasks);
-        db_close();
+        close_database();
         return 1;
     }
     
     if (db_update_task_status(task_id, TASK_STATUS_DONE) != 0) {
         cli_error(c, "Error completing task: %s\n", db_get_error());
         free(tasks);
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -244,7 +267,7 @@ static int cmd_complete(cli_ctx *c) {
     }
     
     free(tasks);
-    db_close();
+    close_database();
     return 0;
 }
 
@@ -254,25 +277,25 @@ static int cmd_delete(cli_ctx *c) {
     const char* id_str = cli_arg(c, 0);
     if (!id_str) {
         cli_error(c, "Error: Task ID is required\n");
-        db_close();
+        close_database();
         return 1;
     }
     
     int task_id = atoi(id_str);
     if (task_id <= 0) {
         cli_error(c, "Error: Invalid task ID\n");
-        db_close();
+        close_database();
         return 1;
     }
     
     if (db_delete_task(task_id) != 0) {
         cli_error(c, "Error deleting task: %s\n", db_get_error());
-        db_close();
+        close_database();
         return 1;
     }
     
     cli_print(c, "Task deleted successfully\n");
-    db_close();
+    close_database();
     return 0;
 }
 
@@ -282,22 +305,22 @@ static int cmd_show(cli_ctx *c) {
     const char* id_str = cli_arg(c, 0);
     if (!id_str) {
         cli_error(c, "Error: Task ID is required\n");
-        db_close();
+        close_database();
         return 1;
     }
     
     int task_id = atoi(id_str);
     if (task_id <= 0) {
         cli_error(c, "Error: Invalid task ID\n");
-        db_close();
+        close_database();
         return 1;
     }
     
     Task* tasks = NULL;
     int count = 0;
-    if (db_load_tasks(&tasks, &count, -1) != 0) {
+    if (db_load_tasks(&tasks, &count, -1, &strings) != 0) {
         cli_error(c, "Error loading tasks: %s\n", db_get_error());
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -312,7 +335,7 @@ static int cmd_show(cli_ctx *c) {
     if (!task) {
         cli_error(c, "Error: Task not found\n");
         free(tasks);
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -335,14 +358,16 @@ static int cmd_show(cli_ctx *c) {
     cli_print(c, "Recurrence:    %s\n", format_recurrence(task->recurrence, task->recurrence_interval));
     cli_print(c, "Order Index:   %d\n", task->order_index);
     
-    if (task->notes[0] != '\0') {
-        cli_print(c, "\nNotes:\n%s\n", task->notes);
+    char* notes = NULL;
+    if (task->has_notes && db_get_task_notes(task->id, &notes) == 0) {
+        cli_print(c, "\nNotes:\n%s\n", notes);
     }
+    free(notes);
     
     cli_print(c, "\n");
     
     free(tasks);
-    db_close();
+    close_database();
     return 0;
 }
 
@@ -352,9 +377,9 @@ static int cmd_projects(cli_ctx *c) {
     Project* projects = NULL;
     int count = 0;
     
-    if (db_load_projects(&projects, &count) != 0) {
+    if (db_load_projects(&projects, &count, &strings) != 0) {
         cli_error(c, "Error loading projects: %s\n", db_get_error());
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -370,7 +395,7 @@ static int cmd_projects(cli_ctx *c) {
     cli_print(c, "\nTotal: %d project(s)\n", count);
     
     free(projects);
-    db_close();
+    close_database();
     return 0;
 }
 
@@ -380,9 +405,9 @@ static int cmd_today(cli_ctx *c) {
     Task* tasks = NULL;
     int count = 0;
     
-    if (db_load_tasks(&tasks, &count, -1) != 0) {
+    if (db_load_tasks(&tasks, &count, -1, &strings) != 0) {
         cli_error(c, "Error loading tasks: %s\n", db_get_error());
-        db_close();
+        close_database();
         return 1;
     }
     
@@ -422,7 +447,210 @@ static int cmd_today(cli_ctx *c) {
     cli_print(c, "\nTotal: %d task(s) available today\n", today_count);
     
     free(tasks);
-    db_close();
+    close_database();
+    return 0;
+}
+
+static int cmd_changes(cli_ctx *c) {
+    if (init_database(c) != 0) return 1;
+    
+    const char* since_str = cli_arg(c, 0);
+    long long since = since_str ? strtoll(since_str, NULL, 10) : 0;
+    
+    TaskChanges changes;
+    if (db_load_tasks_changed_since(since, &changes, &strings) != 0) {
+        cli_error(c, "Error loading changes: %s\n", db_get_error());
+        close_database();
+        return 1;
+    }
+    
+    if (changes.expired) {
+        cli_print(c, "Some deletions since %lld were forgotten; reload everything.\n", since);
+    }
+    
+    cli_print(c, "%-4s %-10s %-40s %-12s\n", "ID", "STATUS", "TITLE", "MODIFIED");
+    cli_print(c, "----------------------------------------------------------------\n");
+    
+    for (int i = 0; i < changes.task_count; i++) {
+        Task* t = &changes.tasks[i];
+        char modified_str[16];
+        format_date(t->modified_at, modified_str, sizeof(modified_str));
+        cli_print(c, "%-4d %-10s %-40s %-12s\n",
+                  t->id, format_status(t->status), t->title, modified_str);
+    }
+    for (int i = 0; i < changes.deleted_count; i++) {
+        cli_print(c, "%-4d %-10s\n", changes.deleted_ids[i], "DELETED");
+    }
+    
+    cli_print(c, "\nChanged: %d, deleted: %d, sync point: %lld\n",
+              changes.task_count, changes.deleted_count, changes.seq);
+    
+    db_free_task_changes(&changes);
+    close_database();
+    return 0;
+}
+
+// One pass over the queries the GUI runs: every perspective and project,
+// the sidebar lists, and a full and an incremental sync
+static int run_stats_workload(const Project* projects, int project_count) {
+    time_t now = time(NULL);
+    struct tm end_tm = *localtime(&now);
+    end_tm.tm_hour = 23;
+    end_tm.tm_min = 59;
+    end_tm.tm_sec = 59;
+    end_tm.tm_isdst = -1;
+    
+    PerspectiveParams params;
+    memset(&params, 0, sizeof(params));
+    params.now = now;
+    params.end_of_today = mktime(&end_tm);
+    params.review_before = now - (7 * 24 * 60 * 60);
+    
+    for (int kind = PERSPECTIVE_INBOX; kind <= PERSPECTIVE_PROJECT; kind++) {
+        int runs = kind == PERSPECTIVE_PROJECT ? project_count : 1;
+        for (int i = 0; i < runs; i++) {
+            Task* tasks = NULL;
+            int count = 0;
+            params.project_id = kind == PERSPECTIVE_PROJECT ? projects[i].id : 0;
+            if (db_load_perspective((PerspectiveKind)kind, &params, &tasks, &count, &strings) != 0) {
+                return -1;
+            }
+            free(tasks);
+        }
+    }
+    
+    Project* loaded_projects = NULL;
+    Context* contexts = NULL;
+    int count = 0;
+    if (db_load_projects(&loaded_projects, &count, &strings) != 0) {
+        return -1;
+    }
+    free(loaded_projects);
+    if (db_load_contexts(&contexts, &count, &strings) != 0) {
+        return -1;
+    }
+    free(contexts);
+    
+    TaskContextMap map;
+    if (db_load_task_context_map(&map) != 0) {
+        return -1;
+    }
+    task_context_map_free(&map);
+    
+    TaskTable table;
+    task_table_init(&table);
+    int result = db_sync_task_table(&table);
+    if (result == 0) {
+        result = db_sync_task_table(&table);  // Nothing changed: the incremental path
+    }
+    task_table_free(&table);
+    
+    string_arena_reset(&strings);
+    return result;
+}
+
+// Statement text on one line, cut to fit width columns
+static void format_sql(const char* sql, char* out, size_t width) {
+    size_t len = 0;
+    bool space = false;
+    for (const char* c = sql; *c != '\0' && len + 1 < width; c++) {
+        if (*c == ' ' || *c == '\n' || *c == '\t' || *c == '\r') {
+            space = len > 0;
+            continue;
+        }
+        if (space && len + 2 < width) {
+            out[len++] = ' ';
+        }
+        space = false;
+        out[len++] = *c;
+    }
+    out[len] = '\0';
+}
+
+static int cmd_stats(cli_ctx *c) {
+    const char* runs_str = cli_opt_str(c, "--runs");
+    const char* limit_str = cli_opt_str(c, "--limit");
+    const char* slow_str = cli_opt_str(c, "--slow");
+    int runs = runs_str ? atoi(runs_str) : 3;
+    int limit = limit_str ? atoi(limit_str) : 20;
+    if (runs < 1 || limit < 1) {
+        cli_error(c, "Error: --runs and --limit must be at least 1\n");
+        return 1;
+    }
+    
+    if (init_database(c) != 0) return 1;
+    
+    Project* projects = NULL;
+    int project_count = 0;
+    if (db_load_projects(&projects, &project_count, &strings) != 0) {
+        cli_error(c, "Error loading projects: %s\n", db_get_error());
+        close_database();
+        return 1;
+    }
+    
+    // Slow runs are logged to stderr as they happen
+    if (slow_str) {
+        db_set_slow_query_ms(strtod(slow_str, NULL));
+    }
+    db_reset_stmt_stats();
+    db_reset_query_stats();
+    db_set_query_profiling(1);
+    
+    for (int i = 0; i < runs; i++) {
+        if (run_stats_workload(projects, project_count) != 0) {
+            cli_error(c, "Error running queries: %s\n", db_get_error());
+            free(projects);
+            close_database();
+            return 1;
+        }
+    }
+    db_set_query_profiling(0);
+    free(projects);
+    
+    DbQueryStats* stats = (DbQueryStats*)malloc((size_t)limit * sizeof(DbQueryStats));
+    if (stats == NULL) {
+        cli_error(c, "Error: Out of memory\n");
+        close_database();
+        return 1;
+    }
+    int count = db_get_query_stats(stats, limit);
+    
+    cli_print(c, "%6s %8s %10s %8s %8s  %s\n", "CALLS", "ROWS", "TOTAL MS", "AVG MS", "MAX MS", "STATEMENT");
+    cli_print(c, "--------------------------------------------------------------------------------------------\n");
+    
+    for (int i = 0; i < count; i++) {
+        DbQueryStats* q = &stats[i];
+        char sql[56];
+        format_sql(q->sql, sql, sizeof(sql));
+        cli_print(c, "%6llu %8llu %10.3f %8.3f %8.3f  %s\n",
+                  q->calls, q->rows, (double)q->total_ns / 1e6,
+                  (double)q->total_ns / 1e6 / (double)q->calls, (double)q->max_ns / 1e6, sql);
+    }
+    
+    DbStmtStats totals;
+    db_get_stmt_stats(&totals);
+    cli_print(c, "\n%llu statement runs in %.3f ms over %d pass(es), %llu compiled\n",
+              totals.statements, (double)totals.statement_ns / 1e6, runs, totals.prepares);
+    if (slow_str) {
+        cli_print(c, "Slow runs logged: %llu\n", totals.slow_statements);
+    }
+    
+    if (cli_opt_bool(c, "--explain")) {
+        char plan[4096];
+        for (int i = 0; i < count; i++) {
+            cli_print(c, "\n[%d] %s\n", i + 1, stats[i].sql);
+            if (db_explain_query(stats[i].sql, plan, sizeof(plan)) != 0) {
+                cli_print(c, "    (no plan: %s)\n", db_get_error());
+                continue;
+            }
+            for (char* line = strtok(plan, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+                cli_print(c, "    %s\n", line);
+            }
+        }
+    }
+    
+    free(stats);
+    close_database();
     return 0;
 }
 
@@ -431,6 +659,14 @@ static int cmd_today(cli_ctx *c) {
 // ============================================================
 
 int main(int argc, char** argv) {
+    // --trace FILE or SAMFOCUS_TRACE=FILE records a Perfetto trace of the command
+    if (trace_start_from_command_line(&argc, argv, "samfocus-cli") != 0) {
+        fprintf(stderr, "Error: %s\n", trace_get_error());
+        return 1;
+    }
+    trace_name_thread("main");
+    atexit(write_trace);
+    
     cli_app app = {
         .name = "samfocus-cli",
         .version = VERSION,
@@ -503,13 +739,36 @@ int main(int argc, char** argv) {
                 .summary = "Show today's available tasks",
                 .handler = cmd_today,
             },
+            {
+                .route = "changes",
+                .summary = "Show tasks changed since a sync point",
+                .handler = cmd_changes,
+                .args = (cli_arg_def[]){
+                    { .name = "since", .description = "Sync point from a previous run (default 0)", .required = false },
+                },
+                .args_count = 1,
+            },
+            {
+                .route = "stats",
+                .summary = "Profile the GUI's queries and show per-statement timings",
+                .handler = cmd_stats,
+                .options = (cli_option[]){
+                    { .long_name = "--runs", .short_name = "-r", .type = CLI_TYPE_STRING, .description = "Passes over the queries (default 3)" },
+                    { .long_name = "--limit", .short_name = "-n", .type = CLI_TYPE_STRING, .description = "Statements to show, most total time first (default 20)" },
+                    { .long_name = "--slow", .short_name = "-s", .type = CLI_TYPE_STRING, .description = "Log runs slower than this many ms to stderr" },
+                    { .long_name = "--explain", .short_name = "-e", .type = CLI_TYPE_BOOL, .description = "Print each statement's query plan" },
+                },
+                .options_count = 4,
+            },
         ),
         
         .groups = (cli_command_group[]){
             { .name = "TASK MANAGEMENT", .description = "Core task operations", .start_idx = 0, .count = 5 },
             { .name = "ORGANIZATION", .description = "Projects and views", .start_idx = 5, .count = 2 },
+            { .name = "SYNC", .description = "Incremental change tracking", .start_idx = 7, .count = 1 },
+            { .name = "DIAGNOSTICS", .description = "Database performance", .start_idx = 8, .count = 1 },
         },
-        .groups_count = 2,
+        .groups_count = 4,
     };
     
     return cli_run(&app, argc, argv);
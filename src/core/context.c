@@ -1,3 +1,36 @@
 #include "context.h"
+#include <stdlib.h>
 
-// No implementation needed yet - contexts are simple data structures
+const int* task_context_map_get(const TaskContextMap* map, int task_id, int* count) {
+    *count = 0;
+    if (map == NULL || map->offsets == NULL || task_id < 0 || task_id > map->max_task_id) {
+        return NULL;
+    }
+    
+    int start = map->offsets[task_id];
+    *count = map->offsets[task_id + 1] - start;
+    return *count > 0 ? &map->context_ids[start] : NULL;
+}
+
+int task_context_map_has(const TaskContextMap* map, int task_id, int context_id) {
+    int count = 0;
+    const int* ids = task_context_map_get(map, task_id, &count);
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == context_id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void task_context_map_free(TaskContextMap* map) {
+    if (map == NULL) {
+        return;
+    }
+    free(map->offsets);
+    free(map->context_ids);
+    map->offsets = NULL;
+    map->context_ids = NULL;
+    map->max_task_id = -1;
+    map->link_count = 0;
+}
@@ -3,12 +3,43 @@
 
 #include <time.h>
 
-// Context structure (for tags like @home, @computer, @errands)
+// Context structure (for tags like @home, @computer, @errands).
+// name and color are owned by the StringArena the context was loaded into.
 typedef struct {
     int id;
-    char name[64];       // Context name (e.g., "home", "computer", "phone")
-    char color[8];       // Hex color for display (e.g., "#FF5733")
+    const char* name;    // Context name (e.g., "home", "computer", "phone")
+    const char* color;   // Hex color for display (e.g., "#FF5733")
     time_t created_at;
 } Context;
 
+// Task -> context links in compressed sparse row form.
+// The contexts of task t are context_ids[offsets[t] .. offsets[t + 1]).
+typedef struct {
+    int* offsets;        // max_task_id + 2 entries, indexed by task id
+    int* context_ids;    // Flat array of context IDs grouped by task
+    int max_task_id;     // Largest task ID covered by offsets
+    int link_count;      // Number of entries in context_ids
+} TaskContextMap;
+
+/**
+ * Get the context IDs linked to a task.
+ * 
+ * @param count Output pointer to number of context IDs
+ * 
+ * Returns a pointer into the map (not owned by caller), or NULL if none.
+ */
+const int* task_context_map_get(const TaskContextMap* map, int task_id, int* count);
+
+/**
+ * Check if a task is linked to a context.
+ * 
+ * Returns 1 if linked, 0 otherwise.
+ */
+int task_context_map_has(const TaskContextMap* map, int task_id, int context_id);
+
+/**
+ * Release the memory held by a map and reset it to empty.
+ */
+void task_context_map_free(TaskContextMap* map);
+
 #endif // CONTEXT_H
@@ -1,5 +1,9 @@
 #include "export.h"
 #include "platform.h"
+#include "trace.h"
+#include "../db/database.h"
+#include <sqlite3.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -71,6 +75,16 @@ static const char* get_project_name(int project_id, Project* projects, int proje
     return "Unknown";
 }
 
+// Notes aren't part of the loaded rows; fetch them for the tasks that have
+// some. Returns NULL for none, otherwise a string the caller frees.
+static char* load_notes(const Task* t) {
+    char* notes = NULL;
+    if (!t->has_notes || db_get_task_notes(t->id, &notes) != 0) {
+        return NULL;
+    }
+    return notes;
+}
+
 // Export as plain text
 static int export_text(FILE* fp, Task* tasks, int task_count, Project* projects, int project_count) {
     fprintf(fp, "SamFocus Task Export - Text Format\n");
@@ -122,8 +136,10 @@ static int export_text(FILE* fp, Task* tasks, int task_count, Project* projects,
                 fprintf(fp, "\n");
             }
             
-            if (t->notes[0] != '\0') {
-                fprintf(fp, "  Notes: %s\n", t->notes);
+            char* notes = load_notes(t);
+            if (notes != NULL) {
+                fprintf(fp, "  Notes: %s\n", notes);
+                free(notes);
             }
             
             fprintf(fp, "\n");
@@ -188,8 +204,10 @@ static int export_markdown(FILE* fp, Task* tasks, int task_count, Project* proje
                 fprintf(fp, "\n");
             }
             
-            if (t->notes[0] != '\0') {
-                fprintf(fp, "  - **Notes:** %s\n", t->notes);
+            char* notes = load_notes(t);
+            if (notes != NULL) {
+                fprintf(fp, "  - **Notes:** %s\n", notes);
+                free(notes);
             }
             
             fprintf(fp, "\n");
@@ -221,15 +239,14 @@ static int export_csv(FILE* fp, Task* tasks, int task_count, Project* projects,
         
         // Escape quotes in title and notes
         char title_escaped[512];
-        char notes_escaped[2048];
+        char* notes_escaped = load_notes(t);
         snprintf(title_escaped, sizeof(title_escaped), "%s", t->title);
-        snprintf(notes_escaped, sizeof(notes_escaped), "%s", t->notes);
         
         // Replace quotes with double quotes for CSV
         for (int j = 0; title_escaped[j]; j++) {
             if (title_escaped[j] == '"') title_escaped[j] = '\'';
         }
-        for (int j = 0; notes_escaped[j]; j++) {
+        for (int j = 0; notes_escaped != NULL && notes_escaped[j]; j++) {
             if (notes_escaped[j] == '"') notes_escaped[j] = '\'';
         }
         
@@ -256,15 +273,16 @@ static int export_csv(FILE* fp, Task* tasks, int task_count, Project* projects,
                 created_str,
                 modified_str,
                 recur_str,
-                notes_escaped);
+                notes_escaped != NULL ? notes_escaped : "");
+        free(notes_escaped);
     }
     
     return 0;
 }
 
-int export_tasks(const char* filepath, ExportFormat format,
-                 Task* tasks, int task_count,
-                 Project* projects, int project_count) {
+static int write_export(const char* filepath, ExportFormat format,
+                        Task* tasks, int task_count,
+                        Project* projects, int project_count) {
     if (!filepath || !tasks) {
         set_error("Invalid parameters");
         return -1;
@@ -297,7 +315,36 @@ int export_tasks(const char* filepath, ExportFormat format,
     return result;
 }
 
-int export_create_backup(const char* db_path) {
+int export_tasks(const char* filepath, ExportFormat format,
+                 Task* tasks, int task_count,
+                 Project* projects, int project_count) {
+    uint64_t span = trace_begin();
+    int result = write_export(filepath, format, tasks, task_count, projects, project_count);
+    trace_end(span, __func__);
+    return result;
+}
+
+// Pages copied per sqlite3_backup_step() call. Keeps each step short so
+// progress stays fresh, while still moving ~1 MB per step at 4 KB pages.
+#define BACKUP_PAGES_PER_STEP 256
+
+// State shared between the UI thread and the backup thread. The worker
+// writes error and then publishes state with release ordering.
+typedef struct {
+    char db_path[512];
+    char backup_path[512];
+    char error[256];
+    atomic_int state;
+    atomic_int pages_done;
+    atomic_int pages_total;
+    PlatformThread thread;
+    int thread_running;
+} BackupJob;
+
+static BackupJob backup_job = {0};
+
+// Build the timestamped .bak path for a database file
+static int make_backup_path(const char* db_path, char* backup_path, size_t size) {
     if (!db_path) {
         set_error("Invalid database path");
         return -1;
@@ -315,36 +362,152 @@ int export_create_backup(const char* db_path) {
     char timestamp[32];
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", tm_info);
     
-    char backup_path[512];
-    snprintf(backup_path, sizeof(backup_path), "%s.%s.bak", db_path, timestamp);
-    
-    // Copy file
-    FILE* src = fopen(db_path, "rb");
-    if (!src) {
-        set_error("Could not open database for reading");
+    snprintf(backup_path, size, "%s.%s.bak", db_path, timestamp);
+    return 0;
+}
+
+// Copy every page of src into dst, publishing progress to job when given
+static int copy_pages(sqlite3* src, sqlite3* dst, char* err, size_t err_size, BackupJob* job) {
+    // One read transaction across every step pins a single snapshot, so
+    // the copy is consistent and never restarts. In WAL mode this does not
+    // block the app's writer.
+    if (sqlite3_exec(src, "BEGIN; SELECT COUNT(*) FROM sqlite_master;", NULL, NULL, NULL) != SQLITE_OK) {
+        snprintf(err, err_size, "Could not read database: %s", sqlite3_errmsg(src));
         return -1;
     }
     
-    FILE* dst = fopen(backup_path, "wb");
-    if (!dst) {
-        fclose(src);
-        set_error("Could not create backup file");
+    sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+    if (!backup) {
+        snprintf(err, err_size, "Could not start backup: %s", sqlite3_errmsg(dst));
+        sqlite3_exec(src, "COMMIT;", NULL, NULL, NULL);
         return -1;
     }
     
-    char buffer[8192];
-    size_t bytes;
-    while ((bytes = fread(buffer, 1, sizeof(buffer), src)) > 0) {
-        if (fwrite(buffer, 1, bytes, dst) != bytes) {
-            fclose(src);
-            fclose(dst);
-            set_error("Error writing backup file");
-            return -1;
+    int rc;
+    do {
+        rc = sqlite3_backup_step(backup, BACKUP_PAGES_PER_STEP);
+        
+        if (job) {
+            int total = sqlite3_backup_pagecount(backup);
+            atomic_store(&job->pages_total, total);
+            atomic_store(&job->pages_done, total - sqlite3_backup_remaining(backup));
         }
+        
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            platform_sleep_ms(10);
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+    
+    sqlite3_backup_finish(backup);
+    sqlite3_exec(src, "COMMIT;", NULL, NULL, NULL);
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(err, err_size, "Error writing backup file: %s", sqlite3_errstr(rc));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Copy db_path to backup_path with the online backup API. Uses its own
+// connections, so it is safe to run off the UI thread.
+static int run_backup(const char* db_path, const char* backup_path,
+                      char* err, size_t err_size, BackupJob* job) {
+    sqlite3* src = NULL;
+    sqlite3* dst = NULL;
+    int result = -1;
+    
+    if (sqlite3_open_v2(db_path, &src, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        snprintf(err, err_size, "Could not open database for reading: %s", sqlite3_errmsg(src));
+    } else if (sqlite3_open_v2(backup_path, &dst,
+                               SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        snprintf(err, err_size, "Could not create backup file: %s", sqlite3_errmsg(dst));
+    } else {
+        sqlite3_busy_timeout(src, 5000);
+        result = copy_pages(src, dst, err, err_size, job);
     }
     
-    fclose(src);
-    fclose(dst);
+    sqlite3_close(src);
+    sqlite3_close(dst);
     
+    // Don't leave a partial copy behind
+    if (result != 0) {
+        remove(backup_path);
+    }
+    
+    return result;
+}
+
+int export_create_backup(const char* db_path) {
+    char backup_path[512];
+    if (make_backup_path(db_path, backup_path, sizeof(backup_path)) != 0) {
+        return -1;
+    }
+    
+    uint64_t span = trace_begin();
+    int result = run_backup(db_path, backup_path, error_msg, sizeof(error_msg), NULL);
+    trace_end(span, __func__);
+    return result;
+}
+
+static void backup_thread_main(void* arg) {
+    BackupJob* job = arg;
+    trace_name_thread("backup");
+    
+    uint64_t span = trace_begin();
+    int result = run_backup(job->db_path, job->backup_path,
+                            job->error, sizeof(job->error), job);
+    trace_end(span, "backup");
+    
+    atomic_store_explicit(&job->state, result == 0 ? BACKUP_SUCCEEDED : BACKUP_FAILED,
+                          memory_order_release);
+}
+
+int export_start_backup(const char* db_path) {
+    if (backup_job.thread_running) {
+        set_error("A backup is already running");
+        return -1;
+    }
+    
+    if (make_backup_path(db_path, backup_job.backup_path, sizeof(backup_job.backup_path)) != 0) {
+        return -1;
+    }
+    
+    snprintf(backup_job.db_path, sizeof(backup_job.db_path), "%s", db_path);
+    backup_job.error[0] = '\0';
+    atomic_store(&backup_job.pages_done, 0);
+    atomic_store(&backup_job.pages_total, 0);
+    atomic_store(&backup_job.state, BACKUP_RUNNING);
+    
+    if (platform_thread_start(&backup_job.thread, backup_thread_main, &backup_job) != 0) {
+        atomic_store(&backup_job.state, BACKUP_IDLE);
+        set_error("Could not start backup thread");
+        return -1;
+    }
+    
+    backup_job.thread_running = 1;
     return 0;
 }
+
+BackupState export_poll_backup(BackupProgress* progress) {
+    BackupState state = (BackupState)atomic_load_explicit(&backup_job.state, memory_order_acquire);
+    
+    if (progress) {
+        progress->state = state;
+        progress->pages_done = atomic_load(&backup_job.pages_done);
+        progress->pages_total = atomic_load(&backup_job.pages_total);
+        progress->backup_path = backup_job.backup_path;
+        progress->error = backup_job.error;
+    }
+    
+    // Report a finished backup once, then go back to idle
+    if (state == BACKUP_SUCCEEDED || state == BACKUP_FAILED) {
+        if (backup_job.thread_running) {
+            platform_thread_join(backup_job.thread);
+            backup_job.thread_running = 0;
+        }
+        atomic_store(&backup_job.state, BACKUP_IDLE);
+    }
+    
+    return state;
+}
@@ -27,8 +27,9 @@ int export_tasks(const char* filepath, ExportFormat format,
                  Project* projects, int project_count);
 
 /**
- * Create a backup of the entire database.
- * Creates a timestamped .db.bak file.
+ * Create a backup of the entire database and wait for it to finish.
+ * Creates a timestamped .db.bak file from a consistent snapshot using
+ * the SQLite online backup API, so WAL contents are included.
  * 
  * @param db_path Path to the database file
  * 
@@ -36,6 +37,44 @@ int export_tasks(const char* filepath, ExportFormat format,
  */
 int export_create_backup(const char* db_path);
 
+typedef enum {
+    BACKUP_IDLE = 0,
+    BACKUP_RUNNING,
+    BACKUP_SUCCEEDED,
+    BACKUP_FAILED
+} BackupState;
+
+/**
+ * Snapshot of the background backup's progress.
+ */
+typedef struct {
+    BackupState state;
+    int pages_done;
+    int pages_total;            // 0 until the first step has run
+    const char* backup_path;    // Valid until the next backup starts
+    const char* error;          // Set when state is BACKUP_FAILED
+} BackupProgress;
+
+/**
+ * Start backing up the database on a background thread.
+ * Only one backup runs at a time.
+ * 
+ * Returns 0 on success, -1 on error (including one already running).
+ */
+int export_start_backup(const char* db_path);
+
+/**
+ * Poll the background backup.
+ * A finished backup is reported as BACKUP_SUCCEEDED or BACKUP_FAILED
+ * exactly once; its thread is joined then and later polls return
+ * BACKUP_IDLE.
+ * 
+ * @param progress Output snapshot (optional, can be NULL)
+ * 
+ * Returns the backup state.
+ */
+BackupState export_poll_backup(BackupProgress* progress);
+
 /**
  * Get the last error message from export operations.
  */
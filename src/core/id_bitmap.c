@@ -0,0 +1,361 @@
+#include "id_bitmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_MAX 4096          // Bigger containers switch to a bitmap...
+#define ARRAY_MIN 2048          // ...and back once they shrink to this
+#define BITMAP_WORDS 1024       // 65536 bits
+
+struct IdBitmapContainer {
+    uint16_t* values;           // Sorted low bits, or NULL for a bitmap container
+    uint64_t* words;            // BITMAP_WORDS words, or NULL for an array container
+    uint32_t key;               // High 16 bits shared by the IDs
+    int count;
+    int capacity;               // Slots in values
+};
+
+void id_bitmap_init(IdBitmap* bitmap) {
+    memset(bitmap, 0, sizeof(IdBitmap));
+}
+
+static void free_container(IdBitmapContainer* container) {
+    free(container->values);
+    free(container->words);
+}
+
+void id_bitmap_free(IdBitmap* bitmap) {
+    for (int i = 0; i < bitmap->container_count; i++) {
+        free_container(&bitmap->containers[i]);
+    }
+    free(bitmap->containers);
+    memset(bitmap, 0, sizeof(IdBitmap));
+}
+
+void id_bitmap_clear(IdBitmap* bitmap) {
+    for (int i = 0; i < bitmap->container_count; i++) {
+        free_container(&bitmap->containers[i]);
+    }
+    bitmap->container_count = 0;
+    bitmap->count = 0;
+}
+
+int id_bitmap_popcount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+    bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((bits * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the container for key, or -(insertion point) - 1 if there is none
+static int find_container(const IdBitmap* bitmap, uint32_t key) {
+    int lo = 0;
+    int hi = bitmap->container_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t mid_key = bitmap->containers[mid].key;
+        if (mid_key < key) {
+            lo = mid + 1;
+        } else if (mid_key > key) {
+            hi = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+    return -lo - 1;
+}
+
+// Index of value in a sorted array, or -(insertion point) - 1
+static int find_value(const uint16_t* values, int count, uint16_t value) {
+    int lo = 0;
+    int hi = count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (values[mid] < value) {
+            lo = mid + 1;
+        } else if (values[mid] > value) {
+            hi = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+    return -lo - 1;
+}
+
+static int insert_container(IdBitmap* bitmap, int index, uint32_t key) {
+    if (bitmap->container_count >= bitmap->container_capacity) {
+        int new_capacity = bitmap->container_capacity > 0 ? bitmap->container_capacity * 2 : 4;
+        IdBitmapContainer* grown = (IdBitmapContainer*)realloc(
+            bitmap->containers, sizeof(IdBitmapContainer) * new_capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        bitmap->containers = grown;
+        bitmap->container_capacity = new_capacity;
+    }
+    
+    memmove(&bitmap->containers[index + 1], &bitmap->containers[index],
+            sizeof(IdBitmapContainer) * (size_t)(bitmap->container_count - index));
+    memset(&bitmap->containers[index], 0, sizeof(IdBitmapContainer));
+    bitmap->containers[index].key = key;
+    bitmap->container_count++;
+    return 0;
+}
+
+static void drop_container(IdBitmap* bitmap, int index) {
+    free_container(&bitmap->containers[index]);
+    memmove(&bitmap->containers[index], &bitmap->containers[index + 1],
+            sizeof(IdBitmapContainer) * (size_t)(bitmap->container_count - index - 1));
+    bitmap->container_count--;
+}
+
+// Switch a full array container to a bitmap
+static int to_bitmap(IdBitmapContainer* container) {
+    uint64_t* words = (uint64_t*)calloc(BITMAP_WORDS, sizeof(uint64_t));
+    if (words == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < container->count; i++) {
+        uint16_t value = container->values[i];
+        words[value / 64] |= 1ULL << (value % 64);
+    }
+    free(container->values);
+    container->values = NULL;
+    container->capacity = 0;
+    container->words = words;
+    return 0;
+}
+
+// Switch a bitmap container that has shrunk back to a sorted array. Stays
+// a bitmap if out of memory, which is still correct.
+static void to_array(IdBitmapContainer* container) {
+    uint16_t* values = (uint16_t*)malloc(sizeof(uint16_t) * ARRAY_MAX);
+    if (values == NULL) {
+        return;
+    }
+    int n = 0;
+    for (int w = 0; w < BITMAP_WORDS; w++) {
+        uint64_t bits = container->words[w];
+        for (int b = 0; bits != 0; b++, bits >>= 1) {
+            if (bits & 1) {
+                values[n++] = (uint16_t)(w * 64 + b);
+            }
+        }
+    }
+    free(container->words);
+    container->words = NULL;
+    container->values = values;
+    container->capacity = ARRAY_MAX;
+}
+
+// Add a low value to a container. Returns 1 if added, 0 if it was already
+// there, -1 if out of memory.
+static int container_add(IdBitmapContainer* container, uint16_t value) {
+    if (container->words != NULL) {
+        uint64_t bit = 1ULL << (value % 64);
+        if (container->words[value / 64] & bit) {
+            return 0;
+        }
+        container->words[value / 64] |= bit;
+        container->count++;
+        return 1;
+    }
+    
+    int pos = find_value(container->values, container->count, value);
+    if (pos >= 0) {
+        return 0;
+    }
+    pos = -pos - 1;
+    
+    if (container->count >= ARRAY_MAX) {
+        if (to_bitmap(container) != 0) {
+            return -1;
+        }
+        return container_add(container, value);
+    }
+    
+    if (container->count >= container->capacity) {
+        int new_capacity = container->capacity > 0 ? container->capacity * 2 : 4;
+        if (new_capacity > ARRAY_MAX) {
+            new_capacity = ARRAY_MAX;
+        }
+        uint16_t* grown = (uint16_t*)realloc(container->values, sizeof(uint16_t) * new_capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        container->values = grown;
+        container->capacity = new_capacity;
+    }
+    
+    memmove(&container->values[pos + 1], &container->values[pos],
+            sizeof(uint16_t) * (size_t)(container->count - pos));
+    container->values[pos] = value;
+    container->count++;
+    return 1;
+}
+
+int id_bitmap_add(IdBitmap* bitmap, int id) {
+    if (id < 0) {
+        return -1;
+    }
+    
+    uint32_t key = (uint32_t)id >> 16;
+    int index = find_container(bitmap, key);
+    if (index < 0) {
+        index = -index - 1;
+        if (insert_container(bitmap, index, key) != 0) {
+            return -1;
+        }
+    }
+    
+    int added = container_add(&bitmap->containers[index], (uint16_t)(id & 0xFFFF));
+    if (added < 0) {
+        if (bitmap->containers[index].count == 0) {
+            drop_container(bitmap, index);
+        }
+        return -1;
+    }
+    bitmap->count += added;
+    return 0;
+}
+
+void id_bitmap_remove(IdBitmap* bitmap, int id) {
+    if (id < 0) {
+        return;
+    }
+    
+    int index = find_container(bitmap, (uint32_t)id >> 16);
+    if (index < 0) {
+        return;
+    }
+    
+    IdBitmapContainer* container = &bitmap->containers[index];
+    uint16_t value = (uint16_t)(id & 0xFFFF);
+    if (container->words != NULL) {
+        uint64_t bit = 1ULL << (value % 64);
+        if ((container->words[value / 64] & bit) == 0) {
+            return;
+        }
+        container->words[value / 64] &= ~bit;
+        container->count--;
+        if (container->count <= ARRAY_MIN) {
+            to_array(container);
+        }
+    } else {
+        int pos = find_value(container->values, container->count, value);
+        if (pos < 0) {
+            return;
+        }
+        memmove(&container->values[pos], &container->values[pos + 1],
+                sizeof(uint16_t) * (size_t)(container->count - pos - 1));
+        container->count--;
+    }
+    
+    bitmap->count--;
+    if (container->count == 0) {
+        drop_container(bitmap, index);
+    }
+}
+
+int id_bitmap_contains(const IdBitmap* bitmap, int id) {
+    if (id < 0) {
+        return 0;
+    }
+    
+    int index = find_container(bitmap, (uint32_t)id >> 16);
+    if (index < 0) {
+        return 0;
+    }
+    
+    const IdBitmapContainer* container = &bitmap->containers[index];
+    uint16_t value = (uint16_t)(id & 0xFFFF);
+    if (container->words != NULL) {
+        return (container->words[value / 64] >> (value % 64)) & 1;
+    }
+    return find_value(container->values, container->count, value) >= 0;
+}
+
+// Count the values two sorted arrays share. A much smaller array is
+// looked up in the bigger one instead of merging both.
+static int arrays_and_count(const uint16_t* a, int a_count, const uint16_t* b, int b_count) {
+    if (a_count > b_count) {
+        const uint16_t* values = a;
+        a = b;
+        b = values;
+        int count = a_count;
+        a_count = b_count;
+        b_count = count;
+    }
+    
+    int count = 0;
+    if (a_count * 32 < b_count) {
+        for (int i = 0; i < a_count; i++) {
+            count += find_value(b, b_count, a[i]) >= 0;
+        }
+        return count;
+    }
+    
+    int i = 0;
+    int j = 0;
+    while (i < a_count && j < b_count) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (a[i] > b[j]) {
+            j++;
+        } else {
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+static int array_bitmap_and_count(const IdBitmapContainer* array, const IdBitmapContainer* bitmap) {
+    int count = 0;
+    for (int i = 0; i < array->count; i++) {
+        uint16_t value = array->values[i];
+        count += (int)((bitmap->words[value / 64] >> (value % 64)) & 1);
+    }
+    return count;
+}
+
+static int container_and_count(const IdBitmapContainer* a, const IdBitmapContainer* b) {
+    if (a->words != NULL && b->words != NULL) {
+        int count = 0;
+        for (int w = 0; w < BITMAP_WORDS; w++) {
+            count += id_bitmap_popcount(a->words[w] & b->words[w]);
+        }
+        return count;
+    }
+    if (a->words != NULL) {
+        return array_bitmap_and_count(b, a);
+    }
+    if (b->words != NULL) {
+        return array_bitmap_and_count(a, b);
+    }
+    return arrays_and_count(a->values, a->count, b->values, b->count);
+}
+
+int id_bitmap_and_count(const IdBitmap* a, const IdBitmap* b) {
+    int count = 0;
+    int i = 0;
+    int j = 0;
+    while (i < a->container_count && j < b->container_count) {
+        uint32_t a_key = a->containers[i].key;
+        uint32_t b_key = b->containers[j].key;
+        if (a_key < b_key) {
+            i++;
+        } else if (a_key > b_key) {
+            j++;
+        } else {
+            count += container_and_count(&a->containers[i], &b->containers[j]);
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
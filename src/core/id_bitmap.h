@@ -0,0 +1,68 @@
+#ifndef ID_BITMAP_H
+#define ID_BITMAP_H
+
+#include <stdint.h>
+
+typedef struct IdBitmapContainer IdBitmapContainer;
+
+/**
+ * A compressed set of non-negative IDs, laid out like a roaring bitmap.
+ * IDs are grouped by their high 16 bits into containers. A container is a
+ * sorted array of the low 16 bits while it holds up to 4096 IDs, and a
+ * 65536-bit bitmap past that. Sparse sets cost 2 bytes per ID, dense ones
+ * 1 bit, and intersections only visit containers both sets have.
+ * 
+ * A zeroed bitmap is empty and ready to use.
+ */
+typedef struct {
+    IdBitmapContainer* containers;  // Sorted by key, none empty
+    int container_count;
+    int container_capacity;
+    int count;                      // IDs held
+} IdBitmap;
+
+/**
+ * Initialize an empty bitmap.
+ */
+void id_bitmap_init(IdBitmap* bitmap);
+
+/**
+ * Release everything the bitmap holds and leave it empty.
+ */
+void id_bitmap_free(IdBitmap* bitmap);
+
+/**
+ * Remove every ID.
+ */
+void id_bitmap_clear(IdBitmap* bitmap);
+
+/**
+ * Add an ID. Adding one that is already there does nothing.
+ * 
+ * Returns 0 on success, -1 if out of memory or the ID is negative.
+ */
+int id_bitmap_add(IdBitmap* bitmap, int id);
+
+/**
+ * Remove an ID. Does nothing if it isn't there.
+ */
+void id_bitmap_remove(IdBitmap* bitmap, int id);
+
+/**
+ * Check whether the bitmap holds an ID.
+ * 
+ * Returns 1 if it does, 0 if not.
+ */
+int id_bitmap_contains(const IdBitmap* bitmap, int id);
+
+/**
+ * Count the IDs both bitmaps hold, without building the intersection.
+ */
+int id_bitmap_and_count(const IdBitmap* a, const IdBitmap* b);
+
+/**
+ * Count the set bits in a word.
+ */
+int id_bitmap_popcount(uint64_t bits);
+
+#endif // ID_BITMAP_H
@@ -0,0 +1,1317 @@
+#include "model.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void model_init(Model* model, int project_filter, int context_filter) {
+    memset(model, 0, sizeof(Model));
+    model->context_map.max_task_id = -1;
+    model->project_filter = project_filter;
+    model->context_filter = context_filter;
+    model->dirty = MODEL_DIRTY_TASKS | MODEL_DIRTY_PROJECTS | MODEL_DIRTY_CONTEXTS |
+                   MODEL_DIRTY_CONTEXT_LINKS | MODEL_DIRTY_TABLE;
+}
+
+static void free_context_sets(Model* model) {
+    for (int i = 0; i < model->context_set_count; i++) {
+        id_bitmap_free(&model->context_sets[i]);
+    }
+    free(model->context_sets);
+    model->context_sets = NULL;
+    model->context_set_count = 0;
+}
+
+void model_free(Model* model) {
+    free(model->tasks);
+    string_arena_free(&model->task_strings);
+    string_arena_free(&model->project_strings);
+    string_arena_free(&model->context_strings);
+    free(model->task_slots);
+    free(model->projects);
+    free(model->contexts);
+    free(model->leaving);
+    free(model->arriving);
+    for (int i = 0; i < model->queued_notes_count; i++) {
+        free(model->queued_notes[i].text);
+    }
+    free(model->queued_notes);
+    task_context_map_free(&model->context_map);
+    task_table_free(&model->table);
+    free_context_sets(model);
+    free(model->counts.projects);
+    free(model->counts.contexts);
+    memset(model, 0, sizeof(Model));
+    model->context_map.max_task_id = -1;
+}
+
+void model_set_filter(Model* model, int project_filter, int context_filter) {
+    if (model->project_filter != project_filter || model->context_filter != context_filter) {
+        model->project_filter = project_filter;
+        model->context_filter = context_filter;
+        model->dirty |= MODEL_DIRTY_TASKS;
+    }
+}
+
+void model_mark_dirty(Model* model, unsigned bits) {
+    model->dirty |= bits;
+}
+
+Task* model_find_task(const Model* model, int id) {
+    if (id < 0 || id >= model->task_slot_count || model->task_slots[id] < 0) {
+        return NULL;
+    }
+    return &model->tasks[model->task_slots[id]];
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+static int push_id(int** ids, int* count, int* capacity, int id) {
+    if (*count >= *capacity) {
+        int new_capacity = *capacity > 0 ? *capacity * 2 : 16;
+        int* grown = (int*)realloc(*ids, sizeof(int) * new_capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        *ids = grown;
+        *capacity = new_capacity;
+    }
+    (*ids)[(*count)++] = id;
+    return 0;
+}
+
+// Make room in task_slots for IDs up to max_id
+static int reserve_slots(Model* model, int max_id) {
+    if (max_id < model->task_slot_count) {
+        return 0;
+    }
+    
+    int new_count = max_id + 1 > model->task_slot_count * 2 ? max_id + 1 : model->task_slot_count * 2;
+    int* grown = (int*)realloc(model->task_slots, sizeof(int) * new_count);
+    if (grown == NULL) {
+        return -1;
+    }
+    for (int i = model->task_slot_count; i < new_count; i++) {
+        grown[i] = -1;
+    }
+    model->task_slots = grown;
+    model->task_slot_count = new_count;
+    return 0;
+}
+
+// Point each loaded task's slot at its index, from index `from` on
+static void index_tasks_from(Model* model, int from) {
+    for (int i = from; i < model->task_count; i++) {
+        model->task_slots[model->tasks[i].id] = i;
+    }
+}
+
+// Index the links by context, one set of task IDs per context
+static int build_context_sets(Model* model) {
+    const TaskContextMap* map = &model->context_map;
+    int max_context_id = -1;
+    for (int i = 0; i < map->link_count; i++) {
+        if (map->context_ids[i] > max_context_id) {
+            max_context_id = map->context_ids[i];
+        }
+    }
+    if (max_context_id < 0) {
+        return 0;
+    }
+    
+    model->context_sets = (IdBitmap*)calloc((size_t)max_context_id + 1, sizeof(IdBitmap));
+    if (model->context_sets == NULL) {
+        return -1;
+    }
+    model->context_set_count = max_context_id + 1;
+    
+    // Task IDs in order, so every set is built by appending
+    for (int task_id = 0; task_id <= map->max_task_id; task_id++) {
+        for (int i = map->offsets[task_id]; i < map->offsets[task_id + 1]; i++) {
+            int context_id = map->context_ids[i];
+            if (context_id >= 0 && id_bitmap_add(&model->context_sets[context_id], task_id) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int load_task_context_map(Model* model) {
+    task_context_map_free(&model->context_map);
+    free_context_sets(model);
+    model->counts.valid = 0;
+    
+    if (db_load_task_context_map(&model->context_map) != 0) {
+        fprintf(stderr, "Failed to load task contexts: %s\n", db_get_error());
+        return -1;
+    }
+    
+    if (build_context_sets(model) != 0) {
+        fprintf(stderr, "Failed to index task contexts: out of memory\n");
+        free_context_sets(model);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Fill in the time bounds the perspective filters compare against
+static void set_time_params(PerspectiveParams* params, time_t now) {
+    // Today covers anything due up to the end of the local day
+    struct tm end_tm = *localtime(&now);
+    end_tm.tm_hour = 23;
+    end_tm.tm_min = 59;
+    end_tm.tm_sec = 59;
+    end_tm.tm_isdst = -1;
+    
+    params->now = now;
+    params->end_of_today = mktime(&end_tm);
+    params->review_before = now - (7 * 24 * 60 * 60);  // Stale after a week
+}
+
+// Load tasks for the selected perspective or project
+static int load_tasks(Model* model) {
+    free(model->tasks);
+    string_arena_reset(&model->task_strings);
+    model->tasks = NULL;
+    model->task_count = 0;
+    model->leaving_count = 0;
+    model->arriving_count = 0;
+    for (int i = 0; i < model->task_slot_count; i++) {
+        model->task_slots[i] = -1;
+    }
+    
+    time_t now = time(NULL);
+    model->next_defer_boundary = db_get_next_defer_boundary(now);
+    
+    // Read before the query: changes that commit in between are merged
+    // again later, which is harmless
+    if (db_get_change_seq(&model->change_seq) != 0) {
+        fprintf(stderr, "Failed to read change sequence: %s\n", db_get_error());
+        return -1;
+    }
+    
+    PerspectiveParams params = {0};
+    set_time_params(&params, now);
+    params.project_id = model->project_filter;
+    if (model->context_filter > 0) {
+        params.context_ids = &model->context_filter;
+        params.context_count = 1;
+        params.context_match = CONTEXT_MATCH_ANY;
+    }
+    
+    switch (model->project_filter) {
+        case -6: model->kind = PERSPECTIVE_REVIEW; break;
+        case -4: model->kind = PERSPECTIVE_FLAGGED; break;
+        case -3: model->kind = PERSPECTIVE_ANYTIME; break;
+        case -2: model->kind = PERSPECTIVE_COMPLETED; break;
+        case -1: model->kind = PERSPECTIVE_TODAY; break;
+        case 0:  model->kind = PERSPECTIVE_INBOX; break;
+        default: model->kind = PERSPECTIVE_PROJECT; break;
+    }
+    model->params = params;
+    
+    if (db_load_perspective(model->kind, &params, &model->tasks, &model->task_count,
+                            &model->task_strings) != 0) {
+        fprintf(stderr, "Failed to load tasks: %s\n", db_get_error());
+        return -1;
+    }
+    
+    int max_id = -1;
+    for (int i = 0; i < model->task_count; i++) {
+        if (model->tasks[i].id > max_id) {
+            max_id = model->tasks[i].id;
+        }
+    }
+    if (reserve_slots(model, max_id) != 0) {
+        fprintf(stderr, "Failed to index tasks: out of memory\n");
+        return -1;
+    }
+    index_tasks_from(model, 0);
+    
+    return 0;
+}
+
+// Apply task changes to the column table and its indexes
+static int sync_task_table(Model* model) {
+    if (db_sync_task_table(&model->table) != 0) {
+        fprintf(stderr, "Failed to load task table: %s\n", db_get_error());
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Rebuild the table's time-dependent sets once time has moved past one of
+// their boundaries: a defer date, the end of the day or the review age
+static int refresh_time_sets(Model* model) {
+    time_t now = time(NULL);
+    if (model->table.next_refresh > 0 && now < model->table.next_refresh) {
+        return 0;
+    }
+    
+    PerspectiveParams params;
+    set_time_params(&params, now);
+    if (task_table_set_time(&model->table, now, params.end_of_today, params.review_before) != 0) {
+        fprintf(stderr, "Failed to index tasks: out of memory\n");
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int load_projects(Model* model) {
+    free(model->projects);
+    string_arena_reset(&model->project_strings);
+    model->projects = NULL;
+    model->project_count = 0;
+    
+    if (db_load_projects(&model->projects, &model->project_count, &model->project_strings) != 0) {
+        fprintf(stderr, "Failed to load projects: %s\n", db_get_error());
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int load_contexts(Model* model) {
+    free(model->contexts);
+    string_arena_reset(&model->context_strings);
+    model->contexts = NULL;
+    model->context_count = 0;
+    
+    if (db_load_contexts(&model->contexts, &model->context_count, &model->context_strings) != 0) {
+        fprintf(stderr, "Failed to load contexts: %s\n", db_get_error());
+        return -1;
+    }
+    
+    return 0;
+}
+
+// ============================================================================
+// In-memory view maintenance
+// ============================================================================
+
+// Whether a loaded task still belongs in the perspective it was loaded for.
+// Mirrors the perspective filters in database.c. The sequential-project head
+// rule and availability are not re-derived here: they only change with
+// edits that requery the view anyway.
+static int task_in_view(const Model* model, const Task* task) {
+    const PerspectiveParams* params = &model->params;
+    int in_view;
+    
+    switch (model->kind) {
+        case PERSPECTIVE_INBOX:
+            in_view = task->project_id == 0 && task->status != TASK_STATUS_DONE &&
+                      task->defer_at <= params->now;
+            break;
+        case PERSPECTIVE_TODAY:
+            in_view = task->available && task->due_at <= params->end_of_today;
+            break;
+        case PERSPECTIVE_ANYTIME:
+            in_view = task->available;
+            break;
+        case PERSPECTIVE_FLAGGED:
+            in_view = task->flagged && task->status != TASK_STATUS_DONE &&
+                      task->defer_at <= params->now;
+            break;
+        case PERSPECTIVE_COMPLETED:
+            in_view = task->status == TASK_STATUS_DONE;
+            break;
+        case PERSPECTIVE_REVIEW:
+            in_view = task->status != TASK_STATUS_DONE && task->modified_at > 0 &&
+                      task->modified_at < params->review_before;
+            break;
+        case PERSPECTIVE_PROJECT:
+            in_view = task->project_id == params->project_id &&
+                      task->status != TASK_STATUS_DONE && task->defer_at <= params->now;
+            break;
+        default:
+            in_view = 1;
+            break;
+    }
+    
+    if (in_view && model->context_filter > 0) {
+        in_view = task_context_map_has(&model->context_map, task->id, model->context_filter);
+    }
+    return in_view;
+}
+
+// Display order used by the perspective queries
+static int task_before(const Task* a, const Task* b) {
+    if (a->order_index != b->order_index) {
+        return a->order_index < b->order_index;
+    }
+    return a->created_at > b->created_at;
+}
+
+// Queue a task to leave the view at the next sync
+static void drop_task(Model* model, int id) {
+    if (push_id(&model->leaving, &model->leaving_count, &model->leaving_capacity, id) != 0) {
+        // Out of memory: fall back to a full reload
+        model->dirty |= MODEL_DIRTY_TASKS;
+        return;
+    }
+    model->dirty |= MODEL_DIRTY_MEMBERSHIP;
+}
+
+// Queue the task to leave the view if an edit moved it out
+static void recheck_task(Model* model, const Task* task) {
+    if (!task_in_view(model, task)) {
+        drop_task(model, task->id);
+    }
+}
+
+static void remove_leaving_tasks(Model* model) {
+    for (int i = 0; i < model->leaving_count; i++) {
+        int id = model->leaving[i];
+        if (model_find_task(model, id) != NULL) {
+            model->task_slots[id] = -2;  // Marked for removal
+        }
+    }
+    model->leaving_count = 0;
+    
+    int kept = 0;
+    for (int i = 0; i < model->task_count; i++) {
+        int id = model->tasks[i].id;
+        if (model->task_slots[id] == -2) {
+            model->task_slots[id] = -1;
+            continue;
+        }
+        if (kept != i) {
+            model->tasks[kept] = model->tasks[i];
+        }
+        model->task_slots[id] = kept++;
+    }
+    model->task_count = kept;
+}
+
+// Place a task that isn't loaded yet in display order
+static int insert_task(Model* model, const Task* task) {
+    int id = task->id;
+    Task* grown = (Task*)realloc(model->tasks, sizeof(Task) * (model->task_count + 1));
+    if (grown == NULL || reserve_slots(model, id) != 0) {
+        if (grown != NULL) {
+            model->tasks = grown;
+        }
+        return -1;
+    }
+    model->tasks = grown;
+    
+    int pos = 0;
+    while (pos < model->task_count && !task_before(task, &model->tasks[pos])) {
+        pos++;
+    }
+    memmove(&model->tasks[pos + 1], &model->tasks[pos],
+            sizeof(Task) * (size_t)(model->task_count - pos));
+    model->tasks[pos] = *task;
+    model->task_count++;
+    index_tasks_from(model, pos);
+    return 0;
+}
+
+// Fetch a task inserted elsewhere and place it in display order
+static int insert_arriving_task(Model* model, int id) {
+    if (model_find_task(model, id) != NULL) {
+        return 0;
+    }
+    
+    Task task;
+    if (db_get_task(id, &task, &model->task_strings) != 0) {
+        return -1;
+    }
+    if (!task_in_view(model, &task)) {
+        return 0;
+    }
+    
+    return insert_task(model, &task);
+}
+
+// Restore display order after order_index edits. The list is almost sorted,
+// so an insertion sort only moves the edited rows.
+static void sort_tasks(Model* model) {
+    for (int i = 1; i < model->task_count; i++) {
+        if (!task_before(&model->tasks[i], &model->tasks[i - 1])) {
+            continue;
+        }
+        Task moving = model->tasks[i];
+        int j = i;
+        while (j > 0 && task_before(&moving, &model->tasks[j - 1])) {
+            model->tasks[j] = model->tasks[j - 1];
+            model->task_slots[model->tasks[j].id] = j;
+            j--;
+        }
+        model->tasks[j] = moving;
+        model->task_slots[moving.id] = j;
+    }
+}
+
+// ============================================================================
+// Changes from other connections
+// ============================================================================
+
+// Whether a loaded row matches the stored one, apart from the modified_at
+// stamp the database puts on every edit
+static int task_matches(const Task* loaded, const Task* stored) {
+    return loaded->project_id == stored->project_id && loaded->status == stored->status &&
+           loaded->defer_at == stored->defer_at && loaded->due_at == stored->due_at &&
+           loaded->flagged == stored->flagged && loaded->order_index == stored->order_index &&
+           loaded->recurrence == stored->recurrence &&
+           loaded->recurrence_interval == stored->recurrence_interval &&
+           loaded->available == stored->available &&
+           loaded->blocked_by_count == stored->blocked_by_count &&
+           loaded->has_notes == stored->has_notes && strcmp(loaded->title, stored->title) == 0;
+}
+
+// Apply one changed row. Returns 1 if it can't be applied in place and the
+// perspective has to be requeried instead.
+static int merge_changed_task(Model* model, const Task* stored) {
+    Task* loaded = model_find_task(model, stored->id);
+    
+    // Link edits only move a row's modified_at
+    int links_changed = loaded != NULL && stored->modified_at > loaded->modified_at;
+    if (links_changed) {
+        model->dirty |= MODEL_DIRTY_CONTEXT_LINKS;
+    }
+    
+    if (loaded != NULL && task_matches(loaded, stored)) {
+        // Usually our own edit, back from the background writer
+        loaded->modified_at = stored->modified_at;
+        recheck_task(model, loaded);
+        return links_changed && model->context_filter > 0;
+    }
+    
+    // The context filter and the sequential-project head depend on more
+    // than the row itself
+    if (model->context_filter > 0 || model->kind == PERSPECTIVE_PROJECT) {
+        return 1;
+    }
+    
+    if (loaded != NULL) {
+        if (loaded->order_index != stored->order_index) {
+            model->dirty |= MODEL_DIRTY_ORDER;
+        }
+        *loaded = *stored;
+        recheck_task(model, loaded);
+        return 0;
+    }
+    
+    if (task_in_view(model, stored)) {
+        if (insert_task(model, stored) != 0) {
+            return 1;
+        }
+        model->dirty |= MODEL_DIRTY_CONTEXT_LINKS;
+    }
+    return 0;
+}
+
+// Move the next defer boundary up if a changed row is deferred to before it.
+// A boundary left behind by an undeferred task only costs an extra refresh.
+static void note_defer_boundary(Model* model, const Task* task, time_t now) {
+    if (task->status != TASK_STATUS_DONE && task->defer_at > now &&
+        (model->next_defer_boundary == 0 || task->defer_at < model->next_defer_boundary)) {
+        model->next_defer_boundary = task->defer_at;
+    }
+}
+
+// Merge the task rows changed or deleted since change_seq, including rows
+// whose availability triggers re-derived, without rereading the rest
+static int merge_task_changes(Model* model) {
+    // A pending requery picks up every change anyway
+    if (model->dirty & MODEL_DIRTY_TASKS) {
+        return 0;
+    }
+    
+    TaskChanges changes;
+    if (db_load_tasks_changed_since(model->change_seq, &changes, &model->task_strings) != 0) {
+        fprintf(stderr, "Failed to load changed tasks: %s\n", db_get_error());
+        model->dirty |= MODEL_DIRTY_TASKS;
+        return -1;
+    }
+    model->change_seq = changes.seq;
+    
+    time_t now = time(NULL);
+    for (int i = 0; i < changes.task_count; i++) {
+        note_defer_boundary(model, &changes.tasks[i], now);
+    }
+    
+    int requery = changes.expired;
+    for (int i = 0; i < changes.deleted_count && !requery; i++) {
+        if (model_find_task(model, changes.deleted_ids[i]) != NULL) {
+            drop_task(model, changes.deleted_ids[i]);
+        }
+    }
+    for (int i = 0; i < changes.task_count && !requery; i++) {
+        requery = merge_changed_task(model, &changes.tasks[i]);
+    }
+    if (requery) {
+        model->dirty |= MODEL_DIRTY_TASKS;
+    }
+    
+    db_free_task_changes(&changes);
+    return 0;
+}
+
+int model_poll_changes(Model* model) {
+    long long version;
+    if (db_get_data_version(&version) != 0) {
+        return -1;
+    }
+    
+    // The first poll can't tell, so it merges whatever landed since the load
+    if (model->data_version_known && version == model->data_version) {
+        return 0;
+    }
+    
+    model->data_version = version;
+    model->data_version_known = 1;
+    model->dirty |= MODEL_DIRTY_CHANGES;
+    
+    // Most commits, our own writer's included, only touch tasks; the lists
+    // are reloaded when their own counters moved
+    long long projects_seq;
+    long long contexts_seq;
+    if (db_get_list_versions(&projects_seq, &contexts_seq) != 0) {
+        model->list_versions_known = 0;
+        model->dirty |= MODEL_DIRTY_PROJECTS | MODEL_DIRTY_CONTEXTS;
+        return 1;
+    }
+    if (!model->list_versions_known || projects_seq != model->projects_seq) {
+        model->dirty |= MODEL_DIRTY_PROJECTS;
+    }
+    if (!model->list_versions_known || contexts_seq != model->contexts_seq) {
+        model->dirty |= MODEL_DIRTY_CONTEXTS;
+    }
+    model->projects_seq = projects_seq;
+    model->contexts_seq = contexts_seq;
+    model->list_versions_known = 1;
+    return 1;
+}
+
+int model_sync(Model* model) {
+    int result = 0;
+    profile_begin(PROFILE_SYNC);
+    
+    // Whatever makes the view merge or requery also changed task rows
+    if (model->dirty & (MODEL_DIRTY_TASKS | MODEL_DIRTY_CHANGES)) {
+        model->dirty |= MODEL_DIRTY_TABLE;
+    }
+    
+    // Merge first: it can leave other parts dirty. Like a requery, it waits
+    // until our own writes have landed.
+    if ((model->dirty & MODEL_DIRTY_CHANGES) && db_writer_pending() == 0) {
+        model->dirty &= ~MODEL_DIRTY_CHANGES;
+        model->rows_version++;
+        if (merge_task_changes(model) != 0) {
+            result = -1;
+        }
+    }
+    
+    if (model->dirty & MODEL_DIRTY_PROJECTS) {
+        model->dirty &= ~MODEL_DIRTY_PROJECTS;
+        model->rows_version++;
+        if (load_projects(model) != 0) {
+            result = -1;
+        }
+    }
+    
+    if (model->dirty & MODEL_DIRTY_CONTEXTS) {
+        model->dirty &= ~MODEL_DIRTY_CONTEXTS;
+        model->rows_version++;
+        if (load_contexts(model) != 0) {
+            result = -1;
+        }
+    }
+    
+    if (model->dirty & MODEL_DIRTY_CONTEXT_LINKS) {
+        model->dirty &= ~MODEL_DIRTY_CONTEXT_LINKS;
+        model->rows_version++;
+        if (load_task_context_map(model) != 0) {
+            result = -1;
+        }
+    }
+    
+    // Rows read while a write is still queued would undo its optimistic edit
+    if ((model->dirty & MODEL_DIRTY_TASKS) && db_writer_pending() == 0) {
+        model->dirty &= ~(MODEL_DIRTY_TASKS | MODEL_DIRTY_MEMBERSHIP | MODEL_DIRTY_ORDER);
+        model->rows_version++;
+        profile_begin(PROFILE_LOAD_TASKS);
+        if (load_tasks(model) != 0) {
+            result = -1;
+        }
+        profile_end(PROFILE_LOAD_TASKS);
+    }
+    
+    if (model->dirty & MODEL_DIRTY_MEMBERSHIP) {
+        model->dirty &= ~MODEL_DIRTY_MEMBERSHIP;
+        model->rows_version++;
+        remove_leaving_tasks(model);
+        for (int i = 0; i < model->arriving_count; i++) {
+            if (insert_arriving_task(model, model->arriving[i]) != 0) {
+                model->dirty |= MODEL_DIRTY_TASKS;
+            }
+        }
+        model->arriving_count = 0;
+    }
+    
+    if (model->dirty & MODEL_DIRTY_ORDER) {
+        model->dirty &= ~MODEL_DIRTY_ORDER;
+        model->rows_version++;
+        sort_tasks(model);
+    }
+    
+    // Read from the database like a requery, so it waits for the writer too
+    if ((model->dirty & MODEL_DIRTY_TABLE) && db_writer_pending() == 0) {
+        model->dirty &= ~MODEL_DIRTY_TABLE;
+        if (sync_task_table(model) != 0) {
+            result = -1;
+        }
+    }
+    if (refresh_time_sets(model) != 0) {
+        result = -1;
+    }
+    
+    profile_end(PROFILE_SYNC);
+    return result;
+}
+
+time_t model_next_wakeup(const Model* model) {
+    time_t wakeup = model->next_defer_boundary;
+    time_t refresh = model->table.next_refresh;
+    if (refresh > 0 && (wakeup == 0 || refresh < wakeup)) {
+        wakeup = refresh;
+    }
+    return wakeup;
+}
+
+void model_task_added(Model* model, int id) {
+    if (push_id(&model->arriving, &model->arriving_count, &model->arriving_capacity, id) != 0) {
+        model->dirty |= MODEL_DIRTY_TASKS;
+        return;
+    }
+    // The new row may carry context links the map doesn't have yet
+    model->dirty |= MODEL_DIRTY_MEMBERSHIP | MODEL_DIRTY_CONTEXT_LINKS | MODEL_DIRTY_TABLE;
+}
+
+static QueuedNotes* find_queued_notes(const Model* model, int id) {
+    for (int i = 0; i < model->queued_notes_count; i++) {
+        if (model->queued_notes[i].task_id == id) {
+            return &model->queued_notes[i];
+        }
+    }
+    return NULL;
+}
+
+static void forget_queued_notes(Model* model, int id) {
+    QueuedNotes* queued = find_queued_notes(model, id);
+    if (queued != NULL) {
+        free(queued->text);
+        *queued = model->queued_notes[--model->queued_notes_count];
+    }
+}
+
+// Once no write is outstanding, the database has the newest notes
+static void drop_landed_notes(Model* model) {
+    if (db_writer_pending() > 0) {
+        return;
+    }
+    for (int i = 0; i < model->queued_notes_count; i++) {
+        free(model->queued_notes[i].text);
+    }
+    model->queued_notes_count = 0;
+}
+
+// Keep the text of a queued notes write. Out of memory, older text for the
+// task is forgotten too, and reads go back to the database.
+static void remember_notes(Model* model, int id, const char* notes) {
+    size_t len = strlen(notes != NULL ? notes : "");
+    char* text = (char*)malloc(len + 1);
+    if (text == NULL) {
+        forget_queued_notes(model, id);
+        return;
+    }
+    memcpy(text, notes != NULL ? notes : "", len + 1);
+    
+    QueuedNotes* queued = find_queued_notes(model, id);
+    if (queued == NULL) {
+        if (model->queued_notes_count == model->queued_notes_capacity) {
+            int capacity = model->queued_notes_capacity > 0 ? model->queued_notes_capacity * 2 : 4;
+            QueuedNotes* grown = (QueuedNotes*)realloc(model->queued_notes,
+                                                       sizeof(QueuedNotes) * capacity);
+            if (grown == NULL) {
+                free(text);
+                forget_queued_notes(model, id);
+                return;
+            }
+            model->queued_notes = grown;
+            model->queued_notes_capacity = capacity;
+        }
+        queued = &model->queued_notes[model->queued_notes_count++];
+        queued->task_id = id;
+        queued->text = NULL;
+    }
+    
+    free(queued->text);
+    queued->text = text;
+}
+
+void model_on_write_complete(Model* model, const DbWriteResult* result) {
+    if (result->kind == DB_WRITE_TASK_NOTES && result->result != 0) {
+        forget_queued_notes(model, result->id);
+    }
+    drop_landed_notes(model);
+    
+    if (result->result != 0) {
+        // Reload so the view drops the edit that didn't stick
+        model->dirty |= MODEL_DIRTY_TASKS;
+        if (result->kind >= DB_WRITE_PROJECT_TITLE && result->kind <= DB_WRITE_PROJECT_DELETE) {
+            model->dirty |= MODEL_DIRTY_PROJECTS;
+        } else if (result->kind == DB_WRITE_CONTEXT_DELETE) {
+            model->dirty |= MODEL_DIRTY_CONTEXTS | MODEL_DIRTY_CONTEXT_LINKS;
+        }
+        return;
+    }
+    
+    switch (result->kind) {
+        case DB_WRITE_TASK_ADD_CONTEXT:
+        case DB_WRITE_TASK_REMOVE_CONTEXT:
+            model->dirty |= MODEL_DIRTY_CONTEXT_LINKS;
+            if (model->context_filter > 0) {
+                model->dirty |= MODEL_DIRTY_TASKS;
+            }
+            break;
+        case DB_WRITE_PROJECT_DELETE:
+            // The project's tasks moved back to the inbox
+            model->dirty |= MODEL_DIRTY_PROJECTS | MODEL_DIRTY_CHANGES;
+            break;
+        case DB_WRITE_CONTEXT_DELETE:
+            // Deleting a context drops its task links too
+            model->dirty |= MODEL_DIRTY_CONTEXTS | MODEL_DIRTY_CONTEXT_LINKS;
+            if (model->context_filter > 0) {
+                model->dirty |= MODEL_DIRTY_TASKS;
+            }
+            break;
+        case DB_WRITE_TASK_INSERT:
+            model_task_added(model, result->id);
+            break;
+        case DB_WRITE_PROJECT_INSERT:
+            model->dirty |= MODEL_DIRTY_PROJECTS;
+            model->added_project_id = result->id;
+            break;
+        case DB_WRITE_CONTEXT_INSERT:
+            model->dirty |= MODEL_DIRTY_CONTEXTS;
+            break;
+        case DB_WRITE_DEPENDENCY_ADD:
+        case DB_WRITE_DEPENDENCY_REMOVE:
+        case DB_WRITE_REFRESH_AVAILABILITY:
+            // Availability and dependency counts of rows no edit touched
+            model->dirty |= MODEL_DIRTY_TASKS;
+            break;
+        default:
+            // Applied in place, or merged from the changed rows
+            break;
+    }
+}
+
+// ============================================================================
+// Optimistic edits
+// ============================================================================
+
+// Triggers re-derive availability on this edit, possibly of other rows
+// too. Those rows are merged once the write lands.
+static void expect_derived_changes(Model* model) {
+    model->dirty |= MODEL_DIRTY_CHANGES;
+}
+
+// Copy a task's row out of the column table to edit it, with modified_at
+// restamped as the database does on an edit. Returns 0 if the table
+// doesn't hold the task yet.
+static int begin_table_edit(Model* model, int id, Task* row) {
+    if (!task_table_get(&model->table, id, row)) {
+        return 0;
+    }
+    row->modified_at = time(NULL);
+    return 1;
+}
+
+// Store an edited row, updating the set indexes with it
+static void end_table_edit(Model* model, const Task* row) {
+    if (task_table_put(&model->table, row) != 0) {
+        // Out of memory: reload the table once the write lands
+        model->table.seq = 0;
+        model->dirty |= MODEL_DIRTY_TABLE;
+    }
+}
+
+// For edits to fields the column table doesn't keep
+static void touch_table_row(Model* model, int id) {
+    Task row;
+    if (begin_table_edit(model, id, &row)) {
+        end_table_edit(model, &row);
+    }
+}
+
+// Stamp modified_at as the database does on an edit; the task may leave
+// the Review perspective
+static void touch_task(Model* model, Task* task) {
+    task->modified_at = time(NULL);
+    model->rows_version++;
+    recheck_task(model, task);
+}
+
+static void edit_status(Model* model, int id, TaskStatus status) {
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->status = status;
+        if (status == TASK_STATUS_DONE) {
+            task->available = 0;
+        }
+        touch_task(model, task);
+    }
+}
+
+int model_set_task_status(Model* model, int id, TaskStatus status) {
+    if (db_writer_set_task_status(id, status) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    edit_status(model, id, status);
+    return 0;
+}
+
+int model_set_task_title(Model* model, int id, const char* title) {
+    if (db_writer_set_task_title(id, title) != 0) {
+        return -1;
+    }
+    touch_table_row(model, id);
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        const char* copy = string_arena_intern(&model->task_strings, title, strlen(title));
+        if (copy == NULL) {
+            // Out of memory: reread the title once the write lands
+            model->dirty |= MODEL_DIRTY_TASKS;
+            return 0;
+        }
+        task->title = copy;
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_set_task_notes(Model* model, int id, const char* notes) {
+    if (db_writer_set_task_notes(id, notes) != 0) {
+        return -1;
+    }
+    // Applied already when there is no writer thread
+    if (db_writer_pending() > 0) {
+        remember_notes(model, id, notes);
+    }
+    touch_table_row(model, id);
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->has_notes = (notes != NULL && notes[0] != '\0');
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_get_task_notes(Model* model, int id, char** notes) {
+    drop_landed_notes(model);
+    
+    // The database would still have the text from before the queued edit
+    QueuedNotes* queued = find_queued_notes(model, id);
+    if (queued == NULL) {
+        return db_get_task_notes(id, notes);
+    }
+    
+    size_t len = strlen(queued->text);
+    *notes = (char*)malloc(len + 1);
+    if (*notes == NULL) {
+        return -1;
+    }
+    memcpy(*notes, queued->text, len + 1);
+    return 0;
+}
+
+static void edit_flagged(Model* model, int id, int flagged) {
+    Task row;
+    if (begin_table_edit(model, id, &row)) {
+        row.flagged = flagged;
+        end_table_edit(model, &row);
+    }
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->flagged = flagged;
+        touch_task(model, task);
+    }
+}
+
+int model_set_task_flagged(Model* model, int id, int flagged) {
+    if (db_writer_set_task_flagged(id, flagged) != 0) {
+        return -1;
+    }
+    edit_flagged(model, id, flagged);
+    return 0;
+}
+
+int model_set_task_defer_at(Model* model, int id, time_t defer_at) {
+    if (db_writer_set_task_defer_at(id, defer_at) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->defer_at = defer_at;
+        if (defer_at > time(NULL)) {
+            task->available = 0;
+        }
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_set_task_due_at(Model* model, int id, time_t due_at) {
+    if (db_writer_set_task_due_at(id, due_at) != 0) {
+        return -1;
+    }
+    
+    Task row;
+    if (begin_table_edit(model, id, &row)) {
+        row.due_at = due_at;
+        end_table_edit(model, &row);
+    }
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->due_at = due_at;
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_set_task_order_index(Model* model, int id, int order_index) {
+    if (db_writer_set_task_order_index(id, order_index) != 0) {
+        return -1;
+    }
+    
+    Task row;
+    if (begin_table_edit(model, id, &row)) {
+        row.order_index = order_index;
+        end_table_edit(model, &row);
+    }
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->order_index = order_index;
+        model->dirty |= MODEL_DIRTY_ORDER;
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_assign_task_to_project(Model* model, int id, int project_id) {
+    if (db_writer_assign_task_to_project(id, project_id) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->project_id = project_id;
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_set_task_recurrence(Model* model, int id, RecurrencePattern pattern, int interval) {
+    if (db_writer_set_task_recurrence(id, pattern, interval) != 0) {
+        return -1;
+    }
+    touch_table_row(model, id);
+    
+    Task* task = model_find_task(model, id);
+    if (task != NULL) {
+        task->recurrence = pattern;
+        task->recurrence_interval = interval;
+        touch_task(model, task);
+    }
+    return 0;
+}
+
+int model_delete_task(Model* model, int id) {
+    if (db_writer_delete_task(id) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    
+    if (model_find_task(model, id) != NULL) {
+        drop_task(model, id);
+    }
+    return 0;
+}
+
+int model_add_context_to_task(Model* model, int task_id, int context_id) {
+    // Links are stored in a packed map; it is reloaded once the write lands
+    if (db_writer_add_context_to_task(task_id, context_id) != 0) {
+        return -1;
+    }
+    touch_table_row(model, task_id);
+    return 0;
+}
+
+int model_remove_context_from_task(Model* model, int task_id, int context_id) {
+    if (db_writer_remove_context_from_task(task_id, context_id) != 0) {
+        return -1;
+    }
+    touch_table_row(model, task_id);
+    return 0;
+}
+
+int model_set_project_title(Model* model, int id, const char* title) {
+    if (db_writer_set_project_title(id, title) != 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < model->project_count; i++) {
+        if (model->projects[i].id == id) {
+            const char* copy = string_arena_intern(&model->project_strings, title, strlen(title));
+            if (copy == NULL) {
+                model->dirty |= MODEL_DIRTY_PROJECTS;
+                break;
+            }
+            model->projects[i].title = copy;
+            // Task rows show the project's name
+            model->rows_version++;
+            break;
+        }
+    }
+    return 0;
+}
+
+int model_set_project_type(Model* model, int id, ProjectType type) {
+    if (db_writer_set_project_type(id, type) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    
+    for (int i = 0; i < model->project_count; i++) {
+        if (model->projects[i].id == id) {
+            model->projects[i].type = type;
+            break;
+        }
+    }
+    return 0;
+}
+
+int model_delete_project(Model* model, int id) {
+    (void)model;
+    // The sidebar may be iterating the project list; it is reloaded once
+    // the write lands
+    return db_writer_delete_project(id);
+}
+
+int model_delete_context(Model* model, int id) {
+    (void)model;
+    return db_writer_delete_context(id);
+}
+
+int model_set_tasks_status(Model* model, const int* ids, int n, TaskStatus status) {
+    if (db_writer_set_tasks_status(ids, n, status) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    
+    for (int i = 0; i < n; i++) {
+        edit_status(model, ids[i], status);
+    }
+    return 0;
+}
+
+int model_delete_tasks(Model* model, const int* ids, int n) {
+    if (db_writer_delete_tasks(ids, n) != 0) {
+        return -1;
+    }
+    expect_derived_changes(model);
+    
+    for (int i = 0; i < n; i++) {
+        if (model_find_task(model, ids[i]) != NULL) {
+            drop_task(model, ids[i]);
+        }
+    }
+    return 0;
+}
+
+int model_set_tasks_flagged(Model* model, const int* ids, int n, int flagged) {
+    if (db_writer_set_tasks_flagged(ids, n, flagged) != 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        edit_flagged(model, ids[i], flagged);
+    }
+    return 0;
+}
+
+int model_add_dependency(Model* model, int task_id, int depends_on_task_id) {
+    (void)model;
+    return db_writer_add_dependency(task_id, depends_on_task_id);
+}
+
+int model_remove_dependency(Model* model, int task_id, int depends_on_task_id) {
+    (void)model;
+    return db_writer_remove_dependency(task_id, depends_on_task_id);
+}
+
+// Completion of an insert made through the model; it runs even without a
+// writer thread, when no default callback may be set
+static void on_row_inserted(const DbWriteResult* result, void* user_data) {
+    if (result->result != 0) {
+        const char* what = result->kind == DB_WRITE_PROJECT_INSERT ? "project" :
+                           result->kind == DB_WRITE_CONTEXT_INSERT ? "context" : "task";
+        fprintf(stderr, "Failed to add %s: %s\n", what, result->error);
+    }
+    model_on_write_complete((Model*)user_data, result);
+}
+
+int model_insert_task(Model* model, const TaskDraft* draft) {
+    DbWrite write = {0};
+    write.kind = DB_WRITE_TASK_INSERT;
+    write.draft = draft;
+    write.callback = on_row_inserted;
+    write.user_data = model;
+    if (db_writer_submit(&write) != 0) {
+        return -1;
+    }
+    
+    if (draft->context_count > 0) {
+        // Contexts named for the first time are created too
+        model->dirty |= MODEL_DIRTY_CONTEXTS;
+    }
+    return 0;
+}
+
+int model_insert_project(Model* model, const char* title, ProjectType type) {
+    DbWrite write = {0};
+    write.kind = DB_WRITE_PROJECT_INSERT;
+    write.text = title;
+    write.value = type;
+    write.callback = on_row_inserted;
+    write.user_data = model;
+    return db_writer_submit(&write);
+}
+
+int model_insert_context(Model* model, const char* name) {
+    DbWrite write = {0};
+    write.kind = DB_WRITE_CONTEXT_INSERT;
+    write.text = name;
+    write.callback = on_row_inserted;
+    write.user_data = model;
+    return db_writer_submit(&write);
+}
+
+int model_take_added_project(Model* model) {
+    int id = model->added_project_id;
+    model->added_project_id = 0;
+    return id;
+}
+
+// ============================================================================
+// Counts over every task
+// ============================================================================
+
+// Zero a count array for IDs below count
+static int reset_counts(int** counts, int* length, int count) {
+    if (count > *length) {
+        int* grown = (int*)realloc(*counts, sizeof(int) * count);
+        if (grown == NULL) {
+            return -1;
+        }
+        *counts = grown;
+    }
+    *length = count;
+    if (count > 0) {
+        memset(*counts, 0, sizeof(int) * count);
+    }
+    return 0;
+}
+
+// Count every badge. Projects take one pass over the table's columns
+// instead of one set intersection each; perspectives and contexts are
+// intersections of the bitmap indexes.
+static int count_badges(Model* model) {
+    const TaskTable* table = &model->table;
+    ModelCounts* counts = &model->counts;
+    if (reset_counts(&counts->projects, &counts->project_count, table->project_set_count) != 0 ||
+        reset_counts(&counts->contexts, &counts->context_count, model->context_set_count) != 0) {
+        return -1;
+    }
+    
+    // Open is the same test open_set holds, as of the time it was built
+    if (table->next_refresh > 0) {
+        for (int row = 0; row < table->count; row++) {
+            int project_id = table->project_ids[row];
+            if (table->status[row] != TASK_STATUS_DONE && table->defer_at[row] <= table->now &&
+                project_id >= 0 && project_id < counts->project_count) {
+                counts->projects[project_id]++;
+            }
+        }
+    }
+    
+    for (int i = 0; i < counts->context_count; i++) {
+        counts->contexts[i] = id_bitmap_and_count(&table->open_set, &model->context_sets[i]);
+    }
+    
+    counts->perspectives[PERSPECTIVE_INBOX] = counts->project_count > 0 ? counts->projects[0] : 0;
+    counts->perspectives[PERSPECTIVE_TODAY] = id_bitmap_and_count(&table->available_set, &table->due_set);
+    counts->perspectives[PERSPECTIVE_ANYTIME] = table->available_set.count;
+    counts->perspectives[PERSPECTIVE_FLAGGED] = id_bitmap_and_count(&table->open_set, &table->flagged_set);
+    counts->perspectives[PERSPECTIVE_COMPLETED] = table->status_sets[TASK_STATUS_DONE].count;
+    counts->perspectives[PERSPECTIVE_REVIEW] = table->stale_set.count;
+    return 0;
+}
+
+// Recount if the table or the links changed since the last count.
+// Returns 0 if the counts can't be had (out of memory).
+static int counts_current(Model* model) {
+    ModelCounts* counts = &model->counts;
+    if (counts->valid && counts->table_version == model->table.version) {
+        return 1;
+    }
+    
+    if (count_badges(model) != 0) {
+        counts->valid = 0;
+        return 0;
+    }
+    counts->table_version = model->table.version;
+    counts->valid = 1;
+    return 1;
+}
+
+int model_count_tasks(Model* model, PerspectiveKind kind, int project_id) {
+    if (!counts_current(model)) {
+        return 0;
+    }
+    
+    const ModelCounts* counts = &model->counts;
+    if (kind == PERSPECTIVE_PROJECT) {
+        return project_id >= 0 && project_id < counts->project_count ? counts->projects[project_id] : 0;
+    }
+    if (kind >= PERSPECTIVE_INBOX && kind < PERSPECTIVE_PROJECT) {
+        return counts->perspectives[kind];
+    }
+    return 0;
+}
+
+int model_count_context_tasks(Model* model, int context_id) {
+    if (!counts_current(model) || context_id < 0 || context_id >= model->counts.context_count) {
+        return 0;
+    }
+    return model->counts.contexts[context_id];
+}
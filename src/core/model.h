@@ -0,0 +1,278 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "task.h"
+#include "project.h"
+#include "context.h"
+#include "../db/database.h"
+#include "../db/writer.h"
+
+/**
+ * Parts of the model that are stale. Edits update the loaded rows in place
+ * and set only the bits for what they actually invalidated.
+ */
+typedef enum {
+    MODEL_DIRTY_TASKS = 1 << 0,         // Re-run the perspective query
+    MODEL_DIRTY_PROJECTS = 1 << 1,      // Reload the project list
+    MODEL_DIRTY_CONTEXTS = 1 << 2,      // Reload the context list
+    MODEL_DIRTY_CONTEXT_LINKS = 1 << 3, // Reload task -> context links
+    MODEL_DIRTY_ORDER = 1 << 4,         // Re-sort the loaded tasks in memory
+    MODEL_DIRTY_MEMBERSHIP = 1 << 5,    // Drop tasks that left the view, add new ones
+    MODEL_DIRTY_CHANGES = 1 << 6,       // Merge task rows changed after change_seq
+    MODEL_DIRTY_TABLE = 1 << 7          // Bring the column table of every task up to date
+} ModelDirty;
+
+/**
+ * Every sidebar badge, counted together and kept until the task table or
+ * the context links change. See model_count_tasks().
+ */
+typedef struct {
+    int perspectives[PERSPECTIVE_PROJECT];  // Indexed by PerspectiveKind
+    int* projects;              // Project ID -> open tasks, 0 for the inbox
+    int project_count;
+    int* contexts;              // Context ID -> open tasks
+    int context_count;
+    unsigned table_version;     // table.version when counted
+    int valid;                  // 0 once the context links are reloaded
+} ModelCounts;
+
+/**
+ * Notes text submitted to the writer for one task, kept until the write
+ * has landed so it can be read back without waiting.
+ */
+typedef struct {
+    int task_id;
+    char* text;
+} QueuedNotes;
+
+/**
+ * Everything the UI shows, loaded from the database and kept current by
+ * applying edits to it directly.
+ * 
+ * Rows are only edited in place during a frame. Anything that adds,
+ * removes or moves a task waits for model_sync(), so pointers into
+ * tasks stay valid until the next frame.
+ */
+typedef struct {
+    Task* tasks;                // Tasks in the current perspective, in display order
+    int task_count;
+    int* task_slots;            // Task ID -> index into tasks, -1 if not loaded
+    int task_slot_count;
+    StringArena task_strings;   // Titles of the loaded tasks, reset on requery
+    
+    Project* projects;
+    int project_count;
+    StringArena project_strings;
+    Context* contexts;
+    int context_count;
+    StringArena context_strings;
+    TaskContextMap context_map;
+    IdBitmap* context_sets;     // Context ID -> its tasks, rebuilt with context_map
+    int context_set_count;
+    
+    TaskTable table;            // Every task's filter fields and set indexes
+    ModelCounts counts;
+    
+    int project_filter;         // Perspective or project ID (see main.c)
+    int context_filter;         // 0 for no context filter
+    PerspectiveKind kind;
+    PerspectiveParams params;   // Parameters the tasks were loaded with
+    time_t next_defer_boundary; // When the next deferred task becomes available (0 = none)
+    
+    long long data_version;     // Last PRAGMA data_version seen
+    int data_version_known;
+    long long change_seq;       // Task changes up to this sequence number are loaded
+    long long projects_seq;     // Project list version loaded (db_get_list_versions)
+    long long contexts_seq;     // Context list version loaded
+    int list_versions_known;
+    
+    int* leaving;               // Tasks to drop at the next sync
+    int leaving_count;
+    int leaving_capacity;
+    int* arriving;              // Tasks to fetch and insert at the next sync
+    int arriving_count;
+    int arriving_capacity;
+    
+    int added_project_id;       // Project model_insert_project() added, until taken (0 = none)
+    
+    QueuedNotes* queued_notes;  // Newest notes per task while writes are outstanding
+    int queued_notes_count;
+    int queued_notes_capacity;
+    
+    unsigned dirty;             // ModelDirty bits
+    unsigned rows_version;      // Bumped whenever a loaded row, or a name one shows, changes
+} Model;
+
+/**
+ * Initialize an empty model showing the given perspective.
+ * Nothing is loaded until model_sync().
+ */
+void model_init(Model* model, int project_filter, int context_filter);
+
+/**
+ * Release everything the model holds.
+ */
+void model_free(Model* model);
+
+/**
+ * Switch to another perspective or context filter. Marks the tasks dirty
+ * if either changed.
+ */
+void model_set_filter(Model* model, int project_filter, int context_filter);
+
+/**
+ * Mark parts of the model stale.
+ * 
+ * @param bits ModelDirty bits
+ */
+void model_mark_dirty(Model* model, unsigned bits);
+
+/**
+ * Check whether another connection has committed since the last poll:
+ * samfocus-cli, another instance, or this process's background writer.
+ * One pragma read, so it can run every frame. The changes are merged at
+ * the next model_sync(); the project and context lists are only reloaded
+ * if the commit changed them.
+ * 
+ * Returns 1 if something changed, 0 if not, -1 on error.
+ */
+int model_poll_changes(Model* model);
+
+/**
+ * Bring every dirty part of the model up to date. Call once per frame
+ * before rendering. A requery waits until the background writer has no
+ * writes in flight, so it can't read rows from before an edit.
+ * 
+ * Returns 0 on success, -1 if a reload failed.
+ */
+int model_sync(Model* model);
+
+/**
+ * Get the next time the model changes with no edit at all: a deferred
+ * task becomes available, a task goes stale or the day ends. A main loop
+ * that sleeps while idle must wake up by then.
+ * 
+ * Returns the time, or 0 if nothing is scheduled.
+ */
+time_t model_next_wakeup(const Model* model);
+
+/**
+ * Find a loaded task by ID in constant time.
+ * 
+ * Returns the task, or NULL if it isn't in the current perspective.
+ */
+Task* model_find_task(const Model* model, int id);
+
+/**
+ * Account for a finished background write. Context link, dependency and
+ * availability writes and project or context deletions mark what they
+ * changed dirty, and inserted rows are picked up; a failed write reloads
+ * so the view drops the optimistic edit.
+ */
+void model_on_write_complete(Model* model, const DbWriteResult* result);
+
+/**
+ * Pick up a task inserted directly through the database.
+ * It is fetched and placed at the next sync if it belongs in the view.
+ */
+void model_task_added(Model* model, int id);
+
+/**
+ * Optimistic edits: update the loaded copy and queue the write on the
+ * background writer. Each returns 0 on success, -1 if the write could
+ * not be queued (the loaded copy is left unchanged).
+ */
+int model_set_task_status(Model* model, int id, TaskStatus status);
+int model_set_task_title(Model* model, int id, const char* title);
+int model_set_task_notes(Model* model, int id, const char* notes);
+int model_set_task_flagged(Model* model, int id, int flagged);
+int model_set_task_defer_at(Model* model, int id, time_t defer_at);
+int model_set_task_due_at(Model* model, int id, time_t due_at);
+int model_set_task_order_index(Model* model, int id, int order_index);
+int model_assign_task_to_project(Model* model, int id, int project_id);
+int model_set_task_recurrence(Model* model, int id, RecurrencePattern pattern, int interval);
+int model_delete_task(Model* model, int id);
+int model_add_context_to_task(Model* model, int task_id, int context_id);
+int model_remove_context_from_task(Model* model, int task_id, int context_id);
+int model_set_project_title(Model* model, int id, const char* title);
+int model_set_project_type(Model* model, int id, ProjectType type);
+int model_delete_project(Model* model, int id);
+int model_delete_context(Model* model, int id);
+
+/**
+ * Batch edits, queued as one write and applied in one transaction.
+ * Completing a recurring task spawns its next instance, which is merged
+ * once the write lands.
+ */
+int model_set_tasks_status(Model* model, const int* ids, int n, TaskStatus status);
+int model_delete_tasks(Model* model, const int* ids, int n);
+int model_set_tasks_flagged(Model* model, const int* ids, int n, int flagged);
+
+/**
+ * Dependency edits. Availability and dependency counts are reloaded once
+ * the write lands.
+ */
+int model_add_dependency(Model* model, int task_id, int depends_on_task_id);
+int model_remove_dependency(Model* model, int task_id, int depends_on_task_id);
+
+/**
+ * Queue a new task on the background writer. It joins the view through
+ * model_task_added() once the insert lands, so the model must outlive
+ * the write.
+ * 
+ * Returns 0 if queued, -1 on error.
+ */
+int model_insert_task(Model* model, const TaskDraft* draft);
+
+/**
+ * Queue a new project or context on the background writer. The list is
+ * reloaded once the insert lands.
+ * 
+ * Returns 0 if queued, -1 on error.
+ */
+int model_insert_project(Model* model, const char* title, ProjectType type);
+int model_insert_context(Model* model, const char* name);
+
+/**
+ * Take the ID of the last project model_insert_project() added, so the
+ * view can select it once it exists.
+ * 
+ * Returns the project ID, or 0 if none landed since the last call.
+ */
+int model_take_added_project(Model* model);
+
+/**
+ * Count the tasks a perspective holds across the whole database, whatever
+ * the model is showing. The counts are as of the last model_sync() or
+ * edit.
+ * 
+ * The first call after the table or the context links change counts every
+ * badge at once: the perspectives from the table's bitmap indexes, and
+ * every project and context in one pass over the open tasks. Until the
+ * next change, calls only look the count up.
+ * 
+ * For PERSPECTIVE_PROJECT this counts every open, undeferred task in
+ * project_id; sequential projects are not cut down to their head.
+ * project_id is ignored for the other perspectives.
+ */
+int model_count_tasks(Model* model, PerspectiveKind kind, int project_id);
+
+/**
+ * Count the open, undeferred tasks linked to a context, across the whole
+ * database. Counted and cached with model_count_tasks().
+ */
+int model_count_context_tasks(Model* model, int context_id);
+
+/**
+ * Load a task's notes, which the loaded rows don't carry (see
+ * db_get_task_notes). While a notes edit is still queued on the writer,
+ * the text submitted last is returned instead, so this never waits for
+ * the writer.
+ * 
+ * @param notes Output string (caller must free)
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int model_get_task_notes(Model* model, int id, char** notes);
+
+#endif // MODEL_H
@@ -1,3 +1,7 @@
+#if !defined(PLATFORM_WINDOWS) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200809L  // nanosleep, clock_gettime
+#endif
+
 #include "platform.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,6 +18,7 @@
     #include <sys/types.h>
     #include <unistd.h>
     #include <errno.h>
+    #include <time.h>
     #define PATH_SEP '/'
     #define mkdir_portable(path) mkdir(path, 0755)
 #endif
@@ -130,3 +135,140 @@ const char* path_join(const char* dir, const char* file) {
     
     return path_join_buf;
 }
+
+// Heap-allocated so the native entry point can unpack fn/arg after
+// platform_thread_start() has returned
+typedef struct {
+    PlatformThreadFn fn;
+    void* arg;
+} ThreadStart;
+
+#ifdef PLATFORM_WINDOWS
+static DWORD WINAPI thread_trampoline(LPVOID param) {
+#else
+static void* thread_trampoline(void* param) {
+#endif
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.fn(start.arg);
+    return 0;
+}
+
+int platform_thread_start(PlatformThread* thread, PlatformThreadFn fn, void* arg) {
+    if (!thread || !fn) {
+        return -1;
+    }
+    
+    ThreadStart* start = malloc(sizeof(ThreadStart));
+    if (!start) {
+        return -1;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    
+#ifdef PLATFORM_WINDOWS
+    HANDLE handle = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+    if (handle == NULL) {
+        free(start);
+        return -1;
+    }
+    *thread = handle;
+#else
+    if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+        free(start);
+        return -1;
+    }
+#endif
+    
+    return 0;
+}
+
+void platform_thread_join(PlatformThread thread) {
+#ifdef PLATFORM_WINDOWS
+    WaitForSingleObject((HANDLE)thread, INFINITE);
+    CloseHandle((HANDLE)thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+void platform_sleep_ms(int ms) {
+#ifdef PLATFORM_WINDOWS
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+uint64_t platform_now_ns(void) {
+#ifdef PLATFORM_WINDOWS
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // Split so the multiply cannot overflow
+    uint64_t seconds = (uint64_t)counter.QuadPart / (uint64_t)frequency.QuadPart;
+    uint64_t rest = (uint64_t)counter.QuadPart % (uint64_t)frequency.QuadPart;
+    return seconds * 1000000000ULL + rest * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+int platform_event_init(PlatformEvent* event) {
+#ifdef PLATFORM_WINDOWS
+    event->handle = CreateEventA(NULL, FALSE, FALSE, NULL);
+    return event->handle != NULL ? 0 : -1;
+#else
+    event->signaled = 0;
+    if (pthread_mutex_init(&event->mutex, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&event->cond, NULL) != 0) {
+        pthread_mutex_destroy(&event->mutex);
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+void platform_event_signal(PlatformEvent* event) {
+#ifdef PLATFORM_WINDOWS
+    SetEvent((HANDLE)event->handle);
+#else
+    pthread_mutex_lock(&event->mutex);
+    event->signaled = 1;
+    pthread_cond_signal(&event->cond);
+    pthread_mutex_unlock(&event->mutex);
+#endif
+}
+
+void platform_event_wait(PlatformEvent* event) {
+#ifdef PLATFORM_WINDOWS
+    WaitForSingleObject((HANDLE)event->handle, INFINITE);
+#else
+    pthread_mutex_lock(&event->mutex);
+    while (!event->signaled) {
+        pthread_cond_wait(&event->cond, &event->mutex);
+    }
+    event->signaled = 0;
+    pthread_mutex_unlock(&event->mutex);
+#endif
+}
+
+void platform_event_destroy(PlatformEvent* event) {
+#ifdef PLATFORM_WINDOWS
+    CloseHandle((HANDLE)event->handle);
+    event->handle = NULL;
+#else
+    pthread_cond_destroy(&event->cond);
+    pthread_mutex_destroy(&event->mutex);
+#endif
+}
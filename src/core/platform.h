@@ -2,6 +2,27 @@
 #define PLATFORM_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#ifdef PLATFORM_WINDOWS
+typedef void* PlatformThread;
+typedef struct {
+    void* handle;
+} PlatformEvent;
+#else
+#include <pthread.h>
+typedef pthread_t PlatformThread;
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int signaled;
+} PlatformEvent;
+#endif
+
+/**
+ * Entry point for a thread started with platform_thread_start().
+ */
+typedef void (*PlatformThreadFn)(void* arg);
 
 /**
  * Get the platform-specific application data directory.
@@ -28,4 +49,51 @@ int ensure_dir_exists(const char* path);
  */
 const char* path_join(const char* dir, const char* file);
 
+/**
+ * Start a thread running fn(arg).
+ * The thread must be reaped with platform_thread_join().
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int platform_thread_start(PlatformThread* thread, PlatformThreadFn fn, void* arg);
+
+/**
+ * Wait for a thread to finish and release it.
+ */
+void platform_thread_join(PlatformThread thread);
+
+/**
+ * Sleep the calling thread for the given number of milliseconds.
+ */
+void platform_sleep_ms(int ms);
+
+/**
+ * Monotonic clock in nanoseconds, for measuring intervals. The origin is
+ * arbitrary.
+ */
+uint64_t platform_now_ns(void);
+
+/**
+ * Auto-reset event for waking a sleeping thread. A signal sent while
+ * nobody is waiting is kept until the next wait.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int platform_event_init(PlatformEvent* event);
+
+/**
+ * Wake one waiter, or the next thread to wait.
+ */
+void platform_event_signal(PlatformEvent* event);
+
+/**
+ * Block until the event is signaled, then reset it.
+ */
+void platform_event_wait(PlatformEvent* event);
+
+/**
+ * Release an event's resources.
+ */
+void platform_event_destroy(PlatformEvent* event);
+
 #endif // PLATFORM_H
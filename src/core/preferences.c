@@ -5,6 +5,9 @@
 #include <string.h>
 #include <stdlib.h>
 
+#define MIN_IDLE_FRAME_MS 100
+#define MAX_IDLE_FRAME_MS 10000
+
 // Platform-specific config path
 static void get_config_path(char* path, size_t size) {
 #ifdef _WIN32
@@ -39,6 +42,9 @@ void preferences_init(Preferences* prefs) {
     prefs->clipboard_history_size = 50;
     
     strncpy(prefs->theme, "default", sizeof(prefs->theme) - 1);
+    
+    prefs->render_on_demand = true;
+    prefs->max_idle_frame_ms = 1000;
 }
 
 int preferences_load(Preferences* prefs) {
@@ -76,6 +82,15 @@ int preferences_load(Preferences* prefs) {
                 prefs->clipboard_history_size = atoi(value);
             } else if (strcmp(key, "theme") == 0) {
                 strncpy(prefs->theme, value, sizeof(prefs->theme) - 1);
+            } else if (strcmp(key, "render_on_demand") == 0) {
+                prefs->render_on_demand = (strcmp(value, "true") == 0);
+            } else if (strcmp(key, "max_idle_frame_ms") == 0) {
+                prefs->max_idle_frame_ms = atoi(value);
+                if (prefs->max_idle_frame_ms < MIN_IDLE_FRAME_MS) {
+                    prefs->max_idle_frame_ms = MIN_IDLE_FRAME_MS;
+                } else if (prefs->max_idle_frame_ms > MAX_IDLE_FRAME_MS) {
+                    prefs->max_idle_frame_ms = MAX_IDLE_FRAME_MS;
+                }
             }
         }
     }
@@ -103,6 +118,8 @@ int preferences_save(const Preferences* prefs) {
     fprintf(f, "system_commands_enabled=%s\n", prefs->system_commands_enabled ? "true" : "false");
     fprintf(f, "clipboard_history_size=%d\n", prefs->clipboard_history_size);
     fprintf(f, "theme=%s\n", prefs->theme);
+    fprintf(f, "render_on_demand=%s\n", prefs->render_on_demand ? "true" : "false");
+    fprintf(f, "max_idle_frame_ms=%d\n", prefs->max_idle_frame_ms);
     
     fclose(f);
     return 0;
@@ -222,6 +239,30 @@ void preferences_render(Preferences* prefs, bool* show_preferences) {
             igSpacing();
         }
         
+        // Performance Section
+        if (igCollapsingHeader_TreeNodeFlags("Performance", ImGuiTreeNodeFlags_DefaultOpen)) {
+            igCheckbox("Only redraw on changes", &prefs->render_on_demand);
+            if (igIsItemHovered(0)) {
+                igSetTooltip("Sleep while idle instead of drawing every display refresh");
+            }
+            
+            if (prefs->render_on_demand) {
+                igIndent(20.0f);
+                igPushItemWidth(150);
+                igSliderInt("##idle", &prefs->max_idle_frame_ms, MIN_IDLE_FRAME_MS, MAX_IDLE_FRAME_MS,
+                            "%d ms", ImGuiSliderFlags_None);
+                igPopItemWidth();
+                igSameLine(0, 10);
+                igText("Max idle frame interval");
+                if (igIsItemHovered(0)) {
+                    igSetTooltip("How often to check for edits from samfocus-cli while idle");
+                }
+                igUnindent(20.0f);
+            }
+            
+            igSpacing();
+        }
+        
         // Save/Reset Buttons
         igSeparator();
         igSpacing();
@@ -21,6 +21,8 @@ typedef struct {
     bool system_commands_enabled;
     int clipboard_history_size;
     char theme[64];
+    bool render_on_demand;      // Sleep between frames while nothing changes
+    int max_idle_frame_ms;      // Longest sleep, which bounds how late outside edits show
 } Preferences;
 
 /**
@@ -0,0 +1,217 @@
+#include "profiler.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A span that has begun but not ended
+typedef struct {
+    ProfileScope scope;
+    uint64_t start_ns;
+    int span;                   // Index into the frame's spans, -1 if not kept
+} OpenSpan;
+
+static ProfileFrame history[PROFILE_HISTORY];
+static int next_slot = 0;       // Slot the current or next frame is written to
+static int finished_count = 0;
+static unsigned frame_number = 0;
+static int in_frame = 0;
+static uint64_t frame_start_ns = 0;
+static OpenSpan open_spans[PROFILE_MAX_DEPTH];
+static int open_count = 0;
+static int dropped_depth = 0;   // Spans begun past PROFILE_MAX_DEPTH, not yet ended
+
+static const char* scope_names[PROFILE_SCOPE_COUNT] = {
+    "Frame",
+    "Events",
+    "Sync",
+    "Load tasks",
+    "Sidebar",
+    "Task list",
+    "Command palette",
+    "Launcher",
+    "Draw",
+    "SQLite"
+};
+
+void profile_frame_begin(void) {
+    if (in_frame) {
+        profile_frame_end();
+    }
+    
+    memset(&history[next_slot], 0, sizeof(ProfileFrame));
+    open_count = 0;
+    dropped_depth = 0;
+    in_frame = 1;
+    frame_start_ns = platform_now_ns();
+}
+
+void profile_frame_end(void) {
+    if (!in_frame) {
+        return;
+    }
+    
+    while (open_count > 0) {
+        profile_end(open_spans[open_count - 1].scope);
+    }
+    
+    ProfileFrame* frame = &history[next_slot];
+    frame->number = frame_number++;
+    frame->duration_ns = platform_now_ns() - frame_start_ns;
+    frame->scope_ns[PROFILE_FRAME] = frame->duration_ns;
+    frame->scopes_run |= 1u << PROFILE_FRAME;
+    trace_end(frame_start_ns, scope_names[PROFILE_FRAME]);
+    
+    in_frame = 0;
+    next_slot = (next_slot + 1) % PROFILE_HISTORY;
+    if (finished_count < PROFILE_HISTORY) {
+        finished_count++;
+    }
+}
+
+void profile_begin(ProfileScope scope) {
+    // Outside a frame, spans only go to the trace
+    if (!in_frame && !trace_enabled()) {
+        return;
+    }
+    if (open_count == PROFILE_MAX_DEPTH) {
+        dropped_depth++;
+        return;
+    }
+    
+    ProfileFrame* frame = &history[next_slot];
+    OpenSpan* open = &open_spans[open_count];
+    open->scope = scope;
+    open->start_ns = platform_now_ns();
+    open->span = -1;
+    if (in_frame && frame->span_count < PROFILE_MAX_SPANS) {
+        open->span = frame->span_count++;
+        ProfileSpan* span = &frame->spans[open->span];
+        span->scope = scope;
+        span->depth = open_count;
+        span->start_ns = open->start_ns - frame_start_ns;
+        span->duration_ns = 0;
+    }
+    open_count++;
+}
+
+void profile_end(ProfileScope scope) {
+    (void)scope;  // Spans nest, so the innermost one is the one ending
+    
+    if (!in_frame && !trace_enabled()) {
+        return;
+    }
+    if (dropped_depth > 0) {
+        dropped_depth--;
+        return;
+    }
+    if (open_count == 0) {
+        return;
+    }
+    
+    OpenSpan* open = &open_spans[--open_count];
+    trace_end(open->start_ns, scope_names[open->scope]);
+    if (!in_frame) {
+        return;
+    }
+    
+    ProfileFrame* frame = &history[next_slot];
+    uint64_t duration = platform_now_ns() - open->start_ns;
+    if (open->span >= 0) {
+        frame->spans[open->span].duration_ns = duration;
+    }
+    frame->scope_ns[open->scope] += duration;
+    frame->scopes_run |= 1u << open->scope;
+}
+
+void profile_add(ProfileScope scope, uint64_t ns) {
+    if (!in_frame) {
+        return;
+    }
+    
+    ProfileFrame* frame = &history[next_slot];
+    frame->scope_ns[scope] += ns;
+    frame->scopes_run |= 1u << scope;
+}
+
+void profile_count_statements(int count) {
+    if (in_frame) {
+        history[next_slot].statements += count;
+    }
+}
+
+void profile_reset(void) {
+    in_frame = 0;
+    next_slot = 0;
+    finished_count = 0;
+    open_count = 0;
+    dropped_depth = 0;
+}
+
+int profile_frame_count(void) {
+    return finished_count;
+}
+
+const ProfileFrame* profile_get_frame(int age) {
+    if (age < 0 || age >= finished_count) {
+        return NULL;
+    }
+    
+    int slot = (next_slot - 1 - age + PROFILE_HISTORY) % PROFILE_HISTORY;
+    return &history[slot];
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Fill stats from unsorted values. The 99th percentile is the nearest
+// rank, so under 100 frames it is the slowest one.
+static int summarize(double* values, int count, ProfileStats* stats) {
+    if (count == 0) {
+        memset(stats, 0, sizeof(ProfileStats));
+        return -1;
+    }
+    
+    qsort(values, (size_t)count, sizeof(double), compare_doubles);
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    
+    int rank = (count * 99 + 99) / 100;
+    stats->min = values[0];
+    stats->avg = sum / count;
+    stats->p99 = values[rank - 1];
+    stats->frames = count;
+    return 0;
+}
+
+int profile_get_stats(ProfileScope scope, ProfileStats* stats) {
+    double values[PROFILE_HISTORY];
+    int count = 0;
+    for (int age = 0; age < finished_count; age++) {
+        const ProfileFrame* frame = profile_get_frame(age);
+        if (frame->scopes_run & (1u << scope)) {
+            values[count++] = (double)frame->scope_ns[scope] / 1e6;
+        }
+    }
+    return summarize(values, count, stats);
+}
+
+int profile_get_statement_stats(ProfileStats* stats) {
+    double values[PROFILE_HISTORY];
+    for (int age = 0; age < finished_count; age++) {
+        values[age] = (double)profile_get_frame(age)->statements;
+    }
+    return summarize(values, finished_count, stats);
+}
+
+const char* profile_scope_name(ProfileScope scope) {
+    if (scope < 0 || scope >= PROFILE_SCOPE_COUNT) {
+        return "?";
+    }
+    return scope_names[scope];
+}
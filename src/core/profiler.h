@@ -0,0 +1,134 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+#define PROFILE_HISTORY 120     // Frames kept for the overlay
+#define PROFILE_MAX_SPANS 48    // Spans kept per frame; later ones still count in the totals
+#define PROFILE_MAX_DEPTH 8     // Deeper spans are ignored
+
+/**
+ * Parts of a frame that are timed. Scopes nest: a load inside the sync
+ * counts towards both.
+ */
+typedef enum {
+    PROFILE_FRAME = 0,          // From the end of the idle wait to the buffer swap
+    PROFILE_EVENTS,             // Writer completions, availability and change polling
+    PROFILE_SYNC,               // model_sync()
+    PROFILE_LOAD_TASKS,         // Perspective requery inside the sync
+    PROFILE_SIDEBAR,
+    PROFILE_TASK_LIST,
+    PROFILE_COMMAND_PALETTE,
+    PROFILE_LAUNCHER,
+    PROFILE_DRAW,               // igRender() and the OpenGL draw
+    PROFILE_SQLITE,             // Statements run on the main connection, as SQLite timed them
+    PROFILE_SCOPE_COUNT
+} ProfileScope;
+
+/**
+ * One timed span, positioned within its frame.
+ */
+typedef struct {
+    ProfileScope scope;
+    int depth;                  // 0 for spans not inside another
+    uint64_t start_ns;          // Since the frame began
+    uint64_t duration_ns;
+} ProfileSpan;
+
+/**
+ * Timings of one finished frame.
+ */
+typedef struct {
+    unsigned number;                            // Frames finished before this one
+    uint64_t duration_ns;
+    uint64_t scope_ns[PROFILE_SCOPE_COUNT];     // Total time in each scope
+    unsigned scopes_run;                        // Bit per scope entered this frame
+    int statements;                             // SQLite statements run
+    ProfileSpan spans[PROFILE_MAX_SPANS];       // In the order they began
+    int span_count;
+} ProfileFrame;
+
+/**
+ * Rolling statistics over the kept frames.
+ */
+typedef struct {
+    double min;
+    double avg;
+    double p99;
+    int frames;                 // Frames the figures cover
+} ProfileStats;
+
+/**
+ * Start timing a frame. Ends the previous one if it is still open.
+ * 
+ * The profiler keeps the last PROFILE_HISTORY frames of the main loop and
+ * is for the main thread only. Spans also go to the session trace while
+ * one runs. Outside a frame they only go to the trace, so instrumented
+ * code costs almost nothing in tests, the CLI or startup.
+ */
+void profile_frame_begin(void);
+
+/**
+ * Finish the frame, closing any span still open, and add it to the history.
+ */
+void profile_frame_end(void);
+
+/**
+ * Begin a span. Spans must end in the reverse order they began.
+ */
+void profile_begin(ProfileScope scope);
+
+/**
+ * End the innermost open span, which must be of this scope.
+ */
+void profile_end(ProfileScope scope);
+
+/**
+ * Add time measured elsewhere, such as SQLite's own statement timing,
+ * to a scope of the current frame. It gets no span.
+ */
+void profile_add(ProfileScope scope, uint64_t ns);
+
+/**
+ * Add to the current frame's count of SQLite statements.
+ */
+void profile_count_statements(int count);
+
+/**
+ * Forget every kept frame.
+ */
+void profile_reset(void);
+
+/**
+ * Number of finished frames kept, up to PROFILE_HISTORY.
+ */
+int profile_frame_count(void);
+
+/**
+ * Get a finished frame: 0 is the newest, profile_frame_count() - 1 the
+ * oldest. Returns NULL if the age is out of range.
+ */
+const ProfileFrame* profile_get_frame(int age);
+
+/**
+ * Min, average and 99th percentile time in a scope, in milliseconds, over
+ * the kept frames that entered it.
+ * 
+ * Returns 0 on success, -1 if no kept frame entered the scope.
+ */
+int profile_get_stats(ProfileScope scope, ProfileStats* stats);
+
+/**
+ * Min, average and 99th percentile of SQLite statements per frame over
+ * every kept frame.
+ * 
+ * Returns 0 on success, -1 if no frame is kept.
+ */
+int profile_get_statement_stats(ProfileStats* stats);
+
+/**
+ * Display name of a scope.
+ */
+const char* profile_scope_name(ProfileScope scope);
+
+#endif // PROFILER_H
@@ -12,7 +12,7 @@ typedef enum {
 // Project structure
 typedef struct {
     int id;
-    char title[256];
+    const char* title;   // Owned by the StringArena the project was loaded into
     ProjectType type;
     time_t created_at;
 } Project;
@@ -0,0 +1,206 @@
+#include "row_view.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void row_view_cache_init(RowViewCache* cache) {
+    memset(cache, 0, sizeof(RowViewCache));
+}
+
+void row_view_cache_free(RowViewCache* cache) {
+    free(cache->rows);
+    free(cache->matches);
+    free(cache->search);
+    memset(cache, 0, sizeof(RowViewCache));
+}
+
+// Last second of the local day holding now
+static time_t end_of_day(time_t now) {
+    struct tm end_tm = *localtime(&now);
+    end_tm.tm_hour = 23;
+    end_tm.tm_min = 59;
+    end_tm.tm_sec = 59;
+    end_tm.tm_isdst = -1;
+    return mktime(&end_tm);
+}
+
+// Case-insensitive substring test
+static int title_matches(const char* title, const char* search) {
+    if (search[0] == '\0') {
+        return 1;
+    }
+    for (const char* start = title; *start != '\0'; start++) {
+        const char* t = start;
+        const char* s = search;
+        while (*t != '\0' && *s != '\0' &&
+               tolower((unsigned char)*t) == tolower((unsigned char)*s)) {
+            t++;
+            s++;
+        }
+        if (*s == '\0') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int find_matches(RowViewCache* cache, const Model* model, const char* search) {
+    if (model->task_count > cache->match_capacity) {
+        int* grown = (int*)realloc(cache->matches, sizeof(int) * model->task_count);
+        if (grown == NULL) {
+            return -1;
+        }
+        cache->matches = grown;
+        cache->match_capacity = model->task_count;
+    }
+    
+    cache->match_count = 0;
+    for (int i = 0; i < model->task_count; i++) {
+        const char* title = model->tasks[i].title != NULL ? model->tasks[i].title : "";
+        if (title_matches(title, search)) {
+            cache->matches[cache->match_count++] = i;
+        }
+    }
+    return 0;
+}
+
+int row_view_cache_update(RowViewCache* cache, const Model* model, const char* search, time_t now) {
+    if (search == NULL) {
+        search = "";
+    }
+    
+    int stale = cache->stamp == 0 || cache->rows_version != model->rows_version;
+    if (stale || now > cache->day_end) {
+        // Start a new stamp instead of clearing every row
+        cache->stamp++;
+        if (cache->stamp == 0) {
+            cache->stamp = 1;
+            memset(cache->rows, 0, sizeof(RowView) * (size_t)cache->row_capacity);
+        }
+        cache->rows_version = model->rows_version;
+        cache->day_end = end_of_day(now);
+    }
+    
+    if (model->task_count > cache->row_capacity) {
+        RowView* grown = (RowView*)realloc(cache->rows, sizeof(RowView) * model->task_count);
+        if (grown == NULL) {
+            return -1;
+        }
+        memset(&grown[cache->row_capacity], 0,
+               sizeof(RowView) * (size_t)(model->task_count - cache->row_capacity));
+        cache->rows = grown;
+        cache->row_capacity = model->task_count;
+    }
+    
+    if (stale || cache->search == NULL || strcmp(cache->search, search) != 0) {
+        char* copy = (char*)malloc(strlen(search) + 1);
+        if (copy == NULL) {
+            return -1;
+        }
+        strcpy(copy, search);
+        free(cache->search);
+        cache->search = copy;
+        
+        if (find_matches(cache, model, search) != 0) {
+            // Redo the matches next frame
+            free(cache->search);
+            cache->search = NULL;
+            return -1;
+        }
+    }
+    
+    return cache->match_count;
+}
+
+static void format_due(RowView* view, time_t due_at, time_t now) {
+    struct tm due_tm = *localtime(&due_at);
+    struct tm now_tm = *localtime(&now);
+    strftime(view->due_label, sizeof(view->due_label), "Due:%m/%d", &due_tm);
+    
+    if (due_tm.tm_year < now_tm.tm_year ||
+        (due_tm.tm_year == now_tm.tm_year && due_tm.tm_yday < now_tm.tm_yday)) {
+        view->due_state = DUE_STATE_OVERDUE;
+    } else if (due_tm.tm_year == now_tm.tm_year && due_tm.tm_yday == now_tm.tm_yday) {
+        view->due_state = DUE_STATE_TODAY;
+    } else {
+        view->due_state = DUE_STATE_LATER;
+    }
+}
+
+static void format_recurrence(RowView* view, const Task* task) {
+    static const char* recur_names[] = {"", "Daily", "Weekly", "Monthly", "Yearly"};
+    
+    if (task->recurrence <= RECUR_NONE || task->recurrence > RECUR_YEARLY) {
+        snprintf(view->recur_label, sizeof(view->recur_label), "Repeat##recur");
+    } else if (task->recurrence_interval == 1) {
+        snprintf(view->recur_label, sizeof(view->recur_label), "🔄%s##recur",
+                 recur_names[task->recurrence]);
+    } else {
+        snprintf(view->recur_label, sizeof(view->recur_label), "🔄Every %d %s##recur",
+                 task->recurrence_interval, recur_names[task->recurrence]);
+    }
+}
+
+static void format_contexts(RowView* view, const Model* model, int task_id) {
+    view->context_label[0] = '\0';
+    
+    int link_count = 0;
+    const int* context_ids = task_context_map_get(&model->context_map, task_id, &link_count);
+    size_t used = 0;
+    for (int i = 0; i < link_count; i++) {
+        const char* name = "?";
+        for (int k = 0; k < model->context_count; k++) {
+            if (model->contexts[k].id == context_ids[i]) {
+                name = model->contexts[k].name;
+                break;
+            }
+        }
+        
+        int written = snprintf(view->context_label + used, sizeof(view->context_label) - used,
+                               "%s@%s", i > 0 ? " " : "", name);
+        if (written < 0 || (size_t)written >= sizeof(view->context_label) - used) {
+            break;  // Truncated; the rest don't fit
+        }
+        used += (size_t)written;
+    }
+}
+
+static void build_view(RowView* view, const Model* model, const Task* task, time_t now) {
+    view->defer_label[0] = '\0';
+    if (task->defer_at > 0) {
+        struct tm defer_tm = *localtime(&task->defer_at);
+        strftime(view->defer_label, sizeof(view->defer_label), "Defer:%m/%d", &defer_tm);
+    }
+    
+    view->due_label[0] = '\0';
+    view->due_state = DUE_STATE_NONE;
+    if (task->due_at > 0) {
+        format_due(view, task->due_at, now);
+    }
+    
+    format_recurrence(view, task);
+    
+    view->project_title = "None";
+    if (task->project_id > 0) {
+        for (int i = 0; i < model->project_count; i++) {
+            if (model->projects[i].id == task->project_id) {
+                view->project_title = model->projects[i].title;
+                break;
+            }
+        }
+    }
+    snprintf(view->project_label, sizeof(view->project_label), "%s##project", view->project_title);
+    
+    format_contexts(view, model, task->id);
+    view->dependency_count = task->dependency_count;
+}
+
+const RowView* row_view_get(RowViewCache* cache, const Model* model, int index, time_t now) {
+    RowView* view = &cache->rows[index];
+    if (view->stamp != cache->stamp) {
+        build_view(view, model, &model->tasks[index], now);
+        view->stamp = cache->stamp;
+    }
+    return view;
+}
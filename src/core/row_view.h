@@ -0,0 +1,79 @@
+#ifndef ROW_VIEW_H
+#define ROW_VIEW_H
+
+#include "model.h"
+#include <time.h>
+
+/**
+ * How a due date compares with today.
+ */
+typedef enum {
+    DUE_STATE_NONE = 0,         // No due date
+    DUE_STATE_LATER,
+    DUE_STATE_TODAY,
+    DUE_STATE_OVERDUE
+} DueState;
+
+/**
+ * What the task list shows for one task, formatted once instead of every
+ * frame. Labels that end up on buttons carry their "##" widget ID suffix.
+ */
+typedef struct {
+    unsigned stamp;             // RowViewCache stamp it was built at, 0 if never
+    char defer_label[16];       // "Defer:MM/DD", empty without a defer date
+    char due_label[16];         // "Due:MM/DD", empty without a due date
+    DueState due_state;
+    char recur_label[64];       // Repeat button label
+    char project_label[300];    // Project combo label
+    const char* project_title;  // "None" for the inbox
+    char context_label[128];    // "@home @work", empty without contexts
+    int dependency_count;
+} RowView;
+
+/**
+ * Row views for the model's loaded tasks, built as rows become visible
+ * and kept until the model's rows change or the day ends. Also keeps the
+ * rows matching the search text, so a frame only visits the rows it
+ * draws. A zeroed cache is empty and ready to use.
+ */
+typedef struct {
+    RowView* rows;              // Parallel to model->tasks
+    int row_capacity;
+    int* matches;               // Indexes into model->tasks matching the search
+    int match_count;
+    int match_capacity;
+    unsigned stamp;             // Rows built at another stamp are stale
+    unsigned rows_version;      // model->rows_version the cache is for
+    time_t day_end;             // Due states hold until this time
+    char* search;               // Search text the matches are for, NULL if none yet
+} RowViewCache;
+
+/**
+ * Initialize an empty cache.
+ */
+void row_view_cache_init(RowViewCache* cache);
+
+/**
+ * Release everything the cache holds and leave it empty.
+ */
+void row_view_cache_free(RowViewCache* cache);
+
+/**
+ * Bring the cache in line with the model, the search text and the time.
+ * Call once per frame before row_view_get(). Cheap unless something
+ * changed: the matches are only redone when the rows or the search do.
+ * 
+ * @param search Case-insensitive substring of the titles to show, "" for all
+ * 
+ * Returns the number of matching rows, listed in cache->matches, or -1 if
+ * out of memory.
+ */
+int row_view_cache_update(RowViewCache* cache, const Model* model, const char* search, time_t now);
+
+/**
+ * Get the view of model->tasks[index], building it if it is stale.
+ * The view stays valid until the next row_view_cache_update().
+ */
+const RowView* row_view_get(RowViewCache* cache, const Model* model, int index, time_t now);
+
+#endif // ROW_VIEW_H
@@ -0,0 +1,72 @@
+#include "spsc_queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+int spsc_queue_init(SpscQueue* queue, size_t item_size, unsigned int capacity) {
+    if (!queue || item_size == 0 || capacity == 0) {
+        return -1;
+    }
+    
+    unsigned int rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    
+    queue->slots = malloc(item_size * rounded);
+    if (!queue->slots) {
+        return -1;
+    }
+    
+    queue->item_size = item_size;
+    queue->capacity = rounded;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 0;
+}
+
+void spsc_queue_free(SpscQueue* queue) {
+    free(queue->slots);
+    queue->slots = NULL;
+    queue->capacity = 0;
+}
+
+// head and tail run freely and wrap at UINT_MAX; their difference is the
+// fill level and the low bits pick the slot
+
+int spsc_queue_push(SpscQueue* queue, const void* item) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    
+    if (tail - head >= queue->capacity) {
+        return -1;
+    }
+    
+    memcpy(queue->slots + (size_t)(tail & (queue->capacity - 1)) * queue->item_size,
+           item, queue->item_size);
+    
+    // Publish the slot contents before the new tail
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+int spsc_queue_pop(SpscQueue* queue, void* item) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    
+    if (head == tail) {
+        return -1;
+    }
+    
+    memcpy(item, queue->slots + (size_t)(head & (queue->capacity - 1)) * queue->item_size,
+           queue->item_size);
+    
+    // Hand the slot back to the producer only after it has been copied out
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 0;
+}
+
+int spsc_queue_is_empty(SpscQueue* queue) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    return head == tail;
+}
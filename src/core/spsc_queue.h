@@ -0,0 +1,51 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one
+ * consumer thread. Items are copied in and out by value.
+ */
+typedef struct {
+    unsigned char* slots;
+    size_t item_size;
+    unsigned int capacity;      // Power of two
+    atomic_uint head;           // Next slot to read, written by the consumer
+    atomic_uint tail;           // Next slot to write, written by the producer
+} SpscQueue;
+
+/**
+ * Allocate a queue. Capacity is rounded up to a power of two.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int spsc_queue_init(SpscQueue* queue, size_t item_size, unsigned int capacity);
+
+/**
+ * Free a queue's storage. Neither thread may be using it.
+ */
+void spsc_queue_free(SpscQueue* queue);
+
+/**
+ * Copy an item into the queue. Producer thread only.
+ * 
+ * Returns 0 on success, -1 if the queue is full.
+ */
+int spsc_queue_push(SpscQueue* queue, const void* item);
+
+/**
+ * Copy the oldest item out of the queue. Consumer thread only.
+ * 
+ * Returns 0 on success, -1 if the queue is empty.
+ */
+int spsc_queue_pop(SpscQueue* queue, void* item);
+
+/**
+ * Check whether the queue is empty. Exact from the consumer thread,
+ * a snapshot from anywhere else.
+ */
+int spsc_queue_is_empty(SpscQueue* queue);
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,158 @@
+#include "string_arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIRST_CHUNK_SIZE 4096
+#define MAX_CHUNK_SIZE (1024 * 1024)
+#define FIRST_SLOT_COUNT 64
+
+struct StringArenaChunk {
+    StringArenaChunk* next;     // Older chunk
+    size_t used;
+    size_t capacity;
+    char data[];
+};
+
+void string_arena_init(StringArena* arena) {
+    memset(arena, 0, sizeof(StringArena));
+}
+
+// FNV-1a
+static size_t hash_text(const char* text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Slot holding text, or the empty slot where it belongs
+static size_t find_slot(const StringArena* arena, const char* text, size_t length) {
+    size_t mask = arena->slot_count - 1;
+    size_t i = hash_text(text, length) & mask;
+    while (arena->slots[i] != NULL) {
+        const char* held = arena->slots[i];
+        if (strncmp(held, text, length) == 0 && held[length] == '\0') {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Keep the intern table at most half full
+static int grow_slots(StringArena* arena) {
+    size_t new_count = arena->slot_count > 0 ? arena->slot_count * 2 : FIRST_SLOT_COUNT;
+    const char** old_slots = arena->slots;
+    size_t old_count = arena->slot_count;
+    
+    arena->slots = (const char**)calloc(new_count, sizeof(const char*));
+    if (arena->slots == NULL) {
+        arena->slots = old_slots;
+        return -1;
+    }
+    arena->slot_count = new_count;
+    
+    for (size_t i = 0; i < old_count; i++) {
+        if (old_slots[i] != NULL) {
+            const char* held = old_slots[i];
+            arena->slots[find_slot(arena, held, strlen(held))] = held;
+        }
+    }
+    free(old_slots);
+    return 0;
+}
+
+// Room for size bytes in the newest chunk, adding a bigger chunk if needed
+static char* reserve(StringArena* arena, size_t size) {
+    StringArenaChunk* head = arena->chunks;
+    if (head != NULL && head->capacity - head->used >= size) {
+        char* out = head->data + head->used;
+        head->used += size;
+        return out;
+    }
+    
+    size_t capacity = head != NULL ? head->capacity * 2 : FIRST_CHUNK_SIZE;
+    if (capacity > MAX_CHUNK_SIZE) {
+        capacity = MAX_CHUNK_SIZE;
+    }
+    if (capacity < size) {
+        capacity = size;
+    }
+    
+    StringArenaChunk* chunk = (StringArenaChunk*)malloc(sizeof(StringArenaChunk) + capacity);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = head;
+    chunk->used = size;
+    chunk->capacity = capacity;
+    arena->chunks = chunk;
+    return chunk->data;
+}
+
+const char* string_arena_intern(StringArena* arena, const char* text, size_t length) {
+    if (text == NULL) {
+        text = "";
+        length = 0;
+    }
+    const char* end = (const char*)memchr(text, '\0', length);
+    if (end != NULL) {
+        length = (size_t)(end - text);
+    }
+    
+    if ((arena->string_count + 1) * 2 > arena->slot_count && grow_slots(arena) != 0) {
+        return NULL;
+    }
+    
+    size_t slot = find_slot(arena, text, length);
+    if (arena->slots[slot] != NULL) {
+        return arena->slots[slot];
+    }
+    
+    char* copy = reserve(arena, length + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    
+    arena->slots[slot] = copy;
+    arena->string_count++;
+    arena->bytes += length + 1;
+    return copy;
+}
+
+void string_arena_reset(StringArena* arena) {
+    // Keep the newest chunk for the next load
+    StringArenaChunk* keep = arena->chunks;
+    if (keep != NULL) {
+        StringArenaChunk* chunk = keep->next;
+        while (chunk != NULL) {
+            StringArenaChunk* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    
+    if (arena->slots != NULL) {
+        memset(arena->slots, 0, sizeof(const char*) * arena->slot_count);
+    }
+    arena->string_count = 0;
+    arena->bytes = 0;
+}
+
+void string_arena_free(StringArena* arena) {
+    StringArenaChunk* chunk = arena->chunks;
+    while (chunk != NULL) {
+        StringArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena->slots);
+    memset(arena, 0, sizeof(StringArena));
+}
@@ -0,0 +1,49 @@
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <stddef.h>
+
+typedef struct StringArenaChunk StringArenaChunk;
+
+/**
+ * Append-only storage for the strings of a loaded result set. Strings are
+ * interned: adding the same text twice returns the same pointer, so
+ * repeated names cost their bytes once and can be compared by pointer.
+ * 
+ * Pointers stay valid until the arena is reset or freed. A zeroed arena
+ * is empty and ready to use.
+ */
+typedef struct {
+    StringArenaChunk* chunks;   // Newest first; strings never move
+    const char** slots;         // Intern table, NULL for an empty slot
+    size_t slot_count;          // Power of two, 0 until the first string
+    size_t string_count;        // Distinct strings held
+    size_t bytes;               // Text bytes held, terminators included
+} StringArena;
+
+/**
+ * Initialize an empty arena.
+ */
+void string_arena_init(StringArena* arena);
+
+/**
+ * Get the arena's copy of the first length bytes of text (up to an
+ * embedded NUL), adding it if it isn't there yet.
+ * 
+ * Returns a NUL-terminated string owned by the arena, or NULL if out
+ * of memory.
+ */
+const char* string_arena_intern(StringArena* arena, const char* text, size_t length);
+
+/**
+ * Drop every string at once. The newest chunk is kept for reuse, so
+ * reloading a result set of similar size allocates little.
+ */
+void string_arena_reset(StringArena* arena);
+
+/**
+ * Release everything the arena holds and leave it empty.
+ */
+void string_arena_free(StringArena* arena);
+
+#endif // STRING_ARENA_H
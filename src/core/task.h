@@ -22,8 +22,8 @@ typedef enum {
 // Task structure
 typedef struct {
     int id;
-    char title[256];
-    char notes[1024];  // Task notes/description
+    const char* title;  // Owned by the StringArena the task was loaded into
+    int has_notes;    // Notes themselves are loaded on demand (db_get_task_notes)
     int project_id;  // NULL/0 if not assigned to a project
     TaskStatus status;
     time_t created_at;
@@ -34,6 +34,24 @@ typedef struct {
     int order_index;  // Manual ordering within list (lower = higher priority)
     RecurrencePattern recurrence;  // Recurrence pattern
     int recurrence_interval;  // Interval for recurrence (e.g., every 2 days)
+    int available;    // Maintained by the database: 1 if the task can be worked on now
+    int blocked_by_count;  // Maintained by the database: incomplete dependencies
+    int dependency_count;  // Loaded with the task: every dependency, done or not
 } Task;
 
+#define TASK_DRAFT_MAX_CONTEXTS 8
+
+// Everything needed to create a task in one step (see db_insert_task_full)
+typedef struct {
+    const char* title;
+    const char* notes;     // NULL for none
+    TaskStatus status;
+    int project_id;        // 0 if not assigned to a project
+    time_t defer_at;       // 0 if not deferred
+    time_t due_at;         // 0 if no due date
+    int flagged;
+    const char* context_names[TASK_DRAFT_MAX_CONTEXTS];  // Created if missing
+    int context_count;
+} TaskDraft;
+
 #endif // TASK_H
@@ -0,0 +1,525 @@
+#include "task_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+#define BLOCK 64
+
+void task_table_init(TaskTable* table) {
+    memset(table, 0, sizeof(TaskTable));
+}
+
+void task_table_free(TaskTable* table) {
+    free(table->ids);
+    free(table->project_ids);
+    free(table->order_indexes);
+    free(table->defer_at);
+    free(table->due_at);
+    free(table->modified_at);
+    free(table->status);
+    free(table->flagged);
+    free(table->available);
+    free(table->rows);
+    for (int i = 0; i <= TASK_STATUS_DONE; i++) {
+        id_bitmap_free(&table->status_sets[i]);
+    }
+    id_bitmap_free(&table->flagged_set);
+    id_bitmap_free(&table->available_set);
+    for (int i = 0; i < table->project_set_count; i++) {
+        id_bitmap_free(&table->project_sets[i]);
+    }
+    free(table->project_sets);
+    id_bitmap_free(&table->open_set);
+    id_bitmap_free(&table->due_set);
+    id_bitmap_free(&table->stale_set);
+    memset(table, 0, sizeof(TaskTable));
+}
+
+void task_table_clear(TaskTable* table) {
+    for (int i = 0; i < table->count; i++) {
+        table->rows[table->ids[i]] = -1;
+    }
+    table->count = 0;
+    table->seq = 0;
+    table->version++;
+    
+    for (int i = 0; i <= TASK_STATUS_DONE; i++) {
+        id_bitmap_clear(&table->status_sets[i]);
+    }
+    id_bitmap_clear(&table->flagged_set);
+    id_bitmap_clear(&table->available_set);
+    for (int i = 0; i < table->project_set_count; i++) {
+        id_bitmap_clear(&table->project_sets[i]);
+    }
+    id_bitmap_clear(&table->open_set);
+    id_bitmap_clear(&table->due_set);
+    id_bitmap_clear(&table->stale_set);
+    table->next_refresh = 0;
+}
+
+int task_table_find(const TaskTable* table, int id) {
+    if (id < 0 || id >= table->row_slot_count) {
+        return -1;
+    }
+    return table->rows[id];
+}
+
+int task_table_get(const TaskTable* table, int id, Task* task) {
+    int row = task_table_find(table, id);
+    if (row < 0) {
+        return 0;
+    }
+    
+    memset(task, 0, sizeof(Task));
+    task->id = id;
+    task->project_id = table->project_ids[row];
+    task->order_index = table->order_indexes[row];
+    task->defer_at = table->defer_at[row];
+    task->due_at = table->due_at[row];
+    task->modified_at = table->modified_at[row];
+    task->status = (TaskStatus)table->status[row];
+    task->flagged = table->flagged[row];
+    task->available = table->available[row];
+    return 1;
+}
+
+// ============================================================================
+// Bitmap indexes
+// ============================================================================
+
+// Make room in project_sets for project IDs up to max_id
+static int reserve_project_sets(TaskTable* table, int max_id) {
+    if (max_id < table->project_set_count) {
+        return 0;
+    }
+    
+    int new_count = max_id + 1 > table->project_set_count * 2 ? max_id + 1 : table->project_set_count * 2;
+    IdBitmap* grown = (IdBitmap*)realloc(table->project_sets, sizeof(IdBitmap) * new_count);
+    if (grown == NULL) {
+        return -1;
+    }
+    for (int i = table->project_set_count; i < new_count; i++) {
+        id_bitmap_init(&grown[i]);
+    }
+    table->project_sets = grown;
+    table->project_set_count = new_count;
+    return 0;
+}
+
+// Bring next_refresh forward to when, if that is sooner
+static void note_refresh(TaskTable* table, time_t when) {
+    if (when < table->next_refresh) {
+        table->next_refresh = when;
+    }
+}
+
+// Place a row in the time-dependent sets, as of the time they were built
+static int index_time_sets(TaskTable* table, int row) {
+    int id = table->ids[row];
+    int done = table->status[row] == TASK_STATUS_DONE;
+    int result = 0;
+    
+    if (!done && table->defer_at[row] <= table->now) {
+        result |= id_bitmap_add(&table->open_set, id);
+    } else if (!done) {
+        note_refresh(table, table->defer_at[row]);
+    }
+    
+    if (table->due_at[row] <= table->end_of_today) {
+        result |= id_bitmap_add(&table->due_set, id);
+    }
+    
+    time_t modified_at = table->modified_at[row];
+    if (!done && modified_at > 0) {
+        if (modified_at < table->review_before) {
+            result |= id_bitmap_add(&table->stale_set, id);
+        } else {
+            // Goes stale once review_before moves past it
+            note_refresh(table, modified_at + (table->now - table->review_before) + 1);
+        }
+    }
+    return result;
+}
+
+// Add a row's task to every set its fields put it in
+static int index_row(TaskTable* table, int row) {
+    int id = table->ids[row];
+    int result = 0;
+    
+    if (table->status[row] <= TASK_STATUS_DONE) {
+        result |= id_bitmap_add(&table->status_sets[table->status[row]], id);
+    }
+    if (table->flagged[row]) {
+        result |= id_bitmap_add(&table->flagged_set, id);
+    }
+    if (table->available[row]) {
+        result |= id_bitmap_add(&table->available_set, id);
+    }
+    
+    int project_id = table->project_ids[row];
+    if (project_id >= 0) {
+        if (reserve_project_sets(table, project_id) != 0) {
+            return -1;
+        }
+        result |= id_bitmap_add(&table->project_sets[project_id], id);
+    }
+    
+    if (table->next_refresh > 0) {
+        result |= index_time_sets(table, row);
+    }
+    return result;
+}
+
+// Take a row's task out of the sets its current fields put it in
+static void unindex_row(TaskTable* table, int row) {
+    int id = table->ids[row];
+    
+    if (table->status[row] <= TASK_STATUS_DONE) {
+        id_bitmap_remove(&table->status_sets[table->status[row]], id);
+    }
+    id_bitmap_remove(&table->flagged_set, id);
+    id_bitmap_remove(&table->available_set, id);
+    
+    int project_id = table->project_ids[row];
+    if (project_id >= 0 && project_id < table->project_set_count) {
+        id_bitmap_remove(&table->project_sets[project_id], id);
+    }
+    
+    id_bitmap_remove(&table->open_set, id);
+    id_bitmap_remove(&table->due_set, id);
+    id_bitmap_remove(&table->stale_set, id);
+}
+
+const IdBitmap* task_table_project_set(const TaskTable* table, int project_id) {
+    if (project_id < 0 || project_id >= table->project_set_count) {
+        return NULL;
+    }
+    return &table->project_sets[project_id];
+}
+
+// ============================================================================
+// Rows
+// ============================================================================
+
+// Grow one column to new_capacity elements of size bytes
+static int grow_column(void** column, int new_capacity, size_t size) {
+    void* grown = realloc(*column, size * (size_t)new_capacity);
+    if (grown == NULL) {
+        return -1;
+    }
+    *column = grown;
+    return 0;
+}
+
+// Make room for one more row. Columns that grew before a failure keep
+// their new size; capacity only moves once all of them have it.
+static int reserve_row(TaskTable* table) {
+    if (table->count < table->capacity) {
+        return 0;
+    }
+    
+    int new_capacity = table->capacity > 0 ? table->capacity * 2 : 256;
+    if (grow_column((void**)&table->ids, new_capacity, sizeof(int)) != 0 ||
+        grow_column((void**)&table->project_ids, new_capacity, sizeof(int)) != 0 ||
+        grow_column((void**)&table->order_indexes, new_capacity, sizeof(int)) != 0 ||
+        grow_column((void**)&table->defer_at, new_capacity, sizeof(time_t)) != 0 ||
+        grow_column((void**)&table->due_at, new_capacity, sizeof(time_t)) != 0 ||
+        grow_column((void**)&table->modified_at, new_capacity, sizeof(time_t)) != 0 ||
+        grow_column((void**)&table->status, new_capacity, 1) != 0 ||
+        grow_column((void**)&table->flagged, new_capacity, 1) != 0 ||
+        grow_column((void**)&table->available, new_capacity, 1) != 0) {
+        return -1;
+    }
+    table->capacity = new_capacity;
+    return 0;
+}
+
+// Make room in rows for IDs up to max_id
+static int reserve_row_slots(TaskTable* table, int max_id) {
+    if (max_id < table->row_slot_count) {
+        return 0;
+    }
+    
+    int new_count = max_id + 1 > table->row_slot_count * 2 ? max_id + 1 : table->row_slot_count * 2;
+    int* grown = (int*)realloc(table->rows, sizeof(int) * new_count);
+    if (grown == NULL) {
+        return -1;
+    }
+    for (int i = table->row_slot_count; i < new_count; i++) {
+        grown[i] = -1;
+    }
+    table->rows = grown;
+    table->row_slot_count = new_count;
+    return 0;
+}
+
+int task_table_put(TaskTable* table, const Task* task) {
+    int row = task_table_find(table, task->id);
+    if (row >= 0) {
+        unindex_row(table, row);
+    } else {
+        if (task->id < 0 || reserve_row_slots(table, task->id) != 0 || reserve_row(table) != 0) {
+            return -1;
+        }
+        row = table->count++;
+        table->ids[row] = task->id;
+        table->rows[task->id] = row;
+    }
+    table->version++;
+    
+    table->project_ids[row] = task->project_id;
+    table->order_indexes[row] = task->order_index;
+    table->defer_at[row] = task->defer_at;
+    table->due_at[row] = task->due_at;
+    table->modified_at[row] = task->modified_at;
+    table->status[row] = (unsigned char)task->status;
+    table->flagged[row] = task->flagged != 0;
+    table->available[row] = task->available != 0;
+    return index_row(table, row) == 0 ? 0 : -1;
+}
+
+void task_table_remove(TaskTable* table, int id) {
+    int row = task_table_find(table, id);
+    if (row < 0) {
+        return;
+    }
+    
+    unindex_row(table, row);
+    table->version++;
+    int last = --table->count;
+    table->rows[id] = -1;
+    if (row == last) {
+        return;
+    }
+    
+    table->ids[row] = table->ids[last];
+    table->project_ids[row] = table->project_ids[last];
+    table->order_indexes[row] = table->order_indexes[last];
+    table->defer_at[row] = table->defer_at[last];
+    table->due_at[row] = table->due_at[last];
+    table->modified_at[row] = table->modified_at[last];
+    table->status[row] = table->status[last];
+    table->flagged[row] = table->flagged[last];
+    table->available[row] = table->available[last];
+    table->rows[table->ids[row]] = row;
+}
+
+// ============================================================================
+// Selection kernels
+// ============================================================================
+
+// Turn one block's 0/1 test results into a bitmap word, row j -> bit j
+static uint64_t pack_hits(const unsigned char* hits) {
+    uint64_t bits = 0;
+#ifdef HAVE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (int k = 0; k < BLOCK; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(hits + k));
+        bits |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpgt_epi8(v, zero)) << k;
+    }
+#else
+    for (int j = 0; j < BLOCK; j++) {
+        bits |= (uint64_t)hits[j] << j;
+    }
+#endif
+    return bits;
+}
+
+// Evaluate test, an expression of row i, for every row into the bitmap out.
+// The test loop has no branches, so compilers turn it into vector compares
+// over a column; the partial block at the end is padded with zeros.
+#define SELECT_ROWS(table, out, test) \
+    do { \
+        unsigned char hits[BLOCK]; \
+        int row_count = (table)->count; \
+        for (int base = 0; base < row_count; base += BLOCK) { \
+            int n = row_count - base < BLOCK ? row_count - base : BLOCK; \
+            for (int j = 0; j < n; j++) { \
+                int i = base + j; \
+                hits[j] = (unsigned char)(test); \
+            } \
+            for (int j = n; j < BLOCK; j++) { \
+                hits[j] = 0; \
+            } \
+            (out)[base / BLOCK] = pack_hits(hits); \
+        } \
+    } while (0)
+
+void task_select_status(const TaskTable* table, TaskStatus status, uint64_t* out) {
+    const unsigned char* column = table->status;
+    unsigned char value = (unsigned char)status;
+    SELECT_ROWS(table, out, column[i] == value);
+}
+
+void task_select_project(const TaskTable* table, int project_id, uint64_t* out) {
+    const int* column = table->project_ids;
+    SELECT_ROWS(table, out, column[i] == project_id);
+}
+
+void task_select_flagged(const TaskTable* table, uint64_t* out) {
+    const unsigned char* column = table->flagged;
+    SELECT_ROWS(table, out, column[i]);
+}
+
+void task_select_available(const TaskTable* table, uint64_t* out) {
+    const unsigned char* column = table->available;
+    SELECT_ROWS(table, out, column[i]);
+}
+
+void task_select_deferred_until(const TaskTable* table, time_t time, uint64_t* out) {
+    const time_t* column = table->defer_at;
+    SELECT_ROWS(table, out, column[i] <= time);
+}
+
+void task_select_due_by(const TaskTable* table, time_t time, uint64_t* out) {
+    const time_t* column = table->due_at;
+    SELECT_ROWS(table, out, column[i] <= time);
+}
+
+void task_select_modified_between(const TaskTable* table, time_t after, time_t before,
+                                  uint64_t* out) {
+    const time_t* column = table->modified_at;
+    SELECT_ROWS(table, out, (column[i] > after) & (column[i] < before));
+}
+
+void task_selection_and(uint64_t* dst, const uint64_t* src, int word_count) {
+    for (int i = 0; i < word_count; i++) {
+        dst[i] &= src[i];
+    }
+}
+
+void task_selection_and_not(uint64_t* dst, const uint64_t* src, int word_count) {
+    for (int i = 0; i < word_count; i++) {
+        dst[i] &= ~src[i];
+    }
+}
+
+static int lowest_bit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int bit = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+int task_selection_count(const uint64_t* bits, int word_count) {
+    int count = 0;
+    for (int i = 0; i < word_count; i++) {
+        count += id_bitmap_popcount(bits[i]);
+    }
+    return count;
+}
+
+int task_selection_next(const uint64_t* bits, int word_count, int from) {
+    if (from < 0) {
+        from = 0;
+    }
+    
+    int word = from / 64;
+    if (word >= word_count) {
+        return -1;
+    }
+    
+    // Drop the bits below from in its word
+    uint64_t current = bits[word] & (~0ULL << (from % 64));
+    while (current == 0) {
+        if (++word >= word_count) {
+            return -1;
+        }
+        current = bits[word];
+    }
+    return word * 64 + lowest_bit(current);
+}
+
+// ============================================================================
+// Time-dependent sets
+// ============================================================================
+
+// Add the tasks of the selected rows to a set, in ID order so each
+// container's array only ever grows at the end
+static int add_selected(TaskTable* table, IdBitmap* set, const uint64_t* rows) {
+    for (int id = 0; id < table->row_slot_count; id++) {
+        int row = table->rows[id];
+        if (row >= 0 && ((rows[row / 64] >> (row % 64)) & 1) &&
+            id_bitmap_add(set, id) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// When the next not-done task becomes available or goes stale
+static void find_next_refresh(TaskTable* table) {
+    time_t review_age = table->now - table->review_before;
+    for (int row = 0; row < table->count; row++) {
+        if (table->status[row] == TASK_STATUS_DONE) {
+            continue;
+        }
+        if (table->defer_at[row] > table->now) {
+            note_refresh(table, table->defer_at[row]);
+        }
+        if (table->modified_at[row] >= table->review_before) {
+            note_refresh(table, table->modified_at[row] + review_age + 1);
+        }
+    }
+}
+
+int task_table_set_time(TaskTable* table, time_t now, time_t end_of_today, time_t review_before) {
+    if (table->next_refresh > 0 && now < table->next_refresh) {
+        return 0;
+    }
+    
+    id_bitmap_clear(&table->open_set);
+    id_bitmap_clear(&table->due_set);
+    id_bitmap_clear(&table->stale_set);
+    table->now = now;
+    table->end_of_today = end_of_today;
+    table->review_before = review_before;
+    table->next_refresh = 0;
+    table->version++;
+    
+    int words = TASK_SELECTION_WORDS(table->count);
+    uint64_t* rows = (uint64_t*)malloc(sizeof(uint64_t) * (words > 0 ? words : 1));
+    uint64_t* done = (uint64_t*)malloc(sizeof(uint64_t) * (words > 0 ? words : 1));
+    if (rows == NULL || done == NULL) {
+        free(rows);
+        free(done);
+        return -1;
+    }
+    
+    task_select_status(table, TASK_STATUS_DONE, done);
+    
+    task_select_deferred_until(table, now, rows);
+    task_selection_and_not(rows, done, words);
+    int result = add_selected(table, &table->open_set, rows);
+    
+    task_select_due_by(table, end_of_today, rows);
+    result |= add_selected(table, &table->due_set, rows);
+    
+    task_select_modified_between(table, 0, review_before, rows);
+    task_selection_and_not(rows, done, words);
+    result |= add_selected(table, &table->stale_set, rows);
+    
+    free(rows);
+    free(done);
+    if (result != 0) {
+        id_bitmap_clear(&table->open_set);
+        id_bitmap_clear(&table->due_set);
+        id_bitmap_clear(&table->stale_set);
+        return -1;
+    }
+    
+    // The day's end is the latest the sets can stay as they are
+    table->next_refresh = end_of_today + 1;
+    find_next_refresh(table);
+    return 0;
+}
@@ -0,0 +1,159 @@
+#ifndef TASK_TABLE_H
+#define TASK_TABLE_H
+
+#include "task.h"
+#include "id_bitmap.h"
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * The fields perspective filters and sidebar counts test, for every task,
+ * stored as one packed array per field. A scan reads only the columns it
+ * tests, a few bytes per task instead of a whole Task struct.
+ * 
+ * Rows are in no particular order, and removing a row moves the last one
+ * into its place. Bitmap indexes by task ID answer set questions ("open
+ * and flagged", "open and in project P") without a scan; put and remove
+ * keep them current. Anything derived from the table can be cached until
+ * version changes. A zeroed table is empty and ready to use.
+ */
+typedef struct {
+    int* ids;
+    int* project_ids;           // 0 for the inbox
+    int* order_indexes;
+    time_t* defer_at;
+    time_t* due_at;
+    time_t* modified_at;
+    unsigned char* status;      // TaskStatus
+    unsigned char* flagged;
+    unsigned char* available;
+    int count;
+    int capacity;
+    
+    int* rows;                  // Task ID -> row, -1 if not in the table
+    int row_slot_count;
+    long long seq;              // Task changes up to this sequence number are applied
+    unsigned version;           // Bumped whenever a row or a set changes
+    
+    IdBitmap status_sets[TASK_STATUS_DONE + 1];  // Indexed by TaskStatus
+    IdBitmap flagged_set;
+    IdBitmap available_set;
+    IdBitmap* project_sets;     // Indexed by project ID, 0 for the inbox
+    int project_set_count;
+    
+    // Sets that depend on the time, as of the last task_table_set_time()
+    IdBitmap open_set;          // Not done, and not deferred past now
+    IdBitmap due_set;           // Due by the end of today, or no due date
+    IdBitmap stale_set;         // Not done, and not modified since review_before
+    time_t now;
+    time_t end_of_today;
+    time_t review_before;
+    time_t next_refresh;        // When one of those sets changes next, 0 if not built
+} TaskTable;
+
+/**
+ * Number of 64-bit words in a selection bitmap over count rows.
+ * Bit (row % 64) of word (row / 64) stands for that row.
+ */
+#define TASK_SELECTION_WORDS(count) (((count) + 63) / 64)
+
+/**
+ * Initialize an empty table.
+ */
+void task_table_init(TaskTable* table);
+
+/**
+ * Release everything the table holds and leave it empty.
+ */
+void task_table_free(TaskTable* table);
+
+/**
+ * Remove every row, keeping the memory for reuse. Resets seq to 0, and
+ * the time-dependent sets are rebuilt at the next task_table_set_time().
+ */
+void task_table_clear(TaskTable* table);
+
+/**
+ * Add a task's row, or overwrite it if the task is already there.
+ * 
+ * Returns 0 on success, -1 if out of memory.
+ */
+int task_table_put(TaskTable* table, const Task* task);
+
+/**
+ * Remove a task's row. Does nothing if the task isn't in the table.
+ */
+void task_table_remove(TaskTable* table, int id);
+
+/**
+ * Get the row holding a task, or -1 if it isn't in the table.
+ */
+int task_table_find(const TaskTable* table, int id);
+
+/**
+ * Copy a task's row out of the table. Fields the table doesn't keep are
+ * zeroed; title is NULL.
+ * 
+ * Returns 1 if the task is in the table, 0 if not.
+ */
+int task_table_get(const TaskTable* table, int id, Task* task);
+
+/**
+ * Bring the time-dependent sets up to now. They are rebuilt with the
+ * selection kernels only when a deferred task has become available, a
+ * task has gone stale, the day has ended or the sets were never built;
+ * otherwise this returns at once, so it can run every frame.
+ * 
+ * @param end_of_today Tasks due up to this time count as due today
+ * @param review_before Tasks not modified since this time are stale
+ * 
+ * Returns 0 on success, -1 if out of memory (the sets are left empty
+ * and rebuilt next time).
+ */
+int task_table_set_time(TaskTable* table, time_t now, time_t end_of_today, time_t review_before);
+
+/**
+ * Get the set of tasks in a project (0 for the inbox).
+ * 
+ * Returns the set, or NULL if the project has no tasks.
+ */
+const IdBitmap* task_table_project_set(const TaskTable* table, int project_id);
+
+/**
+ * Selection kernels. Each evaluates one test for every row, 64 rows at a
+ * time, and writes the result to out as a bitmap of
+ * TASK_SELECTION_WORDS(table->count) words; bits past the last row are 0.
+ * Combine them with the task_selection_* functions below.
+ */
+void task_select_status(const TaskTable* table, TaskStatus status, uint64_t* out);
+void task_select_project(const TaskTable* table, int project_id, uint64_t* out);
+void task_select_flagged(const TaskTable* table, uint64_t* out);
+void task_select_available(const TaskTable* table, uint64_t* out);
+void task_select_deferred_until(const TaskTable* table, time_t time, uint64_t* out);  // defer_at <= time
+void task_select_due_by(const TaskTable* table, time_t time, uint64_t* out);          // due_at <= time
+void task_select_modified_between(const TaskTable* table, time_t after, time_t before,
+                                  uint64_t* out);  // after < modified_at < before
+
+/**
+ * dst = dst AND src, over word_count words.
+ */
+void task_selection_and(uint64_t* dst, const uint64_t* src, int word_count);
+
+/**
+ * dst = dst AND NOT src, over word_count words.
+ */
+void task_selection_and_not(uint64_t* dst, const uint64_t* src, int word_count);
+
+/**
+ * Count the selected rows.
+ */
+int task_selection_count(const uint64_t* bits, int word_count);
+
+/**
+ * Find the first selected row at or after from.
+ * 
+ * Returns the row, or -1 if there are no more.
+ */
+int task_selection_next(const uint64_t* bits, int word_count, int from);
+
+#endif // TASK_TABLE_H
@@ -0,0 +1,224 @@
+#include "trace.h"
+#include "platform.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL _Thread_local
+#endif
+
+#define TRACE_MAX_THREADS 64    // Threads that can be named in the trace
+
+// A finished span. written is published last, so a slot is only read
+// once the span in it is complete.
+typedef struct {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int thread_id;
+    atomic_ullong written;      // Index of the span stored here plus 1, 0 if none
+} TraceSpan;
+
+static TraceSpan* spans = NULL;
+static atomic_ullong next_span;
+static atomic_int enabled;
+static atomic_int next_thread_id;
+static const char* thread_names[TRACE_MAX_THREADS];
+static TRACE_THREAD_LOCAL int thread_id = 0;    // 1-based once assigned
+static uint64_t started_at_ns = 0;
+static char trace_path[512];
+static const char* trace_process = NULL;
+static char error_msg[600] = {0};
+
+static void set_error(const char* msg) {
+    snprintf(error_msg, sizeof(error_msg), "%s", msg);
+}
+
+const char* trace_get_error(void) {
+    return error_msg;
+}
+
+static int current_thread_id(void) {
+    if (thread_id == 0) {
+        thread_id = atomic_fetch_add(&next_thread_id, 1) + 1;
+    }
+    return thread_id;
+}
+
+int trace_start(const char* path, const char* process_name) {
+    if (atomic_load(&enabled)) {
+        set_error("Already tracing");
+        return -1;
+    }
+    if (path == NULL || path[0] == '\0') {
+        set_error("No trace file given");
+        return -1;
+    }
+    
+    spans = (TraceSpan*)calloc(TRACE_CAPACITY, sizeof(TraceSpan));
+    if (spans == NULL) {
+        set_error("Out of memory");
+        return -1;
+    }
+    
+    snprintf(trace_path, sizeof(trace_path), "%s", path);
+    trace_process = process_name;
+    atomic_store(&next_span, 0);
+    started_at_ns = platform_now_ns();
+    atomic_store(&enabled, 1);
+    return 0;
+}
+
+int trace_start_from_command_line(int* argc, char** argv, const char* process_name) {
+    const char* path = NULL;
+    size_t flag_len = strlen(TRACE_FLAG);
+    
+    for (int i = 1; i < *argc; i++) {
+        int used = 0;
+        if (strcmp(argv[i], TRACE_FLAG) == 0) {
+            if (i + 1 >= *argc) {
+                set_error(TRACE_FLAG " needs a file path");
+                return -1;
+            }
+            path = argv[i + 1];
+            used = 2;
+        } else if (strncmp(argv[i], TRACE_FLAG, flag_len) == 0 && argv[i][flag_len] == '=') {
+            path = argv[i] + flag_len + 1;
+            used = 1;
+        }
+        
+        if (used > 0) {
+            for (int j = i; j + used <= *argc; j++) {
+                argv[j] = argv[j + used];  // Moves the terminating NULL too
+            }
+            *argc -= used;
+            break;
+        }
+    }
+    
+    if (path == NULL) {
+        path = getenv(TRACE_ENV_VAR);
+        if (path == NULL || path[0] == '\0') {
+            return 0;
+        }
+    }
+    return trace_start(path, process_name);
+}
+
+int trace_enabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+const char* trace_get_path(void) {
+    return trace_enabled() ? trace_path : NULL;
+}
+
+void trace_name_thread(const char* name) {
+    int id = current_thread_id();
+    if (id < TRACE_MAX_THREADS) {
+        thread_names[id] = name;
+    }
+}
+
+uint64_t trace_begin(void) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return 0;
+    }
+    return platform_now_ns();
+}
+
+void trace_end(uint64_t start_ns, const char* name) {
+    if (start_ns == 0 || !atomic_load_explicit(&enabled, memory_order_acquire)) {
+        return;
+    }
+    
+    uint64_t end_ns = platform_now_ns();
+    unsigned long long index = atomic_fetch_add_explicit(&next_span, 1, memory_order_relaxed);
+    TraceSpan* span = &spans[index % TRACE_CAPACITY];
+    
+    // Unpublish first, so a reader never pairs the old index with new data
+    atomic_store_explicit(&span->written, 0, memory_order_relaxed);
+    span->name = name;
+    span->start_ns = start_ns > started_at_ns ? start_ns : started_at_ns;
+    span->duration_ns = end_ns > span->start_ns ? end_ns - span->start_ns : 0;
+    span->thread_id = current_thread_id();
+    atomic_store_explicit(&span->written, index + 1, memory_order_release);
+}
+
+// Names are static identifiers, but keep the file valid whatever they hold
+static void write_json_string(FILE* fp, const char* text) {
+    fputc('"', fp);
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(fp, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(fp, "\\u%04x", *c);
+        } else {
+            fputc(*c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static void write_name_event(FILE* fp, const char* kind, int tid, const char* name) {
+    fprintf(fp, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", kind, tid);
+    write_json_string(fp, name);
+    fprintf(fp, "}},\n");
+}
+
+int trace_stop(void) {
+    if (!atomic_load(&enabled)) {
+        return 0;
+    }
+    atomic_store(&enabled, 0);
+    
+    unsigned long long total = atomic_load(&next_span);
+    unsigned long long first = total > TRACE_CAPACITY ? total - TRACE_CAPACITY : 0;
+    int result = 0;
+    
+    FILE* fp = fopen(trace_path, "w");
+    if (fp == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Cannot write trace file: %s", trace_path);
+        result = -1;
+    } else {
+        fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        write_name_event(fp, "process_name", 0, trace_process != NULL ? trace_process : "samfocus");
+        int thread_count = atomic_load(&next_thread_id);
+        for (int id = 1; id <= thread_count && id < TRACE_MAX_THREADS; id++) {
+            if (thread_names[id] != NULL) {
+                write_name_event(fp, "thread_name", id, thread_names[id]);
+            }
+        }
+        
+        // Oldest first; a slot still being written is skipped
+        for (unsigned long long index = first; index < total; index++) {
+            TraceSpan* span = &spans[index % TRACE_CAPACITY];
+            if (atomic_load_explicit(&span->written, memory_order_acquire) != index + 1) {
+                continue;
+            }
+            fprintf(fp, "{\"name\":");
+            write_json_string(fp, span->name);
+            fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+                    span->thread_id, (double)(span->start_ns - started_at_ns) / 1000.0,
+                    (double)span->duration_ns / 1000.0);
+        }
+        
+        // The array cannot end in a comma; close it with an instant marker
+        fprintf(fp, "{\"name\":\"trace_stop\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}\n",
+                current_thread_id(), (double)(platform_now_ns() - started_at_ns) / 1000.0);
+        fprintf(fp, "],\"otherData\":{\"dropped_spans\":\"%llu\"}}\n", first);
+        
+        if (fclose(fp) != 0) {
+            snprintf(error_msg, sizeof(error_msg), "Cannot write trace file: %s", trace_path);
+            result = -1;
+        }
+    }
+    
+    free(spans);
+    spans = NULL;
+    return result;
+}
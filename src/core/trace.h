@@ -0,0 +1,80 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_CAPACITY 65536    // Spans kept; once full the oldest are overwritten
+#define TRACE_ENV_VAR "SAMFOCUS_TRACE"
+#define TRACE_FLAG "--trace"
+
+/**
+ * Start tracing into a file written by trace_stop().
+ * 
+ * While tracing, finished spans are kept in a ring buffer with their
+ * thread and timestamps, and trace_stop() writes them as Chrome
+ * trace-event JSON for Perfetto or chrome://tracing. Any thread may
+ * record spans. While tracing is off a span costs one atomic load.
+ * 
+ * @param path File to write the trace to
+ * @param process_name Name the viewer shows for the process
+ * 
+ * Returns 0 on success, -1 on error (already tracing, or out of memory).
+ */
+int trace_start(const char* path, const char* process_name);
+
+/**
+ * Start tracing if the command line has --trace PATH (or --trace=PATH) or
+ * the SAMFOCUS_TRACE environment variable names a file. The flag wins
+ * and is removed from argv, so the program's own parsing never sees it.
+ * 
+ * Returns 0 on success, including when no trace was asked for, or -1 on
+ * error.
+ */
+int trace_start_from_command_line(int* argc, char** argv, const char* process_name);
+
+/**
+ * Stop tracing and write the kept spans. Call once every other thread
+ * has stopped recording. Does nothing if tracing is off.
+ * 
+ * Returns 0 on success, -1 if the file could not be written.
+ */
+int trace_stop(void);
+
+/**
+ * Check whether spans are being recorded.
+ */
+int trace_enabled(void);
+
+/**
+ * File the trace is written to, or NULL while tracing is off.
+ */
+const char* trace_get_path(void);
+
+/**
+ * Get the last tracing error message.
+ */
+const char* trace_get_error(void);
+
+/**
+ * Name the calling thread in the trace.
+ * 
+ * @param name Static string; it is not copied
+ */
+void trace_name_thread(const char* name);
+
+/**
+ * Start a span on the calling thread.
+ * 
+ * Returns the start time to pass to trace_end(), or 0 while tracing is off.
+ */
+uint64_t trace_begin(void);
+
+/**
+ * Record a span from start_ns until now. Does nothing if start_ns is 0.
+ * 
+ * @param start_ns Value from trace_begin(), or any platform_now_ns() time
+ * @param name Static string; it is not copied
+ */
+void trace_end(uint64_t start_ns, const char* name);
+
+#endif // TRACE_H
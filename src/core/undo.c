@@ -6,6 +6,13 @@ void undo_init(UndoStack* stack) {
     stack->count = 0;
     stack->current = 0;
     memset(stack->entries, 0, sizeof(stack->entries));
+    string_arena_init(&stack->strings);
+}
+
+// Snapshots outlive the loaded rows, so they keep their own copy of the title
+static const char* keep_title(UndoStack* stack, const char* title) {
+    const char* copy = string_arena_intern(&stack->strings, title, title ? strlen(title) : 0);
+    return copy != NULL ? copy : "";
 }
 
 void undo_record_task_delete(UndoStack* stack, const Task* task) {
@@ -19,6 +26,7 @@ void undo_record_task_delete(UndoStack* stack, const Task* task) {
     UndoEntry* entry = &stack->entries[stack->count];
     entry->type = UNDO_TYPE_TASK_DELETE;
     entry->task_snapshot = *task;
+    entry->task_snapshot.title = keep_title(stack, task->title);
     entry->affected_id = task->id;
     
     stack->count++;
@@ -35,6 +43,7 @@ void undo_record_task_complete(UndoStack* stack, const Task* task) {
     UndoEntry* entry = &stack->entries[stack->count];
     entry->type = UNDO_TYPE_TASK_COMPLETE;
     entry->task_snapshot = *task;
+    entry->task_snapshot.title = keep_title(stack, task->title);
     entry->affected_id = task->id;
     
     stack->count++;
@@ -51,6 +60,7 @@ void undo_record_task_flag(UndoStack* stack, const Task* task) {
     UndoEntry* entry = &stack->entries[stack->count];
     entry->type = UNDO_TYPE_TASK_FLAG;
     entry->task_snapshot = *task;
+    entry->task_snapshot.title = keep_title(stack, task->title);
     entry->affected_id = task->id;
     
     stack->count++;
@@ -82,6 +92,7 @@ void undo_record_task_edit(UndoStack* stack, const Task* old_task) {
     UndoEntry* entry = &stack->entries[stack->count];
     entry->type = UNDO_TYPE_TASK_EDIT;
     entry->task_snapshot = *old_task;
+    entry->task_snapshot.title = keep_title(stack, old_task->title);
     entry->affected_id = old_task->id;
     
     stack->count++;
@@ -98,6 +109,7 @@ void undo_record_project_delete(UndoStack* stack, const Project* project) {
     UndoEntry* entry = &stack->entries[stack->count];
     entry->type = UNDO_TYPE_PROJECT_DELETE;
     entry->project_snapshot = *project;
+    entry->project_snapshot.title = keep_title(stack, project->title);
     entry->affected_id = project->id;
     
     stack->count++;
@@ -176,4 +188,5 @@ int undo_can_undo(UndoStack* stack) {
 void undo_clear(UndoStack* stack) {
     stack->count = 0;
     stack->current = 0;
+    string_arena_reset(&stack->strings);
 }
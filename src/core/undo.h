@@ -3,6 +3,7 @@
 
 #include "task.h"
 #include "project.h"
+#include "string_arena.h"
 
 #define MAX_UNDO_HISTORY 50
 
@@ -28,6 +29,7 @@ typedef struct {
     UndoEntry entries[MAX_UNDO_HISTORY];
     int count;
     int current;  // Current position in history
+    StringArena strings;  // Snapshot titles, kept until undo_clear
 } UndoStack;
 
 // Initialize the undo system
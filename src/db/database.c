@@ -1,48 +1,971 @@
 #include "database.h"
+#include "../core/platform.h"
+#include "../core/trace.h"
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-static sqlite3* db = NULL;
-static char error_msg[512] = {0};
 
-static void set_error(const char* msg) {
-    snprintf(error_msg, sizeof(error_msg), "%s", msg);
+// ============================================================================
+// Materialized availability
+// ============================================================================
+
+// Number of incomplete tasks the current row depends on
+#define BLOCKED_BY_EXPR \
+    "(SELECT COUNT(*) FROM task_dependencies d " \
+    " JOIN tasks b ON b.id = d.depends_on_task_id " \
+    " WHERE d.task_id = tasks.id AND b.status != 2)"
+
+// A task is available when it is not done, not blocked, its defer date has
+// passed, and it is not waiting behind an earlier task in a sequential project.
+// Relies on blocked_by_count already being current for the row.
+#define AVAILABLE_EXPR \
+    "(status != 2 AND blocked_by_count = 0 " \
+    " AND (defer_at IS NULL OR defer_at <= CAST(strftime('%s', 'now') AS INTEGER)) " \
+    " AND (project_id IS NULL " \
+    "      OR (SELECT p.type FROM projects p WHERE p.id = tasks.project_id) IS NOT 0 " \
+    "      OR id = (SELECT h.id FROM tasks h " \
+    "               WHERE h.project_id = tasks.project_id AND h.status != 2 " \
+    "               ORDER BY h.created_at ASC, h.id ASC LIMIT 1)))"
+
+// Perspective indexes, plus the triggers that keep tasks.available and
+// tasks.blocked_by_count current. Applied by schema migration 2.
+static const char* const availability_schema =
+    "CREATE INDEX IF NOT EXISTS idx_tasks_available ON tasks(available, due_at);"
+    "CREATE INDEX IF NOT EXISTS idx_tasks_defer ON tasks(defer_at);"
+    "CREATE INDEX IF NOT EXISTS idx_tasks_project_sequence ON tasks(project_id, created_at, id);"
+    "CREATE INDEX IF NOT EXISTS idx_task_dependencies_blocker "
+    "    ON task_dependencies(depends_on_task_id);"
+    "CREATE INDEX IF NOT EXISTS idx_tasks_status_defer_due ON tasks(status, defer_at, due_at);"
+    "CREATE INDEX IF NOT EXISTS idx_tasks_inbox_open ON tasks(defer_at) "
+    "    WHERE project_id IS NULL AND status != 2;"
+    "CREATE INDEX IF NOT EXISTS idx_tasks_flagged_open ON tasks(defer_at) "
+    "    WHERE flagged = 1 AND status != 2;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_tasks_availability_insert "
+    "AFTER INSERT ON tasks BEGIN "
+    "    UPDATE tasks SET available = " AVAILABLE_EXPR " "
+    "    WHERE id = NEW.id OR project_id = NEW.project_id;"
+    "END;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_tasks_availability_update "
+    "AFTER UPDATE OF status, defer_at, project_id ON tasks BEGIN "
+    "    UPDATE tasks SET blocked_by_count = " BLOCKED_BY_EXPR " "
+    "    WHERE NEW.status IS NOT OLD.status AND id IN "
+    "        (SELECT task_id FROM task_dependencies WHERE depends_on_task_id = NEW.id);"
+    "    UPDATE tasks SET available = " AVAILABLE_EXPR " "
+    "    WHERE id = NEW.id OR project_id = OLD.project_id OR project_id = NEW.project_id "
+    "       OR id IN (SELECT task_id FROM task_dependencies WHERE depends_on_task_id = NEW.id);"
+    "END;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_tasks_availability_delete "
+    "AFTER DELETE ON tasks BEGIN "
+    "    UPDATE tasks SET available = " AVAILABLE_EXPR " "
+    "    WHERE project_id = OLD.project_id;"
+    "END;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_task_dependencies_availability_insert "
+    "AFTER INSERT ON task_dependencies BEGIN "
+    "    UPDATE tasks SET blocked_by_count = " BLOCKED_BY_EXPR " WHERE id = NEW.task_id;"
+    "    UPDATE tasks SET available = " AVAILABLE_EXPR " WHERE id = NEW.task_id;"
+    "END;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_task_dependencies_availability_delete "
+    "AFTER DELETE ON task_dependencies BEGIN "
+    "    UPDATE tasks SET blocked_by_count = " BLOCKED_BY_EXPR " WHERE id = OLD.task_id;"
+    "    UPDATE tasks SET available = " AVAILABLE_EXPR " WHERE id = OLD.task_id;"
+    "END;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_projects_availability_type "
+    "AFTER UPDATE OF type ON projects BEGIN "
+    "    UPDATE tasks SET available = " AVAILABLE_EXPR " WHERE project_id = NEW.id;"
+    "END;";
+
+// ============================================================================
+// Change tracking
+// ============================================================================
+
+// Current time in SQL, in the same unit as the *_at columns
+#define SQL_NOW "CAST(strftime('%s', 'now') AS INTEGER)"
+
+// Deleted task IDs, kept for a week so other processes can notice them.
+// Each deletion prunes the expired ones. Applied by schema migration 3.
+static const char* const tombstone_schema =
+    "CREATE TABLE IF NOT EXISTS deleted_tasks ("
+    "    id INTEGER PRIMARY KEY,"
+    "    deleted_at INTEGER NOT NULL"
+    ");"
+    "CREATE INDEX IF NOT EXISTS idx_deleted_tasks_deleted_at ON deleted_tasks(deleted_at);"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_tasks_tombstone "
+    "AFTER DELETE ON tasks BEGIN "
+    "    INSERT OR REPLACE INTO deleted_tasks (id, deleted_at) VALUES (OLD.id, " SQL_NOW ");"
+    "    DELETE FROM deleted_tasks WHERE deleted_at < " SQL_NOW " - 604800;"
+    "END;";
+
+// Take the next change sequence number; CURRENT_CHANGE_SEQ then reads it
+#define BUMP_CHANGE_SEQ "UPDATE change_counter SET seq = seq + 1 WHERE id = 1;"
+#define CURRENT_CHANGE_SEQ "(SELECT seq FROM change_counter WHERE id = 1)"
+
+// Whether an update touched a column the user edits (in a tasks trigger)
+#define TASK_EDITED \
+    "(NEW.title IS NOT OLD.title OR NEW.notes IS NOT OLD.notes " \
+    " OR NEW.project_id IS NOT OLD.project_id OR NEW.status IS NOT OLD.status " \
+    " OR NEW.defer_at IS NOT OLD.defer_at OR NEW.due_at IS NOT OLD.due_at " \
+    " OR NEW.flagged IS NOT OLD.flagged OR NEW.order_index IS NOT OLD.order_index " \
+    " OR NEW.recurrence IS NOT OLD.recurrence " \
+    " OR NEW.recurrence_interval IS NOT OLD.recurrence_interval)"
+
+// Stamp a task whose links changed (in a task_contexts/task_dependencies trigger)
+#define TOUCH_LINKED_TASK(id) \
+    BUMP_CHANGE_SEQ \
+    "UPDATE tasks SET change_seq = " CURRENT_CHANGE_SEQ ", modified_at = " SQL_NOW \
+    " WHERE id = " id ";"
+
+// Every committed change to a task row, including availability re-derived
+// by the triggers above, gets the next number from change_counter, so
+// "changed since N" is an index range scan on change_seq. Edits to the
+// task or its links also stamp modified_at. Deletions are numbered in
+// deleted_tasks; pruned_seq is the newest tombstone already dropped.
+// Applied by schema migration 4, after change_seq is backfilled.
+static const char* const change_seq_schema =
+    "CREATE INDEX IF NOT EXISTS idx_tasks_change_seq ON tasks(change_seq);"
+    "CREATE INDEX IF NOT EXISTS idx_deleted_tasks_change_seq ON deleted_tasks(change_seq);"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_tasks_change_insert "
+    "AFTER INSERT ON tasks BEGIN "
+    "    " BUMP_CHANGE_SEQ
+    "    UPDATE tasks SET change_seq = " CURRENT_CHANGE_SEQ " WHERE id = NEW.id;"
+    "END;"
+    ""
+    // Updates that only restamp change_seq, or write back unchanged values,
+    // are not changes
+    "CREATE TRIGGER IF NOT EXISTS trg_tasks_change_update "
+    "AFTER UPDATE ON tasks WHEN NEW.change_seq IS OLD.change_seq AND "
+    "    (" TASK_EDITED " OR NEW.available IS NOT OLD.available "
+    "     OR NEW.blocked_by_count IS NOT OLD.blocked_by_count) BEGIN "
+    "    " BUMP_CHANGE_SEQ
+    "    UPDATE tasks SET change_seq = " CURRENT_CHANGE_SEQ ", "
+    "        modified_at = CASE WHEN " TASK_EDITED " THEN " SQL_NOW " ELSE modified_at END "
+    "    WHERE id = NEW.id;"
+    "END;"
+    ""
+    "DROP TRIGGER IF EXISTS trg_tasks_tombstone;"
+    "CREATE TRIGGER trg_tasks_tombstone "
+    "AFTER DELETE ON tasks BEGIN "
+    "    " BUMP_CHANGE_SEQ
+    "    INSERT OR REPLACE INTO deleted_tasks (id, deleted_at, change_seq) "
+    "        VALUES (OLD.id, " SQL_NOW ", " CURRENT_CHANGE_SEQ ");"
+    "    UPDATE change_counter SET pruned_seq = MAX(pruned_seq, IFNULL("
+    "        (SELECT MAX(change_seq) FROM deleted_tasks WHERE deleted_at < " SQL_NOW " - 604800), 0)) "
+    "    WHERE id = 1;"
+    "    DELETE FROM deleted_tasks WHERE deleted_at < " SQL_NOW " - 604800;"
+    "END;"
+    ""
+    "CREATE TRIGGER IF NOT EXISTS trg_task_contexts_change_insert "
+    "AFTER INSERT ON task_contexts BEGIN " TOUCH_LINKED_TASK("NEW.task_id") " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_task_contexts_change_delete "
+    "AFTER DELETE ON task_contexts BEGIN " TOUCH_LINKED_TASK("OLD.task_id") " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_task_dependencies_change_insert "
+    "AFTER INSERT ON task_dependencies BEGIN " TOUCH_LINKED_TASK("NEW.task_id") " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_task_dependencies_change_delete "
+    "AFTER DELETE ON task_dependencies BEGIN " TOUCH_LINKED_TASK("OLD.task_id") " END;";
+
+#define BUMP_PROJECTS_SEQ "UPDATE change_counter SET projects_seq = projects_seq + 1 WHERE id = 1;"
+#define BUMP_CONTEXTS_SEQ "UPDATE change_counter SET contexts_seq = contexts_seq + 1 WHERE id = 1;"
+
+// Any change to the project or context list bumps its own counter, so a
+// reader can tell a task-only commit from one that renamed a project.
+// Applied by schema migration 5.
+static const char* const list_seq_schema =
+    "CREATE TRIGGER IF NOT EXISTS trg_projects_seq_insert "
+    "AFTER INSERT ON projects BEGIN " BUMP_PROJECTS_SEQ " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_projects_seq_update "
+    "AFTER UPDATE ON projects BEGIN " BUMP_PROJECTS_SEQ " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_projects_seq_delete "
+    "AFTER DELETE ON projects BEGIN " BUMP_PROJECTS_SEQ " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_contexts_seq_insert "
+    "AFTER INSERT ON contexts BEGIN " BUMP_CONTEXTS_SEQ " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_contexts_seq_update "
+    "AFTER UPDATE ON contexts BEGIN " BUMP_CONTEXTS_SEQ " END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_contexts_seq_delete "
+    "AFTER DELETE ON contexts BEGIN " BUMP_CONTEXTS_SEQ " END;";
+
+// ============================================================================
+// Prepared statement cache
+// ============================================================================
+
+// Every fixed query the module runs. Statements are prepared once per
+// connection and reset between uses instead of being finalized.
+typedef enum {
+    STMT_BEGIN,
+    STMT_BEGIN_READ,
+    STMT_COMMIT,
+    STMT_ROLLBACK,
+    STMT_SAVEPOINT,
+    STMT_RELEASE_SAVEPOINT,
+    STMT_ROLLBACK_TO_SAVEPOINT,
+    STMT_INSERT_TASK,
+    STMT_GET_TASK,
+    STMT_INSERT_TASK_FULL,
+    STMT_ENSURE_CONTEXT,
+    STMT_LINK_CONTEXT_BY_NAME,
+    STMT_LOAD_TASKS,
+    STMT_LOAD_TASKS_BY_STATUS,
+    STMT_PERSPECTIVE_INBOX,
+    STMT_PERSPECTIVE_TODAY,
+    STMT_PERSPECTIVE_ANYTIME,
+    STMT_PERSPECTIVE_FLAGGED,
+    STMT_PERSPECTIVE_COMPLETED,
+    STMT_PERSPECTIVE_REVIEW,
+    STMT_PERSPECTIVE_PROJECT,
+    STMT_UPDATE_TASK_STATUS,
+    STMT_UPDATE_TASK_TITLE,
+    STMT_UPDATE_TASK_NOTES,
+    STMT_GET_TASK_NOTES,
+    STMT_UPDATE_TASK_DEFER_AT,
+    STMT_UPDATE_TASK_DUE_AT,
+    STMT_UPDATE_TASK_FLAGGED,
+    STMT_UPDATE_TASK_ORDER_INDEX,
+    STMT_DELETE_TASK,
+    STMT_INSERT_PROJECT,
+    STMT_LOAD_PROJECTS,
+    STMT_UPDATE_PROJECT_TITLE,
+    STMT_UPDATE_PROJECT_TYPE,
+    STMT_UNASSIGN_PROJECT_TASKS,
+    STMT_DELETE_PROJECT,
+    STMT_ASSIGN_TASK_TO_PROJECT,
+    STMT_FIRST_INCOMPLETE_TASK_IN_PROJECT,
+    STMT_INSERT_CONTEXT,
+    STMT_LOAD_CONTEXTS,
+    STMT_DELETE_CONTEXT,
+    STMT_ADD_CONTEXT_TO_TASK,
+    STMT_REMOVE_CONTEXT_FROM_TASK,
+    STMT_GET_TASK_CONTEXTS,
+    STMT_TASK_CONTEXT_MAP_SIZE,
+    STMT_TASK_CONTEXT_MAP_LINKS,
+    STMT_UPDATE_TASK_RECURRENCE,
+    STMT_INSERT_RECURRING_INSTANCE,
+    STMT_COPY_TASK_CONTEXTS,
+    STMT_ADD_DEPENDENCY,
+    STMT_REMOVE_DEPENDENCY,
+    STMT_GET_TASK_DEPENDENCIES,
+    STMT_IS_TASK_BLOCKED,
+    STMT_DEFERRED_AVAILABILITY_DUE,
+    STMT_REFRESH_DEFERRED_AVAILABILITY,
+    STMT_NEXT_DEFER_BOUNDARY,
+    STMT_DATA_VERSION,
+    STMT_CHANGE_COUNTER,
+    STMT_LIST_VERSIONS,
+    STMT_TASKS_CHANGED_SINCE,
+    STMT_TASKS_DELETED_SINCE,
+    STMT_TASK_TABLE_ALL,
+    STMT_TASK_TABLE_CHANGED_SINCE,
+    STMT_COUNT
+} StmtId;
+
+// Column list shared by every task query; read_task_rows depends on the order.
+// Lists only need to know whether a task has notes, so the text itself stays
+// in the database until db_get_task_notes asks for it. The dependency count
+// is a lookup in the task_dependencies primary key.
+#define TASK_COLUMNS \
+    "id, title, IFNULL(notes, '') != '', project_id, status, created_at, modified_at, defer_at, due_at, " \
+    "flagged, order_index, recurrence, recurrence_interval, available, blocked_by_count, " \
+    "(SELECT COUNT(*) FROM task_dependencies WHERE task_dependencies.task_id = tasks.id)"
+#define TASK_SELECT "SELECT " TASK_COLUMNS " FROM tasks "
+#define TASK_ORDER "ORDER BY order_index ASC, created_at DESC"
+
+// Perspective filters. ?1 is the perspective's time bound, ?2 the project ID;
+// parameters from ?3 on are free for the context filter.
+#define INBOX_WHERE     "project_id IS NULL AND status != 2 AND defer_at <= ?1"
+#define TODAY_WHERE     "available = 1 AND due_at <= ?1"
+#define ANYTIME_WHERE   "available = 1"
+#define FLAGGED_WHERE   "flagged = 1 AND status != 2 AND defer_at <= ?1"
+#define COMPLETED_WHERE "status = 2"
+#define REVIEW_WHERE    "status != 2 AND modified_at > 0 AND modified_at < ?1"
+#define PROJECT_WHERE \
+    "project_id = ?2 AND status != 2 AND defer_at <= ?1 " \
+    "AND ((SELECT p.type FROM projects p WHERE p.id = ?2) IS NOT 0 " \
+    "     OR id = (SELECT h.id FROM tasks h WHERE h.project_id = ?2 AND h.status != 2 " \
+    "              ORDER BY h.created_at ASC, h.id ASC LIMIT 1))"
+#define CONTEXT_PARAM_BASE 3
+
+// Columns the task table keeps; read_task_table_rows depends on the order
+#define TASK_TABLE_SELECT \
+    "SELECT id, project_id, order_index, defer_at, due_at, modified_at, status, flagged, available " \
+    "FROM tasks "
+
+static const char* const stmt_sql[STMT_COUNT] = {
+    [STMT_BEGIN] = "BEGIN IMMEDIATE;",
+    [STMT_BEGIN_READ] = "BEGIN DEFERRED;",
+    [STMT_COMMIT] = "COMMIT;",
+    [STMT_ROLLBACK] = "ROLLBACK;",
+    [STMT_SAVEPOINT] = "SAVEPOINT write;",
+    [STMT_RELEASE_SAVEPOINT] = "RELEASE write;",
+    [STMT_ROLLBACK_TO_SAVEPOINT] = "ROLLBACK TO write;",
+    [STMT_GET_TASK] = TASK_SELECT "WHERE id = ?;",
+    [STMT_INSERT_TASK_FULL] =
+        "INSERT INTO tasks (title, notes, project_id, status, created_at, modified_at, "
+        "defer_at, due_at, flagged) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);",
+    [STMT_ENSURE_CONTEXT] =
+        "INSERT OR IGNORE INTO contexts (name, color, created_at) VALUES (?, '#888888', ?);",
+    [STMT_LINK_CONTEXT_BY_NAME] =
+        "INSERT OR IGNORE INTO task_contexts (task_id, context_id) "
+        "SELECT ?, id FROM contexts WHERE name = ?;",
+    [STMT_INSERT_TASK] = "INSERT INTO tasks (title, status, created_at, modified_at) VALUES (?, ?, ?, ?);",
+    [STMT_LOAD_TASKS] =
+        TASK_SELECT "ORDER BY order_index ASC, created_at DESC;",
+    [STMT_LOAD_TASKS_BY_STATUS] =
+        TASK_SELECT "WHERE status = ? ORDER BY order_index ASC, created_at DESC;",
+    [STMT_PERSPECTIVE_INBOX] =
+        TASK_SELECT "WHERE " INBOX_WHERE " " TASK_ORDER ";",
+    [STMT_PERSPECTIVE_TODAY] =
+        TASK_SELECT "WHERE " TODAY_WHERE " " TASK_ORDER ";",
+    [STMT_PERSPECTIVE_ANYTIME] =
+        TASK_SELECT "WHERE " ANYTIME_WHERE " " TASK_ORDER ";",
+    [STMT_PERSPECTIVE_FLAGGED] =
+        TASK_SELECT "WHERE " FLAGGED_WHERE " " TASK_ORDER ";",
+    [STMT_PERSPECTIVE_COMPLETED] =
+        TASK_SELECT "WHERE " COMPLETED_WHERE " " TASK_ORDER ";",
+    [STMT_PERSPECTIVE_REVIEW] =
+        TASK_SELECT "WHERE " REVIEW_WHERE " " TASK_ORDER ";",
+    [STMT_PERSPECTIVE_PROJECT] =
+        TASK_SELECT "WHERE " PROJECT_WHERE " " TASK_ORDER ";",
+    [STMT_UPDATE_TASK_STATUS] = "UPDATE tasks SET status = ? WHERE id = ?;",
+    [STMT_UPDATE_TASK_TITLE] = "UPDATE tasks SET title = ? WHERE id = ?;",
+    [STMT_UPDATE_TASK_NOTES] = "UPDATE tasks SET notes = ? WHERE id = ?;",
+    [STMT_GET_TASK_NOTES] = "SELECT notes FROM tasks WHERE id = ?;",
+    [STMT_UPDATE_TASK_DEFER_AT] = "UPDATE tasks SET defer_at = ? WHERE id = ?;",
+    [STMT_UPDATE_TASK_DUE_AT] = "UPDATE tasks SET due_at = ? WHERE id = ?;",
+    [STMT_UPDATE_TASK_FLAGGED] = "UPDATE tasks SET flagged = ? WHERE id = ?;",
+    [STMT_UPDATE_TASK_ORDER_INDEX] = "UPDATE tasks SET order_index = ? WHERE id = ?;",
+    [STMT_DELETE_TASK] = "DELETE FROM tasks WHERE id = ?;",
+    [STMT_INSERT_PROJECT] = "INSERT INTO projects (title, type, created_at) VALUES (?, ?, ?);",
+    [STMT_LOAD_PROJECTS] =
+        "SELECT id, title, type, created_at FROM projects "
+        "ORDER BY created_at ASC;",
+    [STMT_UPDATE_PROJECT_TITLE] = "UPDATE projects SET title = ? WHERE id = ?;",
+    [STMT_UPDATE_PROJECT_TYPE] = "UPDATE projects SET type = ? WHERE id = ?;",
+    [STMT_UNASSIGN_PROJECT_TASKS] = "UPDATE tasks SET project_id = NULL WHERE project_id = ?;",
+    [STMT_DELETE_PROJECT] = "DELETE FROM projects WHERE id = ?;",
+    [STMT_ASSIGN_TASK_TO_PROJECT] = "UPDATE tasks SET project_id = ? WHERE id = ?;",
+    [STMT_FIRST_INCOMPLETE_TASK_IN_PROJECT] =
+        "SELECT id FROM tasks "
+        "WHERE project_id = ? AND status != ? "
+        "ORDER BY created_at ASC, id ASC LIMIT 1;",
+    [STMT_INSERT_CONTEXT] = "INSERT INTO contexts (name, color, created_at) VALUES (?, ?, ?);",
+    [STMT_LOAD_CONTEXTS] = "SELECT id, name, color, created_at FROM contexts ORDER BY name ASC;",
+    [STMT_DELETE_CONTEXT] = "DELETE FROM contexts WHERE id = ?;",
+    [STMT_ADD_CONTEXT_TO_TASK] = "INSERT OR IGNORE INTO task_contexts (task_id, context_id) VALUES (?, ?);",
+    [STMT_REMOVE_CONTEXT_FROM_TASK] = "DELETE FROM task_contexts WHERE task_id = ? AND context_id = ?;",
+    [STMT_GET_TASK_CONTEXTS] =
+        "SELECT c.id, c.name, c.color, c.created_at "
+        "FROM contexts c "
+        "JOIN task_contexts tc ON c.id = tc.context_id "
+        "WHERE tc.task_id = ? "
+        "ORDER BY c.name ASC;",
+    [STMT_TASK_CONTEXT_MAP_SIZE] =
+        "SELECT COALESCE(MAX(task_id), -1), COUNT(*) FROM task_contexts;",
+    [STMT_TASK_CONTEXT_MAP_LINKS] =
+        "SELECT tc.task_id, tc.context_id "
+        "FROM task_contexts tc "
+        "JOIN contexts c ON c.id = tc.context_id "
+        "ORDER BY tc.task_id ASC, c.name ASC;",
+    [STMT_UPDATE_TASK_RECURRENCE] = "UPDATE tasks SET recurrence = ?, recurrence_interval = ? WHERE id = ?;",
+    [STMT_INSERT_RECURRING_INSTANCE] =
+        "INSERT INTO tasks "
+        "(title, notes, project_id, status, created_at, modified_at, "
+        "defer_at, due_at, flagged, order_index, recurrence, recurrence_interval) "
+        "VALUES (?, IFNULL((SELECT notes FROM tasks WHERE id = ?), ''), "
+        "?, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
+    [STMT_COPY_TASK_CONTEXTS] =
+        "INSERT INTO task_contexts (task_id, context_id) "
+        "SELECT ?, context_id FROM task_contexts WHERE task_id = ?;",
+    [STMT_ADD_DEPENDENCY] = "INSERT OR IGNORE INTO task_dependencies (task_id, depends_on_task_id) VALUES (?, ?);",
+    [STMT_REMOVE_DEPENDENCY] = "DELETE FROM task_dependencies WHERE task_id = ? AND depends_on_task_id = ?;",
+    [STMT_GET_TASK_DEPENDENCIES] = "SELECT depends_on_task_id FROM task_dependencies WHERE task_id = ?;",
+    [STMT_IS_TASK_BLOCKED] =
+        "SELECT COUNT(*) FROM task_dependencies d "
+        "JOIN tasks t ON d.depends_on_task_id = t.id "
+        "WHERE d.task_id = ? AND t.status != ?;",
+    [STMT_DEFERRED_AVAILABILITY_DUE] =
+        "SELECT EXISTS (SELECT 1 FROM tasks "
+        "WHERE defer_at > ? AND defer_at <= ? AND status != 2 AND available = 0 "
+        "AND " AVAILABLE_EXPR ");",
+    [STMT_REFRESH_DEFERRED_AVAILABILITY] =
+        "UPDATE tasks SET available = " AVAILABLE_EXPR " "
+        "WHERE defer_at > ? AND defer_at <= ? AND status != 2 AND available = 0;",
+    [STMT_NEXT_DEFER_BOUNDARY] =
+        "SELECT MIN(defer_at) FROM tasks WHERE defer_at > ? AND status != 2;",
+    [STMT_DATA_VERSION] = "PRAGMA data_version;",
+    [STMT_CHANGE_COUNTER] = "SELECT seq, pruned_seq FROM change_counter WHERE id = 1;",
+    [STMT_LIST_VERSIONS] = "SELECT projects_seq, contexts_seq FROM change_counter WHERE id = 1;",
+    [STMT_TASKS_CHANGED_SINCE] =
+        TASK_SELECT "WHERE change_seq > ?1 AND change_seq <= ?2 ORDER BY change_seq;",
+    [STMT_TASKS_DELETED_SINCE] =
+        "SELECT id FROM deleted_tasks WHERE change_seq > ?1 AND change_seq <= ?2 ORDER BY change_seq;",
+    [STMT_TASK_TABLE_ALL] = TASK_TABLE_SELECT ";",
+    [STMT_TASK_TABLE_CHANGED_SINCE] =
+        TASK_TABLE_SELECT "WHERE change_seq > ?1 AND change_seq <= ?2 ORDER BY change_seq;",
+};
+
+// ============================================================================
+// Connection handles
+// ============================================================================
+
+#define DB_MAX_ACTIVE_RUNS 8     // Statement runs timed at once, counting trigger nesting
+
+// A statement run between its first step and the end SQLite reports
+typedef struct {
+    sqlite3_stmt* stmt;
+    uint64_t start_ns;
+    unsigned long long rows;
+} ActiveRun;
+
+// Totals for one statement text while query profiling is on
+typedef struct {
+    DbQueryStats stats;
+    unsigned hash;
+} QueryEntry;
+
+// Everything tied to one connection. The db_* functions use default_db;
+// other handles are independent and may live on other threads.
+struct SamDb {
+    sqlite3* conn;
+    char error_msg[512];
+    sqlite3_stmt* stmt_cache[STMT_COUNT];
+    DbStmtStats stmt_stats;
+    time_t availability_refreshed_at;   // Deferred tasks promoted up to this time
+    ActiveRun runs[DB_MAX_ACTIVE_RUNS];
+    int run_count;
+    int profile_queries;
+    double slow_query_ms;               // 0 logs nothing
+    QueryEntry* queries;
+    int query_count;
+    int query_capacity;
+};
+
+#if defined(_MSC_VER)
+#define DB_THREAD_LOCAL __declspec(thread)
+#else
+#define DB_THREAD_LOCAL _Thread_local
+#endif
+
+// Errors that have no handle to go to: a failed sdb_open(), or a call made
+// through a NULL handle (db_* before db_init)
+static DB_THREAD_LOCAL char fallback_error[512];
+
+// Handle behind the db_* functions
+static SamDb* default_db = NULL;
+
+static void set_error(SamDb* h, const char* msg) {
+    char* buf = h != NULL ? h->error_msg : fallback_error;
+    snprintf(buf, sizeof(fallback_error), "%s", msg);
+}
+
+const char* sdb_get_error(const SamDb* h) {
+    return h != NULL ? h->error_msg : fallback_error;
 }
 
 const char* db_get_error(void) {
-    return error_msg;
+    return sdb_get_error(default_db);
 }
 
-int db_init(const char* db_path) {
-    if (db != NULL) {
-        set_error("Database already initialized");
+static sqlite3_stmt* acquire_stmt(SamDb* h, StmtId id) {
+    if (h->stmt_cache[id] != NULL) {
+        h->stmt_stats.cache_hits++;
+        return h->stmt_cache[id];
+    }
+    
+    int rc = sqlite3_prepare_v3(h->conn, stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT,
+                                &h->stmt_cache[id], NULL);
+    if (rc != SQLITE_OK) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to prepare statement: %s", sqlite3_errmsg(h->conn));
+        h->stmt_cache[id] = NULL;
+        return NULL;
+    }
+    
+    h->stmt_stats.prepares++;
+    return h->stmt_cache[id];
+}
+
+static void release_stmt(sqlite3_stmt* stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+static void finalize_stmt_cache(SamDb* h) {
+    for (int i = 0; i < STMT_COUNT; i++) {
+        if (h->stmt_cache[i] != NULL) {
+            sqlite3_finalize(h->stmt_cache[i]);
+            h->stmt_cache[i] = NULL;
+        }
+    }
+}
+
+void sdb_get_stmt_stats(SamDb* h, DbStmtStats* stats) {
+    if (h != NULL && stats != NULL) {
+        *stats = h->stmt_stats;
+    }
+}
+
+void sdb_reset_stmt_stats(SamDb* h) {
+    if (h == NULL) {
+        return;
+    }
+    memset(&h->stmt_stats, 0, sizeof(DbStmtStats));
+}
+
+static void free_query_stats(SamDb* h) {
+    for (int i = 0; i < h->query_count; i++) {
+        free((char*)h->queries[i].stats.sql);
+    }
+    free(h->queries);
+    h->queries = NULL;
+    h->query_count = 0;
+    h->query_capacity = 0;
+}
+
+// FNV-1a, so most lookups compare a number rather than the whole text
+static unsigned hash_sql(const char* sql) {
+    unsigned hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)sql; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+static void record_query(SamDb* h, const char* sql, uint64_t elapsed_ns, unsigned long long rows) {
+    unsigned hash = hash_sql(sql);
+    QueryEntry* entry = NULL;
+    for (int i = 0; i < h->query_count; i++) {
+        if (h->queries[i].hash == hash && strcmp(h->queries[i].stats.sql, sql) == 0) {
+            entry = &h->queries[i];
+            break;
+        }
+    }
+    
+    if (entry == NULL) {
+        if (h->query_count == h->query_capacity) {
+            int capacity = h->query_capacity > 0 ? h->query_capacity * 2 : 32;
+            QueryEntry* grown = (QueryEntry*)realloc(h->queries, (size_t)capacity * sizeof(QueryEntry));
+            if (grown == NULL) {
+                return;
+            }
+            h->queries = grown;
+            h->query_capacity = capacity;
+        }
+        
+        size_t len = strlen(sql) + 1;
+        char* copy = (char*)malloc(len);
+        if (copy == NULL) {
+            return;
+        }
+        memcpy(copy, sql, len);
+        
+        entry = &h->queries[h->query_count++];
+        memset(entry, 0, sizeof(QueryEntry));
+        entry->stats.sql = copy;
+        entry->hash = hash;
+    }
+    
+    entry->stats.calls++;
+    entry->stats.rows += rows;
+    entry->stats.total_ns += elapsed_ns;
+    if (elapsed_ns > entry->stats.max_ns) {
+        entry->stats.max_ns = elapsed_ns;
+    }
+}
+
+static ActiveRun* find_run(SamDb* h, sqlite3_stmt* stmt) {
+    for (int i = 0; i < h->run_count; i++) {
+        if (h->runs[i].stmt == stmt) {
+            return &h->runs[i];
+        }
+    }
+    return NULL;
+}
+
+// Triggers report the statement again mid-run, so only a new run starts timing
+static void begin_run(SamDb* h, sqlite3_stmt* stmt) {
+    if (h->run_count == DB_MAX_ACTIVE_RUNS || find_run(h, stmt) != NULL) {
+        return;
+    }
+    
+    ActiveRun* run = &h->runs[h->run_count++];
+    run->stmt = stmt;
+    run->start_ns = platform_now_ns();
+    run->rows = 0;
+}
+
+static void end_run(SamDb* h, sqlite3_stmt* stmt, uint64_t sqlite_ns) {
+    uint64_t elapsed_ns = sqlite_ns;
+    unsigned long long rows = 0;
+    ActiveRun* run = find_run(h, stmt);
+    if (run != NULL) {
+        elapsed_ns = platform_now_ns() - run->start_ns;
+        rows = run->rows;
+        *run = h->runs[--h->run_count];
+    }
+    
+    h->stmt_stats.statements++;
+    h->stmt_stats.statement_ns += elapsed_ns;
+    
+    // Plans asked for by sdb_explain_query() are not the app's own statements
+    if (sqlite3_stmt_isexplain(stmt) != 0) {
+        return;
+    }
+    
+    const char* sql = sqlite3_sql(stmt);
+    if (h->profile_queries && sql != NULL) {
+        record_query(h, sql, elapsed_ns, rows);
+    }
+    
+    if (h->slow_query_ms > 0 && (double)elapsed_ns >= h->slow_query_ms * 1e6) {
+        h->stmt_stats.slow_statements++;
+        char* expanded = sqlite3_expanded_sql(stmt);
+        fprintf(stderr, "Slow query (%.3f ms", (double)elapsed_ns / 1e6);
+        if (run != NULL && h->profile_queries) {
+            fprintf(stderr, ", %llu rows", rows);
+        }
+        fprintf(stderr, "): %s\n", expanded != NULL ? expanded : (sql != NULL ? sql : "?"));
+        sqlite3_free(expanded);
+    }
+}
+
+// SQLite reports when each statement run starts, each row while query
+// profiling is on, and the end of the run as it finishes or is reset.
+// Its own run time is in whole milliseconds on many builds, so runs are
+// timed with platform_now_ns() and SQLite's figure is only the fallback
+// when more runs nest than DB_MAX_ACTIVE_RUNS.
+static int trace_statement(unsigned type, void* context, void* p, void* x) {
+    SamDb* h = (SamDb*)context;
+    sqlite3_stmt* stmt = (sqlite3_stmt*)p;
+    
+    if (type == SQLITE_TRACE_STMT) {
+        begin_run(h, stmt);
+    } else if (type == SQLITE_TRACE_ROW) {
+        ActiveRun* run = find_run(h, stmt);
+        if (run != NULL) {
+            run->rows++;
+        }
+    } else if (type == SQLITE_TRACE_PROFILE) {
+        end_run(h, stmt, (uint64_t)*(sqlite3_int64*)x);
+    }
+    return 0;
+}
+
+static void install_trace(SamDb* h) {
+    unsigned mask = SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE;
+    if (h->profile_queries) {
+        mask |= SQLITE_TRACE_ROW;
+    }
+    sqlite3_trace_v2(h->conn, mask, trace_statement, h);
+}
+
+void sdb_set_query_profiling(SamDb* h, int enabled) {
+    if (h == NULL) {
+        return;
+    }
+    h->profile_queries = enabled != 0;
+    install_trace(h);
+}
+
+int sdb_query_profiling_enabled(SamDb* h) {
+    return h != NULL && h->profile_queries;
+}
+
+void sdb_set_slow_query_ms(SamDb* h, double ms) {
+    if (h != NULL) {
+        h->slow_query_ms = ms > 0 ? ms : 0;
+    }
+}
+
+static int compare_query_total(const void* a, const void* b) {
+    const QueryEntry* x = (const QueryEntry*)a;
+    const QueryEntry* y = (const QueryEntry*)b;
+    return (y->stats.total_ns > x->stats.total_ns) - (y->stats.total_ns < x->stats.total_ns);
+}
+
+int sdb_get_query_stats(SamDb* h, DbQueryStats* stats, int max) {
+    if (h == NULL || h->query_count == 0 || max <= 0) {
+        return 0;
+    }
+    
+    // Sorting in place keeps the busiest statements first for later lookups too
+    qsort(h->queries, (size_t)h->query_count, sizeof(QueryEntry), compare_query_total);
+    int count = h->query_count < max ? h->query_count : max;
+    for (int i = 0; i < count; i++) {
+        stats[i] = h->queries[i].stats;
+    }
+    return count;
+}
+
+void sdb_reset_query_stats(SamDb* h) {
+    if (h != NULL) {
+        free_query_stats(h);
+    }
+}
+
+int sdb_explain_query(SamDb* h, const char* sql, char* plan, size_t size) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    if (size == 0) {
+        return -1;
+    }
+    
+    size_t sql_len = strlen(sql);
+    char* explain = (char*)malloc(sql_len + 20);
+    if (explain == NULL) {
+        set_error(h, "Out of memory");
         return -1;
     }
+    memcpy(explain, "EXPLAIN QUERY PLAN ", 19);
+    memcpy(explain + 19, sql, sql_len + 1);
     
-    int rc = sqlite3_open(db_path, &db);
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(h->conn, explain, -1, &stmt, NULL);
+    free(explain);
     if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Cannot open database: %s", sqlite3_errmsg(db));
-        sqlite3_close(db);
-        db = NULL;
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to explain query: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
-    // Enable foreign keys
-    sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+    // Rows come parents first; each is indented one level below its parent
+    int ids[64];
+    int depths[64];
+    int node_count = 0;
+    size_t used = 0;
+    plan[0] = '\0';
+    
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int id = sqlite3_column_int(stmt, 0);
+        int parent = sqlite3_column_int(stmt, 1);
+        const char* detail = (const char*)sqlite3_column_text(stmt, 3);
+        
+        int depth = 0;
+        for (int i = 0; i < node_count; i++) {
+            if (ids[i] == parent) {
+                depth = depths[i] + 1;
+                break;
+            }
+        }
+        if (node_count < 64) {
+            ids[node_count] = id;
+            depths[node_count] = depth;
+            node_count++;
+        }
+        
+        if (used < size) {
+            int written = snprintf(plan + used, size - used, "%*s%s\n", depth * 2, "",
+                                   detail != NULL ? detail : "");
+            used += written > 0 ? (size_t)written : 0;
+        }
+    }
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to explain query: %s", sqlite3_errmsg(h->conn));
+        sqlite3_finalize(stmt);
+        return -1;
+    }
     
+    sqlite3_finalize(stmt);
     return 0;
 }
 
-int db_create_schema(void) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+void db_config_default(DbConfig* config) {
+    config->journal_mode = DB_JOURNAL_WAL;
+    config->synchronous = DB_SYNC_NORMAL;
+    config->cache_size_kb = 8 * 1024;
+    config->mmap_size = 64LL * 1024 * 1024;
+    config->busy_timeout_ms = 5000;
+    config->temp_store = DB_TEMP_STORE_MEMORY;
+    config->single_threaded = 0;
+}
+
+static const char* journal_mode_name(DbJournalMode mode) {
+    switch (mode) {
+        case DB_JOURNAL_DELETE: return "DELETE";
+        case DB_JOURNAL_TRUNCATE: return "TRUNCATE";
+        case DB_JOURNAL_MEMORY: return "MEMORY";
+        case DB_JOURNAL_WAL:
+        default: return "WAL";
+    }
+}
+
+// Apply the connection pragmas from a DbConfig
+static int apply_config(SamDb* h, const DbConfig* config) {
+    char pragmas[512];
+    
+    // busy_timeout goes first so switching the journal mode can wait out
+    // another process holding the file. A negative cache_size is in KiB.
+    snprintf(pragmas, sizeof(pragmas),
+             "PRAGMA foreign_keys = ON;"
+             "PRAGMA busy_timeout = %d;"
+             "PRAGMA journal_mode = %s;"
+             "PRAGMA synchronous = %d;"
+             "PRAGMA temp_store = %d;"
+             "PRAGMA mmap_size = %lld;",
+             config->busy_timeout_ms,
+             journal_mode_name(config->journal_mode),
+             (int)config->synchronous,
+             (int)config->temp_store,
+             config->mmap_size);
+    
+    char* err_msg = NULL;
+    int rc = sqlite3_exec(h->conn, pragmas, NULL, NULL, &err_msg);
+    if (rc == SQLITE_OK && config->cache_size_kb > 0) {
+        char cache_pragma[64];
+        snprintf(cache_pragma, sizeof(cache_pragma),
+                 "PRAGMA cache_size = -%d;", config->cache_size_kb);
+        rc = sqlite3_exec(h->conn, cache_pragma, NULL, NULL, &err_msg);
+    }
+    
+    if (rc != SQLITE_OK) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to configure database: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    
+    return 0;
+}
+
+SamDb* sdb_open(const char* db_path, const DbConfig* config) {
+    DbConfig defaults;
+    if (config == NULL) {
+        db_config_default(&defaults);
+        config = &defaults;
+    }
+    
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    if (config->single_threaded) {
+        flags |= SQLITE_OPEN_NOMUTEX;
+    }
+    
+    SamDb* h = (SamDb*)calloc(1, sizeof(SamDb));
+    if (h == NULL) {
+        set_error(NULL, "Out of memory");
+        return NULL;
+    }
+    
+    int rc = sqlite3_open_v2(db_path, &h->conn, flags, NULL);
+    if (rc != SQLITE_OK) {
+        snprintf(fallback_error, sizeof(fallback_error), 
+                 "Cannot open database: %s", sqlite3_errmsg(h->conn));
+        sqlite3_close(h->conn);
+        free(h);
+        return NULL;
+    }
+    
+    if (apply_config(h, config) != 0) {
+        memcpy(fallback_error, h->error_msg, sizeof(fallback_error));
+        sqlite3_close(h->conn);
+        free(h);
+        return NULL;
+    }
+    
+    install_trace(h);
+    
+    return h;
+}
+
+void sdb_close(SamDb* h) {
+    if (h != NULL) {
+        finalize_stmt_cache(h);
+        sqlite3_close(h->conn);
+        free_query_stats(h);
+        free(h);
+    }
+}
+
+int db_init(const char* db_path) {
+    return db_init_ex(db_path, NULL);
+}
+
+int db_init_ex(const char* db_path, const DbConfig* config) {
+    if (default_db != NULL) {
+        set_error(default_db, "Database already initialized");
+        return -1;
+    }
+    
+    uint64_t span = trace_begin();
+    default_db = sdb_open(db_path, config);
+    trace_end(span, __func__);
+    return default_db != NULL ? 0 : -1;
+}
+
+void db_close(void) {
+    uint64_t span = trace_begin();
+    sdb_close(default_db);
+    default_db = NULL;
+    trace_end(span, __func__);
+}
+
+SamDb* db_get_default_handle(void) {
+    return default_db;
+}
+
+// ============================================================================
+// Schema migrations
+// ============================================================================
+
+// Run a block of schema SQL, reporting failures as "Failed to <what>: ..."
+static int exec_schema_sql(SamDb* h, const char* sql, const char* what) {
+    char* err = NULL;
+    int rc = sqlite3_exec(h->conn, sql, NULL, NULL, &err);
+    
+    if (rc != SQLITE_OK) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to %s: %s", what, err ? err : sqlite3_errmsg(h->conn));
+        sqlite3_free(err);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Add a column unless the table already has it. Files created before
+// migrations were versioned can have any subset of the later columns.
+// Returns 1 if the column was added, 0 if it existed, -1 on error.
+static int add_column_if_missing(SamDb* h, const char* table, const char* column, const char* decl) {
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(h->conn, "SELECT 1 FROM pragma_table_info(?) WHERE name = ?;",
+                                -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to inspect table %s: %s", table, sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, column, -1, SQLITE_STATIC);
+    int exists = (sqlite3_step(stmt) == SQLITE_ROW);
+    sqlite3_finalize(stmt);
+    
+    if (exists) {
+        return 0;
+    }
+    
+    char sql[256];
+    snprintf(sql, sizeof(sql), "ALTER TABLE %s ADD COLUMN %s %s;", table, column, decl);
+    if (exec_schema_sql(h, sql, "add column") != 0) {
         return -1;
     }
     
+    return 1;
+}
+
+// Migration 1: the base tables, plus the task columns that unversioned
+// files picked up one ALTER TABLE at a time
+static int migrate_base_schema(SamDb* h) {
     const char* schema = 
         "CREATE TABLE IF NOT EXISTS tasks ("
         "    id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -56,13 +979,10 @@ int db_create_schema(void) {
         "    due_at INTEGER DEFAULT 0,"
         "    flagged INTEGER DEFAULT 0,"
         "    order_index INTEGER DEFAULT 0,"
+        "    recurrence INTEGER DEFAULT 0,"
+        "    recurrence_interval INTEGER DEFAULT 1,"
         "    FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE SET NULL"
         ");"
-        "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status);"
-        "CREATE INDEX IF NOT EXISTS idx_tasks_project ON tasks(project_id);"
-        "CREATE INDEX IF NOT EXISTS idx_tasks_flagged ON tasks(flagged);"
-        "CREATE INDEX IF NOT EXISTS idx_tasks_order ON tasks(order_index);"
-        "CREATE INDEX IF NOT EXISTS idx_tasks_modified ON tasks(modified_at);"
         ""
         "CREATE TABLE IF NOT EXISTS projects ("
         "    id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -94,172 +1014,305 @@ int db_create_schema(void) {
         "    FOREIGN KEY (depends_on_task_id) REFERENCES tasks(id) ON DELETE CASCADE"
         ");";
     
-    char* err = NULL;
-    int rc = sqlite3_exec(db, schema, NULL, NULL, &err);
-    
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to create schema: %s", err ? err : "unknown error");
-        sqlite3_free(err);
+    if (exec_schema_sql(h, schema, "create schema") != 0) {
         return -1;
     }
     
-    // Migrate existing databases - add flagged column if it doesn't exist
-    // This will fail silently if the column already exists, which is fine
-    sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN flagged INTEGER DEFAULT 0;", NULL, NULL, NULL);
-    
-    // Migrate existing databases - add order_index column if it doesn't exist
-    sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN order_index INTEGER DEFAULT 0;", NULL, NULL, NULL);
+    if (add_column_if_missing(h, "tasks", "flagged", "INTEGER DEFAULT 0") < 0 ||
+        add_column_if_missing(h, "tasks", "order_index", "INTEGER DEFAULT 0") < 0 ||
+        add_column_if_missing(h, "tasks", "recurrence", "INTEGER DEFAULT 0") < 0 ||
+        add_column_if_missing(h, "tasks", "recurrence_interval", "INTEGER DEFAULT 1") < 0) {
+        return -1;
+    }
     
-    // Migrate existing databases - add modified_at column if it doesn't exist
-    sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN modified_at INTEGER DEFAULT 0;", NULL, NULL, NULL);
+    int added = add_column_if_missing(h, "tasks", "modified_at", "INTEGER DEFAULT 0");
+    if (added < 0) {
+        return -1;
+    }
+    if (added && exec_schema_sql(h, "UPDATE tasks SET modified_at = created_at WHERE modified_at = 0;",
+                                 "backfill modified_at") != 0) {
+        return -1;
+    }
     
-    // Update any tasks with modified_at=0 to use created_at
-    sqlite3_exec(db, "UPDATE tasks SET modified_at = created_at WHERE modified_at = 0;", NULL, NULL, NULL);
+    return exec_schema_sql(h,
+        "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status);"
+        "CREATE INDEX IF NOT EXISTS idx_tasks_project ON tasks(project_id);"
+        "CREATE INDEX IF NOT EXISTS idx_tasks_flagged ON tasks(flagged);"
+        "CREATE INDEX IF NOT EXISTS idx_tasks_order ON tasks(order_index);"
+        "CREATE INDEX IF NOT EXISTS idx_tasks_modified ON tasks(modified_at);"
+        "CREATE INDEX IF NOT EXISTS idx_task_contexts_context ON task_contexts(context_id, task_id);",
+        "create indexes");
+}
+
+// Migration 2: materialized availability columns, perspective indexes and
+// the triggers that keep them current, with a one-off full recompute
+static int migrate_availability(SamDb* h) {
+    if (add_column_if_missing(h, "tasks", "available", "INTEGER NOT NULL DEFAULT 0") < 0 ||
+        add_column_if_missing(h, "tasks", "blocked_by_count", "INTEGER NOT NULL DEFAULT 0") < 0) {
+        return -1;
+    }
     
-    // Migrate existing databases - add recurrence columns if they don't exist
-    sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN recurrence INTEGER DEFAULT 0;", NULL, NULL, NULL);
-    sqlite3_exec(db, "ALTER TABLE tasks ADD COLUMN recurrence_interval INTEGER DEFAULT 1;", NULL, NULL, NULL);
+    if (exec_schema_sql(h, availability_schema, "create availability triggers") != 0) {
+        return -1;
+    }
     
-    return 0;
+    return exec_schema_sql(h,
+        "UPDATE tasks SET blocked_by_count = " BLOCKED_BY_EXPR ";"
+        "UPDATE tasks SET available = " AVAILABLE_EXPR ";",
+        "backfill availability");
 }
 
-void db_close(void) {
-    if (db != NULL) {
-        sqlite3_close(db);
-        db = NULL;
-    }
+// Migration 3: remember deleted task IDs for change detection
+static int migrate_task_tombstones(SamDb* h) {
+    return exec_schema_sql(h, tombstone_schema, "create task tombstones");
 }
 
-int db_insert_task(const char* title, TaskStatus status) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+// Migration 4: change sequence numbers, backfilled in ID order before the
+// triggers that maintain them exist
+static int migrate_change_seq(SamDb* h) {
+    if (add_column_if_missing(h, "tasks", "change_seq", "INTEGER NOT NULL DEFAULT 0") < 0 ||
+        add_column_if_missing(h, "deleted_tasks", "change_seq", "INTEGER NOT NULL DEFAULT 0") < 0) {
         return -1;
     }
     
-    if (title == NULL || title[0] == '\0') {
-        set_error("Task title cannot be empty");
+    if (exec_schema_sql(h,
+            "CREATE TABLE IF NOT EXISTS change_counter ("
+            "    id INTEGER PRIMARY KEY CHECK (id = 1),"
+            "    seq INTEGER NOT NULL,"
+            "    pruned_seq INTEGER NOT NULL DEFAULT 0"
+            ");"
+            "UPDATE tasks SET change_seq = id;"
+            "INSERT OR IGNORE INTO change_counter (id, seq) SELECT 1, IFNULL(MAX(id), 0) FROM tasks;",
+            "backfill change sequence") != 0) {
         return -1;
     }
     
-    time_t now = time(NULL);
-    const char* sql = "INSERT INTO tasks (title, status, created_at, modified_at) VALUES (?, ?, ?, ?);";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    return exec_schema_sql(h, change_seq_schema, "create change tracking triggers");
+}
+
+// Migration 5: change counters for the project and context lists
+static int migrate_list_seqs(SamDb* h) {
+    if (add_column_if_missing(h, "change_counter", "projects_seq", "INTEGER NOT NULL DEFAULT 0") < 0 ||
+        add_column_if_missing(h, "change_counter", "contexts_seq", "INTEGER NOT NULL DEFAULT 0") < 0) {
         return -1;
     }
     
-    sqlite3_bind_text(stmt, 1, title, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 2, status);
-    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)now);
-    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)now);
+    return exec_schema_sql(h, list_seq_schema, "create list change triggers");
+}
+
+// Migration N lives at index N - 1. Append new migrations here and bump
+// DB_SCHEMA_VERSION; never edit one that has shipped.
+typedef int (*MigrationFn)(SamDb* h);
+
+static const MigrationFn migrations[DB_SCHEMA_VERSION] = {
+    migrate_base_schema,
+    migrate_availability,
+    migrate_task_tombstones,
+    migrate_change_seq,
+    migrate_list_seqs,
+};
+
+int sdb_get_schema_version(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
     
-    rc = sqlite3_step(stmt);
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(h->conn, "PRAGMA user_version;", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to read schema version: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    int version = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
     sqlite3_finalize(stmt);
     
-    if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to insert task: %s", sqlite3_errmsg(db));
+    return version;
+}
+
+// Apply the next pending migration in its own transaction. The version is
+// re-read under the write lock so two processes starting together don't
+// both apply it. Returns 1 if a migration ran, 0 if none was pending.
+static int apply_next_migration(SamDb* h) {
+    if (exec_schema_sql(h, "BEGIN IMMEDIATE;", "begin migration") != 0) {
+        return -1;
+    }
+    
+    int version = sdb_get_schema_version(h);
+    if (version < 0 || version >= DB_SCHEMA_VERSION) {
+        sqlite3_exec(h->conn, "ROLLBACK;", NULL, NULL, NULL);
+        return version < 0 ? -1 : 0;
+    }
+    
+    char set_version[64];
+    snprintf(set_version, sizeof(set_version), "PRAGMA user_version = %d;", version + 1);
+    
+    if (migrations[version](h) != 0 ||
+        exec_schema_sql(h, set_version, "update schema version") != 0 ||
+        exec_schema_sql(h, "COMMIT;", "commit migration") != 0) {
+        // Keep the migration's error rather than the rollback's
+        char saved[sizeof(h->error_msg)];
+        memcpy(saved, h->error_msg, sizeof(saved));
+        sqlite3_exec(h->conn, "ROLLBACK;", NULL, NULL, NULL);
+        memcpy(h->error_msg, saved, sizeof(h->error_msg));
         return -1;
     }
     
-    return (int)sqlite3_last_insert_rowid(db);
+    return 1;
 }
 
-int db_load_tasks(Task** tasks, int* count, int status_filter) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_create_schema(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    if (tasks == NULL || count == NULL) {
-        set_error("Invalid parameters");
+    // A current file costs the pragma read, plus one indexed read for
+    // deferred tasks that came due while it was closed
+    int version = sdb_get_schema_version(h);
+    if (version < 0) {
         return -1;
     }
     
-    *tasks = NULL;
-    *count = 0;
+    if (version > DB_SCHEMA_VERSION) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Database schema version %d is newer than this build supports (%d)",
+                 version, DB_SCHEMA_VERSION);
+        return -1;
+    }
     
-    // Build query based on filter
-    const char* sql;
-    if (status_filter >= 0) {
-        sql = "SELECT id, title, notes, project_id, status, created_at, modified_at, defer_at, due_at, flagged, order_index, recurrence, recurrence_interval FROM tasks "
-              "WHERE status = ? ORDER BY order_index ASC, created_at DESC;";
-    } else {
-        sql = "SELECT id, title, notes, project_id, status, created_at, modified_at, defer_at, due_at, flagged, order_index, recurrence, recurrence_interval FROM tasks "
-              "ORDER BY order_index ASC, created_at DESC;";
+    while (version < DB_SCHEMA_VERSION) {
+        int rc = apply_next_migration(h);
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc == 0) {
+            break;
+        }
+        version++;
     }
     
-    sqlite3_stmt* stmt = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    // Promote any tasks whose defer date passed while the file was closed.
+    // Statements are compiled on first use, so a short-lived CLI command
+    // only prepares the few it runs.
+    h->availability_refreshed_at = 0;
+    if (sdb_refresh_availability(h, time(NULL)) < 0) {
         return -1;
     }
     
-    if (status_filter >= 0) {
-        sqlite3_bind_int(stmt, 1, status_filter);
+    return 0;
+}
+
+int sdb_insert_task(SamDb* h, const char* title, TaskStatus status) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (title == NULL || title[0] == '\0') {
+        set_error(h, "Task title cannot be empty");
+        return -1;
+    }
+    
+    time_t now = time(NULL);
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_INSERT_TASK);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_text(stmt, 1, title, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, status);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)now);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)now);
+    
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to insert task: %s", sqlite3_errmsg(h->conn));
+        return -1;
     }
     
-    // Count results first
+    return (int)sqlite3_last_insert_rowid(h->conn);
+}
+
+// Copy a text column into the arena. Returns NULL if out of memory.
+static const char* read_text(sqlite3_stmt* stmt, int column, StringArena* strings) {
+    const char* text = (const char*)sqlite3_column_text(stmt, column);
+    return string_arena_intern(strings, text, (size_t)sqlite3_column_bytes(stmt, column));
+}
+
+// Decode the current row of a task query (columns in TASK_COLUMNS order).
+// Returns 0 on success, -1 if the title didn't fit in the arena.
+static int read_task_row(sqlite3_stmt* stmt, Task* task, StringArena* strings) {
+    task->id = sqlite3_column_int(stmt, 0);
+    task->title = read_text(stmt, 1, strings);
+    task->has_notes = sqlite3_column_int(stmt, 2);
+    task->project_id = sqlite3_column_int(stmt, 3);
+    task->status = (TaskStatus)sqlite3_column_int(stmt, 4);
+    task->created_at = (time_t)sqlite3_column_int64(stmt, 5);
+    task->modified_at = (time_t)sqlite3_column_int64(stmt, 6);
+    task->defer_at = (time_t)sqlite3_column_int64(stmt, 7);
+    task->due_at = (time_t)sqlite3_column_int64(stmt, 8);
+    task->flagged = sqlite3_column_int(stmt, 9);
+    task->order_index = sqlite3_column_int(stmt, 10);
+    task->recurrence = (RecurrencePattern)sqlite3_column_int(stmt, 11);
+    task->recurrence_interval = sqlite3_column_int(stmt, 12);
+    task->available = sqlite3_column_int(stmt, 13);
+    task->blocked_by_count = sqlite3_column_int(stmt, 14);
+    task->dependency_count = sqlite3_column_int(stmt, 15);
+    return task->title != NULL ? 0 : -1;
+}
+
+// Step a task query to completion, appending each row to a growing array and
+// each title to the arena. Columns must be in TASK_COLUMNS order. Does not
+// reset the statement.
+static int read_task_rows(SamDb* h, sqlite3_stmt* stmt, Task** tasks, int* count,
+                          StringArena* strings) {
+    *tasks = NULL;
+    *count = 0;
+    
     int capacity = 16;
     *tasks = (Task*)malloc(sizeof(Task) * capacity);
     if (*tasks == NULL) {
-        set_error("Out of memory");
-        sqlite3_finalize(stmt);
+        set_error(h, "Out of memory");
         return -1;
     }
     
+    int rc;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         if (*count >= capacity) {
             capacity *= 2;
             Task* new_tasks = (Task*)realloc(*tasks, sizeof(Task) * capacity);
             if (new_tasks == NULL) {
-                set_error("Out of memory");
+                set_error(h, "Out of memory");
                 free(*tasks);
                 *tasks = NULL;
                 *count = 0;
-                sqlite3_finalize(stmt);
                 return -1;
             }
             *tasks = new_tasks;
         }
         
-        Task* task = &(*tasks)[*count];
-        task->id = sqlite3_column_int(stmt, 0);
-        
-        const char* title = (const char*)sqlite3_column_text(stmt, 1);
-        strncpy(task->title, title ? title : "", sizeof(task->title) - 1);
-        task->title[sizeof(task->title) - 1] = '\0';
-        
-        const char* notes = (const char*)sqlite3_column_text(stmt, 2);
-        strncpy(task->notes, notes ? notes : "", sizeof(task->notes) - 1);
-        task->notes[sizeof(task->notes) - 1] = '\0';
-        
-        task->project_id = sqlite3_column_int(stmt, 3);
-        task->status = (TaskStatus)sqlite3_column_int(stmt, 4);
-        task->created_at = (time_t)sqlite3_column_int64(stmt, 5);
-        task->modified_at = (time_t)sqlite3_column_int64(stmt, 6);
-        task->defer_at = (time_t)sqlite3_column_int64(stmt, 7);
-        task->due_at = (time_t)sqlite3_column_int64(stmt, 8);
-        task->flagged = sqlite3_column_int(stmt, 9);
-        task->order_index = sqlite3_column_int(stmt, 10);
-        task->recurrence = (RecurrencePattern)sqlite3_column_int(stmt, 11);
-        task->recurrence_interval = sqlite3_column_int(stmt, 12);
-        
+        if (read_task_row(stmt, &(*tasks)[*count], strings) != 0) {
+            set_error(h, "Out of memory");
+            free(*tasks);
+            *tasks = NULL;
+            *count = 0;
+            return -1;
+        }
         (*count)++;
     }
     
-    sqlite3_finalize(stmt);
-    
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Error reading tasks: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading tasks: %s", sqlite3_errmsg(h->conn));
         free(*tasks);
         *tasks = NULL;
         *count = 0;
@@ -269,252 +1322,422 @@ int db_load_tasks(Task** tasks, int* count, int status_filter) {
     return 0;
 }
 
-int db_update_task_status(int id, TaskStatus status) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_load_tasks(SamDb* h, Task** tasks, int* count, int status_filter,
+                   StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET status = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
+    if (tasks == NULL || count == NULL || strings == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    *tasks = NULL;
+    *count = 0;
+    
+    // Pick the cached query based on filter
+    sqlite3_stmt* stmt = acquire_stmt(h, status_filter >= 0 ? STMT_LOAD_TASKS_BY_STATUS
+                                                         : STMT_LOAD_TASKS);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    if (status_filter >= 0) {
+        sqlite3_bind_int(stmt, 1, status_filter);
+    }
+    
+    int result = read_task_rows(h, stmt, tasks, count, strings);
+    release_stmt(stmt);
+    return result;
+}
+
+// Bind the time bound (?1) and project (?2) a perspective filter uses
+static void bind_perspective_params(sqlite3_stmt* stmt, PerspectiveKind kind,
+                                    const PerspectiveParams* params) {
+    switch (kind) {
+        case PERSPECTIVE_INBOX:
+        case PERSPECTIVE_FLAGGED:
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)params->now);
+            break;
+        case PERSPECTIVE_TODAY:
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)params->end_of_today);
+            break;
+        case PERSPECTIVE_REVIEW:
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)params->review_before);
+            break;
+        case PERSPECTIVE_PROJECT:
+            sqlite3_bind_int64(stmt, 1, (sqlite3_int64)params->now);
+            sqlite3_bind_int(stmt, 2, params->project_id);
+            break;
+        default:
+            break;
+    }
+}
+
+// Context-filtered perspectives vary in the number of context IDs, so they are
+// built per call. The subquery is answered from idx_task_contexts_context.
+static int load_perspective_with_contexts(SamDb* h, const char* where, PerspectiveKind kind,
+                                          const PerspectiveParams* params,
+                                          Task** tasks, int* count, StringArena* strings) {
+    size_t sql_size = strlen(TASK_SELECT) + strlen(where) + 256 +
+                      (size_t)params->context_count * 8;
+    char* sql = (char*)malloc(sql_size);
+    if (sql == NULL) {
+        set_error(h, "Out of memory");
+        return -1;
+    }
+    
+    int len = snprintf(sql, sql_size,
+                       TASK_SELECT "WHERE %s AND id IN "
+                       "(SELECT task_id FROM task_contexts WHERE context_id IN (",
+                       where);
+    for (int i = 0; i < params->context_count; i++) {
+        len += snprintf(sql + len, sql_size - (size_t)len, "%s?%d",
+                        i > 0 ? ", " : "", CONTEXT_PARAM_BASE + i);
+    }
+    if (params->context_match == CONTEXT_MATCH_ALL) {
+        // Every selected context must be linked to the task; an ID given
+        // twice still counts once
+        int distinct = 0;
+        for (int i = 0; i < params->context_count; i++) {
+            int seen = 0;
+            for (int j = 0; j < i && !seen; j++) {
+                seen = params->context_ids[j] == params->context_ids[i];
+            }
+            distinct += !seen;
+        }
+        snprintf(sql + len, sql_size - (size_t)len,
+                 ") GROUP BY task_id HAVING COUNT(DISTINCT context_id) = %d) " TASK_ORDER ";",
+                 distinct);
+    } else {
+        snprintf(sql + len, sql_size - (size_t)len, ")) " TASK_ORDER ";");
+    }
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(h->conn, sql, -1, &stmt, NULL);
+    free(sql);
     if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to prepare statement: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    bind_perspective_params(stmt, kind, params);
+    for (int i = 0; i < params->context_count; i++) {
+        sqlite3_bind_int(stmt, CONTEXT_PARAM_BASE + i, params->context_ids[i]);
+    }
+    
+    int result = read_task_rows(h, stmt, tasks, count, strings);
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+int sdb_load_perspective(SamDb* h, PerspectiveKind kind, const PerspectiveParams* params,
+                         Task** tasks, int* count, StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (params == NULL || tasks == NULL || count == NULL || strings == NULL ||
+        (params->context_count > 0 && params->context_ids == NULL)) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    *tasks = NULL;
+    *count = 0;
+    
+    StmtId id;
+    const char* where;
+    switch (kind) {
+        case PERSPECTIVE_INBOX:     id = STMT_PERSPECTIVE_INBOX;     where = INBOX_WHERE; break;
+        case PERSPECTIVE_TODAY:     id = STMT_PERSPECTIVE_TODAY;     where = TODAY_WHERE; break;
+        case PERSPECTIVE_ANYTIME:   id = STMT_PERSPECTIVE_ANYTIME;   where = ANYTIME_WHERE; break;
+        case PERSPECTIVE_FLAGGED:   id = STMT_PERSPECTIVE_FLAGGED;   where = FLAGGED_WHERE; break;
+        case PERSPECTIVE_COMPLETED: id = STMT_PERSPECTIVE_COMPLETED; where = COMPLETED_WHERE; break;
+        case PERSPECTIVE_REVIEW:    id = STMT_PERSPECTIVE_REVIEW;    where = REVIEW_WHERE; break;
+        case PERSPECTIVE_PROJECT:   id = STMT_PERSPECTIVE_PROJECT;   where = PROJECT_WHERE; break;
+        default:
+            set_error(h, "Unknown perspective");
+            return -1;
+    }
+    
+    if (params->context_count > 0) {
+        return load_perspective_with_contexts(h, where, kind, params, tasks, count, strings);
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, id);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    bind_perspective_params(stmt, kind, params);
+    
+    int result = read_task_rows(h, stmt, tasks, count, strings);
+    release_stmt(stmt);
+    return result;
+}
+
+int sdb_update_task_status(SamDb* h, int id, TaskStatus status) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_STATUS);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, status);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_task_title(int id, const char* title) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_task_title(SamDb* h, int id, const char* title) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     if (title == NULL || title[0] == '\0') {
-        set_error("Task title cannot be empty");
+        set_error(h, "Task title cannot be empty");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET title = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_TITLE);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_text(stmt, 1, title, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_task_notes(int id, const char* notes) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_task_notes(SamDb* h, int id, const char* notes) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET notes = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_NOTES);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_text(stmt, 1, notes ? notes : "", -1, SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task notes: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task notes: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_task_defer_at(int id, time_t defer_at) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_get_task_notes(SamDb* h, int id, char** notes) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET defer_at = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
+    if (notes == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    *notes = NULL;
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_GET_TASK_NOTES);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_int(stmt, 1, id);
+    
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        const char* text = (const char*)sqlite3_column_text(stmt, 0);
+        size_t len = (size_t)sqlite3_column_bytes(stmt, 0);
+        *notes = (char*)malloc(len + 1);
+        if (*notes != NULL) {
+            memcpy(*notes, text ? text : "", len);  // NULL notes have 0 bytes
+            (*notes)[len] = '\0';
+        }
+    }
+    release_stmt(stmt);
+    
+    if (rc == SQLITE_DONE) {
+        set_error(h, "Task not found");
+        return -1;
+    }
+    
+    if (rc != SQLITE_ROW) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading task notes: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    if (*notes == NULL) {
+        set_error(h, "Out of memory");
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_update_task_defer_at(SamDb* h, int id, time_t defer_at) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_DEFER_AT);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int64(stmt, 1, (sqlite3_int64)defer_at);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_task_due_at(int id, time_t due_at) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_task_due_at(SamDb* h, int id, time_t due_at) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET due_at = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_DUE_AT);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int64(stmt, 1, (sqlite3_int64)due_at);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_task_flagged(int id, int flagged) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_task_flagged(SamDb* h, int id, int flagged) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET flagged = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_FLAGGED);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, flagged ? 1 : 0);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task flagged status: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task flagged status: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_task_order_index(int id, int order_index) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_task_order_index(SamDb* h, int id, int order_index) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET order_index = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_ORDER_INDEX);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, order_index);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task order: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task order: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_delete_task(int id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_delete_task(SamDb* h, int id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "DELETE FROM tasks WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_DELETE_TASK);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to delete task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to delete task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
@@ -525,24 +1748,19 @@ int db_delete_task(int id) {
 // Project operations
 // ============================================================================
 
-int db_insert_project(const char* title, ProjectType type) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_insert_project(SamDb* h, const char* title, ProjectType type) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     if (title == NULL || title[0] == '\0') {
-        set_error("Project title cannot be empty");
+        set_error(h, "Project title cannot be empty");
         return -1;
     }
     
-    const char* sql = "INSERT INTO projects (title, type, created_at) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_INSERT_PROJECT);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -550,61 +1768,56 @@ int db_insert_project(const char* title, ProjectType type) {
     sqlite3_bind_int(stmt, 2, type);
     sqlite3_bind_int64(stmt, 3, (sqlite3_int64)time(NULL));
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to insert project: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to insert project: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
-    return (int)sqlite3_last_insert_rowid(db);
+    return (int)sqlite3_last_insert_rowid(h->conn);
 }
 
-int db_load_projects(Project** projects, int* count) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_load_projects(SamDb* h, Project** projects, int* count, StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    if (projects == NULL || count == NULL) {
-        set_error("Invalid parameters");
+    if (projects == NULL || count == NULL || strings == NULL) {
+        set_error(h, "Invalid parameters");
         return -1;
     }
     
     *projects = NULL;
     *count = 0;
     
-    const char* sql = "SELECT id, title, type, created_at FROM projects "
-                     "ORDER BY created_at ASC;";
-    
-    sqlite3_stmt* stmt = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_LOAD_PROJECTS);
+    if (stmt == NULL) {
         return -1;
     }
     
     int capacity = 16;
     *projects = (Project*)malloc(sizeof(Project) * capacity);
     if (*projects == NULL) {
-        set_error("Out of memory");
-        sqlite3_finalize(stmt);
+        set_error(h, "Out of memory");
+        release_stmt(stmt);
         return -1;
     }
     
+    int rc;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         if (*count >= capacity) {
             capacity *= 2;
             Project* new_projects = (Project*)realloc(*projects, sizeof(Project) * capacity);
             if (new_projects == NULL) {
-                set_error("Out of memory");
+                set_error(h, "Out of memory");
                 free(*projects);
                 *projects = NULL;
                 *count = 0;
-                sqlite3_finalize(stmt);
+                release_stmt(stmt);
                 return -1;
             }
             *projects = new_projects;
@@ -612,22 +1825,27 @@ int db_load_projects(Project** projects, int* count) {
         
         Project* project = &(*projects)[*count];
         project->id = sqlite3_column_int(stmt, 0);
-        
-        const char* title = (const char*)sqlite3_column_text(stmt, 1);
-        strncpy(project->title, title ? title : "", sizeof(project->title) - 1);
-        project->title[sizeof(project->title) - 1] = '\0';
-        
+        project->title = read_text(stmt, 1, strings);
         project->type = (ProjectType)sqlite3_column_int(stmt, 2);
         project->created_at = (time_t)sqlite3_column_int64(stmt, 3);
         
+        if (project->title == NULL) {
+            set_error(h, "Out of memory");
+            free(*projects);
+            *projects = NULL;
+            *count = 0;
+            release_stmt(stmt);
+            return -1;
+        }
+        
         (*count)++;
     }
     
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Error reading projects: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading projects: %s", sqlite3_errmsg(h->conn));
         free(*projects);
         *projects = NULL;
         *count = 0;
@@ -637,135 +1855,112 @@ int db_load_projects(Project** projects, int* count) {
     return 0;
 }
 
-int db_update_project_title(int id, const char* title) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_project_title(SamDb* h, int id, const char* title) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     if (title == NULL || title[0] == '\0') {
-        set_error("Project title cannot be empty");
+        set_error(h, "Project title cannot be empty");
         return -1;
     }
     
-    const char* sql = "UPDATE projects SET title = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_PROJECT_TITLE);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_text(stmt, 1, title, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update project: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update project: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_update_project_type(int id, ProjectType type) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_project_type(SamDb* h, int id, ProjectType type) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE projects SET type = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_PROJECT_TYPE);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, type);
     sqlite3_bind_int(stmt, 2, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update project type: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update project type: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_delete_project(int id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_delete_project(SamDb* h, int id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     // First, unassign all tasks from this project
-    const char* unassign_sql = "UPDATE tasks SET project_id = NULL WHERE project_id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, unassign_sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UNASSIGN_PROJECT_TASKS);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, id);
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to unassign tasks: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to unassign tasks: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     // Now delete the project
-    const char* delete_sql = "DELETE FROM projects WHERE id = ?;";
-    rc = sqlite3_prepare_v2(db, delete_sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    stmt = acquire_stmt(h, STMT_DELETE_PROJECT);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, id);
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to delete project: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to delete project: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_assign_task_to_project(int task_id, int project_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_assign_task_to_project(SamDb* h, int task_id, int project_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET project_id = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_ASSIGN_TASK_TO_PROJECT);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -776,52 +1971,45 @@ int db_assign_task_to_project(int task_id, int project_id) {
     }
     sqlite3_bind_int(stmt, 2, task_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to assign task to project: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to assign task to project: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_get_first_incomplete_task_in_project(int project_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_get_first_incomplete_task_in_project(SamDb* h, int project_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -2;
     }
     
-    const char* sql = "SELECT id FROM tasks "
-                     "WHERE project_id = ? AND status != ? "
-                     "ORDER BY created_at ASC LIMIT 1;";
-    
-    sqlite3_stmt* stmt = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_FIRST_INCOMPLETE_TASK_IN_PROJECT);
+    if (stmt == NULL) {
         return -2;
     }
     
     sqlite3_bind_int(stmt, 1, project_id);
     sqlite3_bind_int(stmt, 2, TASK_STATUS_DONE);
     
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     
     int task_id = -1;
     if (rc == SQLITE_ROW) {
         task_id = sqlite3_column_int(stmt, 0);
     } else if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Error querying first task: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error querying first task: %s", sqlite3_errmsg(h->conn));
+        release_stmt(stmt);
         return -2;
     }
     
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return task_id;
 }
 
@@ -829,24 +2017,19 @@ int db_get_first_incomplete_task_in_project(int project_id) {
 // Context operations
 // ============================================================================
 
-int db_insert_context(const char* name, const char* color) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_insert_context(SamDb* h, const char* name, const char* color) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     if (name == NULL || name[0] == '\0') {
-        set_error("Context name cannot be empty");
+        set_error(h, "Context name cannot be empty");
         return -1;
     }
     
-    const char* sql = "INSERT INTO contexts (name, color, created_at) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_INSERT_CONTEXT);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -854,86 +2037,92 @@ int db_insert_context(const char* name, const char* color) {
     sqlite3_bind_text(stmt, 2, color ? color : "#888888", -1, SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 3, (sqlite3_int64)time(NULL));
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to insert context: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to insert context: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
-    return (int)sqlite3_last_insert_rowid(db);
+    return (int)sqlite3_last_insert_rowid(h->conn);
 }
 
-int db_load_contexts(Context** contexts, int* count) {
-    if (db == NULL) {
-        set_error("Database not initialized");
-        return -1;
+// Decode the current row of a context query (id, name, color, created_at).
+// Returns 0 on success, -1 if the strings didn't fit in the arena.
+static int read_context_row(sqlite3_stmt* stmt, Context* context, StringArena* strings) {
+    context->id = sqlite3_column_int(stmt, 0);
+    context->name = read_text(stmt, 1, strings);
+    if (sqlite3_column_type(stmt, 2) == SQLITE_NULL) {
+        context->color = string_arena_intern(strings, "#888888", 7);
+    } else {
+        context->color = read_text(stmt, 2, strings);
     }
-    
-    if (contexts == NULL || count == NULL) {
-        set_error("Invalid parameters");
+    context->created_at = (time_t)sqlite3_column_int64(stmt, 3);
+    return context->name != NULL && context->color != NULL ? 0 : -1;
+}
+
+int sdb_load_contexts(SamDb* h, Context** contexts, int* count, StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (contexts == NULL || count == NULL || strings == NULL) {
+        set_error(h, "Invalid parameters");
         return -1;
     }
     
     *contexts = NULL;
     *count = 0;
     
-    const char* sql = "SELECT id, name, color, created_at FROM contexts ORDER BY name ASC;";
-    
-    sqlite3_stmt* stmt = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_LOAD_CONTEXTS);
+    if (stmt == NULL) {
         return -1;
     }
     
     int capacity = 8;
     *contexts = (Context*)malloc(sizeof(Context) * capacity);
     if (*contexts == NULL) {
-        set_error("Out of memory");
-        sqlite3_finalize(stmt);
+        set_error(h, "Out of memory");
+        release_stmt(stmt);
         return -1;
     }
     
+    int rc;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         if (*count >= capacity) {
             capacity *= 2;
             Context* new_contexts = (Context*)realloc(*contexts, sizeof(Context) * capacity);
             if (new_contexts == NULL) {
-                set_error("Out of memory");
+                set_error(h, "Out of memory");
                 free(*contexts);
                 *contexts = NULL;
                 *count = 0;
-                sqlite3_finalize(stmt);
+                release_stmt(stmt);
                 return -1;
             }
             *contexts = new_contexts;
         }
         
-        Context* context = &(*contexts)[*count];
-        context->id = sqlite3_column_int(stmt, 0);
-        
-        const char* name = (const char*)sqlite3_column_text(stmt, 1);
-        strncpy(context->name, name ? name : "", sizeof(context->name) - 1);
-        context->name[sizeof(context->name) - 1] = '\0';
-        
-        const char* color = (const char*)sqlite3_column_text(stmt, 2);
-        strncpy(context->color, color ? color : "#888888", sizeof(context->color) - 1);
-        context->color[sizeof(context->color) - 1] = '\0';
-        
-        context->created_at = (time_t)sqlite3_column_int64(stmt, 3);
+        if (read_context_row(stmt, &(*contexts)[*count], strings) != 0) {
+            set_error(h, "Out of memory");
+            free(*contexts);
+            *contexts = NULL;
+            *count = 0;
+            release_stmt(stmt);
+            return -1;
+        }
         
         (*count)++;
     }
     
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Error reading contexts: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading contexts: %s", sqlite3_errmsg(h->conn));
         free(*contexts);
         *contexts = NULL;
         *count = 0;
@@ -943,123 +2132,100 @@ int db_load_contexts(Context** contexts, int* count) {
     return 0;
 }
 
-int db_delete_context(int id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_delete_context(SamDb* h, int id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "DELETE FROM contexts WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_DELETE_CONTEXT);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to delete context: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to delete context: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_add_context_to_task(int task_id, int context_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_add_context_to_task(SamDb* h, int task_id, int context_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "INSERT OR IGNORE INTO task_contexts (task_id, context_id) VALUES (?, ?);";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_ADD_CONTEXT_TO_TASK);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, task_id);
     sqlite3_bind_int(stmt, 2, context_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to add context to task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to add context to task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_remove_context_from_task(int task_id, int context_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_remove_context_from_task(SamDb* h, int task_id, int context_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "DELETE FROM task_contexts WHERE task_id = ? AND context_id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_REMOVE_CONTEXT_FROM_TASK);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, task_id);
     sqlite3_bind_int(stmt, 2, context_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to remove context from task: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to remove context from task: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_get_task_contexts(int task_id, Context** contexts, int* count) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_get_task_contexts(SamDb* h, int task_id, Context** contexts, int* count,
+                          StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    if (contexts == NULL || count == NULL) {
-        set_error("Invalid parameters");
+    if (contexts == NULL || count == NULL || strings == NULL) {
+        set_error(h, "Invalid parameters");
         return -1;
     }
     
     *contexts = NULL;
     *count = 0;
     
-    const char* sql = "SELECT c.id, c.name, c.color, c.created_at "
-                     "FROM contexts c "
-                     "JOIN task_contexts tc ON c.id = tc.context_id "
-                     "WHERE tc.task_id = ? "
-                     "ORDER BY c.name ASC;";
-    
-    sqlite3_stmt* stmt = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_GET_TASK_CONTEXTS);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -1068,47 +2234,44 @@ int db_get_task_contexts(int task_id, Context** contexts, int* count) {
     int capacity = 4;
     *contexts = (Context*)malloc(sizeof(Context) * capacity);
     if (*contexts == NULL) {
-        set_error("Out of memory");
-        sqlite3_finalize(stmt);
+        set_error(h, "Out of memory");
+        release_stmt(stmt);
         return -1;
     }
     
+    int rc;
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         if (*count >= capacity) {
             capacity *= 2;
             Context* new_contexts = (Context*)realloc(*contexts, sizeof(Context) * capacity);
             if (new_contexts == NULL) {
-                set_error("Out of memory");
+                set_error(h, "Out of memory");
                 free(*contexts);
                 *contexts = NULL;
                 *count = 0;
-                sqlite3_finalize(stmt);
+                release_stmt(stmt);
                 return -1;
             }
             *contexts = new_contexts;
         }
         
-        Context* context = &(*contexts)[*count];
-        context->id = sqlite3_column_int(stmt, 0);
-        
-        const char* name = (const char*)sqlite3_column_text(stmt, 1);
-        strncpy(context->name, name ? name : "", sizeof(context->name) - 1);
-        context->name[sizeof(context->name) - 1] = '\0';
-        
-        const char* color = (const char*)sqlite3_column_text(stmt, 2);
-        strncpy(context->color, color ? color : "#888888", sizeof(context->color) - 1);
-        context->color[sizeof(context->color) - 1] = '\0';
-        
-        context->created_at = (time_t)sqlite3_column_int64(stmt, 3);
+        if (read_context_row(stmt, &(*contexts)[*count], strings) != 0) {
+            set_error(h, "Out of memory");
+            free(*contexts);
+            *contexts = NULL;
+            *count = 0;
+            release_stmt(stmt);
+            return -1;
+        }
         
         (*count)++;
     }
     
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Error reading task contexts: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading task contexts: %s", sqlite3_errmsg(h->conn));
         free(*contexts);
         *contexts = NULL;
         *count = 0;
@@ -1118,28 +2281,132 @@ int db_get_task_contexts(int task_id, Context** contexts, int* count) {
     return 0;
 }
 
+// Defined with the transaction helpers below
+static int exec_control_stmt(SamDb* h, StmtId id, const char* what);
+static int end_batch(SamDb* h, int owned, int result);
+
+// Size the arrays, then fill them in a single pass. Both queries must see
+// the same snapshot; a link or task beyond what was sized is an error.
+static int read_task_context_map(SamDb* h, TaskContextMap* map) {
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_TASK_CONTEXT_MAP_SIZE);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    int max_task_id = -1;
+    int link_total = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        max_task_id = sqlite3_column_int(stmt, 0);
+        link_total = sqlite3_column_int(stmt, 1);
+    }
+    release_stmt(stmt);
+    
+    if (max_task_id < 0) {
+        max_task_id = 0;
+    }
+    
+    int* offsets = (int*)calloc((size_t)max_task_id + 2, sizeof(int));
+    int* context_ids = (int*)malloc(sizeof(int) * (link_total > 0 ? link_total : 1));
+    if (offsets == NULL || context_ids == NULL) {
+        set_error(h, "Out of memory");
+        free(offsets);
+        free(context_ids);
+        return -1;
+    }
+    
+    stmt = acquire_stmt(h, STMT_TASK_CONTEXT_MAP_LINKS);
+    if (stmt == NULL) {
+        free(offsets);
+        free(context_ids);
+        return -1;
+    }
+    
+    // Rows arrive grouped by task, so count per task then prefix-sum
+    int n = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int task_id = sqlite3_column_int(stmt, 0);
+        if (n == link_total || task_id < 0 || task_id > max_task_id) {
+            break;
+        }
+        context_ids[n++] = sqlite3_column_int(stmt, 1);
+        offsets[task_id + 1]++;
+    }
+    
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        if (rc == SQLITE_ROW) {
+            set_error(h, "Task context links changed while loading");
+        } else {
+            snprintf(h->error_msg, sizeof(h->error_msg), 
+                     "Error reading task context map: %s", sqlite3_errmsg(h->conn));
+        }
+        free(offsets);
+        free(context_ids);
+        return -1;
+    }
+    
+    for (int i = 1; i <= max_task_id + 1; i++) {
+        offsets[i] += offsets[i - 1];
+    }
+    
+    map->offsets = offsets;
+    map->context_ids = context_ids;
+    map->max_task_id = max_task_id;
+    map->link_count = n;
+    
+    return 0;
+}
+
+int sdb_load_task_context_map(SamDb* h, TaskContextMap* map) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (map == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    map->offsets = NULL;
+    map->context_ids = NULL;
+    map->max_task_id = -1;
+    map->link_count = 0;
+    
+    // A read transaction keeps other connections' commits out from between
+    // the two queries. Inside the caller's transaction that already holds.
+    int owned = sqlite3_get_autocommit(h->conn);
+    if (owned && exec_control_stmt(h, STMT_BEGIN_READ, "begin") != 0) {
+        return -1;
+    }
+    
+    int result = read_task_context_map(h, map);
+    if (end_batch(h, owned, result) != 0) {
+        task_context_map_free(map);
+        return -1;
+    }
+    return 0;
+}
+
 // ============================================================================
 // Recurrence operations
 // ============================================================================
 
-int db_update_task_recurrence(int id, RecurrencePattern pattern, int interval) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_update_task_recurrence(SamDb* h, int id, RecurrencePattern pattern, int interval) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     if (interval < 1) {
-        set_error("Recurrence interval must be at least 1");
+        set_error(h, "Recurrence interval must be at least 1");
         return -1;
     }
     
-    const char* sql = "UPDATE tasks SET recurrence = ?, recurrence_interval = ? WHERE id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_UPDATE_TASK_RECURRENCE);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -1147,26 +2414,26 @@ int db_update_task_recurrence(int id, RecurrencePattern pattern, int interval) {
     sqlite3_bind_int(stmt, 2, interval);
     sqlite3_bind_int(stmt, 3, id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to update task recurrence: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to update task recurrence: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_create_recurring_instance(Task* template_task) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_create_recurring_instance(SamDb* h, Task* template_task) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     if (template_task == NULL) {
-        set_error("Template task cannot be NULL");
+        set_error(h, "Template task cannot be NULL");
         return -1;
     }
     
@@ -1218,21 +2485,13 @@ int db_create_recurring_instance(Task* template_task) {
     }
     
     // Create the new task instance
-    const char* sql = "INSERT INTO tasks "
-                     "(title, notes, project_id, status, created_at, modified_at, "
-                     "defer_at, due_at, flagged, order_index, recurrence, recurrence_interval) "
-                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_INSERT_RECURRING_INSTANCE);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_text(stmt, 1, template_task->title, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, template_task->notes, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, template_task->id);  // Notes are copied from the stored row
     
     if (template_task->project_id == 0) {
         sqlite3_bind_null(stmt, 3);
@@ -1251,28 +2510,24 @@ int db_create_recurring_instance(Task* template_task) {
     sqlite3_bind_int(stmt, 11, (int)template_task->recurrence);
     sqlite3_bind_int(stmt, 12, template_task->recurrence_interval);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to create recurring instance: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to create recurring instance: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
-    int new_task_id = (int)sqlite3_last_insert_rowid(db);
+    int new_task_id = (int)sqlite3_last_insert_rowid(h->conn);
     
     // Copy contexts from template to new instance
-    const char* copy_contexts_sql = 
-        "INSERT INTO task_contexts (task_id, context_id) "
-        "SELECT ?, context_id FROM task_contexts WHERE task_id = ?;";
-    
-    rc = sqlite3_prepare_v2(db, copy_contexts_sql, -1, &stmt, NULL);
-    if (rc == SQLITE_OK) {
+    stmt = acquire_stmt(h, STMT_COPY_TASK_CONTEXTS);
+    if (stmt != NULL) {
         sqlite3_bind_int(stmt, 1, new_task_id);
         sqlite3_bind_int(stmt, 2, template_task->id);
         sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        release_stmt(stmt);
     }
     
     return new_task_id;
@@ -1282,87 +2537,72 @@ int db_create_recurring_instance(Task* template_task) {
 // Task dependency operations
 // ============================================================================
 
-int db_add_dependency(int task_id, int depends_on_task_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_add_dependency(SamDb* h, int task_id, int depends_on_task_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     // Prevent self-dependency
     if (task_id == depends_on_task_id) {
-        set_error("Task cannot depend on itself");
+        set_error(h, "Task cannot depend on itself");
         return -1;
     }
     
-    const char* sql = "INSERT OR IGNORE INTO task_dependencies (task_id, depends_on_task_id) VALUES (?, ?);";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_ADD_DEPENDENCY);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, task_id);
     sqlite3_bind_int(stmt, 2, depends_on_task_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to add dependency: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to add dependency: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_remove_dependency(int task_id, int depends_on_task_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_remove_dependency(SamDb* h, int task_id, int depends_on_task_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "DELETE FROM task_dependencies WHERE task_id = ? AND depends_on_task_id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_REMOVE_DEPENDENCY);
+    if (stmt == NULL) {
         return -1;
     }
     
     sqlite3_bind_int(stmt, 1, task_id);
     sqlite3_bind_int(stmt, 2, depends_on_task_id);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
     
     if (rc != SQLITE_DONE) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to remove dependency: %s", sqlite3_errmsg(db));
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to remove dependency: %s", sqlite3_errmsg(h->conn));
         return -1;
     }
     
     return 0;
 }
 
-int db_get_task_dependencies(int task_id, int** dependency_ids, int* count) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_get_task_dependencies(SamDb* h, int task_id, int** dependency_ids, int* count) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
-    const char* sql = "SELECT depends_on_task_id FROM task_dependencies WHERE task_id = ?;";
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_GET_TASK_DEPENDENCIES);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -1379,15 +2619,15 @@ int db_get_task_dependencies(int task_id, int** dependency_ids, int* count) {
     
     if (result_count == 0) {
         *dependency_ids = NULL;
-        sqlite3_finalize(stmt);
+        release_stmt(stmt);
         return 0;
     }
     
     // Allocate array
     *dependency_ids = (int*)malloc(result_count * sizeof(int));
     if (*dependency_ids == NULL) {
-        sqlite3_finalize(stmt);
-        set_error("Memory allocation failed");
+        release_stmt(stmt);
+        set_error(h, "Memory allocation failed");
         return -1;
     }
     
@@ -1397,28 +2637,19 @@ int db_get_task_dependencies(int task_id, int** dependency_ids, int* count) {
         (*dependency_ids)[i++] = sqlite3_column_int(stmt, 0);
     }
     
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return 0;
 }
 
-int db_is_task_blocked(int task_id) {
-    if (db == NULL) {
-        set_error("Database not initialized");
+int sdb_is_task_blocked(SamDb* h, int task_id) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
         return -1;
     }
     
     // Check if any dependencies are not completed
-    const char* sql = 
-        "SELECT COUNT(*) FROM task_dependencies d "
-        "JOIN tasks t ON d.depends_on_task_id = t.id "
-        "WHERE d.task_id = ? AND t.status != ?;";
-    
-    sqlite3_stmt* stmt = NULL;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        snprintf(error_msg, sizeof(error_msg), 
-                 "Failed to prepare statement: %s", sqlite3_errmsg(db));
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_IS_TASK_BLOCKED);
+    if (stmt == NULL) {
         return -1;
     }
     
@@ -1431,6 +2662,1169 @@ int db_is_task_blocked(int task_id) {
         blocked = (incomplete_count > 0) ? 1 : 0;
     }
     
-    sqlite3_finalize(stmt);
+    release_stmt(stmt);
     return blocked;
 }
+
+// ============================================================================
+// Availability maintenance
+// ============================================================================
+
+int sdb_refresh_availability(SamDb* h, time_t now) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (now <= h->availability_refreshed_at) {
+        return 0;
+    }
+    
+    // Only rows whose defer date fell inside (last refresh, now] can change.
+    // Look before writing: the UPDATE takes the write lock even when no row
+    // matches, and would wait on another connection's commit.
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_DEFERRED_AVAILABILITY_DUE);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)h->availability_refreshed_at);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)now);
+    
+    int rc = sqlite3_step(stmt);
+    int due = rc == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 0;
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_ROW) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to check availability: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    if (!due) {
+        h->availability_refreshed_at = now;
+        return 0;
+    }
+    
+    stmt = acquire_stmt(h, STMT_REFRESH_DEFERRED_AVAILABILITY);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)h->availability_refreshed_at);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)now);
+    
+    rc = sqlite3_step(stmt);
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to refresh availability: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    h->availability_refreshed_at = now;
+    return sqlite3_changes(h->conn);
+}
+
+time_t sdb_get_next_defer_boundary(SamDb* h, time_t now) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return 0;
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_NEXT_DEFER_BOUNDARY);
+    if (stmt == NULL) {
+        return 0;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)now);
+    
+    time_t boundary = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        boundary = (time_t)sqlite3_column_int64(stmt, 0);
+    }
+    
+    release_stmt(stmt);
+    return boundary;
+}
+
+// ============================================================================
+// Change detection
+// ============================================================================
+
+int sdb_get_data_version(SamDb* h, long long* version) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (version == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_DATA_VERSION);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        *version = (long long)sqlite3_column_int64(stmt, 0);
+    }
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_ROW) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to read data version: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Read the newest change number and the newest one whose tombstone is gone
+static int read_change_counter(SamDb* h, long long* seq, long long* pruned_seq) {
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_CHANGE_COUNTER);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        *seq = (long long)sqlite3_column_int64(stmt, 0);
+        *pruned_seq = (long long)sqlite3_column_int64(stmt, 1);
+    }
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_ROW) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to read change sequence: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_get_change_seq(SamDb* h, long long* seq) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (seq == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    long long pruned_seq;
+    return read_change_counter(h, seq, &pruned_seq);
+}
+
+int sdb_get_list_versions(SamDb* h, long long* projects, long long* contexts) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (projects == NULL || contexts == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_LIST_VERSIONS);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        *projects = (long long)sqlite3_column_int64(stmt, 0);
+        *contexts = (long long)sqlite3_column_int64(stmt, 1);
+    }
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_ROW) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to read list versions: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Load the IDs of tasks deleted in (since, until]
+static int load_deleted_task_ids(SamDb* h, long long since, long long until,
+                                 int** ids, int* count) {
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_TASKS_DELETED_SINCE);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)since);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)until);
+    
+    int capacity = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (*count >= capacity) {
+            capacity = capacity > 0 ? capacity * 2 : 16;
+            int* grown = (int*)realloc(*ids, sizeof(int) * capacity);
+            if (grown == NULL) {
+                break;
+            }
+            *ids = grown;
+        }
+        (*ids)[(*count)++] = sqlite3_column_int(stmt, 0);
+    }
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        if (rc == SQLITE_ROW) {
+            set_error(h, "Out of memory");
+        } else {
+            snprintf(h->error_msg, sizeof(h->error_msg), 
+                     "Error reading deleted tasks: %s", sqlite3_errmsg(h->conn));
+        }
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_load_tasks_changed_since(SamDb* h, long long seq, TaskChanges* changes,
+                                 StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (changes == NULL || strings == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    memset(changes, 0, sizeof(TaskChanges));
+    
+    // Numbers are taken under the write lock, so everything up to the
+    // counter read here has committed. Bounding both queries by it keeps
+    // them consistent without a read transaction; later commits are left
+    // for the next call.
+    long long pruned_seq;
+    if (read_change_counter(h, &changes->seq, &pruned_seq) != 0) {
+        return -1;
+    }
+    changes->expired = pruned_seq > seq;
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_TASKS_CHANGED_SINCE);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)seq);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)changes->seq);
+    
+    int result = read_task_rows(h, stmt, &changes->tasks, &changes->task_count, strings);
+    release_stmt(stmt);
+    
+    if (result == 0) {
+        result = load_deleted_task_ids(h, seq, changes->seq,
+                                       &changes->deleted_ids, &changes->deleted_count);
+    }
+    if (result != 0) {
+        db_free_task_changes(changes);
+    }
+    return result;
+}
+
+void db_free_task_changes(TaskChanges* changes) {
+    if (changes == NULL) {
+        return;
+    }
+    
+    free(changes->tasks);
+    free(changes->deleted_ids);
+    memset(changes, 0, sizeof(TaskChanges));
+}
+
+// Step a TASK_TABLE_SELECT query to completion, storing each row in the
+// table. Does not reset the statement.
+static int read_task_table_rows(SamDb* h, sqlite3_stmt* stmt, TaskTable* table) {
+    Task task;
+    memset(&task, 0, sizeof(Task));
+    
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        task.id = sqlite3_column_int(stmt, 0);
+        task.project_id = sqlite3_column_int(stmt, 1);
+        task.order_index = sqlite3_column_int(stmt, 2);
+        task.defer_at = (time_t)sqlite3_column_int64(stmt, 3);
+        task.due_at = (time_t)sqlite3_column_int64(stmt, 4);
+        task.modified_at = (time_t)sqlite3_column_int64(stmt, 5);
+        task.status = (TaskStatus)sqlite3_column_int(stmt, 6);
+        task.flagged = sqlite3_column_int(stmt, 7);
+        task.available = sqlite3_column_int(stmt, 8);
+        if (task_table_put(table, &task) != 0) {
+            set_error(h, "Out of memory");
+            return -1;
+        }
+    }
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading tasks: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_sync_task_table(SamDb* h, TaskTable* table) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (table == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    // Bounded by the counter like sdb_load_tasks_changed_since
+    long long seq;
+    long long pruned_seq;
+    if (read_change_counter(h, &seq, &pruned_seq) != 0) {
+        return -1;
+    }
+    
+    // Deletions the table hasn't seen may be forgotten: start over
+    int reload = table->seq == 0 || pruned_seq > table->seq;
+    int* deleted_ids = NULL;
+    int deleted_count = 0;
+    if (!reload && load_deleted_task_ids(h, table->seq, seq, &deleted_ids, &deleted_count) != 0) {
+        free(deleted_ids);
+        return -1;
+    }
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, reload ? STMT_TASK_TABLE_ALL : STMT_TASK_TABLE_CHANGED_SINCE);
+    if (stmt == NULL) {
+        free(deleted_ids);
+        return -1;
+    }
+    
+    if (reload) {
+        task_table_clear(table);
+    } else {
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)table->seq);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)seq);
+        for (int i = 0; i < deleted_count; i++) {
+            task_table_remove(table, deleted_ids[i]);
+        }
+    }
+    free(deleted_ids);
+    
+    int result = read_task_table_rows(h, stmt, table);
+    release_stmt(stmt);
+    
+    // A partly applied change set can't be resumed; the next call reloads
+    table->seq = result == 0 ? seq : 0;
+    return result;
+}
+
+// ============================================================================
+// Transactions and batch operations
+// ============================================================================
+
+// Run one of the cached transaction control statements
+static int exec_control_stmt(SamDb* h, StmtId id, const char* what) {
+    sqlite3_stmt* stmt = acquire_stmt(h, id);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to %s transaction: %s", what, sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_begin(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    return exec_control_stmt(h, STMT_BEGIN, "begin");
+}
+
+int sdb_commit(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    return exec_control_stmt(h, STMT_COMMIT, "commit");
+}
+
+int sdb_rollback(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    return exec_control_stmt(h, STMT_ROLLBACK, "roll back");
+}
+
+int sdb_savepoint(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    return exec_control_stmt(h, STMT_SAVEPOINT, "open savepoint in");
+}
+
+int sdb_release_savepoint(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    return exec_control_stmt(h, STMT_RELEASE_SAVEPOINT, "release savepoint in");
+}
+
+int sdb_rollback_to_savepoint(SamDb* h) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    return exec_control_stmt(h, STMT_ROLLBACK_TO_SAVEPOINT, "roll back savepoint in");
+}
+
+int sdb_in_transaction(SamDb* h) {
+    return h != NULL && !sqlite3_get_autocommit(h->conn);
+}
+
+// Batch calls join a transaction the caller already opened, otherwise they
+// open their own. *owned tells the matching end_batch whether to finish it.
+static int begin_batch(SamDb* h, int* owned) {
+    *owned = 0;
+    if (!sqlite3_get_autocommit(h->conn)) {
+        return 0;
+    }
+    if (sdb_begin(h) != 0) {
+        return -1;
+    }
+    *owned = 1;
+    return 0;
+}
+
+static int end_batch(SamDb* h, int owned, int result) {
+    if (!owned) {
+        return result;
+    }
+    if (result != 0) {
+        // Keep the original error message
+        char saved[sizeof(h->error_msg)];
+        memcpy(saved, h->error_msg, sizeof(saved));
+        sdb_rollback(h);
+        memcpy(h->error_msg, saved, sizeof(h->error_msg));
+        return result;
+    }
+    return sdb_commit(h);
+}
+
+// Read one task. Returns 0 if found, 1 if there is no such task, -1 on error.
+static int read_task(SamDb* h, int id, Task* task, StringArena* strings) {
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_GET_TASK);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    sqlite3_bind_int(stmt, 1, id);
+    
+    int rc = sqlite3_step(stmt);
+    int read = 0;
+    if (rc == SQLITE_ROW) {
+        read = read_task_row(stmt, task, strings);
+    }
+    release_stmt(stmt);
+    
+    if (rc == SQLITE_DONE) {
+        return 1;
+    }
+    
+    if (rc != SQLITE_ROW) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Error reading task: %s", sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    if (read != 0) {
+        set_error(h, "Out of memory");
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_get_task(SamDb* h, int id, Task* task, StringArena* strings) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (task == NULL || strings == NULL) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    int found = read_task(h, id, task, strings);
+    if (found == 1) {
+        set_error(h, "Task not found");
+        return -1;
+    }
+    return found;
+}
+
+// Run a two-parameter "SET x = ? WHERE id = ?" statement for every ID
+static int update_tasks_int(SamDb* h, StmtId id, const int* ids, int n, int value, const char* what) {
+    for (int i = 0; i < n; i++) {
+        sqlite3_stmt* stmt = acquire_stmt(h, id);
+        if (stmt == NULL) {
+            return -1;
+        }
+        
+        sqlite3_bind_int(stmt, 1, value);
+        sqlite3_bind_int(stmt, 2, ids[i]);
+        
+        int rc = sqlite3_step(stmt);
+        release_stmt(stmt);
+        
+        if (rc != SQLITE_DONE) {
+            snprintf(h->error_msg, sizeof(h->error_msg), 
+                     "Failed to %s: %s", what, sqlite3_errmsg(h->conn));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int sdb_update_tasks_status(SamDb* h, const int* ids, int n, TaskStatus status) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (ids == NULL || n < 0) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    int owned;
+    if (begin_batch(h, &owned) != 0) {
+        return -1;
+    }
+    
+    StringArena strings;
+    string_arena_init(&strings);
+    
+    int result = 0;
+    for (int i = 0; i < n && result == 0; i++) {
+        // Completing a recurring task spawns its next instance in the same
+        // transaction. A task deleted elsewhere meanwhile is skipped.
+        Task task;
+        int spawn = 0;
+        if (status == TASK_STATUS_DONE) {
+            string_arena_reset(&strings);
+            int missing = read_task(h, ids[i], &task, &strings);
+            if (missing < 0) {
+                result = -1;
+                break;
+            }
+            if (missing) {
+                continue;
+            }
+            spawn = (task.status != TASK_STATUS_DONE && task.recurrence != RECUR_NONE);
+        }
+        
+        result = update_tasks_int(h, STMT_UPDATE_TASK_STATUS, &ids[i], 1, (int)status,
+                                  "update task status");
+        if (result == 0 && spawn && sdb_create_recurring_instance(h, &task) < 0) {
+            result = -1;
+        }
+    }
+    
+    string_arena_free(&strings);
+    return end_batch(h, owned, result);
+}
+
+int sdb_delete_tasks(SamDb* h, const int* ids, int n) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (ids == NULL || n < 0) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    int owned;
+    if (begin_batch(h, &owned) != 0) {
+        return -1;
+    }
+    
+    int result = 0;
+    for (int i = 0; i < n; i++) {
+        sqlite3_stmt* stmt = acquire_stmt(h, STMT_DELETE_TASK);
+        if (stmt == NULL) {
+            result = -1;
+            break;
+        }
+        
+        sqlite3_bind_int(stmt, 1, ids[i]);
+        
+        int rc = sqlite3_step(stmt);
+        release_stmt(stmt);
+        
+        if (rc != SQLITE_DONE) {
+            snprintf(h->error_msg, sizeof(h->error_msg), 
+                     "Failed to delete task: %s", sqlite3_errmsg(h->conn));
+            result = -1;
+            break;
+        }
+    }
+    
+    return end_batch(h, owned, result);
+}
+
+int sdb_set_tasks_flagged(SamDb* h, const int* ids, int n, int flagged) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (ids == NULL || n < 0) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    int owned;
+    if (begin_batch(h, &owned) != 0) {
+        return -1;
+    }
+    
+    int result = update_tasks_int(h, STMT_UPDATE_TASK_FLAGGED, ids, n, flagged ? 1 : 0,
+                                  "update task flag");
+    
+    return end_batch(h, owned, result);
+}
+
+// Run one of db_insert_task_full's per-context steps for a context name
+static int exec_draft_context_stmt(SamDb* h, StmtId id, int task_id, const char* name, time_t now) {
+    sqlite3_stmt* stmt = acquire_stmt(h, id);
+    if (stmt == NULL) {
+        return -1;
+    }
+    
+    if (id == STMT_ENSURE_CONTEXT) {
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)now);
+    } else {
+        sqlite3_bind_int(stmt, 1, task_id);
+        sqlite3_bind_text(stmt, 2, name, -1, SQLITE_TRANSIENT);
+    }
+    
+    int rc = sqlite3_step(stmt);
+    release_stmt(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        snprintf(h->error_msg, sizeof(h->error_msg), 
+                 "Failed to add context '%s': %s", name, sqlite3_errmsg(h->conn));
+        return -1;
+    }
+    
+    return 0;
+}
+
+int sdb_insert_task_full(SamDb* h, const TaskDraft* draft) {
+    if (h == NULL) {
+        set_error(h, "Database not initialized");
+        return -1;
+    }
+    
+    if (draft == NULL || draft->title == NULL || draft->title[0] == '\0') {
+        set_error(h, "Task title cannot be empty");
+        return -1;
+    }
+    
+    if (draft->context_count < 0 || draft->context_count > TASK_DRAFT_MAX_CONTEXTS) {
+        set_error(h, "Invalid parameters");
+        return -1;
+    }
+    
+    int owned;
+    if (begin_batch(h, &owned) != 0) {
+        return -1;
+    }
+    
+    time_t now = time(NULL);
+    int task_id = -1;
+    int result = 0;
+    
+    sqlite3_stmt* stmt = acquire_stmt(h, STMT_INSERT_TASK_FULL);
+    if (stmt == NULL) {
+        result = -1;
+    } else {
+        sqlite3_bind_text(stmt, 1, draft->title, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, draft->notes ? draft->notes : "", -1, SQLITE_TRANSIENT);
+        if (draft->project_id > 0) {
+            sqlite3_bind_int(stmt, 3, draft->project_id);
+        } else {
+            sqlite3_bind_null(stmt, 3);
+        }
+        sqlite3_bind_int(stmt, 4, (int)draft->status);
+        sqlite3_bind_int64(stmt, 5, (sqlite3_int64)now);
+        sqlite3_bind_int64(stmt, 6, (sqlite3_int64)now);
+        sqlite3_bind_int64(stmt, 7, (sqlite3_int64)draft->defer_at);
+        sqlite3_bind_int64(stmt, 8, (sqlite3_int64)draft->due_at);
+        sqlite3_bind_int(stmt, 9, draft->flagged ? 1 : 0);
+        
+        int rc = sqlite3_step(stmt);
+        release_stmt(stmt);
+        
+        if (rc != SQLITE_DONE) {
+            snprintf(h->error_msg, sizeof(h->error_msg), 
+                     "Failed to insert task: %s", sqlite3_errmsg(h->conn));
+            result = -1;
+        } else {
+            task_id = (int)sqlite3_last_insert_rowid(h->conn);
+        }
+    }
+    
+    // Create missing contexts by name, then link them
+    for (int i = 0; i < draft->context_count && result == 0; i++) {
+        const char* name = draft->context_names[i];
+        if (name == NULL || name[0] == '\0') {
+            continue;
+        }
+        if (exec_draft_context_stmt(h, STMT_ENSURE_CONTEXT, task_id, name, now) != 0 ||
+            exec_draft_context_stmt(h, STMT_LINK_CONTEXT_BY_NAME, task_id, name, now) != 0) {
+            result = -1;
+        }
+    }
+    
+    if (end_batch(h, owned, result) != 0) {
+        return -1;
+    }
+    
+    return task_id;
+}
+
+// ============================================================================
+// Default-handle wrappers
+// ============================================================================
+
+void db_get_stmt_stats(DbStmtStats* stats) {
+    uint64_t span = trace_begin();
+    sdb_get_stmt_stats(default_db, stats);
+    trace_end(span, __func__);
+}
+
+void db_reset_stmt_stats(void) {
+    uint64_t span = trace_begin();
+    sdb_reset_stmt_stats(default_db);
+    trace_end(span, __func__);
+}
+
+void db_set_query_profiling(int enabled) {
+    uint64_t span = trace_begin();
+    sdb_set_query_profiling(default_db, enabled);
+    trace_end(span, __func__);
+}
+
+int db_query_profiling_enabled(void) {
+    uint64_t span = trace_begin();
+    int result = sdb_query_profiling_enabled(default_db);
+    trace_end(span, __func__);
+    return result;
+}
+
+void db_set_slow_query_ms(double ms) {
+    uint64_t span = trace_begin();
+    sdb_set_slow_query_ms(default_db, ms);
+    trace_end(span, __func__);
+}
+
+int db_get_query_stats(DbQueryStats* stats, int max) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_query_stats(default_db, stats, max);
+    trace_end(span, __func__);
+    return result;
+}
+
+void db_reset_query_stats(void) {
+    uint64_t span = trace_begin();
+    sdb_reset_query_stats(default_db);
+    trace_end(span, __func__);
+}
+
+int db_explain_query(const char* sql, char* plan, size_t size) {
+    uint64_t span = trace_begin();
+    int result = sdb_explain_query(default_db, sql, plan, size);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_schema_version(void) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_schema_version(default_db);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_create_schema(void) {
+    uint64_t span = trace_begin();
+    int result = sdb_create_schema(default_db);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_insert_task(const char* title, TaskStatus status) {
+    uint64_t span = trace_begin();
+    int result = sdb_insert_task(default_db, title, status);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_load_tasks(Task** tasks, int* count, int status_filter, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_load_tasks(default_db, tasks, count, status_filter, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_load_perspective(PerspectiveKind kind, const PerspectiveParams* params,
+                        Task** tasks, int* count, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_load_perspective(default_db, kind, params, tasks, count, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_status(int id, TaskStatus status) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_status(default_db, id, status);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_title(int id, const char* title) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_title(default_db, id, title);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_notes(int id, const char* notes) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_notes(default_db, id, notes);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_task_notes(int id, char** notes) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_task_notes(default_db, id, notes);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_defer_at(int id, time_t defer_at) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_defer_at(default_db, id, defer_at);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_due_at(int id, time_t due_at) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_due_at(default_db, id, due_at);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_flagged(int id, int flagged) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_flagged(default_db, id, flagged);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_order_index(int id, int order_index) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_order_index(default_db, id, order_index);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_delete_task(int id) {
+    uint64_t span = trace_begin();
+    int result = sdb_delete_task(default_db, id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_insert_project(const char* title, ProjectType type) {
+    uint64_t span = trace_begin();
+    int result = sdb_insert_project(default_db, title, type);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_load_projects(Project** projects, int* count, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_load_projects(default_db, projects, count, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_project_title(int id, const char* title) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_project_title(default_db, id, title);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_project_type(int id, ProjectType type) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_project_type(default_db, id, type);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_delete_project(int id) {
+    uint64_t span = trace_begin();
+    int result = sdb_delete_project(default_db, id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_assign_task_to_project(int task_id, int project_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_assign_task_to_project(default_db, task_id, project_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_first_incomplete_task_in_project(int project_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_first_incomplete_task_in_project(default_db, project_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_insert_context(const char* name, const char* color) {
+    uint64_t span = trace_begin();
+    int result = sdb_insert_context(default_db, name, color);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_load_contexts(Context** contexts, int* count, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_load_contexts(default_db, contexts, count, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_delete_context(int id) {
+    uint64_t span = trace_begin();
+    int result = sdb_delete_context(default_db, id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_add_context_to_task(int task_id, int context_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_add_context_to_task(default_db, task_id, context_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_remove_context_from_task(int task_id, int context_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_remove_context_from_task(default_db, task_id, context_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_task_contexts(int task_id, Context** contexts, int* count, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_task_contexts(default_db, task_id, contexts, count, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_load_task_context_map(TaskContextMap* map) {
+    uint64_t span = trace_begin();
+    int result = sdb_load_task_context_map(default_db, map);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_task_recurrence(int id, RecurrencePattern pattern, int interval) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_task_recurrence(default_db, id, pattern, interval);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_create_recurring_instance(Task* template_task) {
+    uint64_t span = trace_begin();
+    int result = sdb_create_recurring_instance(default_db, template_task);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_add_dependency(int task_id, int depends_on_task_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_add_dependency(default_db, task_id, depends_on_task_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_remove_dependency(int task_id, int depends_on_task_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_remove_dependency(default_db, task_id, depends_on_task_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_task_dependencies(int task_id, int** dependency_ids, int* count) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_task_dependencies(default_db, task_id, dependency_ids, count);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_is_task_blocked(int task_id) {
+    uint64_t span = trace_begin();
+    int result = sdb_is_task_blocked(default_db, task_id);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_refresh_availability(time_t now) {
+    uint64_t span = trace_begin();
+    int result = sdb_refresh_availability(default_db, now);
+    trace_end(span, __func__);
+    return result;
+}
+
+time_t db_get_next_defer_boundary(time_t now) {
+    uint64_t span = trace_begin();
+    time_t result = sdb_get_next_defer_boundary(default_db, now);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_data_version(long long* version) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_data_version(default_db, version);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_change_seq(long long* seq) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_change_seq(default_db, seq);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_list_versions(long long* projects, long long* contexts) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_list_versions(default_db, projects, contexts);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_load_tasks_changed_since(long long seq, TaskChanges* changes, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_load_tasks_changed_since(default_db, seq, changes, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_sync_task_table(TaskTable* table) {
+    uint64_t span = trace_begin();
+    int result = sdb_sync_task_table(default_db, table);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_begin(void) {
+    uint64_t span = trace_begin();
+    int result = sdb_begin(default_db);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_commit(void) {
+    uint64_t span = trace_begin();
+    int result = sdb_commit(default_db);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_rollback(void) {
+    uint64_t span = trace_begin();
+    int result = sdb_rollback(default_db);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_get_task(int id, Task* task, StringArena* strings) {
+    uint64_t span = trace_begin();
+    int result = sdb_get_task(default_db, id, task, strings);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_update_tasks_status(const int* ids, int n, TaskStatus status) {
+    uint64_t span = trace_begin();
+    int result = sdb_update_tasks_status(default_db, ids, n, status);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_delete_tasks(const int* ids, int n) {
+    uint64_t span = trace_begin();
+    int result = sdb_delete_tasks(default_db, ids, n);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_set_tasks_flagged(const int* ids, int n, int flagged) {
+    uint64_t span = trace_begin();
+    int result = sdb_set_tasks_flagged(default_db, ids, n, flagged);
+    trace_end(span, __func__);
+    return result;
+}
+
+int db_insert_task_full(const TaskDraft* draft) {
+    uint64_t span = trace_begin();
+    int result = sdb_insert_task_full(default_db, draft);
+    trace_end(span, __func__);
+    return result;
+}
@@ -4,9 +4,59 @@
 #include "../core/task.h"
 #include "../core/project.h"
 #include "../core/context.h"
+#include "../core/string_arena.h"
+#include "../core/task_table.h"
 
 /**
- * Initialize the database connection.
+ * SQLite journal modes.
+ */
+typedef enum {
+    DB_JOURNAL_WAL = 0,         // Write-ahead log: readers never block the writer
+    DB_JOURNAL_DELETE,          // Classic rollback journal
+    DB_JOURNAL_TRUNCATE,
+    DB_JOURNAL_MEMORY
+} DbJournalMode;
+
+/**
+ * PRAGMA synchronous levels.
+ */
+typedef enum {
+    DB_SYNC_OFF = 0,
+    DB_SYNC_NORMAL = 1,         // Durable in WAL mode, no fsync per commit
+    DB_SYNC_FULL = 2
+} DbSynchronous;
+
+/**
+ * Where SQLite keeps temporary tables and indices.
+ */
+typedef enum {
+    DB_TEMP_STORE_DEFAULT = 0,
+    DB_TEMP_STORE_FILE = 1,
+    DB_TEMP_STORE_MEMORY = 2
+} DbTempStore;
+
+/**
+ * Connection settings applied by db_init_ex().
+ */
+typedef struct {
+    DbJournalMode journal_mode;
+    DbSynchronous synchronous;
+    int cache_size_kb;          // Page cache budget in KiB, 0 for SQLite's default
+    long long mmap_size;        // Bytes of the file to memory-map, 0 to disable
+    int busy_timeout_ms;        // How long to wait on another process's lock
+    DbTempStore temp_store;
+    int single_threaded;        // Open with SQLITE_OPEN_NOMUTEX
+} DbConfig;
+
+/**
+ * Fill a DbConfig with the defaults used by db_init():
+ * WAL, synchronous NORMAL, 8 MiB cache, 64 MiB mmap, 5 s busy timeout,
+ * in-memory temp store, serialized connection.
+ */
+void db_config_default(DbConfig* config);
+
+/**
+ * Initialize the database connection with default settings.
  * Creates the database file if it doesn't exist.
  * 
  * Returns 0 on success, -1 on error.
@@ -14,18 +64,163 @@
 int db_init(const char* db_path);
 
 /**
- * Create database schema (tables, indices).
- * Safe to call multiple times - uses IF NOT EXISTS.
+ * Initialize the database connection with explicit settings.
+ * Creates the database file if it doesn't exist.
+ * 
+ * @param config Connection settings, or NULL for db_config_default()
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_init_ex(const char* db_path, const DbConfig* config);
+
+// ============================================================================
+// Connection handles
+// ============================================================================
+
+/**
+ * An open database connection with its own statement cache and error
+ * message. The db_* functions operate on a default handle opened by
+ * db_init(); every one of them has an sdb_* counterpart (declared at the
+ * end of this header) that takes the handle as its first argument.
+ * A handle must only be used by one thread at a time.
+ */
+typedef struct SamDb SamDb;
+
+/**
+ * Open a connection. Creates the database file if it doesn't exist.
+ * Call sdb_create_schema() before using it for anything else.
+ * 
+ * @param config Connection settings, or NULL for db_config_default()
+ * 
+ * Returns the handle on success, NULL on error (see sdb_get_error(NULL)).
+ */
+SamDb* sdb_open(const char* db_path, const DbConfig* config);
+
+/**
+ * Finalize the handle's cached statements, close it and free it.
+ */
+void sdb_close(SamDb* h);
+
+/**
+ * Get the last error message for a handle. With NULL, returns the calling
+ * thread's last error that had no handle (e.g. a failed sdb_open()).
+ */
+const char* sdb_get_error(const SamDb* h);
+
+/**
+ * Get the handle behind the db_* functions, or NULL before db_init().
+ */
+SamDb* db_get_default_handle(void);
+
+/**
+ * Schema version written by this build (stored in PRAGMA user_version).
+ */
+#define DB_SCHEMA_VERSION 5
+
+/**
+ * Bring the database schema up to DB_SCHEMA_VERSION.
+ * Each pending migration runs once, in its own transaction; a current
+ * file costs a PRAGMA user_version read and a read for deferred tasks
+ * that came due, which are then promoted. Fails if the file was written
+ * by a newer schema version.
  * 
  * Returns 0 on success, -1 on error.
  */
 int db_create_schema(void);
 
+/**
+ * Get the schema version recorded in the database file.
+ * 
+ * Returns the version (0 for a new or unversioned file), -1 on error.
+ */
+int db_get_schema_version(void);
+
 /**
  * Close the database connection.
+ * Finalizes all cached prepared statements first.
  */
 void db_close(void);
 
+/**
+ * Prepared statement cache counters, and what SQLite reports about every
+ * statement run on the connection, cached or not.
+ */
+typedef struct {
+    unsigned long long prepares;        // Statements compiled with sqlite3_prepare
+    unsigned long long cache_hits;      // Calls served by an already-prepared statement
+    unsigned long long statements;      // Statement runs finished
+    unsigned long long statement_ns;    // Time SQLite spent in those runs
+    unsigned long long slow_statements; // Runs logged as slow queries
+} DbStmtStats;
+
+/**
+ * Get the statement counters.
+ */
+void db_get_stmt_stats(DbStmtStats* stats);
+
+/**
+ * Reset the statement counters to zero.
+ */
+void db_reset_stmt_stats(void);
+
+/**
+ * Totals for one statement text, gathered while query profiling is on.
+ */
+typedef struct {
+    const char* sql;                    // Statement text; valid until the stats are reset
+    unsigned long long calls;           // Runs finished
+    unsigned long long rows;            // Result rows stepped
+    unsigned long long total_ns;
+    unsigned long long max_ns;          // Slowest single run
+} DbQueryStats;
+
+/**
+ * Turn per-statement profiling on or off.
+ * 
+ * While it is on, every statement run on the connection adds its time
+ * and result rows to the totals for its SQL text, prepared once or not.
+ * Counting rows costs a callback per row, so it is off by default.
+ * Turning it off keeps the totals gathered so far.
+ */
+void db_set_query_profiling(int enabled);
+
+/**
+ * Check whether per-statement profiling is on.
+ */
+int db_query_profiling_enabled(void);
+
+/**
+ * Log statement runs that take at least ms milliseconds to stderr, with
+ * their bound values filled in. 0 turns the log off. Works whether or
+ * not profiling is on; the row count is only known while it is.
+ */
+void db_set_slow_query_ms(double ms);
+
+/**
+ * Copy the per-statement totals, most total time first.
+ * 
+ * @param stats Array to fill
+ * @param max Entries the array holds
+ * 
+ * Returns the number of entries copied.
+ */
+int db_get_query_stats(DbQueryStats* stats, int max);
+
+/**
+ * Forget the per-statement totals.
+ */
+void db_reset_query_stats(void);
+
+/**
+ * Describe how SQLite runs a statement, from EXPLAIN QUERY PLAN: one step
+ * per line, indented under the step it belongs to, e.g.
+ * "SEARCH tasks USING INDEX idx_tasks_available (available=?)".
+ * Parameters may be left unbound. A plan too long for the buffer is cut.
+ * 
+ * Returns 0 on success, -1 on error (the statement does not compile).
+ */
+int db_explain_query(const char* sql, char* plan, size_t size);
+
 /**
  * Insert a new task.
  * 
@@ -33,16 +228,77 @@ void db_close(void);
  */
 int db_insert_task(const char* title, TaskStatus status);
 
+/**
+ * Insert a task with its notes, project, dates, flag and contexts in one
+ * transaction. Contexts that don't exist yet are created by name.
+ * Joins the caller's transaction if one is open.
+ * 
+ * Returns the new task ID on success, -1 on error.
+ */
+int db_insert_task_full(const TaskDraft* draft);
+
 /**
  * Load tasks matching a status filter.
  * 
  * @param tasks Output pointer to array of tasks (caller must free)
  * @param count Output pointer to number of tasks loaded
  * @param status_filter Filter by status, or -1 for all tasks
+ * @param strings Arena that receives the titles; the tasks point into it
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_load_tasks(Task** tasks, int* count, int status_filter, StringArena* strings);
+
+/**
+ * Built-in perspectives, each backed by a single indexed query.
+ */
+typedef enum {
+    PERSPECTIVE_INBOX = 0,      // No project, not done, defer date passed
+    PERSPECTIVE_TODAY,          // Available and due by end of today (or no due date)
+    PERSPECTIVE_ANYTIME,        // Available
+    PERSPECTIVE_FLAGGED,        // Flagged, not done, defer date passed
+    PERSPECTIVE_COMPLETED,      // Done
+    PERSPECTIVE_REVIEW,         // Not done and not modified since review_before
+    PERSPECTIVE_PROJECT         // One project, sequential projects show only their head
+} PerspectiveKind;
+
+/**
+ * How a multi-context filter combines its contexts.
+ */
+typedef enum {
+    CONTEXT_MATCH_ANY = 0,      // Task has at least one of the contexts (OR)
+    CONTEXT_MATCH_ALL = 1       // Task has every one of the contexts (AND)
+} ContextMatch;
+
+/**
+ * Parameters for db_load_perspective. Each perspective reads only the
+ * fields it needs; the context filter applies to all of them.
+ */
+typedef struct {
+    time_t now;             // Reference time for defer checks
+    time_t end_of_today;    // Today: latest due date to include
+    time_t review_before;   // Review: tasks modified before this are stale
+    int project_id;         // Project: project to load
+    const int* context_ids; // Context filter (NULL for none)
+    int context_count;      // Number of IDs in context_ids
+    ContextMatch context_match;  // Combine contexts with OR or AND
+} PerspectiveParams;
+
+/**
+ * Load the tasks shown by a perspective, ordered like db_load_tasks.
+ * When params->context_count > 0, only tasks linked to the given contexts
+ * are returned, filtered in the same query. Repeated IDs count once.
+ * 
+ * @param kind Perspective to load
+ * @param params Perspective parameters
+ * @param tasks Output pointer to array of tasks (caller must free)
+ * @param count Output pointer to number of tasks loaded
+ * @param strings Arena that receives the titles; the tasks point into it
  * 
  * Returns 0 on success, -1 on error.
  */
-int db_load_tasks(Task** tasks, int* count, int status_filter);
+int db_load_perspective(PerspectiveKind kind, const PerspectiveParams* params,
+                        Task** tasks, int* count, StringArena* strings);
 
 /**
  * Update a task's status.
@@ -65,6 +321,16 @@ int db_update_task_title(int id, const char* title);
  */
 int db_update_task_notes(int id, const char* notes);
 
+/**
+ * Load a task's notes. Task rows only carry has_notes, so this is the
+ * one place the text is read.
+ * 
+ * @param notes Set to a newly allocated string ("" if none); free() it
+ * 
+ * Returns 0 on success, -1 if the task doesn't exist or on error.
+ */
+int db_get_task_notes(int id, char** notes);
+
 /**
  * Update a task's defer date.
  * 
@@ -133,10 +399,11 @@ int db_insert_project(const char* title, ProjectType type);
  * 
  * @param projects Output pointer to array of projects (caller must free)
  * @param count Output pointer to number of projects loaded
+ * @param strings Arena that receives the titles; the projects point into it
  * 
  * Returns 0 on success, -1 on error.
  */
-int db_load_projects(Project** projects, int* count);
+int db_load_projects(Project** projects, int* count, StringArena* strings);
 
 /**
  * Update a project's title.
@@ -190,10 +457,11 @@ int db_insert_context(const char* name, const char* color);
  * 
  * @param contexts Output pointer to array of contexts (caller must free)
  * @param count Output pointer to number of contexts loaded
+ * @param strings Arena that receives names and colors; the contexts point into it
  * 
  * Returns 0 on success, -1 on error.
  */
-int db_load_contexts(Context** contexts, int* count);
+int db_load_contexts(Context** contexts, int* count, StringArena* strings);
 
 /**
  * Delete a context by ID.
@@ -223,10 +491,21 @@ int db_remove_context_from_task(int task_id, int context_id);
  * @param task_id Task ID
  * @param contexts Output pointer to array of contexts (caller must free)
  * @param count Output pointer to number of contexts
+ * @param strings Arena that receives names and colors; the contexts point into it
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_get_task_contexts(int task_id, Context** contexts, int* count, StringArena* strings);
+
+/**
+ * Load every task -> context link in a single query.
+ * Links for each task are ordered by context name.
+ * 
+ * @param map Output map (release with task_context_map_free)
  * 
  * Returns 0 on success, -1 on error.
  */
-int db_get_task_contexts(int task_id, Context** contexts, int* count);
+int db_load_task_context_map(TaskContextMap* map);
 
 // ============================================================================
 // Recurrence operations
@@ -297,4 +576,259 @@ int db_get_task_dependencies(int task_id, int** dependency_ids, int* count);
  */
 int db_is_task_blocked(int task_id);
 
+// ============================================================================
+// Availability maintenance
+// ============================================================================
+
+/**
+ * Recompute availability for tasks whose defer date has passed.
+ * Triggers keep tasks.available current for every other kind of change;
+ * time passing is the one thing they cannot observe. Only writes, and
+ * takes the write lock, when some task actually comes due.
+ * 
+ * @param now Current time
+ * 
+ * Returns the number of tasks re-evaluated, or -1 on error.
+ */
+int db_refresh_availability(time_t now);
+
+/**
+ * Get the earliest defer date after now among incomplete tasks.
+ * db_refresh_availability should be called once this time is reached.
+ * 
+ * Returns the boundary time, or 0 if no task becomes available later.
+ */
+time_t db_get_next_defer_boundary(time_t now);
+
+// ============================================================================
+// Change detection
+// ============================================================================
+
+/**
+ * Get SQLite's data version for this connection. It changes whenever
+ * another connection commits to the file (another process, or the
+ * background writer) and stays the same for this connection's own
+ * writes. Cheap enough to poll every frame.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_get_data_version(long long* version);
+
+/**
+ * Task changes after a sync point, from db_load_tasks_changed_since.
+ */
+typedef struct {
+    Task* tasks;            // Rows added or changed, oldest change first
+    int task_count;
+    int* deleted_ids;       // Tasks deleted
+    int deleted_count;
+    long long seq;          // Sync point to pass next time
+    int expired;            // Some deletions were already forgotten: reload in full
+} TaskChanges;
+
+/**
+ * Get the current change sequence number. Triggers give every insert,
+ * edit, availability change, context or dependency link change and
+ * deletion of a task the next number, so it only grows.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_get_change_seq(long long* seq);
+
+/**
+ * Get the change counters of the project and context lists. Triggers bump
+ * each one on every insert, edit or deletion in its table, so a reader
+ * can skip reloading a list that a commit didn't touch.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_get_list_versions(long long* projects, long long* contexts);
+
+/**
+ * Load every task changed after a sync point, plus the IDs of tasks
+ * deleted since. Answered from indexes on change_seq. Deletions are
+ * remembered for a week; past that, changes->expired is set and the
+ * caller should reload everything instead.
+ * 
+ * @param seq Sync point: 0, or the seq returned by an earlier call or
+ *            by db_get_change_seq
+ * @param changes Output (release with db_free_task_changes)
+ * @param strings Arena that receives the titles of the changed tasks
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_load_tasks_changed_since(long long seq, TaskChanges* changes, StringArena* strings);
+
+/**
+ * Release the arrays held by a TaskChanges.
+ */
+void db_free_task_changes(TaskChanges* changes);
+
+/**
+ * Bring a column table of every task up to date. An empty table (seq 0),
+ * or one whose missing deletions were already forgotten, is loaded in
+ * full; otherwise only the rows changed since table->seq are read, from
+ * the same indexes as db_load_tasks_changed_since. No strings are read.
+ * 
+ * On error the table is left partly updated with seq 0, so the next call
+ * reloads it.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_sync_task_table(TaskTable* table);
+
+// ============================================================================
+// Transactions and batch operations
+// ============================================================================
+
+/**
+ * Begin a write transaction (BEGIN IMMEDIATE).
+ * Every db_* call made before db_commit/db_rollback joins it.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_begin(void);
+
+/**
+ * Commit the current transaction.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_commit(void);
+
+/**
+ * Roll back the current transaction.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_rollback(void);
+
+/**
+ * Load a single task by ID.
+ * 
+ * @param id Task ID
+ * @param task Output task
+ * @param strings Arena that receives the title
+ * 
+ * Returns 0 on success, -1 if not found or on error.
+ */
+int db_get_task(int id, Task* task, StringArena* strings);
+
+/**
+ * Set the status of several tasks in one transaction.
+ * Completing a recurring task spawns its next instance in the same
+ * transaction. IDs with no task, e.g. deleted by another process, are
+ * skipped. Joins the caller's transaction if one is open.
+ * 
+ * @param ids Task IDs
+ * @param n Number of IDs
+ * @param status New status
+ * 
+ * Returns 0 on success, -1 on error. A batch that opened its own
+ * transaction rolls it back on error.
+ */
+int db_update_tasks_status(const int* ids, int n, TaskStatus status);
+
+/**
+ * Delete several tasks in one transaction.
+ * 
+ * Returns 0 on success, -1 on error. A batch that opened its own
+ * transaction rolls it back on error.
+ */
+int db_delete_tasks(const int* ids, int n);
+
+/**
+ * Set or clear the flag on several tasks in one transaction.
+ * 
+ * Returns 0 on success, -1 on error. A batch that opened its own
+ * transaction rolls it back on error.
+ */
+int db_set_tasks_flagged(const int* ids, int n, int flagged);
+
+// ============================================================================
+// Handle variants
+// ============================================================================
+
+/**
+ * Same as the db_* function of the same name, on an explicit handle.
+ */
+void sdb_get_stmt_stats(SamDb* h, DbStmtStats* stats);
+void sdb_reset_stmt_stats(SamDb* h);
+void sdb_set_query_profiling(SamDb* h, int enabled);
+int sdb_query_profiling_enabled(SamDb* h);
+void sdb_set_slow_query_ms(SamDb* h, double ms);
+int sdb_get_query_stats(SamDb* h, DbQueryStats* stats, int max);
+void sdb_reset_query_stats(SamDb* h);
+int sdb_explain_query(SamDb* h, const char* sql, char* plan, size_t size);
+int sdb_get_schema_version(SamDb* h);
+int sdb_create_schema(SamDb* h);
+int sdb_insert_task(SamDb* h, const char* title, TaskStatus status);
+int sdb_load_tasks(SamDb* h, Task** tasks, int* count, int status_filter,
+                   StringArena* strings);
+int sdb_load_perspective(SamDb* h, PerspectiveKind kind, const PerspectiveParams* params,
+                         Task** tasks, int* count, StringArena* strings);
+int sdb_update_task_status(SamDb* h, int id, TaskStatus status);
+int sdb_update_task_title(SamDb* h, int id, const char* title);
+int sdb_update_task_notes(SamDb* h, int id, const char* notes);
+int sdb_get_task_notes(SamDb* h, int id, char** notes);
+int sdb_update_task_defer_at(SamDb* h, int id, time_t defer_at);
+int sdb_update_task_due_at(SamDb* h, int id, time_t due_at);
+int sdb_update_task_flagged(SamDb* h, int id, int flagged);
+int sdb_update_task_order_index(SamDb* h, int id, int order_index);
+int sdb_delete_task(SamDb* h, int id);
+int sdb_insert_project(SamDb* h, const char* title, ProjectType type);
+int sdb_load_projects(SamDb* h, Project** projects, int* count, StringArena* strings);
+int sdb_update_project_title(SamDb* h, int id, const char* title);
+int sdb_update_project_type(SamDb* h, int id, ProjectType type);
+int sdb_delete_project(SamDb* h, int id);
+int sdb_assign_task_to_project(SamDb* h, int task_id, int project_id);
+int sdb_get_first_incomplete_task_in_project(SamDb* h, int project_id);
+int sdb_insert_context(SamDb* h, const char* name, const char* color);
+int sdb_load_contexts(SamDb* h, Context** contexts, int* count, StringArena* strings);
+int sdb_delete_context(SamDb* h, int id);
+int sdb_add_context_to_task(SamDb* h, int task_id, int context_id);
+int sdb_remove_context_from_task(SamDb* h, int task_id, int context_id);
+int sdb_get_task_contexts(SamDb* h, int task_id, Context** contexts, int* count,
+                          StringArena* strings);
+int sdb_load_task_context_map(SamDb* h, TaskContextMap* map);
+int sdb_update_task_recurrence(SamDb* h, int id, RecurrencePattern pattern, int interval);
+int sdb_create_recurring_instance(SamDb* h, Task* template_task);
+int sdb_add_dependency(SamDb* h, int task_id, int depends_on_task_id);
+int sdb_remove_dependency(SamDb* h, int task_id, int depends_on_task_id);
+int sdb_get_task_dependencies(SamDb* h, int task_id, int** dependency_ids, int* count);
+int sdb_is_task_blocked(SamDb* h, int task_id);
+int sdb_refresh_availability(SamDb* h, time_t now);
+time_t sdb_get_next_defer_boundary(SamDb* h, time_t now);
+int sdb_get_data_version(SamDb* h, long long* version);
+int sdb_get_change_seq(SamDb* h, long long* seq);
+int sdb_get_list_versions(SamDb* h, long long* projects, long long* contexts);
+int sdb_load_tasks_changed_since(SamDb* h, long long seq, TaskChanges* changes,
+                                 StringArena* strings);
+int sdb_sync_task_table(SamDb* h, TaskTable* table);
+int sdb_begin(SamDb* h);
+int sdb_commit(SamDb* h);
+int sdb_rollback(SamDb* h);
+int sdb_get_task(SamDb* h, int id, Task* task, StringArena* strings);
+int sdb_update_tasks_status(SamDb* h, const int* ids, int n, TaskStatus status);
+int sdb_delete_tasks(SamDb* h, const int* ids, int n);
+int sdb_set_tasks_flagged(SamDb* h, const int* ids, int n, int flagged);
+int sdb_insert_task_full(SamDb* h, const TaskDraft* draft);
+
+/**
+ * Guard one write inside a larger transaction: open a savepoint, then
+ * release it, or roll back to it and release it if the write failed.
+ * Outside a transaction the savepoint opens one and releasing it commits.
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int sdb_savepoint(SamDb* h);
+int sdb_release_savepoint(SamDb* h);
+int sdb_rollback_to_savepoint(SamDb* h);
+
+/**
+ * Check whether a transaction is open on the handle. SQLite rolls one
+ * back by itself on some errors, such as SQLITE_FULL or SQLITE_IOERR.
+ */
+int sdb_in_transaction(SamDb* h);
+
 #endif // DATABASE_H
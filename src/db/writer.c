@@ -0,0 +1,725 @@
+#include "writer.h"
+#include "database.h"
+#include "../core/platform.h"
+#include "../core/spsc_queue.h"
+#include "../core/trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Queue depth in each direction. Submitting blocks nothing: a full queue
+// is reported as an error.
+#define WRITER_QUEUE_CAPACITY 1024
+
+// Most writes applied in one transaction
+#define WRITER_BATCH_MAX 64
+
+// A write as it travels through the request queue, owning its text,
+// IDs and draft
+typedef struct {
+    DbWrite write;
+    char* text;
+    int* ids;
+    TaskDraft* draft;
+} QueuedWrite;
+
+// A finished write on its way back to the main thread
+typedef struct {
+    DbWriteResult result;
+    DbWriteCallback callback;
+    void* user_data;
+} Completion;
+
+static SamDb* writer_db = NULL;    // Writer thread only, once started
+static SpscQueue requests;      // Main thread -> writer
+static SpscQueue completions;   // Writer -> main thread
+static PlatformEvent wake;
+static PlatformThread writer_thread;
+static atomic_int stopping;
+static int running = 0;
+static unsigned long long submitted = 0;    // Main thread only
+static unsigned long long dispatched = 0;   // Main thread only
+static DbWriteCallback default_callback = NULL;
+static void* default_user_data = NULL;
+static DbWriterNotify notify_callback = NULL;   // Set before the thread starts
+static void* notify_user_data = NULL;
+static char error_msg[512] = {0};
+
+static void set_error(const char* msg) {
+    snprintf(error_msg, sizeof(error_msg), "%s", msg);
+}
+
+const char* db_writer_get_error(void) {
+    return error_msg;
+}
+
+// Context color for DB_WRITE_CONTEXT_INSERT
+#define WRITER_CONTEXT_COLOR "#888888"
+
+static int is_text_kind(DbWriteKind kind) {
+    return kind == DB_WRITE_TASK_TITLE || kind == DB_WRITE_TASK_NOTES ||
+           kind == DB_WRITE_PROJECT_TITLE || kind == DB_WRITE_PROJECT_INSERT ||
+           kind == DB_WRITE_CONTEXT_INSERT;
+}
+
+// Text kinds whose text must not be empty
+static int is_name_kind(DbWriteKind kind) {
+    return kind == DB_WRITE_TASK_TITLE || kind == DB_WRITE_PROJECT_TITLE ||
+           kind == DB_WRITE_PROJECT_INSERT || kind == DB_WRITE_CONTEXT_INSERT;
+}
+
+// Writes whose handle call returns the ID of the row it inserted
+static int is_insert_kind(DbWriteKind kind) {
+    return kind == DB_WRITE_TASK_INSERT || kind == DB_WRITE_PROJECT_INSERT ||
+           kind == DB_WRITE_CONTEXT_INSERT;
+}
+
+static int is_batch_kind(DbWriteKind kind) {
+    return kind == DB_WRITE_TASKS_STATUS || kind == DB_WRITE_TASKS_DELETE ||
+           kind == DB_WRITE_TASKS_FLAGGED;
+}
+
+// Handle function each kind of write runs, as named in traces
+static const char* write_names[DB_WRITE_KIND_COUNT] = {
+    "sdb_update_tasks_status",
+    "sdb_update_task_title",
+    "sdb_update_task_notes",
+    "sdb_update_task_flagged",
+    "sdb_update_task_defer_at",
+    "sdb_update_task_due_at",
+    "sdb_update_task_order_index",
+    "sdb_assign_task_to_project",
+    "sdb_update_task_recurrence",
+    "sdb_delete_task",
+    "sdb_add_context_to_task",
+    "sdb_remove_context_from_task",
+    "sdb_update_project_title",
+    "sdb_update_project_type",
+    "sdb_delete_project",
+    "sdb_delete_context",
+    "sdb_update_tasks_status",
+    "sdb_delete_tasks",
+    "sdb_set_tasks_flagged",
+    "sdb_insert_task_full",
+    "sdb_add_dependency",
+    "sdb_remove_dependency",
+    "sdb_refresh_availability",
+    "sdb_insert_project",
+    "sdb_insert_context"
+};
+
+static int run_write(SamDb* h, const DbWrite* write) {
+    switch (write->kind) {
+        // Through the batch update, so a recurring task's next instance is
+        // spawned in the same transaction
+        case DB_WRITE_TASK_STATUS: return sdb_update_tasks_status(h, &write->id, 1, (TaskStatus)write->value);
+        case DB_WRITE_TASK_TITLE: return sdb_update_task_title(h, write->id, write->text);
+        case DB_WRITE_TASK_NOTES: return sdb_update_task_notes(h, write->id, write->text);
+        case DB_WRITE_TASK_FLAGGED: return sdb_update_task_flagged(h, write->id, (int)write->value);
+        case DB_WRITE_TASK_DEFER_AT: return sdb_update_task_defer_at(h, write->id, (time_t)write->value);
+        case DB_WRITE_TASK_DUE_AT: return sdb_update_task_due_at(h, write->id, (time_t)write->value);
+        case DB_WRITE_TASK_ORDER_INDEX: return sdb_update_task_order_index(h, write->id, (int)write->value);
+        case DB_WRITE_TASK_PROJECT: return sdb_assign_task_to_project(h, write->id, (int)write->value);
+        case DB_WRITE_TASK_RECURRENCE:
+            return sdb_update_task_recurrence(h, write->id, (RecurrencePattern)write->value, write->value2);
+        case DB_WRITE_TASK_DELETE: return sdb_delete_task(h, write->id);
+        case DB_WRITE_TASK_ADD_CONTEXT: return sdb_add_context_to_task(h, write->id, (int)write->value);
+        case DB_WRITE_TASK_REMOVE_CONTEXT: return sdb_remove_context_from_task(h, write->id, (int)write->value);
+        case DB_WRITE_PROJECT_TITLE: return sdb_update_project_title(h, write->id, write->text);
+        case DB_WRITE_PROJECT_TYPE: return sdb_update_project_type(h, write->id, (ProjectType)write->value);
+        case DB_WRITE_PROJECT_DELETE: return sdb_delete_project(h, write->id);
+        case DB_WRITE_CONTEXT_DELETE: return sdb_delete_context(h, write->id);
+        case DB_WRITE_TASKS_STATUS:
+            return sdb_update_tasks_status(h, write->ids, write->id_count, (TaskStatus)write->value);
+        case DB_WRITE_TASKS_DELETE: return sdb_delete_tasks(h, write->ids, write->id_count);
+        case DB_WRITE_TASKS_FLAGGED: return sdb_set_tasks_flagged(h, write->ids, write->id_count, (int)write->value);
+        case DB_WRITE_TASK_INSERT: return sdb_insert_task_full(h, write->draft);
+        case DB_WRITE_DEPENDENCY_ADD: return sdb_add_dependency(h, write->id, (int)write->value);
+        case DB_WRITE_DEPENDENCY_REMOVE: return sdb_remove_dependency(h, write->id, (int)write->value);
+        case DB_WRITE_REFRESH_AVAILABILITY: return sdb_refresh_availability(h, (time_t)write->value);
+        case DB_WRITE_PROJECT_INSERT: return sdb_insert_project(h, write->text, (ProjectType)write->value);
+        case DB_WRITE_CONTEXT_INSERT: return sdb_insert_context(h, write->text, WRITER_CONTEXT_COLOR);
+        default: return -1;
+    }
+}
+
+// Apply a write through the handle API: on the writer's own handle from the
+// writer thread, or on the default handle when no writer is running.
+// Fills in the result's outcome; an insert reports the new row's ID.
+static void apply_write(SamDb* h, const DbWrite* write, DbWriteResult* result) {
+    uint64_t span = trace_begin();
+    int applied = run_write(h, write);
+    trace_end(span, write_names[write->kind]);
+    
+    // Some handle calls return an ID or a row count on success
+    result->result = applied < 0 ? -1 : 0;
+    if (applied < 0) {
+        snprintf(result->error, sizeof(result->error), "%s", sdb_get_error(h));
+    } else if (is_insert_kind(write->kind)) {
+        result->id = applied;
+    }
+}
+
+// Writes that only set a field; a later write of the same kind to the same
+// row makes an earlier one in the batch redundant
+static int is_setter_kind(DbWriteKind kind) {
+    switch (kind) {
+        case DB_WRITE_TASK_DELETE:
+        case DB_WRITE_TASK_ADD_CONTEXT:
+        case DB_WRITE_TASK_REMOVE_CONTEXT:
+        case DB_WRITE_PROJECT_DELETE:
+        case DB_WRITE_CONTEXT_DELETE:
+        case DB_WRITE_TASKS_STATUS:
+        case DB_WRITE_TASKS_DELETE:
+        case DB_WRITE_TASKS_FLAGGED:
+        case DB_WRITE_TASK_INSERT:
+        case DB_WRITE_DEPENDENCY_ADD:
+        case DB_WRITE_DEPENDENCY_REMOVE:
+        case DB_WRITE_REFRESH_AVAILABILITY:
+        case DB_WRITE_PROJECT_INSERT:
+        case DB_WRITE_CONTEXT_INSERT:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// ============================================================================
+// Writer thread
+// ============================================================================
+
+static void push_completion(const Completion* completion) {
+    // The main loop drains completions every frame; wait for room rather
+    // than drop a result
+    while (spsc_queue_push(&completions, completion) != 0) {
+        platform_sleep_ms(1);
+    }
+}
+
+// Apply one write under a savepoint, so a write that fails partway leaves
+// none of its changes in the batch
+static void apply_guarded(DbWrite* write, DbWriteResult* result) {
+    int outermost = !sdb_in_transaction(writer_db);
+    if (sdb_savepoint(writer_db) != 0) {
+        result->result = -1;
+        snprintf(result->error, sizeof(result->error), "%s", sdb_get_error(writer_db));
+        return;
+    }
+    
+    apply_write(writer_db, write, result);
+    if (result->result != 0) {
+        // Both fail harmlessly if SQLite already rolled everything back
+        sdb_rollback_to_savepoint(writer_db);
+        sdb_release_savepoint(writer_db);
+        return;
+    }
+    
+    if (sdb_release_savepoint(writer_db) != 0) {
+        result->result = -1;
+        snprintf(result->error, sizeof(result->error), "%s", sdb_get_error(writer_db));
+        if (outermost) {
+            // Releasing it was the commit, and a failed commit stays open
+            sdb_rollback(writer_db);
+        }
+    }
+}
+
+// Fail the writes in [first, end) that ran and reported success
+static void fail_writes(Completion* done, const int* ran, int first, int end, const char* error) {
+    for (int i = first; i < end; i++) {
+        if (ran[i] && done[i].result.result == 0) {
+            done[i].result.result = -1;
+            snprintf(done[i].result.error, sizeof(done[i].result.error), "%s", error);
+        }
+    }
+}
+
+// Apply a batch of writes in one transaction and report each result
+static void apply_batch(QueuedWrite* batch, int count) {
+    Completion done[WRITER_BATCH_MAX];
+    int ran[WRITER_BATCH_MAX] = {0};
+    uint64_t span = trace_begin();
+    
+    int began = sdb_begin(writer_db) == 0;
+    int first = 0;  // First write in the open transaction
+    
+    for (int i = 0; i < count; i++) {
+        DbWrite* write = &batch[i].write;
+        Completion* completion = &done[i];
+        completion->result.kind = write->kind;
+        completion->result.id = write->id;
+        completion->result.result = 0;
+        completion->result.error[0] = '\0';
+        completion->callback = write->callback;
+        completion->user_data = write->user_data;
+        
+        int superseded = 0;
+        if (is_setter_kind(write->kind)) {
+            for (int j = i + 1; j < count; j++) {
+                if (batch[j].write.kind == write->kind && batch[j].write.id == write->id) {
+                    superseded = 1;
+                    break;
+                }
+            }
+        }
+        
+        if (!superseded) {
+            write->text = batch[i].text;
+            write->ids = batch[i].ids;
+            write->draft = batch[i].draft;
+            ran[i] = 1;
+            apply_guarded(write, &completion->result);
+            
+            if (began && !sdb_in_transaction(writer_db)) {
+                // SQLite rolled the transaction back on an error, taking the
+                // writes before this one with it. The rest get a new one.
+                char err[128];
+                snprintf(err, sizeof(err), "%s", completion->result.result != 0 ?
+                         completion->result.error : "Transaction was rolled back");
+                fail_writes(done, ran, first, i + 1, err);
+                began = sdb_begin(writer_db) == 0;
+                first = i + 1;
+            }
+        }
+    }
+    
+    if (began && sdb_commit(writer_db) != 0) {
+        // Nothing since the transaction opened was persisted
+        char err[128];
+        snprintf(err, sizeof(err), "%s", sdb_get_error(writer_db));
+        sdb_rollback(writer_db);
+        for (int i = first; i < count; i++) {
+            done[i].result.result = -1;
+            snprintf(done[i].result.error, sizeof(done[i].result.error), "%s", err);
+        }
+    }
+    trace_end(span, "writer batch");
+    
+    for (int i = 0; i < count; i++) {
+        free(batch[i].text);
+        free(batch[i].ids);
+        free(batch[i].draft);
+        push_completion(&done[i]);
+    }
+    
+    if (notify_callback != NULL) {
+        notify_callback(notify_user_data);
+    }
+}
+
+static void writer_main(void* arg) {
+    (void)arg;
+    QueuedWrite batch[WRITER_BATCH_MAX];
+    trace_name_thread("writer");
+    
+    for (;;) {
+        int count = 0;
+        while (count < WRITER_BATCH_MAX && spsc_queue_pop(&requests, &batch[count]) == 0) {
+            count++;
+        }
+        
+        if (count > 0) {
+            apply_batch(batch, count);
+            continue;
+        }
+        
+        if (atomic_load(&stopping)) {
+            break;
+        }
+        
+        platform_event_wait(&wake);
+    }
+}
+
+// ============================================================================
+// Main thread
+// ============================================================================
+
+void db_writer_set_notify(DbWriterNotify notify, void* user_data) {
+    notify_callback = notify;
+    notify_user_data = user_data;
+}
+
+int db_writer_start(const char* db_path, DbWriteCallback on_complete, void* user_data) {
+    if (running) {
+        set_error("Writer already running");
+        return -1;
+    }
+    
+    // Only the writer thread uses this handle, so it can skip SQLite's mutexes
+    DbConfig config;
+    db_config_default(&config);
+    config.single_threaded = 1;
+    
+    writer_db = sdb_open(db_path, &config);
+    if (writer_db == NULL) {
+        snprintf(error_msg, sizeof(error_msg),
+                 "Cannot open writer connection: %s", sdb_get_error(NULL));
+        return -1;
+    }
+    
+    if (spsc_queue_init(&requests, sizeof(QueuedWrite), WRITER_QUEUE_CAPACITY) != 0 ||
+        spsc_queue_init(&completions, sizeof(Completion), WRITER_QUEUE_CAPACITY) != 0 ||
+        platform_event_init(&wake) != 0) {
+        set_error("Out of memory");
+        spsc_queue_free(&requests);
+        spsc_queue_free(&completions);
+        sdb_close(writer_db);
+        writer_db = NULL;
+        return -1;
+    }
+    
+    default_callback = on_complete;
+    default_user_data = user_data;
+    atomic_store(&stopping, 0);
+    
+    if (platform_thread_start(&writer_thread, writer_main, NULL) != 0) {
+        set_error("Could not start writer thread");
+        platform_event_destroy(&wake);
+        spsc_queue_free(&requests);
+        spsc_queue_free(&completions);
+        sdb_close(writer_db);
+        writer_db = NULL;
+        return -1;
+    }
+    
+    running = 1;
+    return 0;
+}
+
+void db_writer_stop(void) {
+    if (!running) {
+        return;
+    }
+    
+    atomic_store(&stopping, 1);
+    platform_event_signal(&wake);
+    
+    // Keep draining completions so the thread can't stall on a full queue
+    while (dispatched < submitted) {
+        if (db_writer_dispatch() == 0) {
+            platform_sleep_ms(1);
+        }
+    }
+    platform_thread_join(writer_thread);
+    running = 0;
+    
+    sdb_close(writer_db);
+    writer_db = NULL;
+    
+    platform_event_destroy(&wake);
+    spsc_queue_free(&requests);
+    spsc_queue_free(&completions);
+}
+
+int db_writer_is_running(void) {
+    return running;
+}
+
+// Copy a string into the block at *cursor and move the cursor past it
+static const char* place_string(char** cursor, const char* text) {
+    if (text == NULL) {
+        return NULL;
+    }
+    size_t len = strlen(text);
+    char* copy = *cursor;
+    memcpy(copy, text, len + 1);
+    *cursor += len + 1;
+    return copy;
+}
+
+// Copy a draft and its strings into one block, freed with free()
+static TaskDraft* copy_draft(const TaskDraft* draft) {
+    int context_count = draft->context_count;
+    if (context_count < 0) {
+        context_count = 0;
+    } else if (context_count > TASK_DRAFT_MAX_CONTEXTS) {
+        context_count = TASK_DRAFT_MAX_CONTEXTS;
+    }
+    
+    size_t size = sizeof(TaskDraft) + strlen(draft->title) + 1;
+    if (draft->notes != NULL) {
+        size += strlen(draft->notes) + 1;
+    }
+    for (int i = 0; i < context_count; i++) {
+        if (draft->context_names[i] != NULL) {
+            size += strlen(draft->context_names[i]) + 1;
+        }
+    }
+    
+    TaskDraft* copy = malloc(size);
+    if (copy == NULL) {
+        return NULL;
+    }
+    *copy = *draft;
+    copy->context_count = context_count;
+    
+    char* cursor = (char*)(copy + 1);
+    copy->title = place_string(&cursor, draft->title);
+    copy->notes = place_string(&cursor, draft->notes);
+    for (int i = 0; i < context_count; i++) {
+        copy->context_names[i] = place_string(&cursor, draft->context_names[i]);
+    }
+    return copy;
+}
+
+int db_writer_submit(const DbWrite* write) {
+    if (write == NULL || (unsigned)write->kind >= DB_WRITE_KIND_COUNT) {
+        set_error("Invalid write");
+        return -1;
+    }
+    
+    if (is_name_kind(write->kind) && (write->text == NULL || write->text[0] == '\0')) {
+        set_error(write->kind == DB_WRITE_CONTEXT_INSERT ? "Name cannot be empty" : "Title cannot be empty");
+        return -1;
+    }
+    
+    if (is_batch_kind(write->kind) && (write->ids == NULL || write->id_count < 0)) {
+        set_error("Invalid task IDs");
+        return -1;
+    }
+    
+    if (write->kind == DB_WRITE_TASK_INSERT &&
+        (write->draft == NULL || write->draft->title == NULL || write->draft->title[0] == '\0')) {
+        set_error("Title cannot be empty");
+        return -1;
+    }
+    
+    if (!running) {
+        DbWriteResult result = {write->kind, write->id, 0, {0}};
+        apply_write(db_get_default_handle(), write, &result);
+        
+        DbWriteCallback callback = write->callback ? write->callback : default_callback;
+        void* user_data = write->callback ? write->user_data : default_user_data;
+        if (callback) {
+            callback(&result, user_data);
+        }
+        return 0;
+    }
+    
+    QueuedWrite queued;
+    queued.write = *write;
+    queued.text = NULL;
+    if (is_text_kind(write->kind)) {
+        size_t len = strlen(write->text ? write->text : "");
+        queued.text = malloc(len + 1);
+        if (queued.text == NULL) {
+            set_error("Out of memory");
+            return -1;
+        }
+        memcpy(queued.text, write->text ? write->text : "", len + 1);
+    }
+    queued.write.text = NULL;
+    
+    queued.ids = NULL;
+    if (is_batch_kind(write->kind)) {
+        // At least one slot, so an empty batch still has an array
+        queued.ids = malloc(sizeof(int) * (write->id_count > 0 ? write->id_count : 1));
+        if (queued.ids == NULL) {
+            free(queued.text);
+            set_error("Out of memory");
+            return -1;
+        }
+        memcpy(queued.ids, write->ids, sizeof(int) * write->id_count);
+    }
+    queued.write.ids = NULL;
+    
+    queued.draft = NULL;
+    if (write->kind == DB_WRITE_TASK_INSERT) {
+        queued.draft = copy_draft(write->draft);
+        if (queued.draft == NULL) {
+            free(queued.text);
+            free(queued.ids);
+            set_error("Out of memory");
+            return -1;
+        }
+    }
+    queued.write.draft = NULL;
+    
+    if (spsc_queue_push(&requests, &queued) != 0) {
+        free(queued.text);
+        free(queued.ids);
+        free(queued.draft);
+        set_error("Write queue is full");
+        return -1;
+    }
+    
+    submitted++;
+    platform_event_signal(&wake);
+    return 0;
+}
+
+int db_writer_dispatch(void) {
+    if (!running) {
+        return 0;
+    }
+    
+    int count = 0;
+    Completion completion;
+    while (spsc_queue_pop(&completions, &completion) == 0) {
+        dispatched++;
+        count++;
+        
+        DbWriteCallback callback = completion.callback ? completion.callback : default_callback;
+        void* user_data = completion.callback ? completion.user_data : default_user_data;
+        if (callback) {
+            callback(&completion.result, user_data);
+        }
+    }
+    
+    return count;
+}
+
+void db_writer_flush(void) {
+    while (running && dispatched < submitted) {
+        if (db_writer_dispatch() == 0) {
+            platform_sleep_ms(1);
+        }
+    }
+}
+
+int db_writer_pending(void) {
+    return running ? (int)(submitted - dispatched) : 0;
+}
+
+// ============================================================================
+// Convenience wrappers
+// ============================================================================
+
+static int submit_value(DbWriteKind kind, int id, long long value) {
+    DbWrite write = {0};
+    write.kind = kind;
+    write.id = id;
+    write.value = value;
+    return db_writer_submit(&write);
+}
+
+static int submit_text(DbWriteKind kind, int id, const char* text) {
+    DbWrite write = {0};
+    write.kind = kind;
+    write.id = id;
+    write.text = text;
+    return db_writer_submit(&write);
+}
+
+int db_writer_set_task_status(int id, TaskStatus status) {
+    return submit_value(DB_WRITE_TASK_STATUS, id, status);
+}
+
+int db_writer_set_task_title(int id, const char* title) {
+    return submit_text(DB_WRITE_TASK_TITLE, id, title);
+}
+
+int db_writer_set_task_notes(int id, const char* notes) {
+    return submit_text(DB_WRITE_TASK_NOTES, id, notes);
+}
+
+int db_writer_set_task_flagged(int id, int flagged) {
+    return submit_value(DB_WRITE_TASK_FLAGGED, id, flagged);
+}
+
+int db_writer_set_task_defer_at(int id, time_t defer_at) {
+    return submit_value(DB_WRITE_TASK_DEFER_AT, id, (long long)defer_at);
+}
+
+int db_writer_set_task_due_at(int id, time_t due_at) {
+    return submit_value(DB_WRITE_TASK_DUE_AT, id, (long long)due_at);
+}
+
+int db_writer_set_task_order_index(int id, int order_index) {
+    return submit_value(DB_WRITE_TASK_ORDER_INDEX, id, order_index);
+}
+
+int db_writer_assign_task_to_project(int id, int project_id) {
+    return submit_value(DB_WRITE_TASK_PROJECT, id, project_id);
+}
+
+int db_writer_set_task_recurrence(int id, RecurrencePattern pattern, int interval) {
+    DbWrite write = {0};
+    write.kind = DB_WRITE_TASK_RECURRENCE;
+    write.id = id;
+    write.value = pattern;
+    write.value2 = interval;
+    return db_writer_submit(&write);
+}
+
+int db_writer_delete_task(int id) {
+    return submit_value(DB_WRITE_TASK_DELETE, id, 0);
+}
+
+int db_writer_add_context_to_task(int task_id, int context_id) {
+    return submit_value(DB_WRITE_TASK_ADD_CONTEXT, task_id, context_id);
+}
+
+int db_writer_remove_context_from_task(int task_id, int context_id) {
+    return submit_value(DB_WRITE_TASK_REMOVE_CONTEXT, task_id, context_id);
+}
+
+int db_writer_set_project_title(int id, const char* title) {
+    return submit_text(DB_WRITE_PROJECT_TITLE, id, title);
+}
+
+int db_writer_set_project_type(int id, ProjectType type) {
+    return submit_value(DB_WRITE_PROJECT_TYPE, id, type);
+}
+
+int db_writer_delete_project(int id) {
+    return submit_value(DB_WRITE_PROJECT_DELETE, id, 0);
+}
+
+int db_writer_delete_context(int id) {
+    return submit_value(DB_WRITE_CONTEXT_DELETE, id, 0);
+}
+
+static int submit_ids(DbWriteKind kind, const int* ids, int n, long long value) {
+    DbWrite write = {0};
+    write.kind = kind;
+    write.ids = ids;
+    write.id_count = n;
+    write.value = value;
+    return db_writer_submit(&write);
+}
+
+int db_writer_set_tasks_status(const int* ids, int n, TaskStatus status) {
+    return submit_ids(DB_WRITE_TASKS_STATUS, ids, n, status);
+}
+
+int db_writer_delete_tasks(const int* ids, int n) {
+    return submit_ids(DB_WRITE_TASKS_DELETE, ids, n, 0);
+}
+
+int db_writer_set_tasks_flagged(const int* ids, int n, int flagged) {
+    return submit_ids(DB_WRITE_TASKS_FLAGGED, ids, n, flagged);
+}
+
+int db_writer_insert_task(const TaskDraft* draft) {
+    DbWrite write = {0};
+    write.kind = DB_WRITE_TASK_INSERT;
+    write.draft = draft;
+    return db_writer_submit(&write);
+}
+
+int db_writer_add_dependency(int task_id, int depends_on_task_id) {
+    return submit_value(DB_WRITE_DEPENDENCY_ADD, task_id, depends_on_task_id);
+}
+
+int db_writer_remove_dependency(int task_id, int depends_on_task_id) {
+    return submit_value(DB_WRITE_DEPENDENCY_REMOVE, task_id, depends_on_task_id);
+}
+
+int db_writer_refresh_availability(time_t now) {
+    return submit_value(DB_WRITE_REFRESH_AVAILABILITY, 0, (long long)now);
+}
+
+int db_writer_insert_project(const char* title, ProjectType type) {
+    DbWrite write = {0};
+    write.kind = DB_WRITE_PROJECT_INSERT;
+    write.text = title;
+    write.value = type;
+    return db_writer_submit(&write);
+}
+
+int db_writer_insert_context(const char* name) {
+    return submit_text(DB_WRITE_CONTEXT_INSERT, 0, name);
+}
@@ -0,0 +1,165 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <time.h>
+#include "../core/task.h"
+#include "../core/project.h"
+
+/**
+ * Mutations the background writer can apply.
+ */
+typedef enum {
+    DB_WRITE_TASK_STATUS = 0,       // Completing a recurring task spawns its next instance
+    DB_WRITE_TASK_TITLE,
+    DB_WRITE_TASK_NOTES,
+    DB_WRITE_TASK_FLAGGED,
+    DB_WRITE_TASK_DEFER_AT,
+    DB_WRITE_TASK_DUE_AT,
+    DB_WRITE_TASK_ORDER_INDEX,
+    DB_WRITE_TASK_PROJECT,          // value 0 moves the task back to the inbox
+    DB_WRITE_TASK_RECURRENCE,       // value = pattern, value2 = interval
+    DB_WRITE_TASK_DELETE,
+    DB_WRITE_TASK_ADD_CONTEXT,      // value = context ID
+    DB_WRITE_TASK_REMOVE_CONTEXT,   // value = context ID
+    DB_WRITE_PROJECT_TITLE,
+    DB_WRITE_PROJECT_TYPE,
+    DB_WRITE_PROJECT_DELETE,
+    DB_WRITE_CONTEXT_DELETE,
+    DB_WRITE_TASKS_STATUS,          // ids, value = status
+    DB_WRITE_TASKS_DELETE,          // ids
+    DB_WRITE_TASKS_FLAGGED,         // ids, value = flagged
+    DB_WRITE_TASK_INSERT,           // draft; the result's id is the new task
+    DB_WRITE_DEPENDENCY_ADD,        // value = task depended on
+    DB_WRITE_DEPENDENCY_REMOVE,     // value = task depended on
+    DB_WRITE_REFRESH_AVAILABILITY,  // value = time to refresh at
+    DB_WRITE_PROJECT_INSERT,        // text = title, value = type; the result's id is the new project
+    DB_WRITE_CONTEXT_INSERT,        // text = name, in the default color; the result's id is the new context
+    DB_WRITE_KIND_COUNT
+} DbWriteKind;
+
+/**
+ * Outcome of one write, delivered on the main thread.
+ */
+typedef struct {
+    DbWriteKind kind;
+    int id;                 // Task, project or context the write targeted
+                            // (the inserted row for the insert kinds)
+    int result;             // 0 on success, -1 on error
+    char error[128];        // Set when result is -1
+} DbWriteResult;
+
+typedef void (*DbWriteCallback)(const DbWriteResult* result, void* user_data);
+
+/**
+ * Called on the writer thread after it queues completions, so a main loop
+ * sleeping in an event wait can wake up to dispatch them.
+ */
+typedef void (*DbWriterNotify)(void* user_data);
+
+/**
+ * One queued mutation.
+ */
+typedef struct {
+    DbWriteKind kind;
+    int id;
+    long long value;        // Integer field, timestamp or related ID
+    int value2;
+    const char* text;       // Title, notes or name; copied on submit
+    const int* ids;         // Tasks for the batch kinds; copied on submit
+    int id_count;
+    const TaskDraft* draft; // Task to insert; copied on submit
+    DbWriteCallback callback;   // NULL for the callback given to db_writer_start()
+    void* user_data;
+} DbWrite;
+
+/**
+ * Open a second connection to db_path and start the writer thread.
+ * The schema must already be current.
+ * 
+ * @param on_complete Default completion callback (optional, can be NULL)
+ * 
+ * Returns 0 on success, -1 on error.
+ */
+int db_writer_start(const char* db_path, DbWriteCallback on_complete, void* user_data);
+
+/**
+ * Set the function the writer thread calls once a batch of completions is
+ * ready (optional, NULL for none). It must be safe to call from another
+ * thread, like glfwPostEmptyEvent. Call before db_writer_start().
+ */
+void db_writer_set_notify(DbWriterNotify notify, void* user_data);
+
+/**
+ * Apply every queued write, stop the thread and close its connection.
+ * Remaining completions are dispatched before returning.
+ */
+void db_writer_stop(void);
+
+/**
+ * Check whether the writer thread is running.
+ */
+int db_writer_is_running(void);
+
+/**
+ * Queue a mutation. Main thread only.
+ * Without a running writer, the write is applied synchronously through
+ * the main connection and its callback runs before this returns.
+ * 
+ * Returns 0 if queued (or applied), -1 on error.
+ */
+int db_writer_submit(const DbWrite* write);
+
+/**
+ * Run completion callbacks for finished writes. Call once per frame
+ * from the main loop.
+ * 
+ * Returns the number of callbacks run.
+ */
+int db_writer_dispatch(void);
+
+/**
+ * Block until every submitted write has been applied and dispatched.
+ */
+void db_writer_flush(void);
+
+/**
+ * Get the number of submitted writes whose completions have not been
+ * dispatched yet. Always 0 without a running writer.
+ */
+int db_writer_pending(void);
+
+/**
+ * Get the last error message from the writer.
+ */
+const char* db_writer_get_error(void);
+
+/**
+ * Convenience wrappers around db_writer_submit() using the default callback.
+ */
+int db_writer_set_task_status(int id, TaskStatus status);
+int db_writer_set_task_title(int id, const char* title);
+int db_writer_set_task_notes(int id, const char* notes);
+int db_writer_set_task_flagged(int id, int flagged);
+int db_writer_set_task_defer_at(int id, time_t defer_at);
+int db_writer_set_task_due_at(int id, time_t due_at);
+int db_writer_set_task_order_index(int id, int order_index);
+int db_writer_assign_task_to_project(int id, int project_id);
+int db_writer_set_task_recurrence(int id, RecurrencePattern pattern, int interval);
+int db_writer_delete_task(int id);
+int db_writer_add_context_to_task(int task_id, int context_id);
+int db_writer_remove_context_from_task(int task_id, int context_id);
+int db_writer_set_project_title(int id, const char* title);
+int db_writer_set_project_type(int id, ProjectType type);
+int db_writer_delete_project(int id);
+int db_writer_delete_context(int id);
+int db_writer_set_tasks_status(const int* ids, int n, TaskStatus status);
+int db_writer_delete_tasks(const int* ids, int n);
+int db_writer_set_tasks_flagged(const int* ids, int n, int flagged);
+int db_writer_insert_task(const TaskDraft* draft);
+int db_writer_add_dependency(int task_id, int depends_on_task_id);
+int db_writer_remove_dependency(int task_id, int depends_on_task_id);
+int db_writer_refresh_availability(time_t now);
+int db_writer_insert_project(const char* title, ProjectType type);
+int db_writer_insert_context(const char* name);
+
+#endif // WRITER_H
@@ -12,188 +12,186 @@
 #include "core/task.h"
 #include "core/project.h"
 #include "core/context.h"
+#include "core/model.h"
 #include "core/undo.h"
 #include "core/export.h"
 #include "core/preferences.h"
+#include "core/profiler.h"
+#include "core/trace.h"
 #include "db/database.h"
+#include "db/writer.h"
 #include "ui/inbox_view.h"
 #include "ui/sidebar.h"
 #include "ui/help_overlay.h"
 #include "ui/command_palette.h"
 #include "ui/launcher.h"
+#include "ui/profiler_overlay.h"
+
+#define INPUT_FRAMES 2              // Frames drawn after input so ImGui can settle
+#define TEXT_CURSOR_FRAME_S 0.5     // Longest idle sleep while a text field blinks
+#define ANIMATION_FRAME_S 0.1       // Longest idle sleep for tooltips and progress bars
 
 // Forward declarations
 static void glfw_error_callback(int error, const char* description);
+static void install_input_callbacks(GLFWwindow* window);
 static int init_imgui(GLFWwindow* window);
 static void cleanup_imgui(void);
 
 // Application state
-static Task* tasks = NULL;
-static int task_count = 0;
-static Project* projects = NULL;
-static int project_count = 0;
-static Context* contexts = NULL;
-static int context_count = 0;
+static Model model;
 static int selected_project_id = -1;  // -4 = Flagged, -3 = Anytime, -2 = Completed, -1 = Today, 0 = Inbox, >0 = Project ID
 static int selected_context_id = 0;   // 0 = No filter, >0 = Filter by context
 static CommandPaletteState cmd_palette;
 static bool show_help_overlay = false;
 static bool show_preferences = false;
+static bool show_profiler = false;
 static Preferences preferences;
 static UndoStack undo_stack;
 static const char* db_path = NULL;
+static int busy_frames = INPUT_FRAMES;  // Frames to draw before the loop may sleep
 
-// Load tasks from database (optionally filtered by project)
-static int load_tasks(int project_filter) {
-    if (tasks != NULL) {
-        free(tasks);
-        tasks = NULL;
-        task_count = 0;
-    }
+// Runs on the main thread for each write the writer thread has finished
+static void on_write_complete(const DbWriteResult* result, void* user_data) {
+    (void)user_data;
     
-    // Load all incomplete tasks, we'll filter by project in the UI if needed
-    if (db_load_tasks(&tasks, &task_count, -1) != 0) {
-        fprintf(stderr, "Failed to load tasks: %s\n", db_get_error());
-        return -1;
+    if (result->result != 0) {
+        fprintf(stderr, "Write failed: %s\n", result->error);
     }
     
-    // Get current time for availability checking
-    time_t now = time(NULL);
-    struct tm* now_tm = localtime(&now);
-    
-    // Find project type if filtering by specific project
-    ProjectType project_type = PROJECT_TYPE_SEQUENTIAL;
-    if (project_filter > 0) {
-        for (int j = 0; j < project_count; j++) {
-            if (projects[j].id == project_filter) {
-                project_type = projects[j].type;
-                break;
-            }
-        }
+    // The edit is already on screen; only derived state needs refreshing
+    model_on_write_complete(&model, result);
+}
+
+// Runs on the writer thread once completions are queued: wake the main
+// loop if it is sleeping so they are dispatched
+static void wake_main_loop(void* user_data) {
+    (void)user_data;
+    glfwPostEmptyEvent();
+}
+
+// Show a progress window while a background backup runs, and report the
+// result once it finishes. Returns true while it is running.
+static bool render_backup_progress(void) {
+    BackupProgress progress;
+    BackupState state = export_poll_backup(&progress);
+    
+    if (state == BACKUP_SUCCEEDED) {
+        printf("Database backup created: %s\n", progress.backup_path);
+        return false;
+    }
+    if (state == BACKUP_FAILED) {
+        fprintf(stderr, "Backup failed: %s\n", progress.error);
+        return false;
+    }
+    if (state != BACKUP_RUNNING) {
+        return false;
     }
     
-    int filtered_count = 0;
-    for (int i = 0; i < task_count; i++) {
-        // For Completed perspective, only show completed tasks
-        if (project_filter == -2) {
-            if (tasks[i].status == TASK_STATUS_DONE) {
-                tasks[filtered_count++] = tasks[i];
-            }
-            continue;
-        }
+    ImGuiViewport* viewport = igGetMainViewport();
+    ImVec2 corner = {viewport->WorkPos.x + viewport->WorkSize.x - 16.0f,
+                     viewport->WorkPos.y + viewport->WorkSize.y - 16.0f};
+    igSetNextWindowPos(corner, ImGuiCond_Always, (ImVec2){1.0f, 1.0f});
+    igSetNextWindowSize((ImVec2){300, 0}, ImGuiCond_Always);
+    igSetNextWindowBgAlpha(0.9f);
+    
+    int flags = ImGuiWindowFlags_NoDecoration |
+                ImGuiWindowFlags_NoMove |
+                ImGuiWindowFlags_NoSavedSettings |
+                ImGuiWindowFlags_NoFocusOnAppearing |
+                ImGuiWindowFlags_NoNav;
+    
+    if (igBegin("##BackupProgress", NULL, flags)) {
+        float fraction = progress.pages_total > 0
+            ? (float)progress.pages_done / (float)progress.pages_total : 0.0f;
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%d / %d pages",
+                 progress.pages_done, progress.pages_total);
         
-        // For Review perspective (-6), show stale tasks (not modified in 7+ days)
-        if (project_filter == -6) {
-            time_t week_ago = now - (7 * 24 * 60 * 60);
-            if (tasks[i].status != TASK_STATUS_DONE && 
-                tasks[i].modified_at > 0 && 
-                tasks[i].modified_at < week_ago) {
-                tasks[filtered_count++] = tasks[i];
-            }
-            continue;
-        }
-        
-        // Skip deferred tasks (not yet available) for all other perspectives
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) {
-            continue;
-        }
-        
-        // Skip completed tasks for all perspectives except Completed and Review
-        if (tasks[i].status == TASK_STATUS_DONE) {
-            continue;
-        }
-        
-        if (project_filter == -4) {
-            // Flagged perspective: show only flagged tasks (not deferred, not completed)
-            if (tasks[i].flagged) {
-                tasks[filtered_count++] = tasks[i];
-            }
-        } else if (project_filter == -3) {
-            // Anytime perspective: show all available tasks (not deferred, not completed)
-            tasks[filtered_count++] = tasks[i];
-        } else if (project_filter == -1) {
-            // Today perspective: show tasks that are due today or overdue, or have no due date but are available
-            bool include = false;
-            
-            if (tasks[i].due_at > 0) {
-                struct tm* due_tm = localtime(&tasks[i].due_at);
-                // Check if due today or overdue
-                if (due_tm->tm_year < now_tm->tm_year ||
-                    (due_tm->tm_year == now_tm->tm_year && due_tm->tm_yday <= now_tm->tm_yday)) {
-                    include = true;
-                }
-            } else {
-                // Tasks without due date: include if they're available (not deferred)
-                include = true;
-            }
-            
-            if (include) {
-                tasks[filtered_count++] = tasks[i];
-            }
-        } else if (project_filter == 0) {
-            // Inbox: tasks with no project
-            if (tasks[i].project_id == 0) {
-                tasks[filtered_count++] = tasks[i];
-            }
-        } else {
-            // Specific project: tasks assigned to this project
-            if (tasks[i].project_id == project_filter) {
-                if (project_type == PROJECT_TYPE_PARALLEL) {
-                    // Parallel: show all tasks
-                    tasks[filtered_count++] = tasks[i];
-                } else {
-                    // Sequential: only show first incomplete task
-                    int first_task = db_get_first_incomplete_task_in_project(project_filter);
-                    if (first_task == tasks[i].id) {
-                        tasks[filtered_count++] = tasks[i];
-                    }
-                }
-            }
-        }
+        igText("Backing up database...");
+        igProgressBar(fraction, (ImVec2){-1.0f, 0.0f}, overlay);
     }
-    task_count = filtered_count;
-    
-    return 0;
+    igEnd();
+    return true;
 }
 
-// Load projects from database
-static int load_projects(void) {
-    if (projects != NULL) {
-        free(projects);
-        projects = NULL;
-        project_count = 0;
+// How long the loop may sleep after this frame before drawing another,
+// in seconds. Input and writer completions wake it sooner.
+static double idle_timeout(bool animating) {
+    double timeout = preferences.max_idle_frame_ms / 1000.0;
+    
+    // Defer dates, review ages and midnight change what is shown on their own
+    time_t wakeup = model_next_wakeup(&model);
+    if (wakeup > 0) {
+        double until = difftime(wakeup, time(NULL));
+        if (until < timeout) {
+            timeout = until > 0 ? until : 0;
+        }
     }
     
-    if (db_load_projects(&projects, &project_count) != 0) {
-        fprintf(stderr, "Failed to load projects: %s\n", db_get_error());
-        return -1;
+    ImGuiIO* io = igGetIO_Nil();
+    if (io->WantTextInput && timeout > TEXT_CURSOR_FRAME_S) {
+        timeout = TEXT_CURSOR_FRAME_S;
     }
-    
-    return 0;
+    if ((animating || igIsAnyItemHovered()) && timeout > ANIMATION_FRAME_S) {
+        timeout = ANIMATION_FRAME_S;
+    }
+    return timeout;
 }
 
-// Load contexts from database
-static int load_contexts(void) {
-    if (contexts != NULL) {
-        free(contexts);
-        contexts = NULL;
-        context_count = 0;
+// Charge the statements the main connection ran since the last call to
+// the current frame
+static void profile_statements(void) {
+    static DbStmtStats last;
+    DbStmtStats stats;
+    db_get_stmt_stats(&stats);
+    if (stats.statements > last.statements) {
+        profile_add(PROFILE_SQLITE, stats.statement_ns - last.statement_ns);
+        profile_count_statements((int)(stats.statements - last.statements));
     }
-    
-    if (db_load_contexts(&contexts, &context_count) != 0) {
-        fprintf(stderr, "Failed to load contexts: %s\n", db_get_error());
-        return -1;
+    last = stats;
+}
+
+// Write the session trace, if one was asked for, however main returns
+static void write_trace(void) {
+    char path[512];
+    if (trace_get_path() == NULL) {
+        return;
     }
+    snprintf(path, sizeof(path), "%s", trace_get_path());
     
-    return 0;
+    if (trace_stop() != 0) {
+        fprintf(stderr, "Failed to write trace: %s\n", trace_get_error());
+    } else {
+        printf("Trace written to %s\n", path);
+    }
+}
+
+// Process input, sleeping first if nothing needs another frame yet
+static void wait_for_frame(double timeout) {
+    if (!preferences.render_on_demand || busy_frames > 0 || timeout <= 0) {
+        if (busy_frames > 0) {
+            busy_frames--;
+        }
+        glfwPollEvents();
+        return;
+    }
+    glfwWaitEventsTimeout(timeout);
 }
 
 int main(int argc, char** argv) {
-    (void)argc;
-    (void)argv;
-    
     printf("SamFocus - Starting up...\n");
     
+    // --trace FILE or SAMFOCUS_TRACE=FILE records a Perfetto trace of the session
+    if (trace_start_from_command_line(&argc, argv, "samfocus") != 0) {
+        fprintf(stderr, "Failed to start tracing: %s\n", trace_get_error());
+        return 1;
+    }
+    trace_name_thread("main");
+    if (trace_enabled()) {
+        printf("Tracing to %s\n", trace_get_path());
+        atexit(write_trace);
+    }
+    
     // Get application data directory
     const char* app_dir = get_app_data_dir();
     printf("App data directory: %s\n", app_dir);
@@ -208,7 +206,12 @@ int main(int argc, char** argv) {
     db_path = path_join(app_dir, "samfocus.db");
     printf("Database path: %s\n", db_path);
     
-    if (db_init(db_path) != 0) {
+    // WAL lets samfocus-cli read and write while the GUI has the file open
+    DbConfig db_config;
+    db_config_default(&db_config);
+    db_config.single_threaded = 1;
+    
+    if (db_init_ex(db_path, &db_config) != 0) {
         fprintf(stderr, "Failed to initialize database: %s\n", db_get_error());
         return 1;
     }
@@ -222,22 +225,15 @@ int main(int argc, char** argv) {
     printf("Database initialized successfully\n");
     
     // Load projects, contexts, and tasks
-    if (load_projects() != 0) {
+    model_init(&model, selected_project_id, selected_context_id);
+    if (model_sync(&model) != 0) {
+        model_free(&model);
         db_close();
         return 1;
     }
     
-    if (load_contexts() != 0) {
-        db_close();
-        return 1;
-    }
-    
-    if (load_tasks(selected_project_id) != 0) {
-        db_close();
-        return 1;
-    }
-    
-    printf("Loaded %d projects, %d contexts, and %d tasks\n", project_count, context_count, task_count);
+    printf("Loaded %d projects, %d contexts, and %d tasks\n",
+           model.project_count, model.context_count, model.task_count);
     
     // Setup GLFW
     glfwSetErrorCallback(glfw_error_callback);
@@ -267,6 +263,9 @@ int main(int argc, char** argv) {
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1); // Enable vsync
     
+    // Before ImGui, which chains to these from its own callbacks
+    install_input_callbacks(window);
+    
     // Initialize ImGui
     if (init_imgui(window) != 0) {
         fprintf(stderr, "Failed to initialize ImGui\n");
@@ -287,11 +286,42 @@ int main(int argc, char** argv) {
     preferences_init(&preferences);
     preferences_load(&preferences);
     
+    // Edits are applied on a second connection off the render thread
+    db_writer_set_notify(wake_main_loop, NULL);
+    if (db_writer_start(db_path, on_write_complete, NULL) != 0) {
+        fprintf(stderr, "Background writer unavailable, writing synchronously: %s\n",
+                db_writer_get_error());
+    }
+    
     printf("Entering main loop...\n");
     
-    // Main loop
+    // Main loop. While nothing changes it sleeps until input, a writer
+    // completion, the next scheduled change in the model, or the max idle
+    // interval, which bounds how late edits from samfocus-cli show up.
+    double timeout = 0;
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        wait_for_frame(timeout);
+        profile_statements();  // Outside a frame, so startup queries are not charged
+        profile_frame_begin();
+        
+        // Pick up writes the writer thread has finished
+        profile_begin(PROFILE_EVENTS);
+        db_writer_dispatch();
+        
+        // Deferred tasks becoming available is the one change no trigger sees
+        if (model.next_defer_boundary > 0 && time(NULL) >= model.next_defer_boundary) {
+            // Queued behind pending edits; the tasks reload once it lands
+            db_writer_refresh_availability(time(NULL));
+            model.next_defer_boundary = 0;
+        }
+        
+        // Edits from samfocus-cli or another instance are merged at the sync
+        model_poll_changes(&model);
+        profile_end(PROFILE_EVENTS);
+        
+        // Apply last frame's selection changes and reload only what is stale
+        model_set_filter(&model, selected_project_id, selected_context_id);
+        model_sync(&model);
         
         // Start ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -329,6 +359,11 @@ int main(int argc, char** argv) {
             }
         }
         
+        // F12 to toggle the frame profiler
+        if (igIsKeyPressed_Bool(ImGuiKey_F12, false)) {
+            show_profiler = !show_profiler;
+        }
+        
         // Ctrl+, to open preferences
         if (io->KeyCtrl && igIsKeyPressed_Bool(ImGuiKey_Comma, false)) {
             show_preferences = !show_preferences;
@@ -340,8 +375,7 @@ int main(int argc, char** argv) {
             if (igIsKeyPressed_Bool(ImGuiKey_Z, false)) {
                 if (undo_can_undo(&undo_stack)) {
                     undo_last(&undo_stack);
-                    load_tasks(selected_project_id);
-                    load_projects();
+                    model_mark_dirty(&model, MODEL_DIRTY_TASKS | MODEL_DIRTY_PROJECTS);
                 }
             }
             
@@ -361,57 +395,35 @@ int main(int argc, char** argv) {
         // Position and render sidebar on the left
         igSetNextWindowPos((ImVec2){0, 0}, ImGuiCond_Always, (ImVec2){0, 0});
         igSetNextWindowSize((ImVec2){sidebar_width, (float)display_h}, ImGuiCond_Always);
-        int sidebar_needs_reload = 0;
-        int prev_project = selected_project_id;
-        int prev_context = selected_context_id;
-        sidebar_render(projects, project_count, contexts, context_count, 
-                      tasks, task_count,
-                      &selected_project_id, &selected_context_id, &sidebar_needs_reload);
-        
-        // If project or context changed, reload tasks
-        if (prev_project != selected_project_id || prev_context != selected_context_id) {
-            load_tasks(selected_project_id);
-        }
+        profile_begin(PROFILE_SIDEBAR);
+        sidebar_render(&model, &selected_project_id, &selected_context_id);
+        profile_end(PROFILE_SIDEBAR);
         
         // Position and render inbox/project view on the right
         igSetNextWindowPos((ImVec2){sidebar_width, 0}, ImGuiCond_Always, (ImVec2){0, 0});
         igSetNextWindowSize((ImVec2){(float)display_w - sidebar_width, (float)display_h}, ImGuiCond_Always);
-        int inbox_needs_reload = 0;
-        inbox_view_render(tasks, task_count, projects, project_count, 
-                         contexts, context_count, selected_project_id, &inbox_needs_reload);
-        
-        // Reload if needed
-        if (sidebar_needs_reload) {
-            load_projects();
-            load_contexts();
-        }
-        if (inbox_needs_reload) {
-            load_tasks(selected_project_id);
-        }
+        profile_begin(PROFILE_TASK_LIST);
+        inbox_view_render(&model, selected_project_id);
+        profile_end(PROFILE_TASK_LIST);
         
         // Render command palette
-        if (command_palette_show(&cmd_palette, tasks, task_count, projects, project_count,
-                                contexts, context_count, -1)) {
+        profile_begin(PROFILE_COMMAND_PALETTE);
+        bool palette_picked = command_palette_show(&cmd_palette, model.tasks, model.task_count,
+                                                   model.projects, model.project_count,
+                                                   model.contexts, model.context_count, -1);
+        profile_end(PROFILE_COMMAND_PALETTE);
+        if (palette_picked) {
             // Handle command palette result
             CommandResult* selected = &cmd_palette.results[cmd_palette.selected_index];
             if (selected->type == CMD_TYPE_PROJECT) {
                 selected_project_id = selected->id;
-                load_tasks(selected_project_id);
             } else if (selected->type == CMD_TYPE_CONTEXT) {
                 selected_context_id = selected->id;
-                load_tasks(selected_project_id);
             } else if (selected->type == CMD_TYPE_TASK) {
                 // Jump to the task's project
-                for (int i = 0; i < task_count; i++) {
-                    if (tasks[i].id == selected->id) {
-                        if (tasks[i].project_id > 0) {
-                            selected_project_id = tasks[i].project_id;
-                        } else {
-                            selected_project_id = 0;  // Inbox
-                        }
-                        load_tasks(selected_project_id);
-                        break;
-                    }
+                Task* task = model_find_task(&model, selected->id);
+                if (task != NULL) {
+                    selected_project_id = task->project_id > 0 ? task->project_id : 0;  // 0 = Inbox
                 }
             } else if (selected->type == CMD_TYPE_ACTION) {
                 // Handle actions
@@ -439,15 +451,15 @@ int main(int argc, char** argv) {
                     snprintf(filepath, sizeof(filepath), "%s/tasks_%s.%s",
                             export_get_default_dir(), timestamp, ext);
                     
-                    if (export_tasks(filepath, format, tasks, task_count, projects, project_count) == 0) {
+                    if (export_tasks(filepath, format, model.tasks, model.task_count,
+                                     model.projects, model.project_count) == 0) {
                         printf("Exported to: %s\n", filepath);
                     } else {
                         fprintf(stderr, "Export failed: %s\n", export_get_error());
                     }
                 } else if (selected->action == CMD_ACTION_BACKUP_DB) {
-                    if (export_create_backup(db_path) == 0) {
-                        printf("Database backup created successfully\n");
-                    } else {
+                    // Runs on a background thread; render_backup_progress reports the result
+                    if (export_start_backup(db_path) != 0) {
                         fprintf(stderr, "Backup failed: %s\n", export_get_error());
                     }
                 }
@@ -457,12 +469,9 @@ int main(int argc, char** argv) {
         }
         
         // Render launcher (Raycast-style quick add)
-        int launcher_needs_reload = 0;
-        launcher_render(tasks, task_count, projects, project_count,
-                       contexts, context_count, &launcher_needs_reload);
-        if (launcher_needs_reload) {
-            load_tasks(selected_project_id);
-        }
+        profile_begin(PROFILE_LAUNCHER);
+        launcher_render(&model);
+        profile_end(PROFILE_LAUNCHER);
         
         // Render preferences window
         preferences_render(&preferences, &show_preferences);
@@ -470,7 +479,14 @@ int main(int argc, char** argv) {
         // Render help overlay if toggled
         help_overlay_render(show_help_overlay);
         
+        // Render backup progress while one is running
+        bool backing_up = render_backup_progress();
+        
+        // Render the profiler last, showing frames up to the previous one
+        profiler_overlay_render(&show_profiler);
+        
         // Rendering
+        profile_begin(PROFILE_DRAW);
         igRender();
         
         glfwGetFramebufferSize(window, &display_w, &display_h);
@@ -479,8 +495,19 @@ int main(int argc, char** argv) {
         glClear(GL_COLOR_BUFFER_BIT);
         
         ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
+        profile_end(PROFILE_DRAW);
         
+        // Vsync waits in the swap, so the frame is timed up to it
+        profile_statements();
+        profile_frame_end();
         glfwSwapBuffers(window);
+        
+        // Work left for the next frame: a sync still waiting is retried
+        // without sleeping, unless it waits on the writer, which wakes us
+        if (model.dirty != 0 && db_writer_pending() == 0 && busy_frames == 0) {
+            busy_frames = 1;
+        }
+        timeout = idle_timeout(backing_up);
     }
     
     printf("Shutting down...\n");
@@ -489,16 +516,13 @@ int main(int argc, char** argv) {
     sidebar_cleanup();
     inbox_view_cleanup();
     
-    if (tasks != NULL) {
-        free(tasks);
-    }
+    // Apply any queued edits before the main connection closes
+    db_writer_stop();
+    model_free(&model);
     
-    if (projects != NULL) {
-        free(projects);
-    }
-    
-    if (contexts != NULL) {
-        free(contexts);
+    // Let a running backup finish before the process exits
+    while (export_poll_backup(NULL) == BACKUP_RUNNING) {
+        platform_sleep_ms(10);
     }
     
     cleanup_imgui();
@@ -515,6 +539,68 @@ static void glfw_error_callback(int error, const char* description) {
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
+// Any input or window change gets a few frames drawn right away
+static void note_input(void) {
+    busy_frames = INPUT_FRAMES;
+}
+
+static void on_key(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    (void)window; (void)key; (void)scancode; (void)action; (void)mods;
+    note_input();
+}
+
+static void on_char(GLFWwindow* window, unsigned int codepoint) {
+    (void)window; (void)codepoint;
+    note_input();
+}
+
+static void on_mouse_button(GLFWwindow* window, int button, int action, int mods) {
+    (void)window; (void)button; (void)action; (void)mods;
+    note_input();
+}
+
+static void on_cursor_pos(GLFWwindow* window, double x, double y) {
+    (void)window; (void)x; (void)y;
+    note_input();
+}
+
+static void on_scroll(GLFWwindow* window, double x, double y) {
+    (void)window; (void)x; (void)y;
+    note_input();
+}
+
+static void on_cursor_enter(GLFWwindow* window, int entered) {
+    (void)window; (void)entered;
+    note_input();
+}
+
+static void on_focus(GLFWwindow* window, int focused) {
+    (void)window; (void)focused;
+    note_input();
+}
+
+static void on_resize(GLFWwindow* window, int width, int height) {
+    (void)window; (void)width; (void)height;
+    note_input();
+}
+
+static void on_refresh(GLFWwindow* window) {
+    (void)window;
+    note_input();
+}
+
+static void install_input_callbacks(GLFWwindow* window) {
+    glfwSetKeyCallback(window, on_key);
+    glfwSetCharCallback(window, on_char);
+    glfwSetMouseButtonCallback(window, on_mouse_button);
+    glfwSetCursorPosCallback(window, on_cursor_pos);
+    glfwSetScrollCallback(window, on_scroll);
+    glfwSetCursorEnterCallback(window, on_cursor_enter);
+    glfwSetWindowFocusCallback(window, on_focus);
+    glfwSetFramebufferSizeCallback(window, on_resize);
+    glfwSetWindowRefreshCallback(window, on_refresh);
+}
+
 static int init_imgui(GLFWwindow* window) {
     // Setup Dear ImGui context
     igCreateContext(NULL);
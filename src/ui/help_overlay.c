@@ -64,6 +64,7 @@ void help_overlay_render(bool show_help) {
         igBulletText("End - Jump to last task");
         igBulletText("Ctrl+1 - Today, Ctrl+2 - Anytime, Ctrl+3 - Flagged");
         igBulletText("Ctrl+4 - Inbox, Ctrl+5 - Completed");
+        igBulletText("F12 - Toggle frame profiler");
         igSpacing();
         
         // Task Actions section
@@ -1,9 +1,7 @@
 #ifndef INBOX_VIEW_H
 #define INBOX_VIEW_H
 
-#include "../core/task.h"
-#include "../core/project.h"
-#include "../core/context.h"
+#include "../core/model.h"
 
 /**
  * Initialize the inbox view.
@@ -15,17 +13,10 @@ void inbox_view_init(void);
  * Render the inbox view.
  * Call this every frame.
  * 
- * @param tasks Array of tasks to display
- * @param task_count Number of tasks in the array
- * @param projects Array of all projects (for assignment dropdown)
- * @param project_count Number of projects
- * @param contexts Array of all contexts (for context assignment)
- * @param context_count Number of contexts
+ * @param model Tasks, projects and contexts to display; edits are applied to it
  * @param selected_project_id Currently selected project (0 for Inbox)
- * @param needs_reload Output: set to 1 if tasks need to be reloaded from DB
  */
-void inbox_view_render(Task* tasks, int task_count, Project* projects, int project_count,
-                       Context* contexts, int context_count, int selected_project_id, int* needs_reload);
+void inbox_view_render(Model* model, int selected_project_id);
 
 /**
  * Cleanup inbox view resources.
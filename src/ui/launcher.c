@@ -328,12 +328,16 @@ static void generate_actions(const char* input, Task* tasks, int task_count,
     fuzzy_search_tasks(input, tasks, task_count);
 }
 
-void launcher_render(Task* tasks, int task_count,
-                     Project* projects, int project_count,
-                     Context* contexts, int context_count,
-                     int* needs_reload) {
+void launcher_render(Model* model) {
     if (!launcher_visible) return;
     
+    Task* tasks = model->tasks;
+    int task_count = model->task_count;
+    Project* projects = model->projects;
+    int project_count = model->project_count;
+    Context* contexts = model->contexts;
+    int context_count = model->context_count;
+    
     // Center the launcher window
     ImGuiIO* io = igGetIO_Nil();
     ImVec2 center = {io->DisplaySize.x * 0.5f, io->DisplaySize.y * 0.3f};
@@ -403,13 +407,14 @@ void launcher_render(Task* tasks, int task_count,
                                       &due_date, &defer_date, &flagged, &project_id);
                 
                 if (task_title[0] != '\0') {
-                    int task_id = db_insert_task(task_title, TASK_STATUS_INBOX);
-                    if (task_id > 0) {
-                        if (due_date > 0) db_update_task_due_at(task_id, due_date);
-                        if (defer_date > 0) db_update_task_defer_at(task_id, defer_date);
-                        if (flagged) db_update_task_flagged(task_id, 1);
-                        *needs_reload = 1;
-                    }
+                    TaskDraft draft = {0};
+                    draft.title = task_title;
+                    draft.status = TASK_STATUS_INBOX;
+                    draft.due_at = due_date;
+                    draft.defer_at = defer_date;
+                    draft.flagged = flagged;
+                    
+                    model_insert_task(model, &draft);
                 }
             }
             
@@ -1,9 +1,7 @@
 #ifndef LAUNCHER_H
 #define LAUNCHER_H
 
-#include "../core/task.h"
-#include "../core/project.h"
-#include "../core/context.h"
+#include "../core/model.h"
 
 /**
  * Initialize the launcher system
@@ -28,17 +26,8 @@ int launcher_is_visible(void);
 /**
  * Render the launcher UI
  * 
- * @param tasks Array of tasks for searching
- * @param task_count Number of tasks
- * @param projects Array of projects
- * @param project_count Number of projects
- * @param contexts Array of contexts
- * @param context_count Number of contexts
- * @param needs_reload Output flag to signal main app to reload
+ * @param model Tasks, projects and contexts to search; new tasks are added to it
  */
-void launcher_render(Task* tasks, int task_count, 
-                     Project* projects, int project_count,
-                     Context* contexts, int context_count,
-                     int* needs_reload);
+void launcher_render(Model* model);
 
 #endif // LAUNCHER_H
@@ -0,0 +1,322 @@
+#include "profiler_overlay.h"
+#include "../core/profiler.h"
+#include "../db/database.h"
+#include <stdio.h>
+
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#define CIMGUI_USE_GLFW
+#define CIMGUI_USE_OPENGL3
+#include <cimgui.h>
+
+#define FLAME_ROW_HEIGHT 18.0f
+#define QUERY_ROWS 15           // Statements listed, most total time first
+
+static const ImVec4 scope_colors[PROFILE_SCOPE_COUNT] = {
+    {0.35f, 0.35f, 0.40f, 1.0f},    // Frame
+    {0.55f, 0.45f, 0.75f, 1.0f},    // Events
+    {0.25f, 0.55f, 0.85f, 1.0f},    // Sync
+    {0.20f, 0.70f, 0.90f, 1.0f},    // Load tasks
+    {0.30f, 0.70f, 0.40f, 1.0f},    // Sidebar
+    {0.45f, 0.80f, 0.35f, 1.0f},    // Task list
+    {0.85f, 0.65f, 0.25f, 1.0f},    // Command palette
+    {0.90f, 0.50f, 0.30f, 1.0f},    // Launcher
+    {0.60f, 0.60f, 0.60f, 1.0f},    // Draw
+    {0.85f, 0.30f, 0.35f, 1.0f}     // SQLite
+};
+
+// Frame shown in the flame graph: the one under the mouse, else the pinned
+// one while it is kept, else the newest
+static bool has_pin = false;
+static unsigned pinned_number = 0;
+
+// Age of the pinned frame, or -1 if there is none
+static int pinned_age(int frame_count) {
+    if (!has_pin) {
+        return -1;
+    }
+    unsigned age = profile_get_frame(0)->number - pinned_number;
+    return age < (unsigned)frame_count ? (int)age : -1;
+}
+
+static void render_stats_table(void) {
+    int flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (!igBeginTable("##profile_stats", 5, flags, (ImVec2){0, 0}, 0.0f)) {
+        return;
+    }
+    
+    igTableSetupColumn("Scope", 0, 0.0f, 0);
+    igTableSetupColumn("Min ms", 0, 0.0f, 0);
+    igTableSetupColumn("Avg ms", 0, 0.0f, 0);
+    igTableSetupColumn("P99 ms", 0, 0.0f, 0);
+    igTableSetupColumn("Frames", 0, 0.0f, 0);
+    igTableHeadersRow();
+    
+    for (int scope = 0; scope < PROFILE_SCOPE_COUNT; scope++) {
+        ProfileStats stats;
+        int has_stats = profile_get_stats((ProfileScope)scope, &stats) == 0;
+        
+        igTableNextRow(0, 0.0f);
+        igTableNextColumn();
+        igTextColored(scope_colors[scope], "%s", profile_scope_name((ProfileScope)scope));
+        igTableNextColumn();
+        if (!has_stats) {
+            igTextDisabled("-");
+            continue;
+        }
+        igText("%.2f", stats.min);
+        igTableNextColumn();
+        igText("%.2f", stats.avg);
+        igTableNextColumn();
+        igText("%.2f", stats.p99);
+        igTableNextColumn();
+        igText("%d", stats.frames);
+    }
+    
+    ProfileStats statements;
+    if (profile_get_statement_stats(&statements) == 0) {
+        igTableNextRow(0, 0.0f);
+        igTableNextColumn();
+        igText("Statements");
+        igTableNextColumn();
+        igText("%.0f", statements.min);
+        igTableNextColumn();
+        igText("%.1f", statements.avg);
+        igTableNextColumn();
+        igText("%.0f", statements.p99);
+        igTableNextColumn();
+        igText("%d", statements.frames);
+    }
+    
+    igEndTable();
+}
+
+// Frame times oldest first, with the frame under the mouse, if any
+static int render_frame_histogram(int frame_count) {
+    float times[PROFILE_HISTORY];
+    float slowest = 0.0f;
+    for (int i = 0; i < frame_count; i++) {
+        const ProfileFrame* frame = profile_get_frame(frame_count - 1 - i);
+        times[i] = (float)((double)frame->duration_ns / 1e6);
+        if (times[i] > slowest) {
+            slowest = times[i];
+        }
+    }
+    
+    ImVec2 origin = igGetCursorScreenPos();
+    float width = igGetContentRegionAvail().x;
+    igPlotHistogram_FloatPtr("##frame_times", times, frame_count, 0, "Frame time (ms)",
+                             0.0f, slowest * 1.1f, (ImVec2){width, 60.0f}, sizeof(float));
+    
+    if (!igIsItemHovered(0) || width <= 0.0f) {
+        return -1;
+    }
+    
+    int index = (int)((igGetIO_Nil()->MousePos.x - origin.x) / width * frame_count);
+    if (index < 0 || index >= frame_count) {
+        return -1;
+    }
+    
+    int age = frame_count - 1 - index;
+    if (igIsMouseClicked_Bool(ImGuiMouseButton_Left, false)) {
+        unsigned number = profile_get_frame(age)->number;
+        has_pin = !(has_pin && pinned_number == number);
+        pinned_number = number;
+    }
+    return age;
+}
+
+// Spans laid out by start time and nesting depth, scaled to the frame
+static void render_flame_graph(const ProfileFrame* frame) {
+    ImVec2 origin = igGetCursorScreenPos();
+    float width = igGetContentRegionAvail().x;
+    double scale = frame->duration_ns > 0 ? (double)width / (double)frame->duration_ns : 0.0;
+    ImVec2 mouse = igGetIO_Nil()->MousePos;
+    ImDrawList* draw_list = igGetWindowDrawList();
+    const ProfileSpan* hovered = NULL;
+    
+    int depth_count = 0;
+    for (int i = 0; i < frame->span_count; i++) {
+        const ProfileSpan* span = &frame->spans[i];
+        if (span->depth + 1 > depth_count) {
+            depth_count = span->depth + 1;
+        }
+        
+        ImVec2 p_min = {origin.x + (float)(span->start_ns * scale),
+                        origin.y + span->depth * FLAME_ROW_HEIGHT};
+        ImVec2 p_max = {p_min.x + (float)(span->duration_ns * scale),
+                        p_min.y + FLAME_ROW_HEIGHT - 1.0f};
+        if (p_max.x - p_min.x < 1.0f) {
+            p_max.x = p_min.x + 1.0f;  // Keep very short spans visible
+        }
+        ImDrawList_AddRectFilled(draw_list, p_min, p_max,
+                                 igGetColorU32_Vec4(scope_colors[span->scope]), 2.0f, 0);
+        
+        const char* name = profile_scope_name(span->scope);
+        if (igCalcTextSize(name, NULL, false, -1.0f).x + 6.0f < p_max.x - p_min.x) {
+            ImDrawList_AddText_Vec2(draw_list, (ImVec2){p_min.x + 3.0f, p_min.y + 2.0f},
+                                    igGetColorU32_Vec4((ImVec4){0.0f, 0.0f, 0.0f, 1.0f}),
+                                    name, NULL);
+        }
+        
+        if (mouse.x >= p_min.x && mouse.x < p_max.x && mouse.y >= p_min.y && mouse.y < p_max.y) {
+            hovered = span;
+        }
+    }
+    
+    igDummy((ImVec2){width, depth_count > 0 ? depth_count * FLAME_ROW_HEIGHT : FLAME_ROW_HEIGHT});
+    if (hovered != NULL && igIsItemHovered(0)) {
+        igSetTooltip("%s: %.3f ms", profile_scope_name(hovered->scope),
+                     (double)hovered->duration_ns / 1e6);
+    }
+}
+
+// Slow-query threshold set from the overlay, 0 while the log is off
+static int slow_query_ms = 0;
+
+// Statement text on one line, cut to fit the buffer
+static void one_line_sql(const char* sql, char* out, size_t size) {
+    size_t len = 0;
+    bool space = false;
+    for (const char* c = sql; *c != '\0' && len + 1 < size; c++) {
+        if (*c == ' ' || *c == '\n' || *c == '\t' || *c == '\r') {
+            space = len > 0;
+            continue;
+        }
+        if (space && len + 2 < size) {
+            out[len++] = ' ';
+        }
+        space = false;
+        out[len++] = *c;
+    }
+    out[len] = '\0';
+}
+
+// Per-statement totals from the main connection, with the query plan of
+// the statement under the mouse
+static void render_query_stats(void) {
+    bool profiling = db_query_profiling_enabled() != 0;
+    if (igCheckbox("Profile statements", &profiling)) {
+        db_set_query_profiling(profiling ? 1 : 0);
+    }
+    igSameLine(0.0f, -1.0f);
+    if (igSmallButton("Clear")) {
+        db_reset_query_stats();
+    }
+    
+    igPushItemWidth(160.0f);
+    if (igSliderInt("Log slower than", &slow_query_ms, 0, 100,
+                    slow_query_ms > 0 ? "%d ms" : "off", ImGuiSliderFlags_None)) {
+        db_set_slow_query_ms((double)slow_query_ms);
+    }
+    igPopItemWidth();
+    
+    DbStmtStats totals;
+    db_get_stmt_stats(&totals);
+    if (slow_query_ms > 0) {
+        igSameLine(0.0f, -1.0f);
+        igText("%llu logged", totals.slow_statements);
+    }
+    
+    DbQueryStats stats[QUERY_ROWS];
+    int count = db_get_query_stats(stats, QUERY_ROWS);
+    if (count == 0) {
+        igTextDisabled(profiling ? "No statements run yet" : "Profiling is off");
+        return;
+    }
+    
+    int flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (!igBeginTable("##query_stats", 5, flags, (ImVec2){0, 0}, 0.0f)) {
+        return;
+    }
+    
+    igTableSetupColumn("Calls", 0, 0.0f, 0);
+    igTableSetupColumn("Rows", 0, 0.0f, 0);
+    igTableSetupColumn("Total ms", 0, 0.0f, 0);
+    igTableSetupColumn("Max ms", 0, 0.0f, 0);
+    igTableSetupColumn("Statement", 0, 0.0f, 0);
+    igTableHeadersRow();
+    
+    for (int i = 0; i < count; i++) {
+        DbQueryStats* q = &stats[i];
+        char sql[64];
+        one_line_sql(q->sql, sql, sizeof(sql));
+        
+        igTableNextRow(0, 0.0f);
+        igTableNextColumn();
+        igText("%llu", q->calls);
+        igTableNextColumn();
+        igText("%llu", q->rows);
+        igTableNextColumn();
+        igText("%.3f", (double)q->total_ns / 1e6);
+        igTableNextColumn();
+        igText("%.3f", (double)q->max_ns / 1e6);
+        igTableNextColumn();
+        igTextUnformatted(sql, NULL);
+        
+        // Plans are only worked out for the statement being looked at
+        if (igIsItemHovered(0)) {
+            char plan[2048];
+            if (db_explain_query(q->sql, plan, sizeof(plan)) != 0) {
+                snprintf(plan, sizeof(plan), "No plan: %s", db_get_error());
+            }
+            igSetTooltip("%s\n\n%s", q->sql, plan);
+        }
+    }
+    
+    igEndTable();
+}
+
+void profiler_overlay_render(bool* show) {
+    if (!*show) {
+        return;
+    }
+    
+    ImGuiViewport* viewport = igGetMainViewport();
+    igSetNextWindowPos((ImVec2){viewport->WorkPos.x + viewport->WorkSize.x - 16.0f,
+                                viewport->WorkPos.y + 16.0f},
+                       ImGuiCond_FirstUseEver, (ImVec2){1.0f, 0.0f});
+    igSetNextWindowSize((ImVec2){480, 560}, ImGuiCond_FirstUseEver);
+    igSetNextWindowBgAlpha(0.95f);
+    
+    if (igBegin("Profiler (F12 to toggle)", show, ImGuiWindowFlags_NoCollapse)) {
+        int frame_count = profile_frame_count();
+        igText("Last %d frames", frame_count);
+        igSameLine(0.0f, -1.0f);
+        if (igSmallButton("Reset")) {
+            profile_reset();
+            has_pin = false;
+            frame_count = 0;
+        }
+        
+        if (frame_count == 0) {
+            igTextDisabled("No frames timed yet");
+        } else {
+            render_stats_table();
+            
+            igSpacing();
+            int age = render_frame_histogram(frame_count);
+            int pinned = pinned_age(frame_count);
+            if (age < 0) {
+                age = pinned >= 0 ? pinned : 0;
+            }
+            
+            const ProfileFrame* frame = profile_get_frame(age);
+            char label[32];
+            if (age == 0) {
+                snprintf(label, sizeof(label), "Newest frame");
+            } else {
+                snprintf(label, sizeof(label), "%d frames ago", age);
+            }
+            igText("%s%s: %.2f ms, %d statements", label, age == pinned ? " (pinned)" : "",
+                   (double)frame->duration_ns / 1e6, frame->statements);
+            igTextDisabled("Hover the histogram to inspect a frame, click to pin it");
+            render_flame_graph(frame);
+        }
+        
+        igSpacing();
+        if (igCollapsingHeader_TreeNodeFlags("SQL statements", 0)) {
+            render_query_stats();
+        }
+    }
+    igEnd();
+}
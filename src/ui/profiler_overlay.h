@@ -0,0 +1,16 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <stdbool.h>
+
+/**
+ * Render the frame profiler window if it should be visible: rolling
+ * min/avg/p99 per scope, SQLite statements per frame, and a flame graph
+ * of one of the kept frames.
+ * Call this every frame after all other UI.
+ * 
+ * @param show Visibility flag; cleared when the window is closed
+ */
+void profiler_overlay_render(bool* show);
+
+#endif // PROFILER_OVERLAY_H
@@ -36,121 +36,19 @@ void sidebar_init(void) {
     show_new_context_input = false;
 }
 
-// Helper function to count tasks for Today perspective
-static int count_today_tasks(Task* tasks, int task_count) {
-    time_t now = time(NULL);
-    struct tm* now_tm = localtime(&now);
-    int count = 0;
+void sidebar_render(Model* model, int* selected_project_id, int* selected_context_id) {
+    // Deleted projects and contexts stay in these arrays until the next
+    // model_sync, so they are safe to iterate for the whole frame
+    Project* projects = model->projects;
+    int project_count = model->project_count;
+    Context* contexts = model->contexts;
+    int context_count = model->context_count;
     
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) continue;
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) continue;
-        
-        bool include = false;
-        if (tasks[i].due_at > 0) {
-            struct tm* due_tm = localtime(&tasks[i].due_at);
-            if (due_tm->tm_year < now_tm->tm_year ||
-                (due_tm->tm_year == now_tm->tm_year && due_tm->tm_yday <= now_tm->tm_yday)) {
-                include = true;
-            }
-        } else {
-            include = true;
-        }
-        if (include) count++;
-    }
-    return count;
-}
-
-// Helper function to count tasks for Anytime perspective
-static int count_anytime_tasks(Task* tasks, int task_count) {
-    time_t now = time(NULL);
-    int count = 0;
-    
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) continue;
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) continue;
-        count++;
-    }
-    return count;
-}
-
-// Helper function to count flagged tasks
-static int count_flagged_tasks(Task* tasks, int task_count) {
-    time_t now = time(NULL);
-    int count = 0;
-    
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) continue;
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) continue;
-        if (tasks[i].flagged) count++;
-    }
-    return count;
-}
-
-// Helper function to count inbox tasks
-static int count_inbox_tasks(Task* tasks, int task_count) {
-    time_t now = time(NULL);
-    int count = 0;
-    
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) continue;
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) continue;
-        if (tasks[i].project_id == 0) count++;
-    }
-    return count;
-}
-
-// Helper function to count completed tasks
-static int count_completed_tasks(Task* tasks, int task_count) {
-    int count = 0;
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) count++;
-    }
-    return count;
-}
-
-// Helper function to count tasks for a specific project
-static int count_project_tasks(Task* tasks, int task_count, int project_id) {
-    time_t now = time(NULL);
-    int count = 0;
-    
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) continue;
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) continue;
-        if (tasks[i].project_id == project_id) count++;
-    }
-    return count;
-}
-
-// Helper function to count tasks for a specific context
-static int count_context_tasks(Task* tasks, int task_count, int context_id, Context* contexts, int context_count) {
-    time_t now = time(NULL);
-    int count = 0;
-    
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status == TASK_STATUS_DONE) continue;
-        if (tasks[i].defer_at > 0 && tasks[i].defer_at > now) continue;
-        
-        // Check if this task has the context
-        Context* task_contexts = NULL;
-        int tc_count = 0;
-        if (db_get_task_contexts(tasks[i].id, &task_contexts, &tc_count) == 0) {
-            for (int j = 0; j < tc_count; j++) {
-                if (task_contexts[j].id == context_id) {
-                    count++;
-                    break;
-                }
-            }
-            if (task_contexts) free(task_contexts);
-        }
+    // A project added from here is selected once its insert lands
+    int added_project_id = model_take_added_project(model);
+    if (added_project_id > 0) {
+        *selected_project_id = added_project_id;
     }
-    return count;
-}
-
-void sidebar_render(Project* projects, int project_count, Context* contexts, int context_count,
-                   Task* tasks, int task_count,
-                   int* selected_project_id, int* selected_context_id, int* needs_reload) {
-    *needs_reload = 0;
     
     // Sidebar window (fixed position, set by main.c)
     int window_flags = ImGuiWindowFlags_NoCollapse | 
@@ -169,12 +67,14 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
     igSeparator();
     igSpacing();
     
-    // Perspectives section
+    // Perspectives section. Counts cover every task, not just the ones
+    // the selected perspective loaded, and are cached lookups between
+    // changes.
     igTextColored((ImVec4){0.7f, 0.7f, 0.7f, 1.0f}, "Perspectives");
     igSpacing();
     
     // Today perspective (ID = -1)
-    int today_count = count_today_tasks(tasks, task_count);
+    int today_count = model_count_tasks(model, PERSPECTIVE_TODAY, 0);
     char today_label[64];
     snprintf(today_label, sizeof(today_label), "Today (%d)", today_count);
     bool today_selected = (*selected_project_id == -1);
@@ -183,7 +83,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
     }
     
     // Anytime perspective (ID = -3)
-    int anytime_count = count_anytime_tasks(tasks, task_count);
+    int anytime_count = model_count_tasks(model, PERSPECTIVE_ANYTIME, 0);
     char anytime_label[64];
     snprintf(anytime_label, sizeof(anytime_label), "Anytime (%d)", anytime_count);
     bool anytime_selected = (*selected_project_id == -3);
@@ -192,7 +92,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
     }
     
     // Flagged perspective (ID = -4)
-    int flagged_count = count_flagged_tasks(tasks, task_count);
+    int flagged_count = model_count_tasks(model, PERSPECTIVE_FLAGGED, 0);
     char flagged_label[64];
     snprintf(flagged_label, sizeof(flagged_label), "Flagged (%d)", flagged_count);
     bool flagged_selected = (*selected_project_id == -4);
@@ -201,7 +101,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
     }
     
     // Inbox (always visible, ID = 0)
-    int inbox_count = count_inbox_tasks(tasks, task_count);
+    int inbox_count = model_count_tasks(model, PERSPECTIVE_INBOX, 0);
     char inbox_label[64];
     snprintf(inbox_label, sizeof(inbox_label), "Inbox (%d)", inbox_count);
     bool inbox_selected = (*selected_project_id == 0);
@@ -210,7 +110,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
     }
     
     // Completed perspective (ID = -2)
-    int completed_count = count_completed_tasks(tasks, task_count);
+    int completed_count = model_count_tasks(model, PERSPECTIVE_COMPLETED, 0);
     char completed_label[64];
     snprintf(completed_label, sizeof(completed_label), "Completed (%d)", completed_count);
     bool completed_selected = (*selected_project_id == -2);
@@ -221,17 +121,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
     igSpacing();
     
     // Review perspective (ID = -6) - tasks not modified in 7+ days
-    int stale_days = 7;
-    time_t now = time(NULL);
-    time_t week_ago = now - (stale_days * 24 * 60 * 60);
-    int review_count = 0;
-    for (int i = 0; i < task_count; i++) {
-        if (tasks[i].status != TASK_STATUS_DONE && 
-            tasks[i].modified_at > 0 && 
-            tasks[i].modified_at < week_ago) {
-            review_count++;
-        }
-    }
+    int review_count = model_count_tasks(model, PERSPECTIVE_REVIEW, 0);
     
     char review_label[64];
     snprintf(review_label, sizeof(review_label), "Review (%d)", review_count);
@@ -255,14 +145,11 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
         if (igInputText("##newproject", new_project_buffer, INPUT_BUF_SIZE, 
                        ImGuiInputTextFlags_EnterReturnsTrue, NULL, NULL)) {
             if (new_project_buffer[0] != '\0') {
-                int project_id = db_insert_project(new_project_buffer, PROJECT_TYPE_SEQUENTIAL);
-                if (project_id >= 0) {
+                if (model_insert_project(model, new_project_buffer, PROJECT_TYPE_SEQUENTIAL) == 0) {
                     new_project_buffer[0] = '\0';
                     show_new_project_input = false;
-                    *needs_reload = 1;
-                    *selected_project_id = project_id;
                 } else {
-                    printf("Failed to create project: %s\n", db_get_error());
+                    printf("Failed to create project: %s\n", db_writer_get_error());
                 }
             }
         }
@@ -292,8 +179,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
             if (igInputText("##edit", edit_project_buffer, INPUT_BUF_SIZE,
                            ImGuiInputTextFlags_EnterReturnsTrue, NULL, NULL)) {
                 if (edit_project_buffer[0] != '\0') {
-                    if (db_update_project_title(project->id, edit_project_buffer) == 0) {
-                        *needs_reload = 1;
+                    if (model_set_project_title(model, project->id, edit_project_buffer) == 0) {
                         editing_project_id = -1;
                     }
                 }
@@ -305,7 +191,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
             }
         } else {
             // Display mode
-            int proj_count = count_project_tasks(tasks, task_count, project->id);
+            int proj_count = model_count_tasks(model, PERSPECTIVE_PROJECT, project->id);
             char label[300];
             snprintf(label, sizeof(label), "%s %s (%d)", 
                     project->type == PROJECT_TYPE_SEQUENTIAL ? "→" : "⋯",
@@ -330,17 +216,14 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
                 if (igMenuItem_Bool(type_label, NULL, false, true)) {
                     ProjectType new_type = project->type == PROJECT_TYPE_SEQUENTIAL ? 
                         PROJECT_TYPE_PARALLEL : PROJECT_TYPE_SEQUENTIAL;
-                    if (db_update_project_type(project->id, new_type) == 0) {
-                        *needs_reload = 1;
-                    }
+                    model_set_project_type(model, project->id, new_type);
                     igCloseCurrentPopup();
                 }
                 
                 igSeparator();
                 
                 if (igMenuItem_Bool("Delete", NULL, false, true)) {
-                    if (db_delete_project(project->id) == 0) {
-                        *needs_reload = 1;
+                    if (model_delete_project(model, project->id) == 0) {
                         if (*selected_project_id == project->id) {
                             *selected_project_id = 0;
                         }
@@ -374,14 +257,12 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
         if (igInputText("##newcontext", new_context_buffer, INPUT_BUF_SIZE, 
                        ImGuiInputTextFlags_EnterReturnsTrue, NULL, NULL)) {
             if (new_context_buffer[0] != '\0') {
-                // Use default gray color for now
-                int context_id = db_insert_context(new_context_buffer, "#888888");
-                if (context_id >= 0) {
+                // Created in the default gray for now
+                if (model_insert_context(model, new_context_buffer) == 0) {
                     new_context_buffer[0] = '\0';
                     show_new_context_input = false;
-                    *needs_reload = 1;
                 } else {
-                    printf("Failed to create context: %s\n", db_get_error());
+                    printf("Failed to create context: %s\n", db_writer_get_error());
                 }
             }
         }
@@ -410,7 +291,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
         bool is_selected = (*selected_context_id == context->id);
         
         // Display context name with @ prefix and count
-        int ctx_count = count_context_tasks(tasks, task_count, context->id, contexts, context_count);
+        int ctx_count = model_count_context_tasks(model, context->id);
         char label[80];
         snprintf(label, sizeof(label), "@%s (%d)", context->name, ctx_count);
         
@@ -421,8 +302,7 @@ void sidebar_render(Project* projects, int project_count, Context* contexts, int
         // Right-click context menu
         if (igBeginPopupContextItem(NULL, ImGuiPopupFlags_MouseButtonRight)) {
             if (igMenuItem_Bool("Delete", NULL, false, true)) {
-                if (db_delete_context(context->id) == 0) {
-                    *needs_reload = 1;
+                if (model_delete_context(model, context->id) == 0) {
                     if (*selected_context_id == context->id) {
                         *selected_context_id = 0;
                     }
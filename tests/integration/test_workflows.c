@@ -3,13 +3,20 @@
 #include "../../src/core/task.h"
 #include "../../src/core/project.h"
 #include "../../src/core/context.h"
+#include "../../src/core/model.h"
+#include "../../src/core/row_view.h"
 #include <unistd.h>
 #include <time.h>
 
 static const char* TEST_DB_PATH = "/tmp/samfocus_integration_test.db";
 
+// Strings of everything a test loads, released at teardown
+static StringArena strings;
+
 static void cleanup_test_db(void) {
     unlink(TEST_DB_PATH);
+    unlink("/tmp/samfocus_integration_test.db-wal");
+    unlink("/tmp/samfocus_integration_test.db-shm");
 }
 
 static void setup_test_db(void) {
@@ -20,6 +27,7 @@ static void setup_test_db(void) {
 
 static void teardown_test_db(void) {
     db_close();
+    string_arena_free(&strings);
     cleanup_test_db();
 }
 
@@ -69,7 +77,7 @@ TEST(test_complete_gtd_workflow) {
     // Verify the workflow
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     
     ASSERT_EQ(3, count, "Should have 3 tasks");
     
@@ -134,7 +142,7 @@ TEST(test_recurring_task_workflow) {
     // Load the task
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(1, count, "Should have 1 task");
     
     // Complete the task and create next instance
@@ -145,7 +153,7 @@ TEST(test_recurring_task_workflow) {
     free(tasks);
     
     // Load all tasks
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(2, count, "Should have 2 tasks (completed + new instance)");
     
     // Verify new instance has same properties
@@ -160,7 +168,12 @@ TEST(test_recurring_task_workflow) {
     ASSERT_NOT_NULL(new_task, "New task should exist");
     ASSERT_STR_EQ("Review email", new_task->title, "New task should have same title");
     ASSERT_EQ(RECUR_DAILY, new_task->recurrence, "New task should have same recurrence");
-    ASSERT_STR_EQ("Check inbox every morning", new_task->notes, "New task should have same notes");
+    ASSERT_EQ(1, new_task->has_notes, "New task should have notes");
+    
+    char* notes = NULL;
+    ASSERT_EQ(0, db_get_task_notes(new_id, &notes), "New task's notes should load");
+    ASSERT_STR_EQ("Check inbox every morning", notes, "New task should have same notes");
+    free(notes);
     
     free(tasks);
     teardown_test_db();
@@ -229,7 +242,7 @@ TEST(test_batch_operations_workflow) {
     // Verify results
     Task* loaded_tasks = NULL;
     int count = 0;
-    db_load_tasks(&loaded_tasks, &count, -1);
+    db_load_tasks(&loaded_tasks, &count, -1, &strings);
     
     int flagged_count = 0;
     int done_count = 0;
@@ -266,7 +279,7 @@ TEST(test_defer_and_due_date_workflow) {
     // Load and verify
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     
     ASSERT_EQ(3, count, "Should have 3 tasks");
     
@@ -302,7 +315,7 @@ TEST(test_multi_context_workflow) {
     // Get contexts for task
     Context* contexts = NULL;
     int count = 0;
-    db_get_task_contexts(task_id, &contexts, &count);
+    db_get_task_contexts(task_id, &contexts, &count, &strings);
     
     ASSERT_EQ(3, count, "Task should have 3 contexts");
     
@@ -328,7 +341,7 @@ TEST(test_project_deletion_cascades) {
     // Verify tasks still exist but have no project
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     
     ASSERT_EQ(2, count, "Tasks should still exist");
     ASSERT_EQ(0, tasks[0].project_id, "Task should have no project");
@@ -384,7 +397,7 @@ TEST(test_order_index_workflow) {
     // Load and verify order
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     
     ASSERT_EQ(3, count, "Should have 3 tasks");
     
@@ -397,6 +410,510 @@ TEST(test_order_index_workflow) {
     PASS();
 }
 
+TEST(test_model_edits_in_place) {
+    setup_test_db();
+    
+    int task1 = db_insert_task("First", TASK_STATUS_INBOX);
+    int task2 = db_insert_task("Second", TASK_STATUS_INBOX);
+    int task3 = db_insert_task("Third", TASK_STATUS_INBOX);
+    db_update_task_order_index(task1, 1);
+    db_update_task_order_index(task2, 2);
+    db_update_task_order_index(task3, 3);
+    
+    Model model;
+    model_init(&model, 0, 0);  // Inbox
+    ASSERT_EQ(0, model_sync(&model), "Initial load should succeed");
+    ASSERT_EQ(3, model.task_count, "Inbox should hold all three tasks");
+    
+    // Field edits land in memory and in the database, with no requery
+    ASSERT_EQ(0, model_set_task_title(&model, task2, "Renamed"), "Title edit should succeed");
+    ASSERT_EQ(0, model_set_task_flagged(&model, task2, 1), "Flag edit should succeed");
+    db_reset_stmt_stats();
+    ASSERT_EQ(0, model_sync(&model), "Sync should succeed");
+    DbStmtStats stats;
+    db_get_stmt_stats(&stats);
+    ASSERT_EQ(0, (int)stats.cache_hits, "Field edits should not reload tasks");
+    
+    Task* task = model_find_task(&model, task2);
+    ASSERT_NOT_NULL(task, "Edited task should still be loaded");
+    ASSERT_STR_EQ("Renamed", task->title, "Title should be updated in memory");
+    ASSERT_EQ(1, task->flagged, "Flag should be updated in memory");
+    
+    Task stored;
+    db_get_task(task2, &stored, &strings);
+    ASSERT_STR_EQ("Renamed", stored.title, "Title should be written through");
+    
+    // Reordering moves rows in memory at the next sync
+    model_set_task_order_index(&model, task3, 0);
+    model_sync(&model);
+    ASSERT_EQ(task3, model.tasks[0].id, "Reordered task should move to the top");
+    ASSERT_EQ(0, model.task_slots[task3], "Index should follow the move");
+    
+    // Moving a task to a project takes it out of the inbox
+    int project = db_insert_project("Project", PROJECT_TYPE_PARALLEL);
+    model_assign_task_to_project(&model, task1, project);
+    ASSERT_NOT_NULL(model_find_task(&model, task1), "Rows stay put until the next sync");
+    model_sync(&model);
+    ASSERT_EQ(2, model.task_count, "Assigned task should leave the inbox");
+    ASSERT_NULL(model_find_task(&model, task1), "Assigned task should not be found");
+    
+    // Tasks inserted elsewhere are fetched on their own
+    int task4 = db_insert_task("Fourth", TASK_STATUS_INBOX);
+    model_task_added(&model, task4);
+    model_sync(&model);
+    ASSERT_EQ(3, model.task_count, "Added task should join the inbox");
+    ASSERT_NOT_NULL(model_find_task(&model, task4), "Added task should be indexed");
+    
+    model_delete_task(&model, task4);
+    model_sync(&model);
+    ASSERT_EQ(2, model.task_count, "Deleted task should leave the view");
+    
+    // Quick capture goes through the writer and joins once the insert lands
+    TaskDraft draft = {0};
+    draft.title = "Captured";
+    draft.status = TASK_STATUS_INBOX;
+    ASSERT_EQ(0, model_insert_task(&model, &draft), "Insert should queue");
+    model_sync(&model);
+    ASSERT_EQ(3, model.task_count, "Inserted task should join the inbox");
+    
+    // Batch edits apply in memory like single ones
+    int batch[2] = {task2, task3};
+    ASSERT_EQ(0, model_set_tasks_flagged(&model, batch, 2, 0), "Batch flag should succeed");
+    ASSERT_EQ(0, model_find_task(&model, task3)->flagged + model_find_task(&model, task2)->flagged,
+              "Batch flag should be applied in memory");
+    ASSERT_EQ(0, model_delete_tasks(&model, batch, 2), "Batch delete should succeed");
+    model_sync(&model);
+    ASSERT_EQ(1, model.task_count, "Deleted tasks should leave the view");
+    
+    // New projects and contexts are queued too; the sidebar selects the
+    // project once its ID comes back
+    ASSERT_EQ(0, model_insert_project(&model, "Added", PROJECT_TYPE_PARALLEL), "Project insert should queue");
+    ASSERT_EQ(0, model_insert_context(&model, "added"), "Context insert should queue");
+    int added_project = model_take_added_project(&model);
+    ASSERT(added_project > 0, "Inserted project's ID should come back");
+    ASSERT_EQ(0, model_take_added_project(&model), "The ID should be taken once");
+    model_sync(&model);
+    int listed = 0;
+    for (int i = 0; i < model.project_count; i++) {
+        listed += model.projects[i].id == added_project;
+    }
+    ASSERT_EQ(1, listed, "Inserted project should be listed");
+    ASSERT_EQ(1, model.context_count, "Inserted context should be listed");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_merges_external_changes) {
+    setup_test_db();
+    
+    int renamed = db_insert_task("Renamed elsewhere", TASK_STATUS_INBOX);
+    int deleted = db_insert_task("Deleted elsewhere", TASK_STATUS_INBOX);
+    int completed = db_insert_task("Completed elsewhere", TASK_STATUS_INBOX);
+    int untouched = db_insert_task("Untouched", TASK_STATUS_INBOX);
+    
+    Model model;
+    model_init(&model, 0, 0);  // Inbox
+    model_sync(&model);
+    ASSERT_EQ(4, model.task_count, "Inbox should hold all four tasks");
+    
+    model_poll_changes(&model);
+    model_sync(&model);
+    ASSERT_EQ(0, model_poll_changes(&model), "Nothing changed since the last poll");
+    
+    // A requery would overwrite this; a merge only refreshes rows that differ
+    model_find_task(&model, untouched)->created_at = 1;
+    
+    // Another process edits the file
+    SamDb* cli = sdb_open(TEST_DB_PATH, NULL);
+    ASSERT_NOT_NULL(cli, "Second connection should open");
+    sdb_update_task_title(cli, renamed, "Renamed");
+    sdb_delete_task(cli, deleted);
+    sdb_update_task_status(cli, completed, TASK_STATUS_DONE);
+    int added = sdb_insert_task(cli, "Added elsewhere", TASK_STATUS_INBOX);
+    sdb_close(cli);
+    
+    ASSERT_EQ(1, model_poll_changes(&model), "Poll should notice the other connection");
+    ASSERT_EQ(0, model.dirty & (MODEL_DIRTY_PROJECTS | MODEL_DIRTY_CONTEXTS),
+              "Task-only commits should not reload the lists");
+    ASSERT_EQ(0, model_sync(&model), "Merge should succeed");
+    
+    ASSERT_EQ(3, model.task_count, "Deleted and completed tasks should leave the inbox");
+    ASSERT_NULL(model_find_task(&model, deleted), "Deleted task should be gone");
+    ASSERT_NULL(model_find_task(&model, completed), "Completed task should be gone");
+    ASSERT_NOT_NULL(model_find_task(&model, added), "Added task should be merged in");
+    ASSERT_STR_EQ("Renamed", model_find_task(&model, renamed)->title, "Edit should be merged");
+    ASSERT_EQ(1, (int)model_find_task(&model, untouched)->created_at,
+              "Unchanged rows should not be reloaded");
+    
+    cli = sdb_open(TEST_DB_PATH, NULL);
+    ASSERT_NOT_NULL(cli, "Second connection should open");
+    sdb_insert_project(cli, "Elsewhere", PROJECT_TYPE_PARALLEL);
+    sdb_close(cli);
+    
+    ASSERT_EQ(1, model_poll_changes(&model), "Poll should notice the new project");
+    ASSERT_EQ(MODEL_DIRTY_PROJECTS, model.dirty & (MODEL_DIRTY_PROJECTS | MODEL_DIRTY_CONTEXTS),
+              "Only the project list should reload");
+    model_sync(&model);
+    ASSERT_EQ(1, model.project_count, "New project should be loaded");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_merges_derived_availability) {
+    setup_test_db();
+    
+    int project = db_insert_project("Sequence", PROJECT_TYPE_SEQUENTIAL);
+    int head = db_insert_task("Head", TASK_STATUS_INBOX);
+    int next = db_insert_task("Next", TASK_STATUS_INBOX);
+    int loose = db_insert_task("Loose", TASK_STATUS_INBOX);
+    db_assign_task_to_project(head, project);
+    db_assign_task_to_project(next, project);
+    
+    Model model;
+    model_init(&model, -3, 0);  // Anytime
+    model_sync(&model);
+    ASSERT_EQ(2, model.task_count, "Anytime should hold the head and the loose task");
+    ASSERT_NULL(model_find_task(&model, next), "Next task waits behind the head");
+    
+    // A requery would overwrite this
+    model_find_task(&model, loose)->created_at = 1;
+    
+    // Completing the head re-derives the next task's availability in the
+    // database; the changed rows are merged instead of requerying
+    model_set_task_status(&model, head, TASK_STATUS_DONE);
+    ASSERT_EQ(0, model_sync(&model), "Sync should succeed");
+    
+    ASSERT_NULL(model_find_task(&model, head), "Completed head should leave Anytime");
+    ASSERT_NOT_NULL(model_find_task(&model, next), "Next task should become available");
+    ASSERT_EQ(2, model.task_count, "Anytime should hold the next and the loose task");
+    ASSERT_EQ(1, (int)model_find_task(&model, loose)->created_at, "Unchanged rows should not be reloaded");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_loads_notes_on_demand) {
+    setup_test_db();
+    
+    int task_id = db_insert_task("Write report", TASK_STATUS_INBOX);
+    
+    Model model;
+    model_init(&model, 0, 0);  // Inbox
+    model_sync(&model);
+    ASSERT_EQ(0, model_find_task(&model, task_id)->has_notes, "New task should have no notes");
+    
+    ASSERT_EQ(0, model_set_task_notes(&model, task_id, "Outline first"), "Notes edit should queue");
+    ASSERT_EQ(1, model_find_task(&model, task_id)->has_notes, "Loaded row should show the notes");
+    
+    char* notes = NULL;
+    ASSERT_EQ(0, model_get_task_notes(&model, task_id, &notes), "Notes should load");
+    ASSERT_STR_EQ("Outline first", notes, "Notes should read back the edit");
+    free(notes);
+    
+    model_set_task_notes(&model, task_id, "");
+    ASSERT_EQ(0, model_find_task(&model, task_id)->has_notes, "Cleared notes should unmark the row");
+    
+    // Queued on the writer thread: read back without waiting for it
+    ASSERT_EQ(0, db_writer_start(TEST_DB_PATH, NULL, NULL), "Writer should start");
+    model_set_task_notes(&model, task_id, "Queued");
+    ASSERT_EQ(0, model_get_task_notes(&model, task_id, &notes), "Queued notes should load");
+    ASSERT_STR_EQ("Queued", notes, "Queued notes should read back before they land");
+    free(notes);
+    
+    db_writer_flush();
+    ASSERT_EQ(0, model_get_task_notes(&model, task_id, &notes), "Notes should load");
+    ASSERT_STR_EQ("Queued", notes, "Notes should be written");
+    ASSERT_EQ(0, model.queued_notes_count, "Landed notes should be forgotten");
+    free(notes);
+    db_writer_stop();
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_keeps_long_titles) {
+    setup_test_db();
+    
+    int task_id = db_insert_task("Short", TASK_STATUS_INBOX);
+    int project_id = db_insert_project("Project", PROJECT_TYPE_PARALLEL);
+    
+    Model model;
+    model_init(&model, 0, 0);  // Inbox
+    model_sync(&model);
+    
+    char long_title[400];
+    memset(long_title, 'x', sizeof(long_title) - 1);
+    long_title[sizeof(long_title) - 1] = '\0';
+    
+    model_set_task_title(&model, task_id, long_title);
+    model_set_project_title(&model, project_id, long_title);
+    ASSERT_STR_EQ(long_title, model_find_task(&model, task_id)->title, "Edit should keep the whole title");
+    ASSERT_STR_EQ(long_title, model.projects[0].title, "Project edit should keep the whole title");
+    
+    // A requery replaces the arena with one holding the stored titles
+    model_mark_dirty(&model, MODEL_DIRTY_TASKS | MODEL_DIRTY_PROJECTS);
+    ASSERT_EQ(0, model_sync(&model), "Reload should succeed");
+    ASSERT_STR_EQ(long_title, model_find_task(&model, task_id)->title, "Stored title should be whole");
+    ASSERT_STR_EQ(long_title, model.projects[0].title, "Stored project title should be whole");
+    ASSERT_EQ((int)sizeof(long_title), (int)model.task_strings.bytes,
+              "Task arena should only hold the loaded title");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_counts_cover_all_tasks) {
+    setup_test_db();
+    
+    int project_id = db_insert_project("Project", PROJECT_TYPE_SEQUENTIAL);
+    int context_id = db_insert_context("@home", "#FF0000");
+    int inbox_task = db_insert_task("Inbox task", TASK_STATUS_INBOX);
+    int first = db_insert_task("First step", TASK_STATUS_INBOX);
+    int second = db_insert_task("Second step", TASK_STATUS_INBOX);
+    int done = db_insert_task("Done", TASK_STATUS_DONE);
+    db_assign_task_to_project(first, project_id);
+    db_assign_task_to_project(second, project_id);
+    db_update_task_flagged(inbox_task, 1);
+    db_add_context_to_task(second, context_id);
+    
+    // Showing the project, which only loads its head
+    Model model;
+    model_init(&model, project_id, 0);
+    ASSERT_EQ(0, model_sync(&model), "Initial load should succeed");
+    ASSERT_EQ(1, model.task_count, "A sequential project shows its head");
+    
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_INBOX, 0), "Inbox count covers unloaded tasks");
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_FLAGGED, 0), "Flagged count covers unloaded tasks");
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_COMPLETED, 0), "Completed count covers unloaded tasks");
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_ANYTIME, 0), "Inbox task and head are available");
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "Project count covers every step");
+    ASSERT_EQ(1, model_count_context_tasks(&model, context_id), "Context count covers unloaded tasks");
+    
+    // Edits count right away; changes elsewhere after the next sync
+    model_set_task_flagged(&model, first, 1);
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_FLAGGED, 0), "Flag edit should count at once");
+    model_set_task_status(&model, first, TASK_STATUS_DONE);
+    model_sync(&model);
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_COMPLETED, 0), "Completion should count after sync");
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "One step should remain");
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_ANYTIME, 0), "The next step becomes available");
+    
+    db_delete_task(inbox_task);
+    model_mark_dirty(&model, MODEL_DIRTY_TABLE);
+    model_sync(&model);
+    ASSERT_EQ(0, model_count_tasks(&model, PERSPECTIVE_INBOX, 0), "Deleted task should not count");
+    ASSERT_EQ(3, model.table.count, "Table should track every remaining task");
+    ASSERT(task_table_find(&model.table, done) >= 0, "Tasks outside the view stay in the table");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_counts_follow_links) {
+    setup_test_db();
+    
+    int home = db_insert_context("@home", "#FF0000");
+    int work = db_insert_context("@work", "#00FF00");
+    int project_id = db_insert_project("Project", PROJECT_TYPE_PARALLEL);
+    int task1 = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    int task2 = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    db_assign_task_to_project(task1, project_id);
+    db_assign_task_to_project(task2, project_id);
+    db_add_context_to_task(task1, home);
+    
+    Model model;
+    model_init(&model, -3, 0);  // Anytime
+    model_sync(&model);
+    ASSERT_EQ(1, model_count_context_tasks(&model, home), "One task is @home");
+    ASSERT_EQ(0, model_count_context_tasks(&model, work), "No task is @work");
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "Project holds both tasks");
+    
+    // Link edits count once the links are reloaded
+    model_add_context_to_task(&model, task2, home);
+    model_add_context_to_task(&model, task2, work);
+    model_mark_dirty(&model, MODEL_DIRTY_CONTEXT_LINKS);
+    model_sync(&model);
+    ASSERT_EQ(2, model_count_context_tasks(&model, home), "Both tasks are @home");
+    ASSERT_EQ(1, model_count_context_tasks(&model, work), "One task is @work");
+    
+    // Completing a task takes it out of every open count
+    model_set_task_status(&model, task1, TASK_STATUS_DONE);
+    model_sync(&model);
+    ASSERT_EQ(1, model_count_context_tasks(&model, home), "Done tasks should not count");
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "One open task remains");
+    
+    // Deleting the project moves its tasks to the inbox
+    model_delete_project(&model, project_id);
+    model_mark_dirty(&model, MODEL_DIRTY_CHANGES);
+    model_sync(&model);
+    ASSERT_EQ(0, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "Deleted project holds nothing");
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_INBOX, 0), "Open task should move to the inbox");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_counts_cached_until_change) {
+    setup_test_db();
+    
+    int home = db_insert_context("@home", "#FF0000");
+    int project_id = db_insert_project("Project", PROJECT_TYPE_PARALLEL);
+    int task1 = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    int task2 = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    db_assign_task_to_project(task1, project_id);
+    db_assign_task_to_project(task2, project_id);
+    
+    Model model;
+    model_init(&model, -3, 0);  // Anytime
+    model_sync(&model);
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "Project holds both tasks");
+    ASSERT_EQ(1, model.counts.valid, "Counts should be cached");
+    unsigned version = model.counts.table_version;
+    
+    // Nothing changed, so the next sync keeps the cache
+    model_sync(&model);
+    ASSERT_EQ(0, model_count_tasks(&model, PERSPECTIVE_FLAGGED, 0), "Nothing is flagged");
+    ASSERT_EQ(version, model.counts.table_version, "Counts should not be redone");
+    ASSERT_EQ(0, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id + 100), "Unknown project holds nothing");
+    ASSERT_EQ(0, model_count_tasks(&model, PERSPECTIVE_PROJECT, -1), "Negative project holds nothing");
+    ASSERT_EQ(0, model_count_context_tasks(&model, home + 100), "Unknown context holds nothing");
+    
+    // An edit changes the table, so the next count is redone
+    model_set_task_flagged(&model, task1, 1);
+    ASSERT_EQ(1, model_count_tasks(&model, PERSPECTIVE_FLAGGED, 0), "Flag should count at once");
+    ASSERT(model.counts.table_version != version, "Counts should be redone after an edit");
+    
+    // Reloading the links drops the cache
+    model_add_context_to_task(&model, task2, home);
+    model_mark_dirty(&model, MODEL_DIRTY_CONTEXT_LINKS);
+    model_sync(&model);
+    ASSERT_EQ(0, model.counts.valid, "Reloaded links should drop the counts");
+    ASSERT_EQ(1, model_count_context_tasks(&model, home), "Linked task should count");
+    ASSERT_EQ(2, model_count_tasks(&model, PERSPECTIVE_PROJECT, project_id), "Project count is unchanged");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+// Find a loaded task's index in the model, -1 if it isn't loaded
+static int task_index(const Model* model, int id) {
+    const Task* task = model_find_task(model, id);
+    return task != NULL ? (int)(task - model->tasks) : -1;
+}
+
+TEST(test_row_views_format_once) {
+    setup_test_db();
+    
+    time_t now = time(NULL);
+    int home = db_insert_context("home", "#FF0000");
+    int project_id = db_insert_project("Errands", PROJECT_TYPE_PARALLEL);
+    int milk = db_insert_task("Buy milk", TASK_STATUS_INBOX);
+    int call = db_insert_task("Call Bob", TASK_STATUS_INBOX);
+    int rent = db_insert_task("Pay rent", TASK_STATUS_INBOX);
+    int old = db_insert_task("Old", TASK_STATUS_INBOX);
+    db_assign_task_to_project(milk, project_id);
+    db_add_context_to_task(milk, home);
+    db_update_task_due_at(milk, now);
+    db_update_task_due_at(call, now - 3 * 24 * 60 * 60);
+    db_update_task_defer_at(rent, now - 3 * 24 * 60 * 60);
+    db_update_task_recurrence(rent, RECUR_WEEKLY, 2);
+    db_update_task_status(old, TASK_STATUS_DONE);
+    db_add_dependency(rent, old);
+    
+    Model model;
+    model_init(&model, -3, 0);  // Anytime
+    model_sync(&model);
+    
+    RowViewCache cache;
+    row_view_cache_init(&cache);
+    ASSERT_EQ(3, row_view_cache_update(&cache, &model, "", now), "Every open task should match");
+    ASSERT_EQ(1, row_view_cache_update(&cache, &model, "cALL", now), "Search ignores case");
+    ASSERT_EQ(task_index(&model, call), cache.matches[0], "Match should point at the task");
+    
+    const RowView* view = row_view_get(&cache, &model, task_index(&model, milk), now);
+    ASSERT_STR_EQ("Errands", view->project_title, "Project title should be looked up");
+    ASSERT_STR_EQ("Errands##project", view->project_label, "Combo label carries its ID");
+    ASSERT_STR_EQ("@home", view->context_label, "Contexts should be listed");
+    ASSERT_EQ(DUE_STATE_TODAY, view->due_state, "Due now is due today");
+    ASSERT(strncmp(view->due_label, "Due:", 4) == 0, "Due label should be formatted");
+    ASSERT_EQ(0, view->dependency_count, "No dependencies");
+    
+    view = row_view_get(&cache, &model, task_index(&model, call), now);
+    ASSERT_STR_EQ("None", view->project_title, "Inbox tasks show None");
+    ASSERT_EQ(DUE_STATE_OVERDUE, view->due_state, "Past due date is overdue");
+    ASSERT_STR_EQ("", view->defer_label, "No defer date, no label");
+    
+    view = row_view_get(&cache, &model, task_index(&model, rent), now);
+    ASSERT_STR_EQ("🔄Every 2 Weekly##recur", view->recur_label, "Recurrence label");
+    ASSERT(strncmp(view->defer_label, "Defer:", 6) == 0, "Defer label should be formatted");
+    ASSERT_EQ(1, view->dependency_count, "Dependency should be counted");
+    
+    // Nothing changed: the views are kept
+    unsigned stamp = cache.stamp;
+    model_sync(&model);
+    row_view_cache_update(&cache, &model, "", now);
+    ASSERT_EQ(stamp, cache.stamp, "Views should be kept without changes");
+    
+    // An edit restamps, and the edited row is formatted again
+    model_set_task_due_at(&model, call, 0);
+    row_view_cache_update(&cache, &model, "", now);
+    ASSERT(cache.stamp != stamp, "An edit should restamp the views");
+    view = row_view_get(&cache, &model, task_index(&model, call), now);
+    ASSERT_EQ(DUE_STATE_NONE, view->due_state, "Cleared due date shows no state");
+    
+    // Renaming a project restamps the rows that show its name
+    stamp = cache.stamp;
+    model_set_project_title(&model, project_id, "Chores");
+    row_view_cache_update(&cache, &model, "", now);
+    ASSERT(cache.stamp != stamp, "A project rename should restamp the views");
+    view = row_view_get(&cache, &model, task_index(&model, milk), now);
+    ASSERT_STR_EQ("Chores", view->project_title, "Renamed project title should show");
+    ASSERT_STR_EQ("Chores##project", view->project_label, "Combo label should follow the rename");
+    
+    row_view_cache_free(&cache);
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_model_next_wakeup_follows_defer_dates) {
+    setup_test_db();
+    
+    time_t now = time(NULL);
+    int later = db_insert_task("Later", TASK_STATUS_INBOX);
+    db_update_task_defer_at(later, now + 60 * 60);
+    
+    Model model;
+    model_init(&model, -3, 0);  // Anytime
+    ASSERT_EQ(0, (long long)model_next_wakeup(&model), "Nothing scheduled before the first sync");
+    model_sync(&model);
+    
+    time_t wakeup = model_next_wakeup(&model);
+    ASSERT(wakeup > now, "Wakeup should be in the future");
+    ASSERT(wakeup <= now + 60 * 60, "Wakeup should come by the defer date");
+    
+    // A closer defer date brings the wakeup forward
+    db_update_task_defer_at(later, now + 60);
+    model_poll_changes(&model);
+    model_mark_dirty(&model, MODEL_DIRTY_CHANGES);
+    model_sync(&model);
+    ASSERT(model_next_wakeup(&model) <= now + 60, "Wakeup should follow the new defer date");
+    
+    model_free(&model);
+    teardown_test_db();
+    PASS();
+}
+
 // ============================================================================
 // Main test runner
 // ============================================================================
@@ -414,6 +931,16 @@ int main(void) {
     RUN_TEST(test_project_deletion_cascades);
     RUN_TEST(test_task_deletion_removes_dependencies);
     RUN_TEST(test_order_index_workflow);
+    RUN_TEST(test_model_edits_in_place);
+    RUN_TEST(test_model_merges_external_changes);
+    RUN_TEST(test_model_merges_derived_availability);
+    RUN_TEST(test_model_loads_notes_on_demand);
+    RUN_TEST(test_model_keeps_long_titles);
+    RUN_TEST(test_model_counts_cover_all_tasks);
+    RUN_TEST(test_model_counts_follow_links);
+    RUN_TEST(test_model_counts_cached_until_change);
+    RUN_TEST(test_row_views_format_once);
+    RUN_TEST(test_model_next_wakeup_follows_defer_dates);
     
     PRINT_TEST_SUMMARY();
     return TEST_EXIT_CODE();
@@ -1,16 +1,27 @@
 #include "../test_framework.h"
 #include "../../src/db/database.h"
+#include "../../src/db/writer.h"
 #include "../../src/core/task.h"
 #include "../../src/core/project.h"
 #include "../../src/core/context.h"
+#include "../../src/core/platform.h"
+#include "../../src/core/profiler.h"
+#include "../../src/core/trace.h"
+#include <sqlite3.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <time.h>
 
 static const char* TEST_DB_PATH = "/tmp/samfocus_test.db";
 
+// Strings of everything a test loads, released at teardown
+static StringArena strings;
+
 // Helper function to clean up test database
 static void cleanup_test_db(void) {
     unlink(TEST_DB_PATH);
+    unlink("/tmp/samfocus_test.db-wal");
+    unlink("/tmp/samfocus_test.db-shm");
 }
 
 // Helper function to setup test database
@@ -23,6 +34,7 @@ static void setup_test_db(void) {
 // Helper function to teardown test database
 static void teardown_test_db(void) {
     db_close();
+    string_arena_free(&strings);
     cleanup_test_db();
 }
 
@@ -53,6 +65,256 @@ TEST(test_db_create_schema_succeeds) {
     PASS();
 }
 
+TEST(test_schema_migrations_run_once) {
+    cleanup_test_db();
+    db_init(TEST_DB_PATH);
+    
+    ASSERT_EQ(0, db_get_schema_version(), "New file should be unversioned");
+    ASSERT_EQ(0, db_create_schema(), "Migrations should succeed");
+    ASSERT_EQ(DB_SCHEMA_VERSION, db_get_schema_version(), "Schema should be current");
+    
+    int task_id = db_insert_task("Task", TASK_STATUS_INBOX);
+    db_close();
+    
+    db_init(TEST_DB_PATH);
+    ASSERT_EQ(0, db_create_schema(), "Current schema should open cleanly");
+    ASSERT_EQ(DB_SCHEMA_VERSION, db_get_schema_version(), "Version should be unchanged");
+    
+    Task task;
+    ASSERT_EQ(0, db_get_task(task_id, &task, &strings), "Existing rows should survive");
+    ASSERT_EQ(1, task.available, "Availability triggers should be in place");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_db_init_defaults_to_wal) {
+    cleanup_test_db();
+    
+    ASSERT_EQ(0, db_init(TEST_DB_PATH), "Database initialization should succeed");
+    db_create_schema();
+    db_insert_task("Task", TASK_STATUS_INBOX);
+    
+    ASSERT(access("/tmp/samfocus_test.db-wal", F_OK) == 0,
+           "Default config should use a write-ahead log");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_db_init_ex_applies_config) {
+    cleanup_test_db();
+    
+    DbConfig config;
+    db_config_default(&config);
+    config.journal_mode = DB_JOURNAL_DELETE;
+    config.synchronous = DB_SYNC_FULL;
+    config.single_threaded = 1;
+    
+    ASSERT_EQ(0, db_init_ex(TEST_DB_PATH, &config), "Database initialization should succeed");
+    ASSERT_EQ(-1, db_init_ex(TEST_DB_PATH, &config), "Second initialization should fail");
+    db_create_schema();
+    ASSERT(db_insert_task("Task", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    
+    ASSERT(access("/tmp/samfocus_test.db-wal", F_OK) != 0,
+           "Rollback journal mode should not create a write-ahead log");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_statement_cache_reuses_statements) {
+    setup_test_db();
+    db_reset_stmt_stats();
+    
+    for (int i = 0; i < 5; i++) {
+        ASSERT(db_insert_task("Cached", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    }
+    
+    DbStmtStats stats;
+    db_get_stmt_stats(&stats);
+    // Statements are prepared on first use
+    ASSERT_EQ(1, (int)stats.prepares, "Repeated inserts should not re-prepare");
+    ASSERT_EQ(4, (int)stats.cache_hits, "Later inserts should hit the statement cache");
+    
+    Task* tasks = NULL;
+    int count = 0;
+    ASSERT_EQ(0, db_load_tasks(&tasks, &count, -1, &strings), "Load after cached inserts should succeed");
+    ASSERT_EQ(5, count, "All cached inserts should be stored");
+    free(tasks);
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_stmt_stats_count_statements_run) {
+    setup_test_db();
+    db_reset_stmt_stats();
+    
+    for (int i = 0; i < 3; i++) {
+        ASSERT(db_insert_task("Counted", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    }
+    
+    DbStmtStats stats;
+    db_get_stmt_stats(&stats);
+    ASSERT(stats.statements >= 3, "SQLite should report every insert it ran");
+    
+    db_reset_stmt_stats();
+    db_get_stmt_stats(&stats);
+    ASSERT_EQ(0, (int)stats.statements, "Reset should clear the statement count");
+    ASSERT(stats.statement_ns == 0, "Reset should clear the statement time");
+    
+    teardown_test_db();
+    PASS();
+}
+
+// Entry for the statement whose text contains needle, or NULL
+static const DbQueryStats* find_query(const DbQueryStats* stats, int count, const char* needle) {
+    for (int i = 0; i < count; i++) {
+        if (strstr(stats[i].sql, needle) != NULL) {
+            return &stats[i];
+        }
+    }
+    return NULL;
+}
+
+TEST(test_query_stats_group_by_statement) {
+    setup_test_db();
+    db_set_query_profiling(1);
+    ASSERT(db_query_profiling_enabled(), "Profiling should be on");
+    
+    for (int i = 0; i < 3; i++) {
+        ASSERT(db_insert_task("Profiled", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    }
+    for (int i = 0; i < 2; i++) {
+        Task* tasks = NULL;
+        int count = 0;
+        ASSERT_EQ(0, db_load_tasks(&tasks, &count, -1, &strings), "Load should succeed");
+        free(tasks);
+        string_arena_reset(&strings);
+    }
+    
+    DbQueryStats stats[64];
+    int count = db_get_query_stats(stats, 64);
+    ASSERT(count >= 2, "Both statements should have totals");
+    for (int i = 1; i < count; i++) {
+        ASSERT(stats[i - 1].total_ns >= stats[i].total_ns, "Busiest statement should come first");
+    }
+    
+    const DbQueryStats* insert = find_query(stats, count, "INSERT INTO tasks (title");
+    ASSERT_NOT_NULL(insert, "Insert should be profiled");
+    ASSERT(insert->calls == 3, "Every insert run should be counted once");
+    ASSERT(insert->rows == 0, "An insert returns no rows");
+    
+    const DbQueryStats* load = find_query(stats, count, "ORDER BY order_index ASC, created_at DESC;");
+    ASSERT_NOT_NULL(load, "Load should be profiled");
+    ASSERT(load->calls == 2, "Both loads should be counted");
+    ASSERT(load->rows == 6, "Each load should step three rows");
+    ASSERT(load->max_ns > 0 && load->max_ns <= load->total_ns, "Slowest run should be within the total");
+    
+    // Off keeps what was gathered but adds nothing
+    db_set_query_profiling(0);
+    ASSERT(db_insert_task("Not profiled", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    count = db_get_query_stats(stats, 64);
+    insert = find_query(stats, count, "INSERT INTO tasks (title");
+    ASSERT(insert != NULL && insert->calls == 3, "Runs while off should not be counted");
+    
+    db_reset_query_stats();
+    ASSERT_EQ(0, db_get_query_stats(stats, 64), "Reset should forget every statement");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_slow_query_log_threshold) {
+    setup_test_db();
+    db_reset_stmt_stats();
+    
+    db_set_slow_query_ms(60000);
+    ASSERT(db_insert_task("Fast enough", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    DbStmtStats stats;
+    db_get_stmt_stats(&stats);
+    ASSERT(stats.slow_statements == 0, "Nothing should pass a one minute threshold");
+    
+    db_set_slow_query_ms(0.000001);
+    ASSERT(db_insert_task("Logged", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    db_get_stmt_stats(&stats);
+    ASSERT(stats.slow_statements >= 1, "A tiny threshold should log the insert");
+    
+    db_set_slow_query_ms(0);
+    unsigned long long logged = stats.slow_statements;
+    ASSERT(db_insert_task("Log off", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    db_get_stmt_stats(&stats);
+    ASSERT(stats.slow_statements == logged, "0 should turn the log off");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_explain_query_names_index) {
+    setup_test_db();
+    db_set_query_profiling(1);
+    
+    char plan[1024];
+    ASSERT_EQ(0, db_explain_query("SELECT id FROM tasks WHERE change_seq > ?1;", plan, sizeof(plan)),
+              "Explain should succeed with unbound parameters");
+    ASSERT(strstr(plan, "idx_tasks_change_seq") != NULL, "Plan should use the change_seq index");
+    
+    ASSERT_EQ(0, db_explain_query("SELECT id FROM tasks WHERE id IN (SELECT task_id FROM task_contexts);",
+                                  plan, sizeof(plan)), "Explain with a subquery should succeed");
+    ASSERT(strchr(plan, '\n') != strrchr(plan, '\n'), "Plan should have a line per step");
+    
+    ASSERT_EQ(-1, db_explain_query("SELECT nope FROM nowhere;", plan, sizeof(plan)),
+              "Explain should fail for a bad statement");
+    
+    DbQueryStats stats[64];
+    int count = db_get_query_stats(stats, 64);
+    ASSERT(find_query(stats, count, "EXPLAIN") == NULL, "Explaining should not be profiled");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_handles_are_independent) {
+    const char* other_path = "/tmp/samfocus_test_other.db";
+    cleanup_test_db();
+    unlink(other_path);
+    
+    SamDb* a = sdb_open(TEST_DB_PATH, NULL);
+    SamDb* b = sdb_open(other_path, NULL);
+    ASSERT_NOT_NULL(a, "First handle should open");
+    ASSERT_NOT_NULL(b, "Second handle should open");
+    ASSERT_EQ(0, sdb_create_schema(a), "Schema on first handle should succeed");
+    ASSERT_EQ(0, sdb_create_schema(b), "Schema on second handle should succeed");
+    
+    ASSERT(sdb_insert_task(a, "Only in A", TASK_STATUS_INBOX) > 0, "Insert through A should succeed");
+    
+    Task* tasks = NULL;
+    int count = -1;
+    ASSERT_EQ(0, sdb_load_tasks(b, &tasks, &count, -1, &strings), "Load through B should succeed");
+    ASSERT_EQ(0, count, "B should not see A's task");
+    free(tasks);
+    
+    ASSERT_EQ(-1, sdb_insert_task(b, "", TASK_STATUS_INBOX), "Empty title should fail on B");
+    ASSERT_STR_EQ("Task title cannot be empty", sdb_get_error(b), "B should record its error");
+    ASSERT_STR_EQ("", sdb_get_error(a), "A's error should be untouched");
+    
+    // The db_* functions have no handle until db_init
+    ASSERT_EQ(-1, db_insert_task("No handle", TASK_STATUS_INBOX), "Insert without db_init should fail");
+    ASSERT_STR_EQ("Database not initialized", db_get_error(), "Error should say why");
+    
+    ASSERT_NULL(sdb_open("/nonexistent-dir/samfocus.db", NULL), "Open in a missing directory should fail");
+    ASSERT(sdb_get_error(NULL)[0] != '\0', "Failed open should leave an error");
+    
+    sdb_close(a);
+    sdb_close(b);
+    cleanup_test_db();
+    unlink(other_path);
+    unlink("/tmp/samfocus_test_other.db-wal");
+    unlink("/tmp/samfocus_test_other.db-shm");
+    PASS();
+}
+
 // ============================================================================
 // Task CRUD tests
 // ============================================================================
@@ -85,7 +347,7 @@ TEST(test_load_tasks_returns_inserted_task) {
     
     Task* tasks = NULL;
     int count = 0;
-    int result = db_load_tasks(&tasks, &count, -1);
+    int result = db_load_tasks(&tasks, &count, -1, &strings);
     
     ASSERT_EQ(0, result, "Loading tasks should succeed");
     ASSERT_EQ(1, count, "Should have 1 task");
@@ -107,7 +369,7 @@ TEST(test_update_task_status) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(TASK_STATUS_DONE, tasks[0].status, "Status should be updated");
     
     free(tasks);
@@ -124,7 +386,7 @@ TEST(test_update_task_title) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_STR_EQ("New Title", tasks[0].title, "Title should be updated");
     
     free(tasks);
@@ -141,14 +403,55 @@ TEST(test_update_task_notes) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
-    ASSERT_STR_EQ("These are my notes", tasks[0].notes, "Notes should be updated");
+    db_load_tasks(&tasks, &count, -1, &strings);
+    ASSERT_EQ(1, tasks[0].has_notes, "Task should be marked as having notes");
     
+    char* notes = NULL;
+    ASSERT_EQ(0, db_get_task_notes(task_id, &notes), "Notes should load");
+    ASSERT_STR_EQ("These are my notes", notes, "Notes should be updated");
+    
+    free(notes);
     free(tasks);
     teardown_test_db();
     PASS();
 }
 
+TEST(test_task_notes_load_on_demand) {
+    setup_test_db();
+    
+    int with_notes = db_insert_task("Long notes", TASK_STATUS_INBOX);
+    int without_notes = db_insert_task("No notes", TASK_STATUS_INBOX);
+    
+    // Longer than the old fixed-size buffer
+    char long_notes[3000];
+    memset(long_notes, 'n', sizeof(long_notes) - 1);
+    long_notes[sizeof(long_notes) - 1] = '\0';
+    ASSERT_EQ(0, db_update_task_notes(with_notes, long_notes), "Update should succeed");
+    
+    Task task;
+    ASSERT_EQ(0, db_get_task(with_notes, &task, &strings), "Task should load");
+    ASSERT_EQ(1, task.has_notes, "Task with notes should be marked");
+    ASSERT_EQ(0, db_get_task(without_notes, &task, &strings), "Task should load");
+    ASSERT_EQ(0, task.has_notes, "Task without notes should not be marked");
+    
+    char* notes = NULL;
+    ASSERT_EQ(0, db_get_task_notes(with_notes, &notes), "Notes should load");
+    ASSERT_EQ((int)strlen(long_notes), (int)strlen(notes), "Notes should not be truncated");
+    free(notes);
+    
+    notes = NULL;
+    ASSERT_EQ(0, db_get_task_notes(without_notes, &notes), "Empty notes should load");
+    ASSERT_STR_EQ("", notes, "Task without notes should read back empty");
+    free(notes);
+    
+    notes = NULL;
+    ASSERT_EQ(-1, db_get_task_notes(9999, &notes), "Missing task should fail");
+    ASSERT_NULL(notes, "No notes should be returned for a missing task");
+    
+    teardown_test_db();
+    PASS();
+}
+
 TEST(test_update_task_flagged) {
     setup_test_db();
     
@@ -158,7 +461,7 @@ TEST(test_update_task_flagged) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(1, tasks[0].flagged, "Task should be flagged");
     
     free(tasks);
@@ -176,7 +479,7 @@ TEST(test_update_task_defer_date) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(defer_time, tasks[0].defer_at, "Defer date should be updated");
     
     free(tasks);
@@ -194,7 +497,7 @@ TEST(test_update_task_due_date) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(due_time, tasks[0].due_at, "Due date should be updated");
     
     free(tasks);
@@ -211,7 +514,7 @@ TEST(test_delete_task) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(0, count, "Should have 0 tasks after deletion");
     
     teardown_test_db();
@@ -227,7 +530,7 @@ TEST(test_load_tasks_with_status_filter) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, TASK_STATUS_INBOX);
+    db_load_tasks(&tasks, &count, TASK_STATUS_INBOX, &strings);
     
     ASSERT_EQ(1, count, "Should have 1 inbox task");
     ASSERT_STR_EQ("Inbox Task", tasks[0].title, "Should be the inbox task");
@@ -249,7 +552,7 @@ TEST(test_insert_project) {
     
     Project* projects = NULL;
     int count = 0;
-    db_load_projects(&projects, &count);
+    db_load_projects(&projects, &count, &strings);
     
     ASSERT_EQ(1, count, "Should have 1 project");
     ASSERT_STR_EQ("My Project", projects[0].title, "Project title should match");
@@ -271,7 +574,7 @@ TEST(test_assign_task_to_project) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(project_id, tasks[0].project_id, "Task should be assigned to project");
     
     free(tasks);
@@ -288,7 +591,7 @@ TEST(test_update_project_title) {
     
     Project* projects = NULL;
     int count = 0;
-    db_load_projects(&projects, &count);
+    db_load_projects(&projects, &count, &strings);
     ASSERT_STR_EQ("New Name", projects[0].title, "Title should be updated");
     
     free(projects);
@@ -305,7 +608,7 @@ TEST(test_delete_project) {
     
     Project* projects = NULL;
     int count = 0;
-    db_load_projects(&projects, &count);
+    db_load_projects(&projects, &count, &strings);
     ASSERT_EQ(0, count, "Should have 0 projects");
     
     teardown_test_db();
@@ -324,7 +627,7 @@ TEST(test_insert_context) {
     
     Context* contexts = NULL;
     int count = 0;
-    db_load_contexts(&contexts, &count);
+    db_load_contexts(&contexts, &count, &strings);
     
     ASSERT_EQ(1, count, "Should have 1 context");
     ASSERT_STR_EQ("@home", contexts[0].name, "Context name should match");
@@ -345,7 +648,7 @@ TEST(test_add_context_to_task) {
     
     Context* contexts = NULL;
     int count = 0;
-    db_get_task_contexts(task_id, &contexts, &count);
+    db_get_task_contexts(task_id, &contexts, &count, &strings);
     ASSERT_EQ(1, count, "Task should have 1 context");
     ASSERT_STR_EQ("@work", contexts[0].name, "Context should match");
     
@@ -366,13 +669,51 @@ TEST(test_remove_context_from_task) {
     
     Context* contexts = NULL;
     int count = 0;
-    db_get_task_contexts(task_id, &contexts, &count);
+    db_get_task_contexts(task_id, &contexts, &count, &strings);
     ASSERT_EQ(0, count, "Task should have 0 contexts");
     
     teardown_test_db();
     PASS();
 }
 
+TEST(test_load_task_context_map) {
+    setup_test_db();
+    
+    int task1 = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    int task2 = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    int task3 = db_insert_task("Task 3", TASK_STATUS_INBOX);
+    int work = db_insert_context("work", "#FF0000");
+    int home = db_insert_context("home", "#00FF00");
+    db_add_context_to_task(task1, work);
+    db_add_context_to_task(task1, home);
+    db_add_context_to_task(task3, work);
+    
+    TaskContextMap map;
+    int result = db_load_task_context_map(&map);
+    ASSERT_EQ(0, result, "Loading context map should succeed");
+    ASSERT_EQ(3, map.link_count, "Map should hold 3 links");
+    
+    int count = 0;
+    const int* ids = task_context_map_get(&map, task1, &count);
+    ASSERT_EQ(2, count, "Task 1 should have 2 contexts");
+    ASSERT_EQ(home, ids[0], "Contexts should be ordered by name");
+    ASSERT_EQ(work, ids[1], "Contexts should be ordered by name");
+    
+    task_context_map_get(&map, task2, &count);
+    ASSERT_EQ(0, count, "Task 2 should have 0 contexts");
+    task_context_map_get(&map, task3 + 100, &count);
+    ASSERT_EQ(0, count, "Unknown task should have 0 contexts");
+    
+    ASSERT_EQ(1, task_context_map_has(&map, task3, work), "Task 3 should have work context");
+    ASSERT_EQ(0, task_context_map_has(&map, task3, home), "Task 3 should not have home context");
+    
+    task_context_map_free(&map);
+    ASSERT(map.offsets == NULL && map.context_ids == NULL, "Free should reset the map");
+    
+    teardown_test_db();
+    PASS();
+}
+
 // ============================================================================
 // Recurrence tests
 // ============================================================================
@@ -386,7 +727,7 @@ TEST(test_update_task_recurrence) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(RECUR_DAILY, tasks[0].recurrence, "Recurrence should be set");
     ASSERT_EQ(1, tasks[0].recurrence_interval, "Interval should be set");
     
@@ -403,7 +744,7 @@ TEST(test_create_recurring_instance) {
     
     Task* tasks = NULL;
     int count = 0;
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     
     int new_task_id = db_create_recurring_instance(&tasks[0]);
     ASSERT(new_task_id > 0, "Should create new instance");
@@ -412,7 +753,7 @@ TEST(test_create_recurring_instance) {
     free(tasks);
     
     // Load all tasks again
-    db_load_tasks(&tasks, &count, -1);
+    db_load_tasks(&tasks, &count, -1, &strings);
     ASSERT_EQ(2, count, "Should have 2 tasks now");
     
     free(tasks);
@@ -439,6 +780,10 @@ TEST(test_add_dependency) {
     ASSERT_EQ(1, dep_count, "Should have 1 dependency");
     ASSERT_EQ(task1_id, deps[0], "Dependency should match");
     
+    Task task;
+    ASSERT_EQ(0, db_get_task(task2_id, &task, &strings), "Task lookup should succeed");
+    ASSERT_EQ(1, task.dependency_count, "Loaded task should carry its dependency count");
+    
     free(deps);
     teardown_test_db();
     PASS();
@@ -494,6 +839,1220 @@ TEST(test_self_dependency_fails) {
     PASS();
 }
 
+// ============================================================================
+// Availability tests
+// ============================================================================
+
+// Helper function to read a single task back from the database
+static Task load_task_by_id(int id) {
+    Task found;
+    memset(&found, 0, sizeof(found));
+    Task* tasks = NULL;
+    int count = 0;
+    if (db_load_tasks(&tasks, &count, -1, &strings) == 0) {
+        for (int i = 0; i < count; i++) {
+            if (tasks[i].id == id) {
+                found = tasks[i];
+                break;
+            }
+        }
+        free(tasks);
+    }
+    return found;
+}
+
+TEST(test_availability_tracks_dependencies) {
+    setup_test_db();
+    
+    int task1_id = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    int task2_id = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    ASSERT_EQ(1, load_task_by_id(task2_id).available, "New task should be available");
+    
+    db_add_dependency(task2_id, task1_id);
+    Task task2 = load_task_by_id(task2_id);
+    ASSERT_EQ(1, task2.blocked_by_count, "Task 2 should be blocked by one task");
+    ASSERT_EQ(0, task2.available, "Blocked task should not be available");
+    
+    db_update_task_status(task1_id, TASK_STATUS_DONE);
+    task2 = load_task_by_id(task2_id);
+    ASSERT_EQ(0, task2.blocked_by_count, "Completing the blocker should unblock");
+    ASSERT_EQ(1, task2.available, "Unblocked task should be available");
+    ASSERT_EQ(0, load_task_by_id(task1_id).available, "Done task should not be available");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_availability_tracks_sequential_projects) {
+    setup_test_db();
+    
+    int project_id = db_insert_project("Sequence", PROJECT_TYPE_SEQUENTIAL);
+    int task1_id = db_insert_task("Step 1", TASK_STATUS_ACTIVE);
+    int task2_id = db_insert_task("Step 2", TASK_STATUS_ACTIVE);
+    db_assign_task_to_project(task1_id, project_id);
+    db_assign_task_to_project(task2_id, project_id);
+    
+    ASSERT_EQ(1, load_task_by_id(task1_id).available, "First step should be available");
+    ASSERT_EQ(0, load_task_by_id(task2_id).available, "Second step should wait");
+    
+    db_update_task_status(task1_id, TASK_STATUS_DONE);
+    ASSERT_EQ(1, load_task_by_id(task2_id).available, "Second step should become available");
+    
+    db_update_task_status(task1_id, TASK_STATUS_ACTIVE);
+    ASSERT_EQ(0, load_task_by_id(task2_id).available, "Reopening step 1 should block step 2");
+    
+    db_update_project_type(project_id, PROJECT_TYPE_PARALLEL);
+    ASSERT_EQ(1, load_task_by_id(task2_id).available, "Parallel project should free all steps");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_availability_tracks_defer_dates) {
+    setup_test_db();
+    
+    time_t now = time(NULL);
+    int task_id = db_insert_task("Deferred", TASK_STATUS_INBOX);
+    
+    db_update_task_defer_at(task_id, now + 3600);
+    ASSERT_EQ(0, load_task_by_id(task_id).available, "Future defer should hide task");
+    ASSERT_EQ((int)(now + 3600), (int)db_get_next_defer_boundary(now),
+              "Next defer boundary should be the deferred task");
+    
+    db_update_task_defer_at(task_id, now - 60);
+    ASSERT_EQ(1, load_task_by_id(task_id).available, "Past defer should show task");
+    ASSERT_EQ(0, (int)db_get_next_defer_boundary(now), "No later defer boundary should remain");
+    ASSERT(db_refresh_availability(now + 1) >= 0, "Refreshing availability should succeed");
+    
+    // With nothing due, a refresh only reads, so another writer can't stall it
+    DbConfig config;
+    db_config_default(&config);
+    SamDb* other = sdb_open(TEST_DB_PATH, &config);
+    ASSERT_NOT_NULL(other, "Second connection should open");
+    ASSERT_EQ(0, sdb_begin(other), "Second connection should take the write lock");
+    int refreshed = db_refresh_availability(now + 2);
+    sdb_rollback(other);
+    sdb_close(other);
+    ASSERT_EQ(0, refreshed, "Refresh should not need the write lock");
+    
+    teardown_test_db();
+    PASS();
+}
+
+// ============================================================================
+// Perspective tests
+// ============================================================================
+
+// Helper function to count the tasks a perspective returns
+static int perspective_count(PerspectiveKind kind, const PerspectiveParams* params) {
+    Task* tasks = NULL;
+    int count = 0;
+    if (db_load_perspective(kind, params, &tasks, &count, &strings) != 0) {
+        return -1;
+    }
+    free(tasks);
+    return count;
+}
+
+TEST(test_load_perspective_builtin_views) {
+    setup_test_db();
+    
+    time_t now = time(NULL);
+    int inbox_id = db_insert_task("Inbox task", TASK_STATUS_INBOX);
+    int flagged_id = db_insert_task("Flagged task", TASK_STATUS_INBOX);
+    int deferred_id = db_insert_task("Deferred task", TASK_STATUS_INBOX);
+    int done_id = db_insert_task("Done task", TASK_STATUS_INBOX);
+    int due_id = db_insert_task("Due next week", TASK_STATUS_INBOX);
+    (void)inbox_id;
+    db_update_task_flagged(flagged_id, 1);
+    db_update_task_defer_at(deferred_id, now + 3600);
+    db_update_task_status(done_id, TASK_STATUS_DONE);
+    db_update_task_due_at(due_id, now + 7 * 24 * 3600);
+    
+    PerspectiveParams params = {0};
+    params.now = now;
+    params.end_of_today = now + 60;
+    params.review_before = now - 7 * 24 * 3600;
+    
+    ASSERT_EQ(3, perspective_count(PERSPECTIVE_INBOX, &params), "Inbox should hide done and deferred tasks");
+    ASSERT_EQ(1, perspective_count(PERSPECTIVE_FLAGGED, &params), "Flagged should return the flagged task");
+    ASSERT_EQ(1, perspective_count(PERSPECTIVE_COMPLETED, &params), "Completed should return the done task");
+    ASSERT_EQ(3, perspective_count(PERSPECTIVE_ANYTIME, &params), "Anytime should return available tasks");
+    ASSERT_EQ(2, perspective_count(PERSPECTIVE_TODAY, &params), "Today should skip tasks due later");
+    ASSERT_EQ(0, perspective_count(PERSPECTIVE_REVIEW, &params), "Fresh tasks should not need review");
+    
+    params.review_before = now + 60;
+    ASSERT_EQ(4, perspective_count(PERSPECTIVE_REVIEW, &params), "Review should return open stale tasks");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_load_perspective_project) {
+    setup_test_db();
+    
+    int project_id = db_insert_project("Sequence", PROJECT_TYPE_SEQUENTIAL);
+    int task1_id = db_insert_task("Step 1", TASK_STATUS_ACTIVE);
+    int task2_id = db_insert_task("Step 2", TASK_STATUS_ACTIVE);
+    db_assign_task_to_project(task1_id, project_id);
+    db_assign_task_to_project(task2_id, project_id);
+    
+    PerspectiveParams params = {0};
+    params.now = time(NULL);
+    params.project_id = project_id;
+    
+    Task* tasks = NULL;
+    int count = 0;
+    ASSERT_EQ(0, db_load_perspective(PERSPECTIVE_PROJECT, &params, &tasks, &count, &strings), "Project load should succeed");
+    ASSERT_EQ(1, count, "Sequential project should show only its first task");
+    ASSERT_EQ(task1_id, tasks[0].id, "First task should be shown");
+    free(tasks);
+    
+    db_update_project_type(project_id, PROJECT_TYPE_PARALLEL);
+    ASSERT_EQ(2, perspective_count(PERSPECTIVE_PROJECT, &params), "Parallel project should show every task");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_load_perspective_context_filter) {
+    setup_test_db();
+    
+    int both_id = db_insert_task("Both contexts", TASK_STATUS_INBOX);
+    int work_id = db_insert_task("Work only", TASK_STATUS_INBOX);
+    db_insert_task("No contexts", TASK_STATUS_INBOX);
+    int work = db_insert_context("work", "#FF0000");
+    int phone = db_insert_context("phone", "#00FF00");
+    db_add_context_to_task(both_id, work);
+    db_add_context_to_task(both_id, phone);
+    db_add_context_to_task(work_id, work);
+    
+    PerspectiveParams params = {0};
+    params.now = time(NULL);
+    int ids[2] = {work, phone};
+    
+    params.context_ids = &phone;
+    params.context_count = 1;
+    ASSERT_EQ(1, perspective_count(PERSPECTIVE_INBOX, &params), "Single context should filter");
+    
+    params.context_ids = ids;
+    params.context_count = 2;
+    params.context_match = CONTEXT_MATCH_ANY;
+    ASSERT_EQ(2, perspective_count(PERSPECTIVE_INBOX, &params), "OR filter should match either context");
+    
+    params.context_match = CONTEXT_MATCH_ALL;
+    Task* tasks = NULL;
+    int count = 0;
+    ASSERT_EQ(0, db_load_perspective(PERSPECTIVE_INBOX, &params, &tasks, &count, &strings), "AND filter should load");
+    ASSERT_EQ(1, count, "AND filter should require both contexts");
+    ASSERT_EQ(both_id, tasks[0].id, "AND filter should return the task with both contexts");
+    free(tasks);
+    
+    int repeated[3] = {work, phone, work};
+    params.context_ids = repeated;
+    params.context_count = 3;
+    ASSERT_EQ(1, perspective_count(PERSPECTIVE_INBOX, &params), "AND filter should ignore repeated IDs");
+    
+    teardown_test_db();
+    PASS();
+}
+
+// ============================================================================
+// Batch operation tests
+// ============================================================================
+
+TEST(test_batch_update_status_spawns_recurring) {
+    setup_test_db();
+    
+    int ids[4];
+    ids[0] = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    ids[1] = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    ids[2] = db_insert_task("Daily", TASK_STATUS_INBOX);
+    db_update_task_recurrence(ids[2], RECUR_DAILY, 1);
+    
+    // Deleted elsewhere while still selected
+    ids[3] = db_insert_task("Gone", TASK_STATUS_INBOX);
+    db_delete_task(ids[3]);
+    
+    int result = db_update_tasks_status(ids, 4, TASK_STATUS_DONE);
+    ASSERT_EQ(0, result, "Batch status update should skip the deleted task");
+    
+    Task* tasks = NULL;
+    int count = 0;
+    db_load_tasks(&tasks, &count, TASK_STATUS_DONE, &strings);
+    ASSERT_EQ(3, count, "All three tasks should be done");
+    free(tasks);
+    
+    db_load_tasks(&tasks, &count, TASK_STATUS_INBOX, &strings);
+    ASSERT_EQ(1, count, "Recurring task should spawn one new instance");
+    ASSERT_STR_EQ("Daily", tasks[0].title, "Spawned instance should copy the title");
+    free(tasks);
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_batch_delete_and_flag) {
+    setup_test_db();
+    
+    int ids[3];
+    ids[0] = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    ids[1] = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    ids[2] = db_insert_task("Task 3", TASK_STATUS_INBOX);
+    
+    ASSERT_EQ(0, db_set_tasks_flagged(ids, 2, 1), "Batch flag should succeed");
+    Task task;
+    ASSERT_EQ(0, db_get_task(ids[1], &task, &strings), "Task lookup should succeed");
+    ASSERT_EQ(1, task.flagged, "Task 2 should be flagged");
+    ASSERT_EQ(0, db_get_task(ids[2], &task, &strings), "Task lookup should succeed");
+    ASSERT_EQ(0, task.flagged, "Task 3 should not be flagged");
+    
+    ASSERT_EQ(0, db_delete_tasks(ids, 2), "Batch delete should succeed");
+    Task* tasks = NULL;
+    int count = 0;
+    db_load_tasks(&tasks, &count, -1, &strings);
+    ASSERT_EQ(1, count, "Only one task should remain");
+    ASSERT_EQ(ids[2], tasks[0].id, "Unselected task should remain");
+    free(tasks);
+    ASSERT_EQ(-1, db_get_task(ids[0], &task, &strings), "Deleted task should not be found");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_batch_joins_caller_transaction) {
+    setup_test_db();
+    
+    int ids[2];
+    ids[0] = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    ids[1] = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    
+    ASSERT_EQ(0, db_begin(), "Begin should succeed");
+    ASSERT_EQ(0, db_delete_tasks(ids, 2), "Batch delete should succeed");
+    ASSERT_EQ(0, db_rollback(), "Rollback should succeed");
+    
+    Task* tasks = NULL;
+    int count = 0;
+    db_load_tasks(&tasks, &count, -1, &strings);
+    ASSERT_EQ(2, count, "Rollback should undo the batch");
+    free(tasks);
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_insert_task_full) {
+    setup_test_db();
+    
+    int work_id = db_insert_context("@work", "#ff0000");
+    
+    TaskDraft draft = {0};
+    draft.title = "Call Bob";
+    draft.status = TASK_STATUS_INBOX;
+    draft.flagged = 1;
+    draft.defer_at = 1700000000;
+    draft.due_at = 1800000000;
+    draft.context_names[draft.context_count++] = "@work";
+    draft.context_names[draft.context_count++] = "@phone";
+    
+    int task_id = db_insert_task_full(&draft);
+    ASSERT(task_id > 0, "Draft insert should return a task id");
+    
+    Task task;
+    ASSERT_EQ(0, db_get_task(task_id, &task, &strings), "Task should exist");
+    ASSERT_STR_EQ("Call Bob", task.title, "Title should match");
+    ASSERT_EQ(1, task.flagged, "Task should be flagged");
+    ASSERT_EQ(1700000000, (int)task.defer_at, "Defer date should be set");
+    ASSERT_EQ(1800000000, (int)task.due_at, "Due date should be set");
+    
+    Context* contexts = NULL;
+    int count = 0;
+    db_load_contexts(&contexts, &count, &strings);
+    ASSERT_EQ(2, count, "Missing context should be created, existing one reused");
+    free(contexts);
+    
+    Context* linked = NULL;
+    int link_count = 0;
+    db_get_task_contexts(task_id, &linked, &link_count, &strings);
+    ASSERT_EQ(2, link_count, "Task should be linked to both contexts");
+    ASSERT(linked[0].id == work_id || linked[1].id == work_id,
+           "Existing context should be linked");
+    free(linked);
+    
+    TaskDraft empty = {0};
+    ASSERT_EQ(-1, db_insert_task_full(&empty), "Draft without a title should fail");
+    
+    teardown_test_db();
+    PASS();
+}
+
+// ============================================================================
+// Background writer tests
+// ============================================================================
+
+typedef struct {
+    int completed;
+    int failed;
+    int last_id;
+} WriteCounts;
+
+static void count_write(const DbWriteResult* result, void* user_data) {
+    WriteCounts* counts = user_data;
+    counts->completed++;
+    counts->last_id = result->id;
+    if (result->result != 0) {
+        counts->failed++;
+    }
+}
+
+TEST(test_writer_applies_queued_writes) {
+    setup_test_db();
+    
+    int task1_id = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    int task2_id = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    
+    WriteCounts counts = {0, 0, 0};
+    ASSERT_EQ(0, db_writer_start(TEST_DB_PATH, count_write, &counts), "Writer should start");
+    
+    db_writer_set_task_title(task1_id, "Renamed");
+    db_writer_set_task_flagged(task1_id, 1);
+    db_writer_set_task_flagged(task1_id, 0);
+    db_writer_set_task_flagged(task1_id, 1);
+    db_writer_delete_task(task2_id);
+    db_writer_assign_task_to_project(task1_id, 999);
+    db_writer_flush();
+    
+    ASSERT_EQ(6, counts.completed, "Every write should report completion");
+    ASSERT_EQ(1, counts.failed, "Assigning a missing project should fail");
+    
+    Task task;
+    ASSERT_EQ(0, db_get_task(task1_id, &task, &strings), "Task should exist");
+    ASSERT_STR_EQ("Renamed", task.title, "Title should be written");
+    ASSERT_EQ(1, task.flagged, "Last flag write should win");
+    ASSERT_EQ(0, task.project_id, "Failed write should not apply");
+    ASSERT_EQ(-1, db_get_task(task2_id, &task, &strings), "Deleted task should be gone");
+    
+    db_writer_stop();
+    ASSERT_EQ(0, db_writer_is_running(), "Writer should stop");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_writer_applies_batch_writes) {
+    setup_test_db();
+    
+    int task1_id = db_insert_task("Task 1", TASK_STATUS_INBOX);
+    int task2_id = db_insert_task("Task 2", TASK_STATUS_INBOX);
+    int task3_id = db_insert_task("Task 3", TASK_STATUS_INBOX);
+    db_update_task_recurrence(task1_id, RECUR_DAILY, 1);
+    
+    WriteCounts counts = {0, 0, 0};
+    ASSERT_EQ(0, db_writer_start(TEST_DB_PATH, count_write, &counts), "Writer should start");
+    
+    // Copies are queued, so the caller's draft and IDs can go at once
+    {
+        char title[16];
+        snprintf(title, sizeof(title), "%s", "Captured");
+        TaskDraft draft = {0};
+        draft.title = title;
+        draft.status = TASK_STATUS_INBOX;
+        draft.context_names[draft.context_count++] = "errands";
+        ASSERT_EQ(0, db_writer_insert_task(&draft), "Insert should queue");
+        title[0] = '\0';
+    }
+    db_writer_flush();
+    int inserted_id = counts.last_id;
+    ASSERT(inserted_id > task3_id, "Insert should report the new task's ID");
+    
+    int ids[2] = {task1_id, task2_id};
+    ASSERT_EQ(0, db_writer_set_tasks_flagged(ids, 2, 1), "Batch flag should queue");
+    ASSERT_EQ(0, db_writer_set_tasks_status(ids, 2, TASK_STATUS_DONE), "Batch status should queue");
+    ids[0] = task3_id;
+    ASSERT_EQ(0, db_writer_add_dependency(task2_id, task3_id), "Dependency add should queue");
+    ASSERT_EQ(0, db_writer_add_dependency(task3_id, task3_id), "Dependency add should queue");
+    ASSERT_EQ(0, db_writer_remove_dependency(task2_id, task3_id), "Dependency removal should queue");
+    ASSERT_EQ(0, db_writer_delete_tasks(&inserted_id, 1), "Batch delete should queue");
+    ASSERT_EQ(0, db_writer_refresh_availability(time(NULL)), "Availability refresh should queue");
+    db_writer_flush();
+    
+    ASSERT_EQ(8, counts.completed, "Every write should report completion");
+    ASSERT_EQ(1, counts.failed, "A self-dependency should fail");
+    
+    Task task;
+    ASSERT_EQ(0, db_get_task(task1_id, &task, &strings), "Task should exist");
+    ASSERT_EQ(1, task.flagged, "IDs should be copied on submit");
+    ASSERT_EQ(0, db_get_task(task2_id, &task, &strings), "Task should exist");
+    ASSERT_EQ(1, task.flagged, "Batch flag should be written");
+    ASSERT_EQ(TASK_STATUS_DONE, task.status, "Batch status should be written");
+    ASSERT_EQ(0, task.dependency_count, "Removed dependency should be gone");
+    ASSERT_EQ(-1, db_get_task(inserted_id, &task, &strings), "Batch delete should be written");
+    
+    Task* inbox = NULL;
+    int inbox_count = 0;
+    ASSERT_EQ(0, db_load_tasks(&inbox, &inbox_count, TASK_STATUS_INBOX, &strings), "Inbox should load");
+    int spawned = 0;
+    for (int i = 0; i < inbox_count; i++) {
+        if (strcmp(inbox[i].title, "Task 1") == 0) {
+            spawned++;
+        }
+    }
+    free(inbox);
+    ASSERT_EQ(1, spawned, "Completing a recurring task should spawn its next instance");
+    
+    db_writer_stop();
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_writer_rolls_back_failed_writes) {
+    setup_test_db();
+    
+    int task_id = db_insert_task("Task", TASK_STATUS_INBOX);
+    
+    // Make linking a context fail after the task and context are inserted
+    sqlite3* conn = NULL;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(TEST_DB_PATH, &conn), "Side connection should open");
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(conn,
+        "CREATE TRIGGER refuse_links BEFORE INSERT ON task_contexts "
+        "BEGIN SELECT RAISE(ABORT, 'links refused'); END;", NULL, NULL, NULL),
+        "Trigger should be created");
+    sqlite3_close(conn);
+    
+    WriteCounts counts = {0, 0, 0};
+    ASSERT_EQ(0, db_writer_start(TEST_DB_PATH, count_write, &counts), "Writer should start");
+    
+    TaskDraft draft = {0};
+    draft.title = "Linked";
+    draft.status = TASK_STATUS_INBOX;
+    draft.context_names[draft.context_count++] = "errands";
+    db_writer_insert_task(&draft);
+    db_writer_set_task_flagged(task_id, 1);
+    db_writer_flush();
+    db_writer_stop();
+    
+    ASSERT_EQ(2, counts.completed, "Every write should report completion");
+    ASSERT_EQ(1, counts.failed, "The insert should fail");
+    
+    Task task;
+    ASSERT_EQ(0, db_get_task(task_id, &task, &strings), "Task should exist");
+    ASSERT_EQ(1, task.flagged, "Writes after a failed one should persist");
+    
+    Task* tasks = NULL;
+    int task_count = 0;
+    ASSERT_EQ(0, db_load_tasks(&tasks, &task_count, -1, &strings), "Tasks should load");
+    free(tasks);
+    ASSERT_EQ(1, task_count, "A failed insert should leave no task behind");
+    
+    Context* contexts = NULL;
+    int context_count = 0;
+    ASSERT_EQ(0, db_load_contexts(&contexts, &context_count, &strings), "Contexts should load");
+    free(contexts);
+    ASSERT_EQ(0, context_count, "A failed insert should leave no context behind");
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_writer_without_thread_writes_synchronously) {
+    setup_test_db();
+    
+    int task_id = db_insert_task("Task", TASK_STATUS_INBOX);
+    
+    DbWrite write = {0};
+    WriteCounts counts = {0, 0, 0};
+    write.kind = DB_WRITE_TASK_STATUS;
+    write.id = task_id;
+    write.value = TASK_STATUS_DONE;
+    write.callback = count_write;
+    write.user_data = &counts;
+    
+    ASSERT_EQ(0, db_writer_submit(&write), "Submit should succeed");
+    ASSERT_EQ(1, counts.completed, "Callback should run immediately");
+    
+    Task task;
+    db_get_task(task_id, &task, &strings);
+    ASSERT_EQ(TASK_STATUS_DONE, task.status, "Status should be written");
+    
+    ASSERT_EQ(-1, db_writer_set_task_title(task_id, ""), "Empty title should be rejected");
+    ASSERT_EQ(-1, db_writer_insert_context(""), "Empty context name should be rejected");
+    
+    write.kind = DB_WRITE_PROJECT_INSERT;
+    write.id = 0;
+    write.text = "Project";
+    write.value = PROJECT_TYPE_PARALLEL;
+    ASSERT_EQ(0, db_writer_submit(&write), "Project insert should apply");
+    ASSERT(counts.last_id > 0, "Project insert should report the new ID");
+    
+    Project* projects = NULL;
+    int project_count = 0;
+    db_load_projects(&projects, &project_count, &strings);
+    free(projects);
+    ASSERT_EQ(1, project_count, "Inserted project should be stored");
+    
+    teardown_test_db();
+    PASS();
+}
+
+static void count_notify(void* user_data) {
+    atomic_fetch_add((atomic_int*)user_data, 1);
+}
+
+TEST(test_writer_notifies_after_batches) {
+    setup_test_db();
+    
+    int task_id = db_insert_task("Task", TASK_STATUS_INBOX);
+    atomic_int notified;
+    atomic_init(&notified, 0);
+    
+    db_writer_set_notify(count_notify, &notified);
+    ASSERT_EQ(0, db_writer_start(TEST_DB_PATH, NULL, NULL), "Writer should start");
+    db_writer_set_task_flagged(task_id, 1);
+    db_writer_flush();
+    ASSERT(atomic_load(&notified) >= 1, "Writer should notify once completions are queued");
+    
+    db_writer_stop();
+    db_writer_set_notify(NULL, NULL);
+    
+    teardown_test_db();
+    PASS();
+}
+
+// ============================================================================
+// Change detection tests
+// ============================================================================
+
+TEST(test_change_detection_sees_other_connections) {
+    setup_test_db();
+    time_t start = time(NULL);
+    
+    int kept = db_insert_task("Kept", TASK_STATUS_INBOX);
+    int edited = db_insert_task("Edited", TASK_STATUS_INBOX);
+    int removed = db_insert_task("Removed", TASK_STATUS_INBOX);
+    
+    long long sync_point;
+    ASSERT_EQ(0, db_get_change_seq(&sync_point), "Change sequence should be readable");
+    
+    long long before, after;
+    ASSERT_EQ(0, db_get_data_version(&before), "Data version should be readable");
+    db_update_task_flagged(kept, 1);
+    db_get_data_version(&after);
+    ASSERT(before == after, "Own writes should not change the data version");
+    
+    SamDb* other = sdb_open(TEST_DB_PATH, NULL);
+    ASSERT_NOT_NULL(other, "Second connection should open");
+    sdb_update_task_title(other, edited, "Edited elsewhere");
+    sdb_delete_task(other, removed);
+    sdb_close(other);
+    
+    db_get_data_version(&after);
+    ASSERT(before != after, "Another connection's commit should change the data version");
+    
+    TaskChanges changes;
+    ASSERT_EQ(0, db_load_tasks_changed_since(sync_point, &changes, &strings), "Delta load should succeed");
+    ASSERT_EQ(2, changes.task_count, "Both edited tasks should be returned");
+    ASSERT_EQ(kept, changes.tasks[0].id, "Changes should come back in order");
+    ASSERT_STR_EQ("Edited elsewhere", changes.tasks[1].title, "Delta should carry the edit");
+    ASSERT(changes.tasks[1].modified_at >= start, "Edits should stamp modified_at");
+    ASSERT_EQ(1, changes.deleted_count, "One task was deleted");
+    ASSERT_EQ(removed, changes.deleted_ids[0], "Tombstone should name the deleted task");
+    ASSERT_EQ(0, changes.expired, "Nothing should have expired");
+    
+    sync_point = changes.seq;
+    db_free_task_changes(&changes);
+    ASSERT_EQ(0, db_load_tasks_changed_since(sync_point, &changes, &strings), "Empty delta should succeed");
+    ASSERT_EQ(0, changes.task_count + changes.deleted_count, "Nothing changed after the sync point");
+    db_free_task_changes(&changes);
+    
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_change_seq_covers_derived_and_linked_changes) {
+    setup_test_db();
+    
+    int project_id = db_insert_project("Sequence", PROJECT_TYPE_SEQUENTIAL);
+    int head = db_insert_task("Head", TASK_STATUS_INBOX);
+    int next = db_insert_task("Next", TASK_STATUS_INBOX);
+    int other = db_insert_task("Other", TASK_STATUS_INBOX);
+    db_assign_task_to_project(head, project_id);
+    db_assign_task_to_project(next, project_id);
+    int context_id = db_insert_context("home", "#FF0000");
+    
+    long long sync_point;
+    db_get_change_seq(&sync_point);
+    
+    // Writing back the same value is not a change
+    db_update_task_title(other, "Other");
+    TaskChanges changes;
+    db_load_tasks_changed_since(sync_point, &changes, &strings);
+    ASSERT_EQ(0, changes.task_count, "No-op update should not be a change");
+    db_free_task_changes(&changes);
+    
+    // Completing the head makes the next task available through a trigger
+    db_update_task_status(head, TASK_STATUS_DONE);
+    db_load_tasks_changed_since(sync_point, &changes, &strings);
+    ASSERT_EQ(2, changes.task_count, "Derived availability should count as a change");
+    ASSERT_EQ(next, changes.tasks[1].id, "Re-derived row should come last");
+    ASSERT_EQ(1, changes.tasks[1].available, "Delta should carry the new availability");
+    sync_point = changes.seq;
+    db_free_task_changes(&changes);
+    
+    // Link tables touch the task they belong to
+    db_add_context_to_task(other, context_id);
+    db_load_tasks_changed_since(sync_point, &changes, &strings);
+    ASSERT_EQ(1, changes.task_count, "Context link should count as a change");
+    ASSERT_EQ(other, changes.tasks[0].id, "Linked task should be returned");
+    sync_point = changes.seq;
+    db_free_task_changes(&changes);
+    
+    db_add_dependency(other, next);
+    db_load_tasks_changed_since(sync_point, &changes, &strings);
+    ASSERT_EQ(1, changes.task_count, "Dependency should count as a change once");
+    ASSERT_EQ(0, changes.tasks[0].available, "Dependent task should be blocked");
+    db_free_task_changes(&changes);
+    
+    teardown_test_db();
+    PASS();
+}
+
+// ============================================================================
+// String storage tests
+// ============================================================================
+
+TEST(test_string_arena_interns_and_resets) {
+    StringArena arena;
+    string_arena_init(&arena);
+    
+    const char* home = string_arena_intern(&arena, "home", 4);
+    ASSERT_NOT_NULL(home, "Intern should succeed");
+    ASSERT_STR_EQ("home", home, "Interned text should match");
+    ASSERT(home == string_arena_intern(&arena, "homework", 4),
+           "Same text should return the same pointer");
+    ASSERT(home != string_arena_intern(&arena, "work", 4), "Different text should not be shared");
+    ASSERT_EQ(2, (int)arena.string_count, "Two distinct strings should be held");
+    ASSERT_EQ(10, (int)arena.bytes, "Bytes should match the text held");
+    
+    // Enough strings to span several chunks and intern table resizes
+    char text[32];
+    const char* first = NULL;
+    for (int i = 0; i < 5000; i++) {
+        snprintf(text, sizeof(text), "string %d", i);
+        const char* copy = string_arena_intern(&arena, text, strlen(text));
+        ASSERT_NOT_NULL(copy, "Intern should succeed");
+        if (i == 0) {
+            first = copy;
+        }
+    }
+    ASSERT_STR_EQ("string 0", first, "Earlier strings should not move");
+    ASSERT(first == string_arena_intern(&arena, "string 0", 8), "Lookup should survive resizes");
+    ASSERT_STR_EQ("home", home, "Earlier strings should not move");
+    
+    string_arena_reset(&arena);
+    ASSERT_EQ(0, (int)arena.string_count, "Reset should drop every string");
+    ASSERT_EQ(0, (int)arena.bytes, "Reset should drop every byte");
+    ASSERT_STR_EQ("again", string_arena_intern(&arena, "again", 5), "Arena should be reusable");
+    
+    string_arena_free(&arena);
+    PASS();
+}
+
+TEST(test_loaded_strings_are_not_truncated) {
+    setup_test_db();
+    
+    char long_title[600];
+    memset(long_title, 't', sizeof(long_title) - 1);
+    long_title[sizeof(long_title) - 1] = '\0';
+    char long_name[100];
+    memset(long_name, 'c', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    
+    db_insert_task(long_title, TASK_STATUS_INBOX);
+    db_insert_project(long_title, PROJECT_TYPE_PARALLEL);
+    db_insert_context(long_name, "#FF0000");
+    db_insert_context("@home", "#FF0000");
+    
+    Task* tasks = NULL;
+    int task_count = 0;
+    ASSERT_EQ(0, db_load_tasks(&tasks, &task_count, -1, &strings), "Task load should succeed");
+    ASSERT_STR_EQ(long_title, tasks[0].title, "Task title should load in full");
+    
+    Project* projects = NULL;
+    int project_count = 0;
+    ASSERT_EQ(0, db_load_projects(&projects, &project_count, &strings), "Project load should succeed");
+    ASSERT(projects[0].title == tasks[0].title, "Repeated text should be stored once");
+    
+    Context* contexts = NULL;
+    int context_count = 0;
+    ASSERT_EQ(0, db_load_contexts(&contexts, &context_count, &strings), "Context load should succeed");
+    ASSERT_EQ(2, context_count, "Should load both contexts");
+    ASSERT_STR_EQ("@home", contexts[0].name, "Contexts should be ordered by name");
+    ASSERT_STR_EQ(long_name, contexts[1].name, "Context name should load in full");
+    ASSERT(contexts[0].color == contexts[1].color, "Shared colors should be interned");
+    
+    // Memory follows the text actually stored
+    ASSERT_EQ((int)(sizeof(long_title) + sizeof(long_name) + strlen("@home") + 1 + strlen("#FF0000") + 1),
+              (int)strings.bytes, "Arena should hold each distinct string once");
+    
+    free(tasks);
+    free(projects);
+    free(contexts);
+    teardown_test_db();
+    PASS();
+}
+
+// ============================================================================
+// Task table tests
+// ============================================================================
+
+TEST(test_task_table_selects_rows) {
+    TaskTable table;
+    task_table_init(&table);
+    
+    // More than two blocks, so the kernels cover a partial last block
+    Task task;
+    memset(&task, 0, sizeof(Task));
+    for (int id = 1; id <= 150; id++) {
+        task.id = id;
+        task.status = id % 3 == 0 ? TASK_STATUS_DONE : TASK_STATUS_INBOX;
+        task.flagged = id % 5 == 0;
+        task.project_id = id % 4;
+        task.defer_at = id * 10;
+        task.due_at = id % 2 == 0 ? 0 : id;
+        task.modified_at = id;
+        task.available = id % 7 != 0;
+        ASSERT_EQ(0, task_table_put(&table, &task), "Put should succeed");
+    }
+    ASSERT_EQ(150, table.count, "Table should hold every task");
+    
+    uint64_t rows[TASK_SELECTION_WORDS(150)];
+    uint64_t scratch[TASK_SELECTION_WORDS(150)];
+    int words = TASK_SELECTION_WORDS(table.count);
+    ASSERT_EQ(3, words, "150 rows should take three words");
+    
+    task_select_status(&table, TASK_STATUS_DONE, rows);
+    ASSERT_EQ(50, task_selection_count(rows, words), "Every third task is done");
+    task_select_project(&table, 2, rows);
+    ASSERT_EQ(38, task_selection_count(rows, words), "Project 2 should hold 38 tasks");
+    task_select_deferred_until(&table, 500, rows);
+    ASSERT_EQ(50, task_selection_count(rows, words), "Fifty tasks are deferred up to 500");
+    task_select_modified_between(&table, 10, 21, rows);
+    ASSERT_EQ(10, task_selection_count(rows, words), "Ten tasks were modified in (10, 21)");
+    
+    // Open, flagged tasks
+    task_select_flagged(&table, rows);
+    task_select_status(&table, TASK_STATUS_DONE, scratch);
+    task_selection_and_not(rows, scratch, words);
+    ASSERT_EQ(20, task_selection_count(rows, words), "Twenty flagged tasks are open");
+    
+    // Available tasks with no due date or due by 99
+    task_select_available(&table, rows);
+    task_select_due_by(&table, 99, scratch);
+    task_selection_and(rows, scratch, words);
+    int expected = 0;
+    for (int id = 1; id <= 150; id++) {
+        expected += id % 7 != 0 && (id % 2 == 0 || id <= 99);
+    }
+    ASSERT_EQ(expected, task_selection_count(rows, words), "AND should match a plain scan");
+    
+    // Walking a selection visits its rows in order
+    task_select_project(&table, 0, rows);
+    int visited = 0;
+    int row = task_selection_next(rows, words, 0);
+    while (row >= 0) {
+        ASSERT_EQ(0, table.ids[row] % 4, "Only project 0 rows should be visited");
+        visited++;
+        row = task_selection_next(rows, words, row + 1);
+    }
+    ASSERT_EQ(37, visited, "Every selected row should be visited");
+    
+    // Removing moves the last row into the hole
+    task_table_remove(&table, 1);
+    ASSERT_EQ(149, table.count, "Removed task should leave the table");
+    ASSERT_EQ(-1, task_table_find(&table, 1), "Removed task should not be found");
+    ASSERT_EQ(150, table.ids[task_table_find(&table, 150)], "Moved row should be reindexed");
+    task_select_project(&table, 1, rows);
+    ASSERT_EQ(37, task_selection_count(rows, TASK_SELECTION_WORDS(table.count)),
+              "Counts should follow the removal");
+    
+    task_table_free(&table);
+    PASS();
+}
+
+TEST(test_sync_task_table_applies_changes) {
+    setup_test_db();
+    
+    int kept = db_insert_task("Kept", TASK_STATUS_INBOX);
+    int deleted = db_insert_task("Deleted", TASK_STATUS_INBOX);
+    int flagged = db_insert_task("Flagged", TASK_STATUS_INBOX);
+    
+    TaskTable table;
+    task_table_init(&table);
+    ASSERT_EQ(0, db_sync_task_table(&table), "First sync should load every task");
+    ASSERT_EQ(3, table.count, "Table should hold every task");
+    ASSERT(table.seq > 0, "Table should record its sync point");
+    
+    // Changes from another connection are read as a delta
+    SamDb* other = sdb_open(TEST_DB_PATH, NULL);
+    ASSERT_NOT_NULL(other, "Second connection should open");
+    sdb_update_task_flagged(other, flagged, 1);
+    sdb_delete_task(other, deleted);
+    int added = sdb_insert_task(other, "Added", TASK_STATUS_INBOX);
+    sdb_close(other);
+    
+    long long seq_before = table.seq;
+    ASSERT_EQ(0, db_sync_task_table(&table), "Second sync should succeed");
+    ASSERT(table.seq > seq_before, "Sync point should move forward");
+    ASSERT_EQ(3, table.count, "One task left and one arrived");
+    ASSERT_EQ(-1, task_table_find(&table, deleted), "Deleted task should be gone");
+    ASSERT(task_table_find(&table, added) >= 0, "Added task should be present");
+    ASSERT(task_table_find(&table, kept) >= 0, "Untouched task should stay");
+    ASSERT_EQ(1, table.flagged[task_table_find(&table, flagged)], "Flag should be applied");
+    
+    // Nothing changed: nothing to do
+    ASSERT_EQ(0, db_sync_task_table(&table), "Idle sync should succeed");
+    ASSERT_EQ(3, table.count, "Idle sync should change nothing");
+    
+    task_table_free(&table);
+    teardown_test_db();
+    PASS();
+}
+
+TEST(test_id_bitmap_set_operations) {
+    IdBitmap evens;
+    IdBitmap threes;
+    id_bitmap_init(&evens);
+    id_bitmap_init(&threes);
+    
+    // Spans several containers; the first ones fill past the array limit
+    for (int id = 0; id < 200000; id += 2) {
+        ASSERT_EQ(0, id_bitmap_add(&evens, id), "Add should succeed");
+    }
+    for (int id = 0; id < 200000; id += 3) {
+        id_bitmap_add(&threes, id);
+    }
+    id_bitmap_add(&threes, 3);  // Already there
+    ASSERT_EQ(100000, evens.count, "Every even ID should be held once");
+    ASSERT_EQ(66667, threes.count, "Re-adding should not count twice");
+    ASSERT_EQ(4, evens.container_count, "IDs should be grouped by their high bits");
+    ASSERT_EQ(1, id_bitmap_contains(&evens, 131072), "Even ID should be found");
+    ASSERT_EQ(0, id_bitmap_contains(&evens, 131073), "Odd ID should not be found");
+    ASSERT_EQ(-1, id_bitmap_add(&evens, -1), "Negative IDs should be refused");
+    
+    // Bitmap containers against each other
+    ASSERT_EQ(33334, id_bitmap_and_count(&evens, &threes), "Multiples of six should intersect");
+    
+    // A sparse set against dense ones, and two sparse sets
+    IdBitmap sparse;
+    IdBitmap other_sparse;
+    id_bitmap_init(&sparse);
+    id_bitmap_init(&other_sparse);
+    for (int id = 0; id < 600; id++) {
+        id_bitmap_add(&sparse, id * 7);
+        id_bitmap_add(&other_sparse, id * 5);
+    }
+    int expected = 0;
+    for (int id = 0; id < 600; id++) {
+        expected += (id * 7) % 2 == 0;
+    }
+    ASSERT_EQ(expected, id_bitmap_and_count(&sparse, &evens), "Array and bitmap should intersect");
+    ASSERT_EQ(expected, id_bitmap_and_count(&evens, &sparse), "Intersection should be symmetric");
+    ASSERT_EQ(86, id_bitmap_and_count(&sparse, &other_sparse), "Multiples of 35 below 3000 should intersect");
+    
+    // Shrinking a dense container switches it back to an array
+    for (int id = 0; id < 65536; id += 2) {
+        if (id % 64 != 0) {
+            id_bitmap_remove(&evens, id);
+        }
+    }
+    id_bitmap_remove(&evens, 1);  // Not there
+    ASSERT_EQ(100000 - 32768 + 1024, evens.count, "Removed IDs should be gone");
+    ASSERT_EQ(1, id_bitmap_contains(&evens, 128), "Kept ID should still be found");
+    ASSERT_EQ(0, id_bitmap_contains(&evens, 130), "Removed ID should not be found");
+    expected = 0;
+    for (int id = 0; id < 200000; id += 3) {
+        expected += id_bitmap_contains(&evens, id);
+    }
+    ASSERT_EQ(expected, id_bitmap_and_count(&evens, &threes), "Shrunk container should still intersect");
+    
+    id_bitmap_clear(&evens);
+    ASSERT_EQ(0, evens.count, "Cleared bitmap should be empty");
+    ASSERT_EQ(0, id_bitmap_and_count(&evens, &threes), "Empty bitmap intersects nothing");
+    
+    id_bitmap_free(&evens);
+    id_bitmap_free(&threes);
+    id_bitmap_free(&sparse);
+    id_bitmap_free(&other_sparse);
+    PASS();
+}
+
+TEST(test_task_table_indexes_follow_changes) {
+    TaskTable table;
+    task_table_init(&table);
+    
+    time_t now = 1000000;
+    time_t end_of_today = now + 3600;
+    time_t review_before = now - 7 * 24 * 3600;
+    
+    Task task;
+    memset(&task, 0, sizeof(Task));
+    task.id = 1;                            // Open, flagged, in project 5
+    task.project_id = 5;
+    task.flagged = 1;
+    task.available = 1;
+    task.modified_at = now;
+    task_table_put(&table, &task);
+    task.id = 2;                            // Deferred until now + 60, in the inbox
+    task.project_id = 0;
+    task.flagged = 0;
+    task.available = 0;
+    task.defer_at = now + 60;
+    task_table_put(&table, &task);
+    task.id = 3;                            // Done, untouched for ages
+    task.status = TASK_STATUS_DONE;
+    task.defer_at = 0;
+    task.modified_at = review_before - 100;
+    task_table_put(&table, &task);
+    task.id = 4;                            // Open, untouched for ages, due tomorrow
+    task.status = TASK_STATUS_INBOX;
+    task.due_at = end_of_today + 100;
+    task_table_put(&table, &task);
+    
+    ASSERT_EQ(1, table.status_sets[TASK_STATUS_DONE].count, "One task is done");
+    ASSERT_EQ(1, table.flagged_set.count, "One task is flagged");
+    ASSERT_EQ(1, task_table_project_set(&table, 5)->count, "Project 5 holds one task");
+    ASSERT_EQ(3, task_table_project_set(&table, 0)->count, "The inbox holds three tasks");
+    ASSERT_NULL(task_table_project_set(&table, 9), "Unknown projects have no set");
+    
+    // Time-dependent sets are built on the first call
+    ASSERT_EQ(0, task_table_set_time(&table, now, end_of_today, review_before), "Build should succeed");
+    ASSERT_EQ(2, table.open_set.count, "Tasks 1 and 4 are open");
+    ASSERT_EQ(3, table.due_set.count, "Only task 4 is due after today");
+    ASSERT_EQ(1, table.stale_set.count, "Task 4 is stale, task 3 is done");
+    ASSERT_EQ(now + 60, table.next_refresh, "Task 2's defer date is the next boundary");
+    ASSERT_EQ(1, id_bitmap_and_count(&table.open_set, task_table_project_set(&table, 0)),
+              "One open inbox task");
+    
+    // Before the boundary nothing is rebuilt; puts keep the sets current
+    task.id = 5;
+    task.due_at = 0;
+    task.modified_at = now;
+    task_table_put(&table, &task);
+    ASSERT_EQ(0, task_table_set_time(&table, now + 30, end_of_today, review_before + 30),
+              "Early call should succeed");
+    ASSERT_EQ(now, table.now, "Sets should not be rebuilt before the boundary");
+    ASSERT_EQ(3, table.open_set.count, "Added task should be open");
+    
+    // Completing a task takes it out of the open and stale sets
+    task_table_get(&table, 4, &task);
+    task.status = TASK_STATUS_DONE;
+    task_table_put(&table, &task);
+    ASSERT_EQ(2, table.open_set.count, "Completed task should no longer be open");
+    ASSERT_EQ(0, table.stale_set.count, "Completed task should no longer be stale");
+    ASSERT_EQ(2, table.status_sets[TASK_STATUS_DONE].count, "Two tasks are done");
+    
+    // Past the boundary the deferred task opens up
+    ASSERT_EQ(0, task_table_set_time(&table, now + 60, end_of_today, review_before + 60),
+              "Rebuild should succeed");
+    ASSERT_EQ(3, table.open_set.count, "Deferred task should be open now");
+    
+    task_table_remove(&table, 1);
+    ASSERT_EQ(0, table.flagged_set.count, "Removed task should leave the flagged set");
+    ASSERT_EQ(0, task_table_project_set(&table, 5)->count, "Removed task should leave its project");
+    ASSERT_EQ(2, table.open_set.count, "Removed task should leave the open set");
+    
+    task_table_free(&table);
+    PASS();
+}
+
+// ============================================================================
+// Profiler tests
+// ============================================================================
+
+TEST(test_profiler_rolling_stats) {
+    profile_reset();
+    
+    for (int i = 1; i <= 100; i++) {
+        profile_frame_begin();
+        profile_add(PROFILE_SIDEBAR, (uint64_t)i * 1000000);
+        if (i % 2 == 0) {
+            profile_add(PROFILE_LOAD_TASKS, 2000000);
+        }
+        profile_count_statements(i);
+        profile_frame_end();
+    }
+    
+    ProfileStats stats;
+    ASSERT_EQ(0, profile_get_stats(PROFILE_SIDEBAR, &stats), "Sidebar should have stats");
+    ASSERT_EQ(100, stats.frames, "Every frame entered the sidebar");
+    ASSERT(stats.min == 1.0, "Min should be the fastest frame");
+    ASSERT(stats.avg == 50.5, "Avg should be the mean over the frames");
+    ASSERT(stats.p99 == 99.0, "P99 should be the 99th of 100 sorted frames");
+    
+    ASSERT_EQ(0, profile_get_stats(PROFILE_LOAD_TASKS, &stats), "Loads should have stats");
+    ASSERT_EQ(50, stats.frames, "Only frames that loaded should count");
+    ASSERT(stats.avg == 2.0, "Frames without a load should not drag the average down");
+    
+    ASSERT_EQ(-1, profile_get_stats(PROFILE_LAUNCHER, &stats), "Scopes never entered have no stats");
+    
+    ASSERT_EQ(0, profile_get_statement_stats(&stats), "Statement stats should exist");
+    ASSERT(stats.min == 1.0 && stats.p99 == 99.0, "Statements per frame should be summarized");
+    
+    profile_reset();
+    ASSERT_EQ(-1, profile_get_statement_stats(&stats), "Reset should forget every frame");
+    
+    PASS();
+}
+
+TEST(test_profiler_spans_nest_and_wrap) {
+    profile_reset();
+    
+    // Outside a frame, spans are ignored
+    profile_begin(PROFILE_SYNC);
+    profile_end(PROFILE_SYNC);
+    ASSERT_EQ(0, profile_frame_count(), "Spans outside a frame should not make one");
+    
+    profile_frame_begin();
+    profile_begin(PROFILE_SYNC);
+    profile_begin(PROFILE_LOAD_TASKS);
+    profile_end(PROFILE_LOAD_TASKS);
+    profile_end(PROFILE_SYNC);
+    profile_begin(PROFILE_SIDEBAR);  // Left open; the frame end closes it
+    profile_frame_end();
+    
+    const ProfileFrame* frame = profile_get_frame(0);
+    ASSERT(frame != NULL, "The frame should be kept");
+    ASSERT_EQ(3, frame->span_count, "Each span should be kept");
+    ASSERT_EQ(PROFILE_SYNC, frame->spans[0].scope, "Spans should be in the order they began");
+    ASSERT_EQ(0, frame->spans[0].depth, "Outer span should be at depth 0");
+    ASSERT_EQ(1, frame->spans[1].depth, "Nested span should be one deeper");
+    ASSERT_EQ(0, frame->spans[2].depth, "A span after the outer one ends is back at depth 0");
+    ASSERT(frame->spans[1].start_ns >= frame->spans[0].start_ns &&
+           frame->spans[1].duration_ns <= frame->spans[0].duration_ns,
+           "Nested span should lie within its parent");
+    ASSERT(frame->scopes_run & (1u << PROFILE_SIDEBAR), "Open spans should be closed at frame end");
+    ASSERT(frame->scope_ns[PROFILE_SYNC] <= frame->duration_ns, "Scope time should fit in the frame");
+    
+    for (int i = 0; i < PROFILE_HISTORY + 5; i++) {
+        profile_frame_begin();
+        profile_frame_end();
+    }
+    ASSERT_EQ(PROFILE_HISTORY, profile_frame_count(), "History should stop growing when full");
+    ASSERT_EQ(PROFILE_HISTORY - 1,
+              (int)(profile_get_frame(0)->number - profile_get_frame(PROFILE_HISTORY - 1)->number),
+              "Kept frames should be the newest ones");
+    ASSERT(profile_get_frame(PROFILE_HISTORY) == NULL, "Older frames should be gone");
+    
+    profile_reset();
+    PASS();
+}
+
+// ============================================================================
+// Trace tests
+// ============================================================================
+
+static const char* TEST_TRACE_PATH = "/tmp/samfocus_test_trace.json";
+
+// Whole file as a string, or NULL; the caller frees it
+static char* read_file(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    
+    char* text = (char*)malloc((size_t)size + 1);
+    if (text != NULL) {
+        size_t got = fread(text, 1, (size_t)size, fp);
+        text[got] = '\0';
+    }
+    fclose(fp);
+    return text;
+}
+
+static void trace_from_helper(void* arg) {
+    (void)arg;
+    trace_name_thread("helper");
+    uint64_t span = trace_begin();
+    trace_end(span, "helper_span");
+}
+
+TEST(test_trace_writes_chrome_json) {
+    unlink(TEST_TRACE_PATH);
+    
+    ASSERT(trace_begin() == 0, "Spans should not be timed while tracing is off");
+    ASSERT_EQ(0, trace_start(TEST_TRACE_PATH, "test"), "Tracing should start");
+    ASSERT_EQ(-1, trace_start(TEST_TRACE_PATH, "test"), "Tracing should not start twice");
+    trace_name_thread("main");
+    
+    setup_test_db();
+    ASSERT(db_insert_task("Traced", TASK_STATUS_INBOX) > 0, "Insert should succeed");
+    
+    PlatformThread helper;
+    ASSERT_EQ(0, platform_thread_start(&helper, trace_from_helper, NULL), "Helper should start");
+    platform_thread_join(helper);
+    
+    uint64_t span = trace_begin();
+    ASSERT(span != 0, "Spans should be timed while tracing");
+    trace_end(span, "odd \"name\"");
+    teardown_test_db();
+    
+    ASSERT_EQ(0, trace_stop(), "Trace should be written");
+    ASSERT(!trace_enabled(), "Tracing should be off after stopping");
+    
+    char* text = read_file(TEST_TRACE_PATH);
+    ASSERT(text != NULL, "Trace file should exist");
+    const char* opening = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    ASSERT(strncmp(text, opening, strlen(opening)) == 0,
+           "Trace should be a trace-event object");
+    ASSERT(strstr(text, "{\"name\":\"db_insert_task\",\"ph\":\"X\"") != NULL,
+           "db_* calls should be complete spans");
+    ASSERT(strstr(text, "\"name\":\"db_init_ex\"") != NULL, "Opening the database should be traced");
+    ASSERT(strstr(text, "\"args\":{\"name\":\"helper\"}") != NULL, "Threads should be named");
+    ASSERT(strstr(text, "\"name\":\"helper_span\"") != NULL, "Other threads should record spans");
+    ASSERT(strstr(text, "\"odd \\\"name\\\"\"") != NULL, "Names should be escaped");
+    ASSERT(strstr(text, "\"dropped_spans\":\"0\"}}\n") != NULL, "Trace should end the object");
+    free(text);
+    
+    unlink(TEST_TRACE_PATH);
+    PASS();
+}
+
+TEST(test_trace_flag_and_ring) {
+    unlink(TEST_TRACE_PATH);
+    
+    char* missing[] = {"samfocus", "--trace", NULL};
+    int missing_count = 2;
+    ASSERT_EQ(-1, trace_start_from_command_line(&missing_count, missing, "test"),
+              "--trace without a path should fail");
+    
+    char* args[] = {"samfocus-cli", "list", "--trace", (char*)TEST_TRACE_PATH, "--inbox", NULL};
+    int count = 5;
+    ASSERT_EQ(0, trace_start_from_command_line(&count, args, "test"), "Flag should start tracing");
+    ASSERT(trace_enabled(), "Tracing should be on");
+    ASSERT_EQ(3, count, "Flag and path should be removed");
+    ASSERT_STR_EQ("list", args[1], "Arguments before the flag should stay");
+    ASSERT_STR_EQ("--inbox", args[2], "Arguments after the flag should move up");
+    ASSERT(args[3] == NULL, "argv should stay NULL-terminated");
+    
+    // Overfill the ring: the oldest spans give way
+    for (int i = 0; i < TRACE_CAPACITY + 5; i++) {
+        trace_end(trace_begin(), "filler");
+    }
+    ASSERT_EQ(0, trace_stop(), "Trace should be written");
+    
+    char* text = read_file(TEST_TRACE_PATH);
+    ASSERT(text != NULL, "Trace file should exist");
+    ASSERT(strstr(text, "\"dropped_spans\":\"5\"") != NULL, "Overwritten spans should be counted");
+    free(text);
+    
+    unlink(TEST_TRACE_PATH);
+    PASS();
+}
+
 // ============================================================================
 // Main test runner
 // ============================================================================
@@ -504,6 +2063,15 @@ int main(void) {
     // Initialization tests
     RUN_TEST(test_db_init_creates_database);
     RUN_TEST(test_db_create_schema_succeeds);
+    RUN_TEST(test_schema_migrations_run_once);
+    RUN_TEST(test_db_init_defaults_to_wal);
+    RUN_TEST(test_db_init_ex_applies_config);
+    RUN_TEST(test_statement_cache_reuses_statements);
+    RUN_TEST(test_stmt_stats_count_statements_run);
+    RUN_TEST(test_query_stats_group_by_statement);
+    RUN_TEST(test_slow_query_log_threshold);
+    RUN_TEST(test_explain_query_names_index);
+    RUN_TEST(test_handles_are_independent);
     
     // Task CRUD tests
     RUN_TEST(test_insert_task_succeeds);
@@ -512,6 +2080,7 @@ int main(void) {
     RUN_TEST(test_update_task_status);
     RUN_TEST(test_update_task_title);
     RUN_TEST(test_update_task_notes);
+    RUN_TEST(test_task_notes_load_on_demand);
     RUN_TEST(test_update_task_flagged);
     RUN_TEST(test_update_task_defer_date);
     RUN_TEST(test_update_task_due_date);
@@ -528,6 +2097,7 @@ int main(void) {
     RUN_TEST(test_insert_context);
     RUN_TEST(test_add_context_to_task);
     RUN_TEST(test_remove_context_from_task);
+    RUN_TEST(test_load_task_context_map);
     
     // Recurrence tests
     RUN_TEST(test_update_task_recurrence);
@@ -539,6 +2109,51 @@ int main(void) {
     RUN_TEST(test_is_task_blocked);
     RUN_TEST(test_self_dependency_fails);
     
+    // Availability tests
+    RUN_TEST(test_availability_tracks_dependencies);
+    RUN_TEST(test_availability_tracks_sequential_projects);
+    RUN_TEST(test_availability_tracks_defer_dates);
+    
+    // Perspective tests
+    RUN_TEST(test_load_perspective_builtin_views);
+    RUN_TEST(test_load_perspective_project);
+    RUN_TEST(test_load_perspective_context_filter);
+    
+    // Batch operation tests
+    RUN_TEST(test_batch_update_status_spawns_recurring);
+    RUN_TEST(test_batch_delete_and_flag);
+    RUN_TEST(test_batch_joins_caller_transaction);
+    RUN_TEST(test_insert_task_full);
+    
+    // Background writer tests
+    RUN_TEST(test_writer_applies_queued_writes);
+    RUN_TEST(test_writer_applies_batch_writes);
+    RUN_TEST(test_writer_rolls_back_failed_writes);
+    RUN_TEST(test_writer_without_thread_writes_synchronously);
+    RUN_TEST(test_writer_notifies_after_batches);
+    
+    // Change detection tests
+    RUN_TEST(test_change_detection_sees_other_connections);
+    RUN_TEST(test_change_seq_covers_derived_and_linked_changes);
+    
+    // String storage tests
+    RUN_TEST(test_string_arena_interns_and_resets);
+    RUN_TEST(test_loaded_strings_are_not_truncated);
+    
+    // Task table tests
+    RUN_TEST(test_task_table_selects_rows);
+    RUN_TEST(test_sync_task_table_applies_changes);
+    RUN_TEST(test_id_bitmap_set_operations);
+    RUN_TEST(test_task_table_indexes_follow_changes);
+    
+    // Profiler tests
+    RUN_TEST(test_profiler_rolling_stats);
+    RUN_TEST(test_profiler_spans_nest_and_wrap);
+    
+    // Trace tests
+    RUN_TEST(test_trace_writes_chrome_json);
+    RUN_TEST(test_trace_flag_and_ring);
+    
     PRINT_TEST_SUMMARY();
     return TEST_EXIT_CODE();
 }